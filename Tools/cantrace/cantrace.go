@@ -0,0 +1,250 @@
+// cantrace decodes a CAN traffic capture saved by RepRapFirmware using M954 F"filename"
+// and prints the frames in CSV format, followed by a summary of the traffic.
+// The summary gives the frame and byte counts for each message type, the estimated bus utilisation overall and in the busiest window,
+// the distribution of expansion board reply times and of movement message lead times, and the longest movement message queue.
+// Bus utilisation is estimated from the frame lengths assuming worst-case bit stuffing, at the bit rates given on the command line.
+// Time sync messages are only included if they were captured using M954 T1.
+//
+// Usage: cantrace [-rate kbps] [-datarate kbps] [-window ms] capturefile
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"encoding/hex"
+	"flag"
+	"fmt"
+	"io"
+	"os"
+	"sort"
+)
+
+// fileHeader must match struct CanTrace::FileHeader in src/CAN/CanTrace.h
+type fileHeader struct {
+	Magic             [8]byte
+	Version           uint32
+	StepClockRate     uint32
+	EntrySize         uint32
+	NumEntries        uint32
+	NumRecorded       uint32
+	CapturedDataBytes uint32
+}
+
+// entry must match struct CanTrace::Entry in src/CAN/CanTrace.h
+type entry struct {
+	Time       uint32
+	Info       int32
+	MsgType    uint16
+	Src        uint8
+	Dst        uint8
+	DataLength uint8
+	Flags      uint8
+	QueueDepth uint8
+	Spare      uint8
+	Data       [16]byte
+}
+
+const (
+	flagReceived = 0x01
+	flagMotion   = 0x02
+	flagReply    = 0x04
+	flagTimeout  = 0x08
+	flagTimeSync = 0x10
+	flagUrgent   = 0x20
+)
+
+// paddedLength returns the number of data bytes actually sent in a CAN-FD frame, which is rounded up to the next valid DLC length
+func paddedLength(n int) int {
+	for _, l := range []int{0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} {
+		if n <= l {
+			return l
+		}
+	}
+	return 64
+}
+
+// frameTime returns the time in microseconds to send a CAN-FD frame with an extended ID and the specified data length.
+// The arbitration phase and the end of frame are sent at the nominal rate, and the control field, data and CRC at the data rate.
+func frameTime(dataLength int, rate, dataRate float64) float64 {
+	const nominalBits = 37 + 13 // SOF, 29-bit ID and control bits up to BRS; CRC delimiter, ACK, EOF and interframe space
+	n := paddedLength(dataLength)
+	crcBits := 17
+	if n > 16 {
+		crcBits = 21
+	}
+	dataBits := float64(1+4+4+8*n+crcBits) * 1.2 // ESI, DLC, stuff count, data, CRC plus worst-case stuff bits
+	return float64(nominalBits)*1.2*1000.0/rate + dataBits*1000.0/dataRate
+}
+
+type durations []float64
+
+func (d durations) summary() string {
+	if len(d) == 0 {
+		return "none"
+	}
+	sort.Float64s(d)
+	return fmt.Sprintf("%d, min %.2fms, median %.2fms, 99%% %.2fms, max %.2fms",
+		len(d), d[0], d[len(d)/2], d[len(d)*99/100], d[len(d)-1])
+}
+
+type typeCounts struct {
+	sent, received           int
+	bytesSent, bytesReceived int
+}
+
+func main() {
+	rate := flag.Float64("rate", 1000, "nominal bit rate in kbps")
+	dataRate := flag.Float64("datarate", 0, "data phase bit rate in kbps if bit rate switching is used, default same as nominal rate")
+	window := flag.Float64("window", 10, "window in milliseconds for measuring peak bus utilisation")
+	flag.Parse()
+	if flag.NArg() != 1 {
+		fmt.Fprintln(os.Stderr, "Usage: cantrace [-rate kbps] [-datarate kbps] [-window ms] capturefile")
+		os.Exit(1)
+	}
+	if *dataRate <= 0 {
+		*dataRate = *rate
+	}
+
+	f, err := os.Open(flag.Arg(0))
+	if err != nil {
+		panic(err)
+	}
+	defer f.Close()
+
+	var hdr fileHeader
+	if err = binary.Read(f, binary.LittleEndian, &hdr); err != nil {
+		panic(err)
+	}
+	if string(bytes.TrimRight(hdr.Magic[:], "\x00")) != "RRFCANT" {
+		fmt.Fprintln(os.Stderr, "Not a CAN capture file")
+		os.Exit(1)
+	}
+	if hdr.Version != 1 || hdr.EntrySize != uint32(binary.Size(entry{})) || hdr.CapturedDataBytes != 16 {
+		fmt.Fprintf(os.Stderr, "Unsupported file version %d or entry size %d\n", hdr.Version, hdr.EntrySize)
+		os.Exit(1)
+	}
+
+	clocksToMs := 1000.0 / float64(hdr.StepClockRate)
+	fmt.Println("frame,timeMs,direction,type,src,dst,length,infoMs,queueDepth,flags,data")
+
+	counts := make(map[uint16]*typeCounts)
+	var replyTimes, leadTimes durations
+	var busyTimes []float64  // time each frame occupied the bus, in microseconds
+	var frameTimes []float64 // when each frame was sent or received, in milliseconds
+	var firstTime uint32
+	numCaptured, numTimeouts, numLate, maxQueue := 0, 0, 0, 0
+	for i := uint32(0); i < hdr.NumEntries; i++ {
+		var e entry
+		if err = binary.Read(f, binary.LittleEndian, &e); err != nil {
+			if err == io.EOF || err == io.ErrUnexpectedEOF {
+				break
+			}
+			panic(err)
+		}
+		if e.Time == 0 && e.Flags == 0 && e.MsgType == 0 {
+			continue // padding written because the entry was overwritten while the file was being saved
+		}
+		if numCaptured == 0 {
+			firstTime = e.Time
+		}
+		numCaptured++
+		timeMs := float64(e.Time-firstTime) * clocksToMs
+
+		direction := "tx"
+		if e.Flags&flagReceived != 0 {
+			direction = "rx"
+		}
+		info := ""
+		if e.Flags&(flagMotion|flagReply|flagTimeout) != 0 {
+			info = fmt.Sprintf("%.3f", float64(e.Info)/1000.0)
+		}
+		var flags []byte
+		for _, fl := range []struct {
+			bit  uint8
+			name byte
+		}{{flagMotion, 'M'}, {flagReply, 'R'}, {flagTimeout, 'T'}, {flagTimeSync, 'S'}, {flagUrgent, 'U'}} {
+			if e.Flags&fl.bit != 0 {
+				flags = append(flags, fl.name)
+			}
+		}
+		n := int(e.DataLength)
+		if n > len(e.Data) {
+			n = len(e.Data)
+		}
+		fmt.Printf("%d,%.3f,%s,%d,%d,%d,%d,%s,%d,%s,%s\n",
+			int(hdr.NumRecorded)-int(hdr.NumEntries)+int(i), timeMs, direction, e.MsgType, e.Src, e.Dst, e.DataLength,
+			info, e.QueueDepth, flags, hex.EncodeToString(e.Data[:n]))
+
+		switch {
+		case e.Flags&flagTimeout != 0:
+			numTimeouts++
+			continue // no frame was received
+		case e.Flags&flagReply != 0:
+			replyTimes = append(replyTimes, float64(e.Info)/1000.0)
+		case e.Flags&flagMotion != 0:
+			if e.Info < 0 {
+				numLate++
+			}
+			leadTimes = append(leadTimes, float64(e.Info)/1000.0)
+			if int(e.QueueDepth) > maxQueue {
+				maxQueue = int(e.QueueDepth)
+			}
+		}
+
+		tc := counts[e.MsgType]
+		if tc == nil {
+			tc = &typeCounts{}
+			counts[e.MsgType] = tc
+		}
+		if e.Flags&flagReceived != 0 {
+			tc.received++
+			tc.bytesReceived += int(e.DataLength)
+		} else {
+			tc.sent++
+			tc.bytesSent += int(e.DataLength)
+		}
+		busyTimes = append(busyTimes, frameTime(int(e.DataLength), *rate, *dataRate))
+		frameTimes = append(frameTimes, timeMs)
+	}
+
+	if len(frameTimes) == 0 {
+		fmt.Fprintln(os.Stderr, "No frames captured")
+		return
+	}
+	span := frameTimes[len(frameTimes)-1]
+	// Timeout entries record requests that weren't replied to, so they aren't frames on the bus
+	fmt.Fprintf(os.Stderr, "%d entries (of %d recorded), %d frames over %.1fms\n", numCaptured, hdr.NumRecorded, len(frameTimes), span)
+
+	var types []int
+	for t := range counts {
+		types = append(types, int(t))
+	}
+	sort.Ints(types)
+	fmt.Fprintln(os.Stderr, "type    sent   bytes  received   bytes")
+	for _, t := range types {
+		tc := counts[uint16(t)]
+		fmt.Fprintf(os.Stderr, "%4d  %6d  %6d    %6d  %6d\n", t, tc.sent, tc.bytesSent, tc.received, tc.bytesReceived)
+	}
+
+	// Estimate the bus utilisation overall and in the busiest window
+	totalBusy, peakBusy, windowBusy := 0.0, 0.0, 0.0
+	peakStart, start := 0.0, 0
+	for i, t := range frameTimes {
+		totalBusy += busyTimes[i]
+		windowBusy += busyTimes[i]
+		for frameTimes[start] <= t-*window {
+			windowBusy -= busyTimes[start]
+			start++
+		}
+		if windowBusy > peakBusy {
+			peakBusy = windowBusy
+			peakStart = frameTimes[start]
+		}
+	}
+	if span > 0 {
+		fmt.Fprintf(os.Stderr, "Estimated bus utilisation at %.0f/%.0fkbps: mean %.1f%%, peak %.1f%% in the %.0fms window starting at %.1fms\n",
+			*rate, *dataRate, totalBusy/(span*10.0), peakBusy/(*window*10.0), *window, peakStart)
+	}
+	fmt.Fprintf(os.Stderr, "Reply times: %s, timeouts %d\n", replyTimes.summary(), numTimeouts)
+	fmt.Fprintf(os.Stderr, "Movement lead times: %s, late %d, max queued %d\n", leadTimes.summary(), numLate, maxQueue)
+}
@@ -0,0 +1,292 @@
+/*
+ * gridscanner.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host test for GridScanner. It simulates an analog Z probe scanning the rows of a grid over a synthetic bed, feeding the readings
+ *  to GridScanner in the same order as G29 S0 C does: a stationary reading at the start of the row, readings taken while moving
+ *  along the row, then a stationary reading at the end of the row. It checks the heights stored against the true bed heights,
+ *  that alternate rows are scanned in opposite directions, that rows covering only part of the grid store only those points,
+ *  and that points where the reading is outside the calibrated range are counted instead of stored.
+ *  It exits with a nonzero status if any check fails.
+ *
+ *  GridScanner.h and GridScanner.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Movement/BedProbing -o gridscanner Tools/gridscanner/gridscanner.cpp src/Movement/BedProbing/GridScanner.cpp
+ */
+
+#include "GridScanner.h"
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+constexpr unsigned int NumX = 11, NumY = 6;
+constexpr float XMin = 10.0, XSpacing = 20.0, YMin = 10.0, YSpacing = 25.0;
+constexpr float TriggerHeight = 1.0;				// the probe gap at which the reading equals TriggerReading
+constexpr int TriggerReading = 500;
+constexpr float ProbeSensitivity = 400.0;			// change in reading per mm change in gap
+constexpr float ScanMargin = 0.5;
+constexpr float ReadingInterval = 1.7;				// distance in mm moved between readings, not a divisor of the grid spacing
+constexpr float Tolerance = 0.005;					// allowed height error, from the readings being integers and interpolation between them
+
+typedef float (*SurfaceFunction)(float x, float y);
+
+static float TiltedBed(float x, float y)
+{
+	return 0.0015 * x - 0.001 * y + 0.05;
+}
+
+static float WarpedBed(float x, float y)
+{
+	const float u = x/200.0 - 0.5, v = y/150.0 - 0.5;
+	return -0.2 * (u * u + v * v) + 0.05 * u * v;
+}
+
+// A bed with a raised spot under one grid point, high enough for the reading there to exceed the trigger reading
+static float BumpedBed(float x, float y)
+{
+	const float dx = x - (XMin + 5 * XSpacing), dy = y - (YMin + 2 * YSpacing);
+	return (dx * dx + dy * dy < 4.0) ? ScanMargin + 0.2 : 0.0;
+}
+
+struct HeightStore
+{
+	std::vector<float> heights;
+	std::vector<unsigned int> timesSet;
+	std::vector<unsigned int> order;				// the grid indices in the order in which they were stored
+
+	HeightStore() : heights(NumX * NumY, 0.0), timesSet(NumX * NumY, 0) { }
+};
+
+static float GetXCoordinate(const void *context, uint32_t xIndex)
+{
+	(void)context;
+	return XMin + xIndex * XSpacing;
+}
+
+static void SetHeight(void *context, uint32_t xIndex, uint32_t yIndex, float heightError)
+{
+	HeightStore * const store = static_cast<HeightStore*>(context);
+	const unsigned int index = yIndex * NumX + xIndex;
+	store->heights[index] = heightError;
+	++store->timesSet[index];
+	store->order.push_back(index);
+}
+
+// Return the probe reading with the probe at the scanning height above the bed at (x, y)
+static int GetReading(SurfaceFunction surface, float scanHeight, float x, float y)
+{
+	const float gap = scanHeight - surface(x, y);
+	return (int)lrintf(TriggerReading + (TriggerHeight - gap) * ProbeSensitivity);
+}
+
+struct Row
+{
+	uint32_t yIndex, lowXIndex, highXIndex;
+};
+
+// Calibrate at the first point of the first row and scan the given rows, returning false if calibration failed
+static bool Scan(GridScanner& scanner, HeightStore& store, SurfaceFunction surface, const std::vector<Row>& rows)
+{
+	const float x0 = GetXCoordinate(nullptr, rows[0].lowXIndex), y0 = YMin + rows[0].yIndex * YSpacing;
+	const float referenceHeightError = surface(x0, y0);
+	const float scanHeight = referenceHeightError + TriggerHeight + ScanMargin;
+	const int triggerReading = GetReading(surface, scanHeight - ScanMargin, x0, y0);
+	const int scanReading = GetReading(surface, scanHeight, x0, y0);
+	if (!scanner.Calibrate(referenceHeightError, triggerReading, scanReading, ScanMargin))
+	{
+		return false;
+	}
+
+	scanner.Start(GetXCoordinate, SetHeight, &store);
+	for (const Row& row : rows)
+	{
+		scanner.StartRow(row.yIndex, row.lowXIndex, row.highXIndex);
+		const float y = YMin + row.yIndex * YSpacing;
+		const float startX = GetXCoordinate(nullptr, scanner.GetRowStartXIndex());
+		const float endX = GetXCoordinate(nullptr, scanner.GetRowEndXIndex());
+		const float step = (endX >= startX) ? ReadingInterval : -ReadingInterval;
+		scanner.AddReading(startX, GetReading(surface, scanHeight, startX, y));
+		for (float x = startX + step; (step > 0.0) ? x < endX : x > endX; x += step)
+		{
+			scanner.AddReading(x, GetReading(surface, scanHeight, x, y));
+		}
+		scanner.AddReading(endX, GetReading(surface, scanHeight, endX, y));
+		if (!scanner.IsRowFinished())
+		{
+			printf("  row %u not finished after the reading at the end of the row\n", (unsigned int)row.yIndex);
+			return false;
+		}
+	}
+	return true;
+}
+
+static std::vector<Row> FullRows()
+{
+	std::vector<Row> rows;
+	for (uint32_t y = 0; y < NumY; ++y)
+	{
+		rows.push_back(Row{y, 0, NumX - 1});
+	}
+	return rows;
+}
+
+// Check that the points in the rows were each stored once with the true height, and that no other points were stored
+static bool CheckHeights(const char *name, const HeightStore& store, SurfaceFunction surface, const std::vector<Row>& rows, float tolerance)
+{
+	bool ok = true;
+	float worst = 0.0;
+	for (uint32_t yIndex = 0; yIndex < NumY; ++yIndex)
+	{
+		for (uint32_t xIndex = 0; xIndex < NumX; ++xIndex)
+		{
+			bool inRow = false;
+			for (const Row& row : rows)
+			{
+				inRow = inRow || (row.yIndex == yIndex && xIndex >= row.lowXIndex && xIndex <= row.highXIndex);
+			}
+			const unsigned int index = yIndex * NumX + xIndex;
+			if (store.timesSet[index] != ((inRow) ? 1u : 0u))
+			{
+				printf("  %s: point (%u, %u) stored %u times\n", name, (unsigned int)xIndex, (unsigned int)yIndex, store.timesSet[index]);
+				ok = false;
+			}
+			else if (inRow)
+			{
+				const float error = fabsf(store.heights[index] - surface(XMin + xIndex * XSpacing, YMin + yIndex * YSpacing));
+				worst = fmaxf(worst, error);
+			}
+		}
+	}
+	printf("%-28s worst height error %.4f\n", name, (double)worst);
+	if (worst > tolerance)
+	{
+		printf("  %s: worst height error exceeds %.4f\n", name, (double)tolerance);
+		ok = false;
+	}
+	return ok;
+}
+
+static bool TestSurface(const char *name, SurfaceFunction surface, float tolerance)
+{
+	GridScanner scanner;
+	HeightStore store;
+	const std::vector<Row> rows = FullRows();
+	if (!Scan(scanner, store, surface, rows))
+	{
+		printf("  %s: scan failed\n", name);
+		return false;
+	}
+	bool ok = CheckHeights(name, store, surface, rows, tolerance);
+	if (scanner.GetNumPointsOutOfRange() != 0)
+	{
+		printf("  %s: %u points out of range\n", name, scanner.GetNumPointsOutOfRange());
+		ok = false;
+	}
+	return ok;
+}
+
+// Check that alternate rows are scanned in opposite directions, so the points are stored in serpentine order
+static bool TestDirections()
+{
+	GridScanner scanner;
+	HeightStore store;
+	const std::vector<Row> rows = FullRows();
+	if (!Scan(scanner, store, TiltedBed, rows))
+	{
+		printf("  directions: scan failed\n");
+		return false;
+	}
+	unsigned int n = 0;
+	for (uint32_t yIndex = 0; yIndex < NumY; ++yIndex)
+	{
+		for (uint32_t i = 0; i < NumX; ++i)
+		{
+			const uint32_t xIndex = ((yIndex & 1) == 0) ? i : NumX - 1 - i;
+			if (n >= store.order.size() || store.order[n] != yIndex * NumX + xIndex)
+			{
+				printf("  directions: point %u stored out of order\n", n);
+				return false;
+			}
+			++n;
+		}
+	}
+	printf("%-28s ok\n", "serpentine order");
+	return true;
+}
+
+// Check that rows covering only part of the grid, as when the probe can't reach all of it, store only those points
+static bool TestPartialRows()
+{
+	GridScanner scanner;
+	HeightStore store;
+	const std::vector<Row> rows = { {0, 2, 8}, {1, 1, 9}, {3, 0, 4}, {4, 6, 6}, {5, 3, 10} };
+	if (!Scan(scanner, store, WarpedBed, rows))
+	{
+		printf("  partial rows: scan failed\n");
+		return false;
+	}
+	return CheckHeights("partial rows", store, WarpedBed, rows, Tolerance);
+}
+
+// Check that a point whose reading is above the trigger reading is counted as out of range and not stored
+static bool TestOutOfRange()
+{
+	GridScanner scanner;
+	HeightStore store;
+	if (!Scan(scanner, store, BumpedBed, FullRows()))
+	{
+		printf("  out of range: scan failed\n");
+		return false;
+	}
+	const unsigned int bumpIndex = 2 * NumX + 5;
+	bool ok = true;
+	if (scanner.GetNumPointsOutOfRange() != 1 || store.timesSet[bumpIndex] != 0)
+	{
+		printf("  out of range: %u points out of range, bumped point stored %u times\n", scanner.GetNumPointsOutOfRange(), store.timesSet[bumpIndex]);
+		ok = false;
+	}
+	if (store.order.size() != NumX * NumY - 1)
+	{
+		printf("  out of range: %u points stored\n", (unsigned int)store.order.size());
+		ok = false;
+	}
+	if (ok)
+	{
+		printf("%-28s ok\n", "out of range point");
+	}
+	return ok;
+}
+
+// Check that calibration is refused when the reading hardly changes with height
+static bool TestCalibration()
+{
+	GridScanner scanner;
+	const int change = (int)(GridScanner::MinSensitivity * ScanMargin);
+	if (scanner.Calibrate(0.0, TriggerReading, TriggerReading - change + 1, ScanMargin))
+	{
+		printf("  calibration: accepted a sensitivity below the minimum\n");
+		return false;
+	}
+	if (!scanner.Calibrate(0.0, TriggerReading, TriggerReading - (int)(ProbeSensitivity * ScanMargin), ScanMargin))
+	{
+		printf("  calibration: refused a good sensitivity\n");
+		return false;
+	}
+	printf("%-28s ok\n", "calibration");
+	return true;
+}
+
+int main()
+{
+	bool ok = TestSurface("tilted bed", TiltedBed, Tolerance);
+
+	ok = TestSurface("warped bed", WarpedBed, Tolerance) && ok;
+	ok = TestDirections() && ok;
+	ok = TestPartialRows() && ok;
+	ok = TestOutOfRange() && ok;
+	ok = TestCalibration() && ok;
+	printf("\n%s\n", (ok) ? "PASS" : "FAIL");
+	return (ok) ? 0 : 1;
+}
@@ -0,0 +1,368 @@
+/*
+ * heatersim.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host simulator for the heater control loop. It runs the LocalHeater PID control law, with and without the Smith predictor
+ *  dead time compensation, against a simulated first order process with dead time, and reports the time to reach the setpoint
+ *  and the overshoot. With option -check it exits with a nonzero status unless dead time compensation reduces the overshoot
+ *  by at least a quarter without making the settling time worse, so it can be used for regression testing after changing
+ *  the controller. The time to first reach the setpoint is reported but not checked, because the predictor doesn't improve it:
+ *  it is limited by the heater power. If no process model is given, -check runs a set of typical bed and hot end models.
+ *  Option -v prints the time, temperature and PWM of the dead time compensated run in CSV format.
+ *
+ *  The heater model sources are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Heating -o heatersim Tools/heatersim/heatersim.cpp src/Heating/SmithPredictor.cpp src/Heating/FopDtEstimator.cpp
+ *
+ *  Option -identify also runs the online model identification during a heat-up and a setpoint change, and reports the identified model.
+ *
+ *  Usage: heatersim [-check] [-v] [-identify] [gain timeConstant deadTime target [maxPwm]]
+ *  The model used by the controller can be made different from the simulated plant by setting environment variable
+ *  HEATERSIM_MODEL_ERROR to the fractional error in the gain, time constant and dead time, e.g. 0.2 for 20% too high.
+ */
+
+#include "SmithPredictor.h"
+#include "FopDtEstimator.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <deque>
+
+constexpr float SampleInterval = 0.25;				// must match HeatSampleIntervalMillis in the firmware
+constexpr float Ambient = 25.0;						// must match NormalAmbientTemperature in the firmware
+constexpr float CloseEnough = 1.0;					// temperature error within which we consider the setpoint reached
+constexpr float SimulationTime = 3600.0;			// how long we simulate for, in seconds
+constexpr unsigned int NumPreviousTemperatures = 4;	// must match LocalHeater
+constexpr float MinOvershootReduction = 0.25;		// the fraction by which -check requires the predictor to reduce overshoot
+constexpr float MinCheckedOvershoot = 0.2;			// if PID overshoots by less than this then we only check that the predictor isn't worse
+
+struct ProcessModel
+{
+	float gain, timeConstant, deadTime, maxPwm;
+};
+
+struct PidParameters
+{
+	float kP, recipTi, tD;
+};
+
+// This must match FopDt::CalcPidConstants
+static void CalcPidConstants(const ProcessModel& m, PidParameters& setpointChange, PidParameters& loadChange)
+{
+	const float timeFrac = m.deadTime/m.timeConstant;
+	loadChange.kP = 0.7/(m.gain * timeFrac);
+	loadChange.recipTi = (1.0/1.14)/(powf(m.timeConstant, 0.25) * powf(m.deadTime, 0.75));
+	loadChange.tD = m.deadTime * 0.7;
+
+	setpointChange.kP = 0.7/(m.gain * timeFrac);
+	setpointChange.recipTi = 1.0/(powf(m.timeConstant, 0.5) * powf(m.deadTime, 0.5));
+	setpointChange.tD = m.deadTime * 0.7;
+}
+
+struct Result
+{
+	float timeToSetpoint;		// time at which the temperature first came within CloseEnough of the target, or -1 if it never did
+	float settleTime;			// time after which the temperature stayed within CloseEnough of the target, or -1 if it never did
+	float overshoot;			// maximum temperature above the target
+};
+
+static Result Simulate(const ProcessModel& plant, const ProcessModel& model, float target, bool usePrediction, bool verbose, FopDtEstimator *estimator = nullptr)
+{
+	const float initialTarget = target;
+	PidParameters setpointParams, loadParams;
+	CalcPidConstants(model, setpointParams, loadParams);
+
+	SmithPredictor predictor;
+	predictor.Reset(Ambient, Ambient, model.deadTime, SampleInterval);
+
+	// Plant state. The dead time is simulated using a queue of PWM values.
+	float plantTemperature = Ambient;
+	const size_t deadTimeSamples = (size_t)lrintf(plant.deadTime/SampleInterval);
+	std::deque<float> pwmDelayLine(deadTimeSamples, 0.0);
+
+	float previousTemperatures[NumPreviousTemperatures];
+	unsigned int previousTemperatureIndex = 0, numPreviousTemperatures = 0;
+	float iAccumulator = 0.0, lastPwm = 0.0;
+	bool stable = false;
+
+	Result rslt = { -1.0, -1.0, 0.0 };
+	for (unsigned int step = 0; (float)step * SampleInterval < SimulationTime; ++step)
+	{
+		const float now = (float)step * SampleInterval;
+		if (estimator != nullptr && now >= SimulationTime/2)
+		{
+			target = (initialTarget + Ambient)/2;			// change the setpoint half way through to give the estimator some more data
+		}
+		const float temperature = plantTemperature;
+		const float error = target - temperature;
+
+		// Calculate the derivative the same way as LocalHeater does
+		float derivative = 0.0;
+		if (numPreviousTemperatures == NumPreviousTemperatures)
+		{
+			derivative = (temperature - previousTemperatures[previousTemperatureIndex])/(SampleInterval * NumPreviousTemperatures);
+		}
+		else
+		{
+			++numPreviousTemperatures;
+		}
+		previousTemperatures[previousTemperatureIndex] = temperature;
+		previousTemperatureIndex = (previousTemperatureIndex + 1) % NumPreviousTemperatures;
+
+		if (!stable && fabsf(error) <= CloseEnough)
+		{
+			stable = true;
+		}
+
+		// This is the control law in LocalHeater::Spin
+		const bool inLoadMode = stable || fabsf(error) < 3.0;
+		const PidParameters& params = (inLoadMode) ? loadParams : setpointParams;
+		float controlTemperature = temperature, controlDerivative = derivative;
+		if (usePrediction)
+		{
+			controlTemperature += predictor.GetTemperatureCorrection();
+			controlDerivative += predictor.GetRateCorrection();
+		}
+		const float controlError = target - controlTemperature;
+		const float pPlusD = params.kP * ((usePrediction) ? controlError : controlError - params.tD * derivative);
+		const float expectedPwm = std::clamp<float>((controlTemperature - Ambient)/model.gain, 0.0, model.maxPwm);
+		float pwm;
+		if (pPlusD + expectedPwm > model.maxPwm)
+		{
+			pwm = model.maxPwm;
+			if (!stable && controlError > 0.0 && controlDerivative > 0.0)
+			{
+				iAccumulator = expectedPwm;
+			}
+		}
+		else if (pPlusD + expectedPwm < 0.0)
+		{
+			pwm = 0.0;
+		}
+		else
+		{
+			iAccumulator = std::clamp<float>(iAccumulator + controlError * params.kP * params.recipTi * SampleInterval, 0.0, model.maxPwm);
+			pwm = std::clamp<float>(pPlusD + iAccumulator, 0.0, model.maxPwm);
+		}
+		predictor.Update(pwm, model.gain, model.timeConstant);
+		if (estimator != nullptr)
+		{
+			estimator->AddSample(temperature, lastPwm);		// LocalHeater passes the PWM that was applied up to when the temperature was read
+		}
+		lastPwm = pwm;
+
+		// Advance the plant
+		pwmDelayLine.push_back(pwm);
+		const float delayedPwm = pwmDelayLine.front();
+		pwmDelayLine.pop_front();
+		plantTemperature += (plant.gain * delayedPwm - (plantTemperature - Ambient)) * SampleInterval/plant.timeConstant;
+
+		// Gather the statistics
+		if (now >= SimulationTime/2 && estimator != nullptr)
+		{
+			// Don't count the response to the setpoint change
+		}
+		else if (fabsf(plantTemperature - target) <= CloseEnough)
+		{
+			if (rslt.timeToSetpoint < 0.0)
+			{
+				rslt.timeToSetpoint = now;
+			}
+			if (rslt.settleTime < 0.0)
+			{
+				rslt.settleTime = now;
+			}
+		}
+		else
+		{
+			rslt.settleTime = -1.0;
+		}
+		rslt.overshoot = std::max<float>(rslt.overshoot, plantTemperature - target);
+
+		if (verbose)
+		{
+			printf("%.2f,%.2f,%.3f\n", (double)now, (double)plantTemperature, (double)pwm);
+		}
+	}
+	return rslt;
+}
+
+struct CheckCase
+{
+	const char *name;
+	ProcessModel plant;
+	float target;
+};
+
+// The processes that -check uses if none is given on the command line
+static const CheckCase CheckCases[] =
+{
+	{ "bed",				{ 120.0, 400.0, 10.0, 1.0 },	90.0 },
+	{ "hot end",			{ 300.0, 150.0, 4.0, 1.0 },		210.0 },
+	{ "fast hot end",		{ 200.0, 100.0, 8.0, 1.0 },		200.0 },
+	{ "long dead time",		{ 100.0, 300.0, 30.0, 1.0 },	80.0 },
+};
+
+// Simulate a process with and without the predictor and print the results, returning true if -check would pass
+static bool Compare(const char *name, const ProcessModel& plant, float target, bool verbose)
+{
+	ProcessModel model = plant;
+	const char * const modelError = getenv("HEATERSIM_MODEL_ERROR");
+	if (modelError != nullptr)
+	{
+		const float factor = 1.0 + strtof(modelError, nullptr);
+		model.gain *= factor;
+		model.timeConstant *= factor;
+		model.deadTime *= factor;
+	}
+
+	const Result pid = Simulate(plant, model, target, false, false);
+	const Result predictive = Simulate(plant, model, target, true, verbose);
+	if (name != nullptr)
+	{
+		printf("%s:\n", name);
+	}
+	printf("PID:        reached %.1fs, settled %.1fs, overshoot %.2fC\n", (double)pid.timeToSetpoint, (double)pid.settleTime, (double)pid.overshoot);
+	printf("Predictive: reached %.1fs, settled %.1fs, overshoot %.2fC\n", (double)predictive.timeToSetpoint, (double)predictive.settleTime, (double)predictive.overshoot);
+
+	if (predictive.settleTime < 0.0)
+	{
+		printf("FAIL: predictive controller did not settle\n");
+		return false;
+	}
+	if (pid.settleTime >= 0.0 && predictive.settleTime > pid.settleTime * 1.02 + 5.0)
+	{
+		printf("FAIL: predictive controller settled more slowly than PID\n");
+		return false;
+	}
+	if (pid.overshoot >= MinCheckedOvershoot)
+	{
+		if (predictive.overshoot > pid.overshoot * (1.0 - MinOvershootReduction))
+		{
+			printf("FAIL: predictive controller did not reduce the overshoot by at least %d%%\n", (int)(MinOvershootReduction * 100.0));
+			return false;
+		}
+	}
+	else if (predictive.overshoot > pid.overshoot + 0.1)
+	{
+		printf("FAIL: predictive controller overshoot is worse than PID\n");
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[])
+{
+	bool check = false, verbose = false, identify = false;
+	int argIndex = 1;
+	while (argIndex < argc && argv[argIndex][0] == '-')
+	{
+		if (strcmp(argv[argIndex], "-check") == 0)
+		{
+			check = true;
+		}
+		else if (strcmp(argv[argIndex], "-v") == 0)
+		{
+			verbose = true;
+		}
+		else if (strcmp(argv[argIndex], "-identify") == 0)
+		{
+			identify = true;
+		}
+		else
+		{
+			fprintf(stderr, "Unknown option %s\n", argv[argIndex]);
+			return 2;
+		}
+		++argIndex;
+	}
+
+	// Default to a typical bed heater with a long dead time
+	ProcessModel plant = CheckCases[0].plant;
+	float target = CheckCases[0].target;
+	const bool modelGiven = (argc - argIndex >= 4);
+	if (modelGiven)
+	{
+		plant.gain = strtof(argv[argIndex], nullptr);
+		plant.timeConstant = strtof(argv[argIndex + 1], nullptr);
+		plant.deadTime = strtof(argv[argIndex + 2], nullptr);
+		target = strtof(argv[argIndex + 3], nullptr);
+		if (argc - argIndex >= 5)
+		{
+			plant.maxPwm = strtof(argv[argIndex + 4], nullptr);
+		}
+	}
+
+	bool passed;
+	if (check && !modelGiven && !verbose)
+	{
+		passed = true;
+		for (const CheckCase& c : CheckCases)
+		{
+			if (!Compare(c.name, c.plant, c.target, false))
+			{
+				passed = false;
+			}
+		}
+	}
+	else
+	{
+		passed = Compare(nullptr, plant, target, verbose);
+	}
+
+	ProcessModel model = plant;
+	const char * const modelError = getenv("HEATERSIM_MODEL_ERROR");
+	if (modelError != nullptr)
+	{
+		const float factor = 1.0 + strtof(modelError, nullptr);
+		model.gain *= factor;
+		model.timeConstant *= factor;
+		model.deadTime *= factor;
+	}
+
+	if (identify)
+	{
+		// Run the online model identification on a heat-up followed by a setpoint change, using the controller's model for the initial dead time guess
+		FopDtEstimator estimator;
+		estimator.Reset(model.deadTime, SampleInterval);
+		(void)Simulate(plant, model, target, true, false, &estimator);
+		FopDtEstimator::Estimate est;
+		if (estimator.GetEstimate(est))
+		{
+			printf("Identified: gain %.1f, time constant %.1f, dead time %.2f, ambient %.1f, confidence %.0f%%\n",
+					(double)est.gain, (double)est.timeConstant, (double)est.deadTime, (double)est.ambientTemperature, (double)(est.confidence * 100.0));
+			printf("Actual:     gain %.1f, time constant %.1f, dead time %.2f, ambient %.1f\n",
+					(double)plant.gain, (double)plant.timeConstant, (double)plant.deadTime, (double)Ambient);
+			if (check && (fabsf(est.gain/plant.gain - 1.0) > 0.1 || fabsf(est.timeConstant/plant.timeConstant - 1.0) > 0.1))
+			{
+				printf("FAIL: identified model differs from actual model by more than 10%%\n");
+				return 1;
+			}
+		}
+		else
+		{
+			printf("No model identified\n");
+			if (check)
+			{
+				printf("FAIL: no model identified\n");
+				return 1;
+			}
+		}
+	}
+
+	if (check)
+	{
+		if (!passed)
+		{
+			return 1;
+		}
+		printf("PASS\n");
+	}
+	return 0;
+}
+
+// End
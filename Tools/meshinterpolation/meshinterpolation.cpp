@@ -0,0 +1,215 @@
+/*
+ * meshinterpolation.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host benchmark for height map interpolation. It samples a synthetic bed surface on grids of several spacings, then for bilinear
+ *  interpolation and for bicubic interpolation using BicubicSlopeTable it reports the worst and RMS error against the true surface,
+ *  the time to build the slope table and the evaluation cost per segment. The evaluation cost includes the clamping and cell lookup
+ *  that HeightMap::GetInterpolatedHeightError does for each segment end point.
+ *  It exits with a nonzero status if bicubic interpolation fails to pass through the grid points or to reproduce a quadratic surface,
+ *  including in the cells at the edges of the grid.
+ *
+ *  BicubicSlopeTable.h and BicubicSlopeTable.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Movement/BedProbing -o meshinterpolation Tools/meshinterpolation/meshinterpolation.cpp src/Movement/BedProbing/BicubicSlopeTable.cpp
+ *
+ *  Usage: meshinterpolation [bedSize]
+ *  The default bed size is 400mm square.
+ */
+
+#include "BicubicSlopeTable.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+typedef float (*SurfaceFunction)(float x, float y, float bedSize);
+
+// A bed that sags in the middle, with a twist and a gentle ripple from the bed supports
+static float WarpedBed(float x, float y, float bedSize)
+{
+	const float u = x/bedSize - 0.5, v = y/bedSize - 0.5;
+	return -0.4 * (u * u + v * v) + 0.15 * u * v + 0.03 * sinf(6.0 * u + 1.0) * cosf(5.0 * v);
+}
+
+static float QuadraticBed(float x, float y, float bedSize)
+{
+	const float u = x/bedSize, v = y/bedSize;
+	return 0.2 * u * u - 0.1 * u * v + 0.3 * v * v + 0.05 * u - 0.02;
+}
+
+class Grid
+{
+public:
+	Grid(float p_bedSize, uint32_t p_numPoints, SurfaceFunction f)
+		: bedSize(p_bedSize), numPoints(p_numPoints), spacing(p_bedSize/(p_numPoints - 1)), recipSpacing(1.0/spacing),
+		  heights(p_numPoints * p_numPoints), table(p_numPoints * p_numPoints)
+	{
+		for (uint32_t y = 0; y < numPoints; ++y)
+		{
+			for (uint32_t x = 0; x < numPoints; ++x)
+			{
+				heights[y * numPoints + x] = f(x * spacing, y * spacing, bedSize);
+			}
+		}
+	}
+
+	bool BuildTable() { return table.Build(heights.data(), numPoints, numPoints); }
+
+	// This matches HeightMap::GetInterpolatedHeightError
+	float Interpolate(float x, float y, bool bicubic) const
+	{
+		const float last = (numPoints - 1) * spacing - 0.01;
+		if (x < 0.0) { x = 0.0; }
+		if (y < 0.0) { y = 0.0; }
+		if (x > last) { x = last; }
+		if (y > last) { y = last; }
+
+		const float xf = x * recipSpacing;
+		const float xFloor = floorf(xf);
+		const uint32_t xIndex = (uint32_t)xFloor;
+		const float yf = y * recipSpacing;
+		const float yFloor = floorf(yf);
+		const uint32_t yIndex = (uint32_t)yFloor;
+		return (bicubic) ? table.Interpolate(heights.data(), xIndex, yIndex, xf - xFloor, yf - yFloor)
+							: Bilinear(xIndex, yIndex, xf - xFloor, yf - yFloor);
+	}
+
+	uint32_t NumPoints() const { return numPoints; }
+	float Spacing() const { return spacing; }
+	float Height(uint32_t x, uint32_t y) const { return heights[y * numPoints + x]; }
+
+private:
+	float Bilinear(uint32_t xIndex, uint32_t yIndex, float xFrac, float yFrac) const
+	{
+		const uint32_t index00 = yIndex * numPoints + xIndex;
+		const uint32_t index01 = index00 + numPoints;
+		const float xyFrac = xFrac * yFrac;
+		return (heights[index00] * (1.0 - xFrac - yFrac + xyFrac))
+				+ (heights[index00 + 1] * (xFrac - xyFrac))
+				+ (heights[index01] * (yFrac - xyFrac))
+				+ (heights[index01 + 1] * xyFrac);
+	}
+
+	float bedSize;
+	uint32_t numPoints;
+	float spacing, recipSpacing;
+	std::vector<float> heights;
+	BicubicSlopeTable table;
+};
+
+struct ErrorStats
+{
+	float maxError, rmsError;
+};
+
+static ErrorStats MeasureError(const Grid& grid, bool bicubic, SurfaceFunction f, float bedSize, float margin)
+{
+	const unsigned int samples = 400;
+	double sumSquares = 0.0;
+	float maxError = 0.0;
+	for (unsigned int i = 0; i <= samples; ++i)
+	{
+		const float y = margin + (bedSize - 2 * margin) * i/samples;
+		for (unsigned int j = 0; j <= samples; ++j)
+		{
+			const float x = margin + (bedSize - 2 * margin) * j/samples;
+			const float err = fabsf(grid.Interpolate(x, y, bicubic) - f(x, y, bedSize));
+			sumSquares += (double)err * err;
+			if (err > maxError)
+			{
+				maxError = err;
+			}
+		}
+	}
+	return ErrorStats{ maxError, (float)sqrt(sumSquares/((samples + 1) * (samples + 1))) };
+}
+
+// Return the evaluation time per segment in nanoseconds, for segments along a set of diagonal moves across the bed
+static double MeasureEvaluationTime(const Grid& grid, bool bicubic, float bedSize)
+{
+	const unsigned int numSegments = 2000000;
+	volatile float sink = 0.0;
+	float sum = 0.0;
+	const auto start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < numSegments; ++i)
+	{
+		const float t = (float)(i % 10007) * (1.0/10007.0);
+		const float offset = (float)(i % 13) * (bedSize/13.0);
+		sum += grid.Interpolate(t * bedSize, fmodf(t * bedSize * 0.7 + offset, bedSize), bicubic);
+	}
+	const auto finish = std::chrono::steady_clock::now();
+	sink = sum;
+	(void)sink;
+	return std::chrono::duration<double, std::nano>(finish - start).count()/numSegments;
+}
+
+int main(int argc, char *argv[])
+{
+	const float bedSize = (argc > 1) ? strtof(argv[1], nullptr) : 400.0;
+	if (!(bedSize > 0.0))
+	{
+		fprintf(stderr, "Bad bed size\n");
+		return 2;
+	}
+
+	bool ok = true;
+
+	// Check that bicubic interpolation passes through the grid points and reproduces a quadratic surface over the whole grid
+	{
+		Grid grid(bedSize, 11, QuadraticBed);
+		if (!grid.BuildTable())
+		{
+			fprintf(stderr, "Failed to build slope table\n");
+			return 1;
+		}
+		float maxPointError = 0.0;
+		for (uint32_t y = 0; y + 1 < grid.NumPoints(); ++y)
+		{
+			for (uint32_t x = 0; x + 1 < grid.NumPoints(); ++x)
+			{
+				maxPointError = fmaxf(maxPointError, fabsf(grid.Interpolate(x * grid.Spacing(), y * grid.Spacing(), true) - grid.Height(x, y)));
+			}
+		}
+		const ErrorStats quadraticError = MeasureError(grid, true, QuadraticBed, bedSize, 0.0);
+		printf("Bicubic check: max error at grid points %.6f, max error on quadratic surface %.6f\n", (double)maxPointError, (double)quadraticError.maxError);
+		if (maxPointError > 1.0e-5 || quadraticError.maxError > 1.0e-4)
+		{
+			ok = false;
+		}
+	}
+
+	// Compare accuracy and cost on the warped bed
+	printf("\nBed %.0fmm square\n", (double)bedSize);
+	printf("points  spacing  method    max error  RMS error  build us  ns/segment\n");
+	const uint32_t pointCounts[] = { 6, 9, 11, 16, 21, 41 };
+	for (uint32_t numPoints : pointCounts)
+	{
+		Grid grid(bedSize, numPoints, WarpedBed);
+		const auto start = std::chrono::steady_clock::now();
+		grid.BuildTable();
+		const auto finish = std::chrono::steady_clock::now();
+		const double buildTime = std::chrono::duration<double, std::micro>(finish - start).count();
+
+		for (int method = 0; method < 2; ++method)
+		{
+			const bool bicubic = (method == 1);
+			const ErrorStats stats = MeasureError(grid, bicubic, WarpedBed, bedSize, 0.0);
+			const double ns = MeasureEvaluationTime(grid, bicubic, bedSize);
+			char buildText[16] = "-";
+			if (bicubic)
+			{
+				snprintf(buildText, sizeof(buildText), "%.1f", buildTime);
+			}
+			printf("%3u x %-3u %6.1f  %-8s  %9.4f  %9.4f  %8s  %10.1f\n",
+					(unsigned int)numPoints, (unsigned int)numPoints, (double)grid.Spacing(), (bicubic) ? "bicubic" : "bilinear",
+					(double)stats.maxError, (double)stats.rmsError, buildText, ns);
+		}
+	}
+
+	printf("\n%s\n", (ok) ? "PASS" : "FAIL");
+	return (ok) ? 0 : 1;
+}
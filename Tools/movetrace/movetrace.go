@@ -0,0 +1,124 @@
+// movetrace decodes a move trace file saved by RepRapFirmware using M595 F"filename"
+// and prints a timeline of the moves in CSV format, followed by a summary.
+//
+// Usage: movetrace tracefile
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"os"
+)
+
+// fileHeader must match struct MoveTrace::FileHeader in src/Movement/MoveTrace.h
+type fileHeader struct {
+	Magic         [8]byte
+	Version       uint32
+	StepClockRate uint32
+	EntrySize     uint32
+	NumEntries    uint32
+	NumRecorded   uint32
+	Spare         uint32
+}
+
+// entry must match struct MoveTrace::Entry in src/Movement/MoveTrace.h
+type entry struct {
+	StartTime         uint32
+	PlannedClocks     uint32
+	ActualClocks      uint32
+	PrepareLeadClocks uint32
+	RequestedSpeed    float32
+	StartSpeed        float32
+	TopSpeed          float32
+	EndSpeed          float32
+	Distance          float32
+	FilePos           uint32
+	Flags             uint16
+	Spare             uint16
+}
+
+const (
+	flagLookaheadUnderrun = 0x0001
+	flagStartedLate       = 0x0002
+	flagPrintingMove      = 0x0004
+	flagCheckingEndstops  = 0x0008
+)
+
+func main() {
+	if len(os.Args) != 2 {
+		fmt.Fprintln(os.Stderr, "Usage: movetrace tracefile")
+		os.Exit(1)
+	}
+
+	f, err := os.Open(os.Args[1])
+	if err != nil {
+		panic(err)
+	}
+	defer f.Close()
+
+	var hdr fileHeader
+	if err = binary.Read(f, binary.LittleEndian, &hdr); err != nil {
+		panic(err)
+	}
+	if string(bytes.TrimRight(hdr.Magic[:], "\x00")) != "RRFMTRC" {
+		fmt.Fprintln(os.Stderr, "Not a move trace file")
+		os.Exit(1)
+	}
+	if hdr.Version != 1 || hdr.EntrySize != uint32(binary.Size(entry{})) {
+		fmt.Fprintf(os.Stderr, "Unsupported file version %d or entry size %d\n", hdr.Version, hdr.EntrySize)
+		os.Exit(1)
+	}
+
+	clocksToMs := 1000.0 / float64(hdr.StepClockRate)
+	fmt.Println("move,startMs,plannedMs,actualMs,delayMs,prepareLeadMs,requestedSpeed,startSpeed,topSpeed,endSpeed,distance,filePos,printing,lookaheadUnderrun,startedLate")
+
+	var firstStart uint32
+	var numUnderruns, numLate, numMoves int
+	var totalPlanned, totalActual uint64
+	var minLead int32
+	for i := uint32(0); i < hdr.NumEntries; i++ {
+		var e entry
+		if err = binary.Read(f, binary.LittleEndian, &e); err != nil {
+			if err == io.EOF || err == io.ErrUnexpectedEOF {
+				break
+			}
+			panic(err)
+		}
+		if e.PlannedClocks == 0 && e.ActualClocks == 0 && e.StartTime == 0 {
+			continue // padding written because tracing was reconfigured while the file was being saved
+		}
+		if numMoves == 0 {
+			firstStart = e.StartTime
+			minLead = int32(e.PrepareLeadClocks)
+		}
+		numMoves++
+
+		lead := int32(e.PrepareLeadClocks)
+		if lead < minLead {
+			minLead = lead
+		}
+		if e.Flags&flagLookaheadUnderrun != 0 {
+			numUnderruns++
+		}
+		if e.Flags&flagStartedLate != 0 {
+			numLate++
+		}
+		totalPlanned += uint64(e.PlannedClocks)
+		totalActual += uint64(e.ActualClocks)
+
+		fmt.Printf("%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%.1f,%.1f,%.1f,%.3f,%d,%t,%t,%t\n",
+			int(hdr.NumRecorded)-int(hdr.NumEntries)+int(i),
+			float64(e.StartTime-firstStart)*clocksToMs,
+			float64(e.PlannedClocks)*clocksToMs,
+			float64(e.ActualClocks)*clocksToMs,
+			float64(int64(e.ActualClocks)-int64(e.PlannedClocks))*clocksToMs,
+			float64(lead)*clocksToMs,
+			e.RequestedSpeed, e.StartSpeed, e.TopSpeed, e.EndSpeed, e.Distance, e.FilePos,
+			e.Flags&flagPrintingMove != 0, e.Flags&flagLookaheadUnderrun != 0, e.Flags&flagStartedLate != 0)
+	}
+
+	fmt.Fprintf(os.Stderr, "%d moves (of %d recorded), planned %.1fms, actual %.1fms, lookahead underruns %d, late starts %d, min prepare lead %.1fms\n",
+		numMoves, hdr.NumRecorded, float64(totalPlanned)*clocksToMs, float64(totalActual)*clocksToMs, numUnderruns, numLate, float64(minLead)*clocksToMs)
+}
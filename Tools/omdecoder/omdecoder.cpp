@@ -0,0 +1,457 @@
+/*
+ * omdecoder.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Reference decoder for the compact object model encoding in src/Linux/ObjectModelCodec.h, and a host test of the encoder.
+ *  The decoder is what the SBC must implement to accept FirmwareRequest::CompactObjectModel packets.
+ *  The test encodes a sequence of object model responses like those that the Duet Control Server polls for, decodes them and checks that:
+ *  - every response decodes to exactly the JSON text that was encoded, however the text is split across output buffers;
+ *  - numbers that can't be sent as scaled integers, escaped strings, empty objects and arrays and keys that don't fit the key table survive;
+ *  - a response that is measured but never written doesn't disturb the decoder, e.g. when there was no room for it in the transfer;
+ *  - after the encoder is reset, a new decoder can decode the next response;
+ *  - text that isn't JSON, such as an error message, is rejected so that it is sent as JSON instead.
+ *  It also reports the size of the compact messages compared to the JSON text.
+ *
+ *  ObjectModelCodec.h and ObjectModelCodec.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Linux -o omdecoder Tools/omdecoder/omdecoder.cpp src/Linux/ObjectModelCodec.cpp
+ */
+
+#include "ObjectModelCodec.h"
+#include <cstdio>
+#include <cstring>
+#include <cinttypes>
+#include <string>
+#include <vector>
+#include <memory>
+
+static bool Check(bool condition, const char *what) noexcept
+{
+	if (!condition)
+	{
+		printf("  FAILED: %s\n", what);
+	}
+	return condition;
+}
+
+// Reference decoder. It keeps the key table and the previous message in the same form as the encoder does.
+class ObjectModelDecoder
+{
+public:
+	// Decode one message including its CompactObjectModelHeader, returning false if it is not valid
+	bool Decode(const uint8_t *msg, size_t length, std::string& json)
+	{
+		json.clear();
+		if (length < sizeof(CompactObjectModelHeader))
+		{
+			return false;
+		}
+		CompactObjectModelHeader header;
+		memcpy(&header, msg, sizeof(header));
+		if (header.length != length - sizeof(CompactObjectModelHeader))
+		{
+			return false;
+		}
+		if (header.flags & CompactObjectModelHeader::ResetFlag)
+		{
+			keys.clear();
+			previous.clear();
+		}
+
+		const uint8_t *p = msg + sizeof(CompactObjectModelHeader);
+		const uint8_t * const end = msg + length;
+		const uint8_t *q = previous.data();
+		const uint8_t * const previousEnd = previous.data() + previous.size();
+		std::vector<uint8_t> current;
+		stack.clear();
+		afterKey = false;
+
+		while (p < end)
+		{
+			uint64_t val;
+			if ((CompactToken)*p == CompactToken::copy)
+			{
+				const size_t len = CompactCodec::ReadVarint(p + 1, end, val);
+				if (len == 0)
+				{
+					return false;
+				}
+				p += 1 + len;
+				for (uint64_t i = 0; i < val; ++i)
+				{
+					const size_t tokenLength = CompactCodec::TokenLength(q, previousEnd);
+					if (tokenLength == 0 || !EmitToken(q, tokenLength, json))
+					{
+						return false;
+					}
+					current.insert(current.end(), q, q + tokenLength);
+					q += tokenLength;
+				}
+				continue;
+			}
+
+			if ((CompactToken)*p == CompactToken::keyDefine)
+			{
+				// Store the key, then treat this as a reference to it
+				uint64_t id, keyLength;
+				size_t n = 1;
+				size_t len = CompactCodec::ReadVarint(p + n, end, id);
+				n += len;
+				const size_t len2 = (len == 0) ? 0 : CompactCodec::ReadVarint(p + n, end, keyLength);
+				n += len2;
+				if (len == 0 || len2 == 0 || keyLength > (uint64_t)(end - p - n) || id > 0xFFFF)
+				{
+					return false;
+				}
+				if (keys.size() <= id)
+				{
+					keys.resize(id + 1);
+				}
+				keys[id].assign(reinterpret_cast<const char *>(p + n), keyLength);
+				p += n + keyLength;
+
+				uint8_t ref[11];
+				ref[0] = (uint8_t)CompactToken::keyRef;
+				const size_t refLength = 1 + CompactCodec::WriteVarint(ref + 1, id);
+				if (!EmitToken(ref, refLength, json))
+				{
+					return false;
+				}
+				current.insert(current.end(), ref, ref + refLength);
+			}
+			else
+			{
+				const size_t tokenLength = CompactCodec::TokenLength(p, end);
+				if (tokenLength == 0 || !EmitToken(p, tokenLength, json))
+				{
+					return false;
+				}
+				current.insert(current.end(), p, p + tokenLength);
+				p += tokenLength;
+			}
+
+			// A token that isn't copied replaces the token at the same place in the previous message
+			if (q < previousEnd)
+			{
+				q += CompactCodec::TokenLength(q, previousEnd);
+			}
+		}
+
+		if (!stack.empty())
+		{
+			return false;
+		}
+		previous.swap(current);
+		return true;
+	}
+
+private:
+	struct Level
+	{
+		bool isObject;
+		bool first;
+	};
+
+	// Append the JSON for one token, adding the commas and colons that the encoder left out
+	bool EmitToken(const uint8_t *p, size_t length, std::string& json)
+	{
+		const CompactToken tok = (CompactToken)*p;
+		const bool isKey = (tok == CompactToken::keyRef || tok == CompactToken::keyString);
+		const bool isEnd = (tok == CompactToken::objectEnd || tok == CompactToken::arrayEnd);
+		if (!stack.empty())
+		{
+			Level& level = stack.back();
+			if (isEnd)
+			{
+				if (afterKey || level.isObject != (tok == CompactToken::objectEnd))
+				{
+					return false;
+				}
+			}
+			else if (level.isObject && !afterKey && !isKey)
+			{
+				return false;						// objects must contain key/value pairs
+			}
+			else if (!afterKey)
+			{
+				if (!level.first)
+				{
+					json += ',';
+				}
+				level.first = false;
+			}
+		}
+		else if (isEnd || isKey)
+		{
+			return false;
+		}
+		afterKey = false;
+
+		uint64_t val;
+		switch (tok)
+		{
+		case CompactToken::objectStart:		json += '{'; stack.push_back({ true, true }); break;
+		case CompactToken::arrayStart:		json += '['; stack.push_back({ false, true }); break;
+		case CompactToken::objectEnd:		json += '}'; stack.pop_back(); break;
+		case CompactToken::arrayEnd:		json += ']'; stack.pop_back(); break;
+		case CompactToken::nullValue:		json += "null"; break;
+		case CompactToken::falseValue:		json += "false"; break;
+		case CompactToken::trueValue:		json += "true"; break;
+
+		case CompactToken::integer:
+			CompactCodec::ReadVarint(p + 1, p + length, val);
+			json += std::to_string(CompactCodec::UnZigZag(val));
+			break;
+
+		case CompactToken::decimal:
+			{
+				const unsigned int places = p[1];
+				CompactCodec::ReadVarint(p + 2, p + length, val);
+				const int64_t mantissa = CompactCodec::UnZigZag(val);
+				std::string digits = std::to_string((mantissa < 0) ? -(uint64_t)mantissa : (uint64_t)mantissa);
+				if (digits.size() <= places)
+				{
+					digits.insert(0, places + 1 - digits.size(), '0');
+				}
+				digits.insert(digits.size() - places, 1, '.');
+				if (mantissa < 0)
+				{
+					json += '-';
+				}
+				json += digits;
+			}
+			break;
+
+		case CompactToken::rawNumber:
+			{
+				const size_t n = CompactCodec::ReadVarint(p + 1, p + length, val);
+				json.append(reinterpret_cast<const char *>(p + 1 + n), val);
+			}
+			break;
+
+		case CompactToken::string:
+		case CompactToken::keyString:
+			json += '"';
+			json.append(reinterpret_cast<const char *>(p + 3), length - 3);
+			json += '"';
+			if (isKey)
+			{
+				json += ':';
+				afterKey = true;
+			}
+			break;
+
+		case CompactToken::keyRef:
+			CompactCodec::ReadVarint(p + 1, p + length, val);
+			if (val >= keys.size())
+			{
+				return false;
+			}
+			json += '"';
+			json += keys[val];
+			json += "\":";
+			afterKey = true;
+			break;
+
+		default:
+			return false;
+		}
+		return true;
+	}
+
+	std::vector<std::string> keys;
+	std::vector<uint8_t> previous;
+	std::vector<Level> stack;
+	bool afterKey = false;
+};
+
+// Encode a response, splitting the text into chunks of the given size like the chain of OutputBuffers it comes from.
+// If write is false then the response is measured but not written, as when there isn't room for it in the transfer.
+static bool Encode(ObjectModelEncoder& encoder, const std::string& json, size_t chunkSize, std::vector<uint8_t>& msg, bool write = true)
+{
+	encoder.Begin();
+	for (size_t i = 0; i < json.size(); i += chunkSize)
+	{
+		if (!encoder.Feed(json.data() + i, std::min(chunkSize, json.size() - i)))
+		{
+			return false;
+		}
+	}
+	if (!encoder.End())
+	{
+		return false;
+	}
+	msg.assign(encoder.GetEncodedLength(), 0xCC);
+	if (write)
+	{
+		encoder.Write(reinterpret_cast<char *>(msg.data()));
+	}
+	return true;
+}
+
+// Build a status response like the ones the SBC polls for. Only the values change from one call to the next unless numHeaters changes.
+static std::string MakeStatus(unsigned int iteration, unsigned int numHeaters)
+{
+	char buf[256];
+	std::string s = "{\"key\":\"\",\"flags\":\"d99vno\",\"result\":{\"boards\":[{\"mcuTemp\":{\"current\":";
+	snprintf(buf, sizeof(buf), "%.1f},\"v12\":{\"current\":%.1f},\"vIn\":{\"current\":%.1f}}],", 40.0 + (iteration % 7) * 0.1, 12.1, 24.0 + (iteration % 3) * 0.1);
+	s += buf;
+	s += "\"heat\":{\"heaters\":[";
+	for (unsigned int h = 0; h < numHeaters; ++h)
+	{
+		snprintf(buf, sizeof(buf), "%s{\"active\":%.1f,\"avgPwm\":%.3f,\"current\":%.1f,\"standby\":0,\"state\":\"%s\"}",
+					(h == 0) ? "" : ",", (h == 0) ? 60.0 : 215.0, 0.25 + (iteration % 5) * 0.01, 20.0 + h * 40 + (iteration % 11) * 0.3, (iteration & 1) ? "active" : "off");
+		s += buf;
+	}
+	s += "]},\"job\":{\"filePosition\":";
+	snprintf(buf, sizeof(buf), "%u,\"layer\":%u,\"timesLeft\":{\"filament\":null,\"file\":%u}},", 123456 + iteration * 731, 5 + iteration / 20, 3600 - iteration);
+	s += buf;
+	s += "\"move\":{\"axes\":[";
+	for (unsigned int a = 0; a < 3; ++a)
+	{
+		snprintf(buf, sizeof(buf), "%s{\"machinePosition\":%.3f,\"userPosition\":%.3f}", (a == 0) ? "" : ",", (double)(a * 10) + iteration * 0.125, (double)(a * 10) + iteration * 0.125);
+		s += buf;
+	}
+	snprintf(buf, sizeof(buf), "],\"currentMove\":{\"acceleration\":%d,\"requestedSpeed\":%.1f,\"topSpeed\":%.1f},\"extruders\":[{\"position\":%.1f}]},",
+				1000, 50.0, 48.5, -2.5 + iteration);
+	s += buf;
+	snprintf(buf, sizeof(buf), "\"state\":{\"displayMessage\":\"Layer \\\"%u\\\"\",\"status\":\"processing\",\"upTime\":%u},\"tools\":[],\"volumes\":{}}}",
+				iteration / 20, 1000 + iteration);
+	s += buf;
+	return s;
+}
+
+int main()
+{
+	bool ok = true;
+	std::unique_ptr<ObjectModelEncoder> encoder(new ObjectModelEncoder);
+	std::unique_ptr<ObjectModelDecoder> decoder(new ObjectModelDecoder);
+	std::vector<uint8_t> msg;
+	std::string json;
+
+	// Round trip of a stream of status responses, with the number of heaters changing part way through
+	printf("Status responses:\n");
+	const size_t chunkSizes[] = { 1, 7, 64, 100000 };
+	size_t firstText = 0, firstEncoded = 0, laterText = 0, laterEncoded = 0;
+	bool allDecoded = true;
+	for (unsigned int i = 0; i < 200; ++i)
+	{
+		const std::string text = MakeStatus(i, (i < 100) ? 3 : 4);
+		if (!Encode(*encoder, text, chunkSizes[i % 4], msg))
+		{
+			ok = Check(false, "status response not encoded");
+			break;
+		}
+		if (!decoder->Decode(msg.data(), msg.size(), json) || json != text)
+		{
+			printf("  response %u: %s\n  decoded: %s\n", i, text.c_str(), json.c_str());
+			allDecoded = false;
+			break;
+		}
+		if (i == 0)
+		{
+			firstText = text.size();
+			firstEncoded = msg.size();
+		}
+		else
+		{
+			laterText += text.size();
+			laterEncoded += msg.size();
+		}
+	}
+	ok = Check(allDecoded, "status response decoded wrongly") && ok;
+	printf("  first response %zu bytes of JSON sent as %zu bytes\n", firstText, firstEncoded);
+	printf("  later responses %zu bytes of JSON sent as %zu bytes (%.1f%%)\n", laterText, laterEncoded, 100.0 * laterEncoded / laterText);
+	ok = Check(firstEncoded < firstText, "first response not compressed") && ok;
+	ok = Check(laterEncoded * 4 < laterText, "later responses not compressed by a factor of 4") && ok;
+
+	// A response that is measured but not written must not disturb the decoder
+	printf("Responses that are not written:\n");
+	ok = Check(Encode(*encoder, MakeStatus(300, 5), 64, msg, false), "unwritten response not encoded") && ok;
+	ok = Check(Encode(*encoder, MakeStatus(301, 4), 64, msg), "response after unwritten one not encoded") && ok;
+	ok = Check(decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(301, 4), "response after unwritten one decoded wrongly") && ok;
+	ok = Check(Encode(*encoder, MakeStatus(302, 5), 64, msg), "response with new heater not encoded") && ok;
+	ok = Check(decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(302, 5), "response with new heater decoded wrongly") && ok;
+
+	// Values that can't be sent as scaled integers, escaped strings and empty containers
+	printf("Unusual values:\n");
+	const char * const unusual[] =
+	{
+		"{\"a\":[1e-05,-0.0,-0,0.000,123456789012345678901234,-9223372036854775807,1.5E+10],\"b\":{},\"c\":[[]],\"d\":\"\\\"\\\\\\/\\n\\u00e9\"}",
+		"[null,true,false,\"x\",{\"a\":1},[]]",
+		"{\"sparse\":[null,null,{\"x\":0.5}]}",
+		"42",
+		"\"just_a_string\"",
+		"{ \"spaced\" : [ 1 , 2 ]\n}",
+	};
+	for (const char *text : unusual)
+	{
+		const bool encoded = Encode(*encoder, text, 3, msg);
+		const bool decoded = encoded && decoder->Decode(msg.data(), msg.size(), json);
+		// The decoder doesn't reproduce whitespace. None of these strings contain whitespace or escaped quotes, so just remove it all.
+		std::string expected;
+		for (const char *p = text; *p != 0; ++p)
+		{
+			if (*p != ' ' && *p != '\n')
+			{
+				expected += *p;
+			}
+		}
+		if (!decoded || json != expected)
+		{
+			printf("  %s\n  decoded: %s\n", text, json.c_str());
+			ok = Check(false, "unusual value decoded wrongly");
+		}
+	}
+
+	// Text that is not JSON must be rejected
+	printf("Text that is not JSON:\n");
+	const char * const notJson[] = { "Error: unknown value 'foo'", "{\"a\":1", "{\"a\":1}}", "{1:2}", "{\"a\":tru}", "{\"a\":\"unterminated}" };
+	for (const char *text : notJson)
+	{
+		if (Encode(*encoder, text, 5, msg))
+		{
+			printf("  %s\n", text);
+			ok = Check(false, "text that is not JSON was encoded");
+		}
+	}
+	ok = Check(encoder->GetNumFailed() == sizeof(notJson)/sizeof(notJson[0]), "failures not counted") && ok;
+	ok = Check(Encode(*encoder, MakeStatus(303, 5), 64, msg) && decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(303, 5),
+				"response after rejected text decoded wrongly") && ok;
+
+	// After the encoder is reset, e.g. because the SBC restarted, a new decoder must be able to decode the next response
+	printf("Reset:\n");
+	encoder->Reset();
+	decoder.reset(new ObjectModelDecoder);
+	ok = Check(Encode(*encoder, MakeStatus(304, 5), 64, msg), "response after reset not encoded") && ok;
+	ok = Check((msg[2] & CompactObjectModelHeader::ResetFlag) != 0, "reset flag not set") && ok;
+	ok = Check(decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(304, 5), "response after reset decoded wrongly") && ok;
+	ok = Check(Encode(*encoder, MakeStatus(305, 5), 64, msg) && (msg[2] & CompactObjectModelHeader::ResetFlag) == 0, "reset flag not cleared") && ok;
+	ok = Check(decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(305, 5), "second response after reset decoded wrongly") && ok;
+
+	// Fill the key table so that some keys have to be sent as text
+	printf("Key table full:\n");
+	std::string manyKeys = "{";
+	for (size_t i = 0; i < ObjectModelEncoder::MaxKeys + 50; ++i)
+	{
+		manyKeys += (i == 0) ? "\"k" : ",\"k";
+		manyKeys += std::to_string(i) + "\":" + std::to_string(i);
+	}
+	manyKeys += "}";
+	ok = Check(Encode(*encoder, manyKeys, 64, msg) && decoder->Decode(msg.data(), msg.size(), json) && json == manyKeys, "keys beyond the table decoded wrongly") && ok;
+	ok = Check(Encode(*encoder, MakeStatus(306, 5), 64, msg) && decoder->Decode(msg.data(), msg.size(), json) && json == MakeStatus(306, 5),
+				"response after key table full decoded wrongly") && ok;
+
+	// A response too long to keep is rejected so that it can be sent as JSON
+	std::string longText = "[\"" + std::string(ObjectModelEncoder::MaxEncodedLength, 'x') + "\"]";
+	ok = Check(!Encode(*encoder, longText, 64, msg), "response too long to keep was encoded") && ok;
+
+	printf("Encoded %" PRIu32 " responses, %" PRIu32 " bytes of JSON sent as %" PRIu32 " bytes, %" PRIu32 " rejected\n",
+			encoder->GetNumEncoded(), encoder->GetTextBytes(), encoder->GetEncodedBytes(), encoder->GetNumFailed());
+	printf("\n%s\n", (ok) ? "PASS" : "FAIL");
+	return (ok) ? 0 : 1;
+}
+
+// End
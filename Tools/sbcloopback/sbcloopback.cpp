@@ -0,0 +1,406 @@
+/*
+ * sbcloopback.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host loopback test for the SBC transfer codec. It connects two simulated ends of the SPI link, one following the rules that DataTransfer uses
+ *  and the other following the rules that the SBC must use, and runs transfers of packets between them. It checks that:
+ *  - CRC16 gives the standard check value and packets survive a round trip through the writer and reader with the correct alignment and padding;
+ *  - the writer reserves the requested space, e.g. for resend requests;
+ *  - both ends always agree on whether a transfer was pipelined, and pipelining only starts when both ends support protocol version 3;
+ *  - a short pipelined transfer takes two SPI exchanges, and long transfers, corrupted headers and corrupted data are still handled;
+ *  - an SBC restart or a firmware build without pipelining support never receives a pipelined header exchange.
+ *  It also reports the number of SPI exchanges needed to stream short G-code packets with each protocol version.
+ *
+ *  TransferCodec.h and TransferCodec.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Linux -o sbcloopback Tools/sbcloopback/sbcloopback.cpp src/Linux/TransferCodec.cpp
+ */
+
+#include "TransferCodec.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <memory>
+
+static bool Check(bool condition, const char *what) noexcept
+{
+	if (!condition)
+	{
+		printf("  FAILED: %s\n", what);
+	}
+	return condition;
+}
+
+// One end of the link
+struct Endpoint
+{
+	Endpoint(bool p_isFirmware, bool p_supportsPipelining) noexcept
+		: writer(tx.Data()), reader(rx.Data()), isFirmware(p_isFirmware), supportsPipelining(p_supportsPipelining)
+	{
+		tx.header.formatCode = LinuxFormatCode;
+		tx.header.protocolVersion = LinuxProtocolVersion;
+	}
+
+	TransferArea rx {}, tx {};
+	PacketWriter writer;
+	PacketReader reader;
+	bool isFirmware;
+	bool supportsPipelining;
+	bool firmwareSentVersion3 = false;		// true if the last header from the firmware in a completed transfer said version 3
+	uint16_t lastSequenceNumber = 0;
+	bool dataSentWithHeader = false;
+	TransferResponse response = TransferResponse::Success;
+
+	// Choose the protocol version to send and set up the header, as DataTransfer::StartNextTransfer does
+	void StartTransfer() noexcept
+	{
+		if (isFirmware)
+		{
+			tx.header.protocolVersion = (supportsPipelining && rx.header.protocolVersion == LinuxPipelinedProtocolVersion) ? LinuxPipelinedProtocolVersion : LinuxProtocolVersion;
+		}
+		else
+		{
+			tx.header.protocolVersion = (supportsPipelining) ? LinuxPipelinedProtocolVersion : LinuxProtocolVersion;
+		}
+		tx.header.sequenceNumber++;
+		TransferCodec::FinishHeader(tx.header, writer.GetNumPackets(), tx.Data(), writer.GetDataLength());
+	}
+
+	// Return true if this end expects the header exchange to include the pipelined data
+	bool LongHeaderExchange() const noexcept
+	{
+		// The firmware also has to allow for the SBC having restarted, which it detects from the sequence number
+		return firmwareSentVersion3 && (!isFirmware || rx.header.sequenceNumber == (uint16_t)(lastSequenceNumber + 1));
+	}
+
+	// Check the received header, as DataTransfer::IsReady does
+	void CheckHeaderExchange() noexcept
+	{
+		dataSentWithHeader = false;
+		if (rx.header.checksumHeader != TransferCodec::HeaderChecksum(rx.header))
+		{
+			response = TransferResponse::BadHeaderChecksum;
+			return;
+		}
+		response = TransferCodec::CheckHeader(rx.header);
+		if (response == TransferResponse::Success)
+		{
+			dataSentWithHeader = TransferCodec::DataSentWithHeader(rx.header, tx.header, LongHeaderExchange());
+			if (dataSentWithHeader)
+			{
+				CheckData();
+			}
+		}
+	}
+
+	void CheckData() noexcept
+	{
+		response = (rx.header.checksumData == TransferCodec::CRC16(rx.Data(), rx.header.dataLength)) ? TransferResponse::Success : TransferResponse::BadDataChecksum;
+	}
+
+	void TransferComplete() noexcept
+	{
+		const TransferHeader& firmwareHeader = (isFirmware) ? tx.header : rx.header;
+		firmwareSentVersion3 = (firmwareHeader.protocolVersion == LinuxPipelinedProtocolVersion);
+		lastSequenceNumber = rx.header.sequenceNumber;
+		reader.Reset(rx.header.dataLength);
+		writer.Reset();
+	}
+};
+
+enum class Fault
+{
+	none,
+	headerFromSbc,
+	headerFromFirmware,
+	dataFromSbc,
+	dataFromFirmware
+};
+
+struct TransferResult
+{
+	bool ok;
+	bool pipelined;
+	unsigned int numExchanges;
+};
+
+// Exchange bytes between the two areas starting at the header, or at the data. Apply the pending fault if it affects this exchange.
+static void Exchange(Endpoint& firmware, Endpoint& sbc, bool fromHeader, size_t length, Fault& pendingFault) noexcept
+{
+	const size_t offset = (fromHeader) ? 0 : sizeof(TransferHeader);
+	char * const fwRx = reinterpret_cast<char *>(&firmware.rx) + offset;
+	char * const sbcRx = reinterpret_cast<char *>(&sbc.rx) + offset;
+	memcpy(fwRx, reinterpret_cast<const char *>(&sbc.tx) + offset, length);
+	memcpy(sbcRx, reinterpret_cast<const char *>(&firmware.tx) + offset, length);
+
+	const size_t dataExchanged = (fromHeader) ? length - sizeof(TransferHeader) : length;
+	switch (pendingFault)
+	{
+	case Fault::headerFromSbc:
+	case Fault::headerFromFirmware:
+		if (fromHeader)
+		{
+			((pendingFault == Fault::headerFromSbc) ? firmware.rx : sbc.rx).header.dataLength ^= 0x0004;
+			pendingFault = Fault::none;
+		}
+		break;
+
+	case Fault::dataFromSbc:
+	case Fault::dataFromFirmware:
+		{
+			TransferArea& area = (pendingFault == Fault::dataFromSbc) ? firmware.rx : sbc.rx;
+			if (area.header.dataLength != 0 && dataExchanged != 0)
+			{
+				area.Data()[0] ^= 0x10;
+				pendingFault = Fault::none;
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
+
+// Run one transfer. The SBC is the SPI master so it decides how many bytes to clock in each exchange.
+static TransferResult RunTransfer(Endpoint& firmware, Endpoint& sbc, Fault fault) noexcept
+{
+	TransferResult result = { false, false, 0 };
+	firmware.StartTransfer();
+	sbc.StartTransfer();
+
+	for (unsigned int attempt = 0; attempt < 4; ++attempt)
+	{
+		// A pipelined header exchange also carries the first part of the data. The firmware always sets up for that but the SBC may clock fewer bytes.
+		const bool longExchange = sbc.LongHeaderExchange();
+		if (longExchange && !firmware.supportsPipelining)
+		{
+			printf("  SBC clocked a pipelined header exchange that the firmware can't receive\n");
+			return result;
+		}
+		Exchange(firmware, sbc, true, TransferCodec::HeaderExchangeLength(longExchange), fault);
+		firmware.CheckHeaderExchange();
+		sbc.CheckHeaderExchange();
+		result.numExchanges += 2;										// the header exchange and the response exchange
+
+		if (firmware.response == TransferResponse::Success && sbc.response == TransferResponse::Success)
+		{
+			if (firmware.dataSentWithHeader != sbc.dataSentWithHeader)
+			{
+				printf("  ends disagree about whether the transfer was pipelined\n");
+				return result;
+			}
+			if (!firmware.dataSentWithHeader && (firmware.rx.header.dataLength != 0 || sbc.rx.header.dataLength != 0))
+			{
+				// Exchange the data, retrying if it was corrupted
+				const size_t length = std::max<size_t>(firmware.rx.header.dataLength, sbc.rx.header.dataLength);
+				unsigned int dataAttempt = 0;
+				do
+				{
+					if (++dataAttempt > 4)
+					{
+						printf("  data exchange failed\n");
+						return result;
+					}
+					Exchange(firmware, sbc, false, length, fault);
+					firmware.CheckData();
+					sbc.CheckData();
+					result.numExchanges += 2;
+				} while (firmware.response != TransferResponse::Success || sbc.response != TransferResponse::Success);
+			}
+			result.ok = true;
+			result.pipelined = firmware.dataSentWithHeader;
+			firmware.TransferComplete();
+			sbc.TransferComplete();
+			return result;
+		}
+
+		// A header checksum error, or a data checksum error in a pipelined transfer, means both ends restart the transfer
+		for (const Endpoint *e : { &firmware, &sbc })
+		{
+			if (e->response != TransferResponse::Success && e->response != TransferResponse::BadHeaderChecksum && e->response != TransferResponse::BadDataChecksum)
+			{
+				printf("  unexpected response %u\n", (unsigned int)e->response);
+				return result;
+			}
+		}
+	}
+	printf("  transfer failed after repeated attempts\n");
+	return result;
+}
+
+// Write some packets resembling G-codes or replies, numbered from 'first'. Return the number written.
+static unsigned int WritePackets(PacketWriter& writer, unsigned int first, unsigned int count, size_t maxLength) noexcept
+{
+	char data[LinuxTransferBufferSize];
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const unsigned int n = first + i;
+		const size_t length = (n * 37) % (maxLength + 1);
+		if (!writer.CanWritePacket(length, 0))
+		{
+			return i;
+		}
+		for (size_t j = 0; j < length; ++j)
+		{
+			data[j] = (char)(n + j * 7);
+		}
+		writer.WritePacketHeader((uint16_t)n, length);
+		writer.WriteData(data, length);
+	}
+	return count;
+}
+
+// Read the packets written by WritePackets and check them
+static bool ReadPackets(PacketReader& reader, const char *base, unsigned int first, unsigned int count, size_t maxLength) noexcept
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		const unsigned int n = first + i;
+		const PacketHeader * const packet = reader.ReadPacket();
+		if (packet == nullptr || packet->request != (uint16_t)n || packet->id != i || packet->length != (n * 37) % (maxLength + 1))
+		{
+			printf("  packet %u missing or wrong header\n", i);
+			return false;
+		}
+		if ((reinterpret_cast<const char *>(packet) - base) % 4 != 0)
+		{
+			printf("  packet %u misaligned\n", i);
+			return false;
+		}
+		const char * const data = reader.ReadData(packet->length);
+		for (size_t j = 0; j < packet->length; ++j)
+		{
+			if (data[j] != (char)(n + j * 7))
+			{
+				printf("  packet %u data wrong at offset %u\n", i, (unsigned int)j);
+				return false;
+			}
+		}
+	}
+	return Check(reader.ReadPacket() == nullptr, "extra packet read");
+}
+
+static bool TestCodec() noexcept
+{
+	printf("Codec\n");
+	bool ok = Check(TransferCodec::CRC16("123456789", 9) == 0x4B37, "CRC16 check value");
+
+	// Round trip through the writer and reader, including packets whose lengths aren't a multiple of 4
+	std::unique_ptr<TransferArea> area(new TransferArea);
+	PacketWriter writer(area->Data());
+	const unsigned int numWritten = WritePackets(writer, 1, 50, 60);
+	ok = Check(numWritten == 50, "packets not written") && ok;
+	PacketReader reader(area->Data());
+	reader.Reset(writer.GetDataLength());
+	ok = ReadPackets(reader, area->Data(), 1, numWritten, 60) && ok;
+
+	// Strings written in several parts are concatenated, and the next packet header is aligned
+	writer.Reset();
+	writer.WritePacketHeader(1, 5);
+	writer.WriteData("ab", 2);
+	writer.WriteData("cde", 3);
+	writer.WritePacketHeader(2, 0);
+	reader.Reset(writer.GetDataLength());
+	const PacketHeader *packet = reader.ReadPacket();
+	ok = Check(packet != nullptr && packet->length == 5 && memcmp(reader.ReadData(5), "abcde", 5) == 0, "concatenated string") && ok;
+	packet = reader.ReadPacket();
+	ok = Check(packet != nullptr && packet->request == 2 && packet->id == 1 && writer.GetDataLength() == 2 * sizeof(PacketHeader) + 8, "padding") && ok;
+
+	// Space reserved for resend requests is not used
+	writer.Reset();
+	const size_t reserved = 10 * sizeof(PacketHeader);
+	ok = Check(writer.CanWritePacket(LinuxTransferBufferSize - reserved - sizeof(PacketHeader), reserved), "can't fill buffer") && ok;
+	ok = Check(!writer.CanWritePacket(LinuxTransferBufferSize - reserved - sizeof(PacketHeader) + 1, reserved), "reserved space used") && ok;
+	writer.Advance(LinuxTransferBufferSize - 4);
+	ok = Check(writer.FreeSpace(reserved) == 0 && !writer.CanWritePacket(0, reserved), "free space underflow") && ok;
+	return ok;
+}
+
+struct LinkTest
+{
+	const char *name;
+	bool firmwarePipelining;
+	bool sbcPipelining;
+	size_t maxPacketLength;
+	unsigned int packetsPerTransfer;
+	bool expectPipelined;
+};
+
+// Stream packets in both directions and check that they all arrive
+static bool TestLink(const LinkTest& test) noexcept
+{
+	std::unique_ptr<Endpoint> firmware(new Endpoint(true, test.firmwarePipelining));
+	std::unique_ptr<Endpoint> sbc(new Endpoint(false, test.sbcPipelining));
+
+	constexpr unsigned int NumTransfers = 40;
+	const Fault faults[] = { Fault::none, Fault::headerFromSbc, Fault::headerFromFirmware, Fault::dataFromSbc, Fault::dataFromFirmware };
+	bool ok = true;
+	unsigned int totalExchanges = 0, numPipelined = 0;
+	unsigned int fwWritten = 0, sbcWritten = 0;
+	for (unsigned int t = 0; t < NumTransfers && ok; ++t)
+	{
+		// Simulate an SBC restart part way through
+		if (t == NumTransfers/2)
+		{
+			sbc.reset(new Endpoint(false, test.sbcPipelining));
+			sbcWritten = 0;
+		}
+
+		const unsigned int firstFw = t * 1000, firstSbc = t * 1000 + 500;
+		fwWritten = WritePackets(firmware->writer, firstFw, test.packetsPerTransfer, test.maxPacketLength);
+		sbcWritten = WritePackets(sbc->writer, firstSbc, test.packetsPerTransfer, test.maxPacketLength);
+		const Fault fault = (t >= 10 && t < 10 + sizeof(faults)/sizeof(faults[0])) ? faults[t - 10] : Fault::none;
+		const TransferResult result = RunTransfer(*firmware, *sbc, fault);
+		if (!result.ok)
+		{
+			printf("  transfer %u failed\n", t);
+			ok = false;
+			break;
+		}
+		totalExchanges += result.numExchanges;
+		if (result.pipelined)
+		{
+			++numPipelined;
+		}
+		ok = ReadPackets(firmware->reader, firmware->rx.Data(), firstSbc, sbcWritten, test.maxPacketLength) && ok;
+		ok = ReadPackets(sbc->reader, sbc->rx.Data(), firstFw, fwWritten, test.maxPacketLength) && ok;
+	}
+
+	printf("%s: %u transfers, %u pipelined, %.2f SPI exchanges per transfer\n",
+			test.name, NumTransfers, numPipelined, (double)totalExchanges/NumTransfers);
+	if (test.expectPipelined)
+	{
+		// Pipelining starts on the third transfer after a connection because each end must see the other send version 3 first.
+		// After the SBC restarts we lose only one because we are already sending version 3. The faulty transfers are pipelined too but need extra exchanges.
+		ok = Check(numPipelined == NumTransfers - 3, "pipelining not used when expected") && ok;
+	}
+	else
+	{
+		ok = Check(numPipelined == 0, "pipelining used when not expected") && ok;
+	}
+	return ok;
+}
+
+int main()
+{
+	bool ok = TestCodec();
+
+	const LinkTest tests[] =
+	{
+		{ "Short packets, version 2 SBC", true, false, 60, 6, false },
+		{ "Short packets, version 3 SBC", true, true, 60, 6, true },
+		{ "Short packets, firmware without pipelining", false, true, 60, 6, false },
+		{ "Long packets, version 3 SBC", true, true, 400, 20, false },
+	};
+
+	for (const LinkTest& test : tests)
+	{
+		ok = TestLink(test) && ok;
+	}
+
+	printf("\n%s\n", (ok) ? "PASS" : "FAIL");
+	return (ok) ? 0 : 1;
+}
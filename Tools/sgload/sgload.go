@@ -0,0 +1,150 @@
+// sgload decodes a StallGuard load log saved by RepRapFirmware using M915 K"filename"
+// and prints the readings in CSV format, followed by a summary for each driver.
+// The summary separates readings taken during moves that were checking endstops (e.g. sensorless homing moves)
+// from other moving readings, and gives the 1st and 50th percentiles, which helps when choosing the M915 S threshold.
+// Readings taken at standstill are listed but not included in the summary because they don't measure load.
+//
+// Usage: sgload logfile
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"os"
+	"sort"
+)
+
+// fileHeader must match struct StallGuardLog::FileHeader in src/Movement/StepperDrivers/StallGuardLog.h
+type fileHeader struct {
+	Magic          [8]byte
+	Version        uint32
+	StepClockRate  uint32
+	EntrySize      uint32
+	NumEntries     uint32
+	NumRecorded    uint32
+	IntervalMillis uint32
+}
+
+// entry must match struct StallGuardLog::Entry in src/Movement/StepperDrivers/StallGuardLog.h
+type entry struct {
+	Time     uint32
+	FilePos  uint32
+	X        float32
+	Y        float32
+	SgResult uint16
+	Driver   uint8
+	Flags    uint8
+}
+
+const (
+	flagStandstill       = 0x01
+	flagStalled          = 0x02
+	flagPositionValid    = 0x04
+	flagCheckingEndstops = 0x08
+
+	noFilePosition = 0xFFFFFFFF
+)
+
+type readings []int
+
+func (r readings) summary() string {
+	if len(r) == 0 {
+		return "no readings"
+	}
+	sort.Ints(r)
+	sum := 0
+	for _, v := range r {
+		sum += v
+	}
+	return fmt.Sprintf("%d readings, min %d, 1%% %d, median %d, mean %.1f, max %d",
+		len(r), r[0], r[len(r)/100], r[len(r)/2], float64(sum)/float64(len(r)), r[len(r)-1])
+}
+
+func main() {
+	if len(os.Args) != 2 {
+		fmt.Fprintln(os.Stderr, "Usage: sgload logfile")
+		os.Exit(1)
+	}
+
+	f, err := os.Open(os.Args[1])
+	if err != nil {
+		panic(err)
+	}
+	defer f.Close()
+
+	var hdr fileHeader
+	if err = binary.Read(f, binary.LittleEndian, &hdr); err != nil {
+		panic(err)
+	}
+	if string(bytes.TrimRight(hdr.Magic[:], "\x00")) != "RRFSGLD" {
+		fmt.Fprintln(os.Stderr, "Not a StallGuard load log file")
+		os.Exit(1)
+	}
+	if hdr.Version != 1 || hdr.EntrySize != uint32(binary.Size(entry{})) {
+		fmt.Fprintf(os.Stderr, "Unsupported file version %d or entry size %d\n", hdr.Version, hdr.EntrySize)
+		os.Exit(1)
+	}
+
+	clocksToMs := 1000.0 / float64(hdr.StepClockRate)
+	fmt.Println("reading,timeMs,driver,sgResult,x,y,filePos,standstill,stalled,checkingEndstops")
+
+	homing := make(map[uint8]readings)
+	moving := make(map[uint8]readings)
+	var drivers []uint8
+	var firstTime uint32
+	numReadings := 0
+	for i := uint32(0); i < hdr.NumEntries; i++ {
+		var e entry
+		if err = binary.Read(f, binary.LittleEndian, &e); err != nil {
+			if err == io.EOF || err == io.ErrUnexpectedEOF {
+				break
+			}
+			panic(err)
+		}
+		if e.Time == 0 && e.Flags == 0 && e.SgResult == 0 {
+			continue // padding written because the entry was overwritten while the file was being saved
+		}
+		if numReadings == 0 {
+			firstTime = e.Time
+		}
+		numReadings++
+
+		x, y := "", ""
+		if e.Flags&flagPositionValid != 0 {
+			x = fmt.Sprintf("%.2f", e.X)
+			y = fmt.Sprintf("%.2f", e.Y)
+		}
+		filePos := ""
+		if e.FilePos != noFilePosition {
+			filePos = fmt.Sprint(e.FilePos)
+		}
+		fmt.Printf("%d,%.3f,%d,%d,%s,%s,%s,%t,%t,%t\n",
+			int(hdr.NumRecorded)-int(hdr.NumEntries)+int(i),
+			float64(e.Time-firstTime)*clocksToMs,
+			e.Driver, e.SgResult, x, y, filePos,
+			e.Flags&flagStandstill != 0, e.Flags&flagStalled != 0, e.Flags&flagCheckingEndstops != 0)
+
+		if e.Flags&flagStandstill != 0 {
+			continue
+		}
+		if _, ok := homing[e.Driver]; !ok {
+			if _, ok := moving[e.Driver]; !ok {
+				drivers = append(drivers, e.Driver)
+			}
+		}
+		if e.Flags&flagCheckingEndstops != 0 {
+			homing[e.Driver] = append(homing[e.Driver], int(e.SgResult))
+		} else {
+			moving[e.Driver] = append(moving[e.Driver], int(e.SgResult))
+		}
+	}
+
+	fmt.Fprintf(os.Stderr, "%d readings (of %d recorded), minimum interval %dms per driver\n", numReadings, hdr.NumRecorded, hdr.IntervalMillis)
+	sort.Slice(drivers, func(i, j int) bool { return drivers[i] < drivers[j] })
+	for _, d := range drivers {
+		fmt.Fprintf(os.Stderr, "Driver %d checking endstops: %s\n", d, homing[d].summary())
+		fmt.Fprintf(os.Stderr, "Driver %d other moves: %s\n", d, moving[d].summary())
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * thermistortable.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host test program for the thermistor lookup table. For each thermistor it builds the table the same way as the firmware does,
+ *  then compares the interpolated temperature with the exact Steinhart-Hart result over the range the table covers.
+ *  It exits with a nonzero status if the error anywhere exceeds the limit, default 0.3C. This is well below the
+ *  temperature resolution of a 12-bit ADC reading of a 100K thermistor at the top of the range.
+ *
+ *  ThermistorTable.h and ThermistorTable.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Heating/Sensors -o thermistortable Tools/thermistortable/thermistortable.cpp src/Heating/Sensors/ThermistorTable.cpp
+ *
+ *  Usage: thermistortable [maxError] [r25 beta [c]]
+ *  With no thermistor parameters it tests a selection of common thermistors.
+ */
+
+#include "ThermistorTable.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+struct ThermistorParameters
+{
+	const char *name;
+	float r25, beta, shC;
+};
+
+static const ThermistorParameters commonThermistors[] =
+{
+	{ "100K B4138 (RRF default)",	100000.0,	4138.0,		0.0 },
+	{ "100K B4725 C7.06e-8 (E3D)",	100000.0,	4725.0,		7.06e-8 },
+	{ "100K B3950",					100000.0,	3950.0,		0.0 },
+	{ "10K B3988",					10000.0,	3988.0,		0.0 },
+	{ "4.7K B3950",					4700.0,		3950.0,		0.0 },
+	{ "500K B4723 C1.19e-7 (Dyze)",	500000.0,	4723.0,		1.196220e-7 },
+	{ "1M B4267",					1000000.0,	4267.0,		0.0 },
+};
+
+// Test one thermistor, returning the maximum error found or a negative value if the table couldn't be built
+static float TestThermistor(const ThermistorParameters& p)
+{
+	// Calculate the Steinhart-Hart coefficients the same way as Thermistor::CalcDerivedParameters
+	const float shB = 1.0/p.beta;
+	const float lnR25 = logf(p.r25);
+	const float shA = 1.0/(25.0 + 273.15) - shB * lnR25 - p.shC * lnR25 * lnR25 * lnR25;
+
+	ThermistorTable table;
+	if (!table.Build(shA, shB, p.shC))
+	{
+		return -1.0;
+	}
+
+	float maxError = 0.0, worstTemperature = 0.0;
+	unsigned int numChecked = 0;
+	for (float t = ThermistorTable::MinTemperature; t <= ThermistorTable::MaxTemperature; t += 0.05)
+	{
+		// Find the resistance at this temperature by bisection on ln(R), then convert it back using the table
+		const float recipT = 1.0/(t + 273.15);
+		float low = -10.0, high = 30.0;
+		for (unsigned int i = 0; i < 60; ++i)
+		{
+			const float mid = 0.5 * (low + high);
+			((shA + shB * mid + p.shC * mid * mid * mid < recipT) ? low : high) = mid;
+		}
+		const float resistance = expf(0.5 * (low + high));
+
+		float tableTemperature;
+		if (!table.Lookup(resistance, tableTemperature))
+		{
+			printf("  %s: resistance %.2f at %.2fC is outside the table\n", p.name, (double)resistance, (double)t);
+			return 1.0e6;
+		}
+		const float error = fabsf(tableTemperature - ThermistorTable::Calculate(shA, shB, p.shC, resistance));
+		if (error > maxError)
+		{
+			maxError = error;
+			worstTemperature = t;
+		}
+		++numChecked;
+	}
+	printf("%-28s max error %.3fC at %.1fC (%u points)\n", p.name, (double)maxError, (double)worstTemperature, numChecked);
+	return maxError;
+}
+
+int main(int argc, char *argv[])
+{
+	const float errorLimit = (argc >= 2) ? strtof(argv[1], nullptr) : 0.3;
+	bool ok = true;
+	if (argc >= 4)
+	{
+		const ThermistorParameters p = { "custom", strtof(argv[2], nullptr), strtof(argv[3], nullptr), (argc >= 5) ? strtof(argv[4], nullptr) : (float)0.0 };
+		const float err = TestThermistor(p);
+		ok = err >= 0.0 && err <= errorLimit;
+	}
+	else
+	{
+		for (const ThermistorParameters& p : commonThermistors)
+		{
+			const float err = TestThermistor(p);
+			if (err < 0.0)
+			{
+				printf("%-28s table could not be built\n", p.name);
+			}
+			if (err < 0.0 || err > errorLimit)
+			{
+				ok = false;
+			}
+		}
+	}
+	printf((ok) ? "PASS\n" : "FAIL\n");
+	return (ok) ? 0 : 1;
+}
+
+// End
@@ -0,0 +1,243 @@
+/*
+ * tmcscheduler.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Host test for TmcRegisterScheduler. It runs the scheduler against a mock bus for two arrangements:
+ *  - TMC51xx: all drivers are daisy chained on SPI, so every driver does one transaction per cycle and a read result arrives in the following cycle.
+ *  - TMC22xx: drivers are polled in turn over a single UART, so each driver only gets every Nth transaction.
+ *  For each arrangement it reports the DRV_STATUS refresh rate per driver for the scheduler and for the old round robin of the read registers,
+ *  then checks that the other registers are read at close to their configured intervals, that DRV_STATUS keeps being read during a continuous
+ *  stream of writes, and that the writes get all the other transactions.
+ *
+ *  TmcRegisterScheduler.h and TmcRegisterScheduler.cpp are compiled without the rest of the firmware, so they must not include any firmware headers.
+ *  Build from the repository root with:
+ *    g++ -std=gnu++17 -O2 -Isrc/Movement/StepperDrivers -o tmcscheduler Tools/tmcscheduler/tmcscheduler.cpp src/Movement/StepperDrivers/TmcRegisterScheduler.cpp
+ */
+
+#include "TmcRegisterScheduler.h"
+#include <cstdio>
+#include <vector>
+
+constexpr unsigned int NumReadRegisters = 4;
+constexpr unsigned int ReadDrvStat = 1;
+static const char * const RegNames[NumReadRegisters] = { "GSTAT", "DRV_STATUS", "MSCNT", "PWM_SCALE" };
+
+struct BusConfig
+{
+	const char *name;
+	unsigned int numDrivers;
+	uint32_t transactionMicros;				// how long one transaction on the bus takes
+	bool chained;							// true if all drivers take part in every transaction
+	uint16_t intervals[NumReadRegisters];
+	uint16_t maxPriorityDelay;
+};
+
+struct MockDriver
+{
+	TmcRegisterScheduler scheduler;
+	unsigned int pendingWrites;
+	unsigned int pendingRead;				// register whose value arrives in the next transaction, or NoRead
+	unsigned int roundRobinIndex;
+	uint32_t readCounts[NumReadRegisters];
+	uint32_t numWrites;
+	uint32_t lastDrvStatTime, maxDrvStatGap;
+
+	static constexpr unsigned int NoRead = 0xFF;
+};
+
+struct RunResult
+{
+	double drvStatHz;						// average DRV_STATUS reads per second per driver
+	double regHz[NumReadRegisters];			// average reads per second per driver of each register
+	uint32_t maxDrvStatGapMicros;			// longest gap between DRV_STATUS reads on any driver
+	uint32_t reportedHz;					// the refresh rate reported by the scheduler for driver 0
+	uint32_t reportedMaxGap;				// the maximum gap reported by the scheduler for driver 0
+	double writesPerSecond;					// writes per second per driver
+};
+
+// Simulate the bus for the given time. If writeStorm is true then every driver always has a write pending.
+// If roundRobin is true then we use the old scheme of writing if there is anything to write, else reading the next register in turn.
+static RunResult RunBus(const BusConfig& config, uint32_t durationMillis, bool writeStorm, bool roundRobin)
+{
+	std::vector<MockDriver> drivers(config.numDrivers);
+	for (MockDriver& d : drivers)
+	{
+		d.scheduler.Init(NumReadRegisters, config.intervals, ReadDrvStat, config.maxPriorityDelay, 0);
+		d.pendingWrites = 11;				// the initial register writes after power up
+		d.pendingRead = MockDriver::NoRead;
+		d.roundRobinIndex = 0;
+		for (uint32_t& c : d.readCounts) { c = 0; }
+		d.numWrites = 0;
+		d.lastDrvStatTime = 0;
+		d.maxDrvStatGap = 0;
+	}
+
+	const uint64_t durationMicros = (uint64_t)durationMillis * 1000;
+	unsigned int nextUartDriver = 0;
+	for (uint64_t nowMicros = 0; nowMicros < durationMicros; nowMicros += config.transactionMicros)
+	{
+		const uint32_t nowMillis = (uint32_t)(nowMicros/1000);
+		for (unsigned int i = 0; i < config.numDrivers; ++i)
+		{
+			if (!config.chained && i != nextUartDriver)
+			{
+				continue;
+			}
+
+			MockDriver& d = drivers[i];
+			if (writeStorm)
+			{
+				d.pendingWrites = 1;
+			}
+
+			// Choose what to do in this transaction
+			unsigned int regToRead;
+			if (roundRobin)
+			{
+				if (d.pendingWrites != 0)
+				{
+					regToRead = TmcRegisterScheduler::WriteNext;
+				}
+				else
+				{
+					regToRead = d.roundRobinIndex;
+					d.roundRobinIndex = (d.roundRobinIndex + 1) % NumReadRegisters;
+				}
+			}
+			else
+			{
+				regToRead = d.scheduler.ChooseNext(nowMillis, d.pendingWrites != 0);
+			}
+
+			// On the chained bus the reply to a read request arrives in the next transaction. Over the UART it arrives in the same one.
+			const uint32_t replyMicros = (uint32_t)nowMicros + config.transactionMicros;
+			unsigned int regReceived = MockDriver::NoRead;
+			if (config.chained)
+			{
+				regReceived = d.pendingRead;
+				d.pendingRead = (regToRead == TmcRegisterScheduler::WriteNext) ? MockDriver::NoRead : regToRead;
+			}
+			else if (regToRead != TmcRegisterScheduler::WriteNext)
+			{
+				regReceived = regToRead;
+			}
+
+			if (regToRead == TmcRegisterScheduler::WriteNext)
+			{
+				--d.pendingWrites;
+				++d.numWrites;
+			}
+
+			if (regReceived != MockDriver::NoRead)
+			{
+				++d.readCounts[regReceived];
+				d.scheduler.ReadCompleted(regReceived, replyMicros/1000);
+				if (regReceived == ReadDrvStat)
+				{
+					const uint32_t gap = replyMicros - d.lastDrvStatTime;
+					if (gap > d.maxDrvStatGap)
+					{
+						d.maxDrvStatGap = gap;
+					}
+					d.lastDrvStatTime = replyMicros;
+				}
+			}
+		}
+		nextUartDriver = (nextUartDriver + 1) % config.numDrivers;
+	}
+
+	RunResult result;
+	const double seconds = durationMillis/1000.0;
+	for (unsigned int r = 0; r < NumReadRegisters; ++r)
+	{
+		uint64_t total = 0;
+		for (const MockDriver& d : drivers)
+		{
+			total += d.readCounts[r];
+		}
+		result.regHz[r] = total/(seconds * config.numDrivers);
+	}
+	result.drvStatHz = result.regHz[ReadDrvStat];
+	uint64_t totalWrites = 0;
+	result.maxDrvStatGapMicros = 0;
+	for (const MockDriver& d : drivers)
+	{
+		totalWrites += d.numWrites;
+		if (d.maxDrvStatGap > result.maxDrvStatGapMicros)
+		{
+			result.maxDrvStatGapMicros = d.maxDrvStatGap;
+		}
+	}
+	result.writesPerSecond = totalWrites/(seconds * config.numDrivers);
+	result.reportedHz = drivers[0].scheduler.GetPriorityRefreshRate(durationMillis, result.reportedMaxGap);
+	return result;
+}
+
+static bool Check(bool condition, const char *what)
+{
+	if (!condition)
+	{
+		printf("  FAILED: %s\n", what);
+	}
+	return condition;
+}
+
+static bool TestBus(const BusConfig& config)
+{
+	const uint32_t duration = 10000;
+	const double transactionsPerSecond = 1.0e6/config.transactionMicros/((config.chained) ? 1 : config.numDrivers);
+	printf("\n%s: %u drivers, %.0f transactions/sec per driver\n", config.name, config.numDrivers, transactionsPerSecond);
+
+	const RunResult oldResult = RunBus(config, duration, false, true);
+	const RunResult newResult = RunBus(config, duration, false, false);
+	printf("  DRV_STATUS refresh: round robin %.0fHz, scheduled %.0fHz (reported %uHz, max gap %ums)\n",
+			oldResult.drvStatHz, newResult.drvStatHz, (unsigned int)newResult.reportedHz, (unsigned int)newResult.reportedMaxGap);
+
+	bool ok = true;
+	ok = Check(newResult.drvStatHz > oldResult.drvStatHz * 2.5, "DRV_STATUS refresh rate not improved") && ok;
+	ok = Check(newResult.reportedHz + 2 >= (uint32_t)newResult.drvStatHz && newResult.reportedHz <= (uint32_t)newResult.drvStatHz + 2, "reported refresh rate wrong") && ok;
+
+	// The other registers should be read at about their configured rates. Intervals are counted in whole milliseconds, so allow some slack.
+	for (unsigned int r = 0; r < NumReadRegisters; ++r)
+	{
+		if (r != ReadDrvStat)
+		{
+			const double wantedHz = 1000.0/config.intervals[r];
+			printf("  %-9s wanted %.1fHz, got %.1fHz\n", RegNames[r], wantedHz, newResult.regHz[r]);
+			ok = Check(newResult.regHz[r] > wantedHz * 0.8 && newResult.regHz[r] < wantedHz * 1.1, "register not refreshed at its configured rate") && ok;
+		}
+	}
+
+	// With a write always pending, DRV_STATUS must still be read at least once per maximum delay, allowing for the millisecond clock resolution
+	const RunResult stormResult = RunBus(config, duration, true, false);
+	const double perDriverTransactionMicros = 1.0e6/transactionsPerSecond;
+	const double allowedGap = (config.maxPriorityDelay + 1) * 1000.0 + 2 * perDriverTransactionMicros;
+	printf("  write storm: DRV_STATUS %.0fHz, max gap %.2fms (allowed %.2fms), writes %.0f/sec\n",
+			stormResult.drvStatHz, stormResult.maxDrvStatGapMicros/1000.0, allowedGap/1000.0, stormResult.writesPerSecond);
+	ok = Check(stormResult.maxDrvStatGapMicros <= allowedGap, "DRV_STATUS starved by writes") && ok;
+	ok = Check(stormResult.writesPerSecond + stormResult.drvStatHz > transactionsPerSecond * 0.98 && stormResult.writesPerSecond > transactionsPerSecond * 0.5,
+				"writes starved by reads") && ok;
+	return ok;
+}
+
+int main()
+{
+	const BusConfig configs[] =
+	{
+		{ "TMC51xx chained SPI", 6, 100, true, { 100, 0, 100, 250 }, 5 },
+		{ "TMC51xx chained SPI", 12, 180, true, { 100, 0, 100, 250 }, 5 },
+		{ "TMC22xx UART", 5, 1200, false, { 200, 0, 200, 500 }, 20 },
+		{ "TMC22xx UART", 8, 1200, false, { 200, 0, 200, 500 }, 20 },
+	};
+
+	bool ok = true;
+	for (const BusConfig& config : configs)
+	{
+		ok = TestBus(config) && ok;
+	}
+
+	printf("\n%s\n", (ok) ? "PASS" : "FAIL");
+	return (ok) ? 0 : 1;
+}
@@ -10,6 +10,7 @@
 #if SUPPORT_CAN_EXPANSION
 
 #include "CanMotion.h"
+#include "CanTrace.h"
 #include "CommandProcessor.h"
 #include "CanMessageGenericConstructor.h"
 #include <CanMessageBuffer.h>
@@ -119,6 +120,7 @@ static Task<CanSenderTaskStackWords> canClockTask;
 
 static CanMessageBuffer * volatile pendingBuffers;
 static CanMessageBuffer * volatile lastBuffer;			// only valid when pendingBuffers != nullptr
+static unsigned int numPendingMotionBuffers = 0;		// how many buffers are in the pendingBuffers list
 
 static TaskHandle taskWaitingOnFifo0 = nullptr;
 static TaskHandle taskWaitingOnFifo1 = nullptr;
@@ -419,14 +421,17 @@ extern "C" [[noreturn]] void CanSenderLoop(void *) noexcept
 			if (urgentMessage != nullptr)
 			{
 				mcan_fd_send_ext_message(urgentMessage->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(urgentMessage->msg)), urgentMessage->dataLength, TxBufferIndexUrgent, MaxUrgentSendWait);
+				CanTrace::RecordSent(urgentMessage, CanTrace::FlagUrgent);
 			}
 			else if (pendingBuffers != nullptr)
 			{
 				CanMessageBuffer *buf;
+				unsigned int queueDepth;
 				{
 					TaskCriticalSectionLocker lock;
 					buf = pendingBuffers;
 					pendingBuffers = buf->next;
+					queueDepth = numPendingMotionBuffers--;
 				}
 
 #if 0
@@ -435,6 +440,7 @@ extern "C" [[noreturn]] void CanSenderLoop(void *) noexcept
 				// Send the message
 				mcan_fd_send_ext_message(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength,
 											TxBufferIndexMotion, MaxMotionSendWait);
+				CanTrace::RecordMotionSent(buf, buf->msg.move.whenToExecute, queueDepth);
 
 #ifdef CAN_DEBUG
 				// Display a debug message too
@@ -471,6 +477,7 @@ extern "C" [[noreturn]] void CanClockLoop(void *) noexcept
 			WaitForTxBufferFree(TxBufferIndexTimeSync, MaxTimeSyncSendWait);			// make sure we can send immediately
 			msg->timeSent = StepTimer::GetTimerTicks();
 			mcan_fd_send_ext_message_no_wait(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength, TxBufferIndexTimeSync);
+			CanTrace::RecordSent(buf, CanTrace::FlagTimeSync);
 			CanMessageBuffer::Free(buf);
 		}
 		// Delay until it is time again
@@ -655,6 +662,7 @@ void CanInterface::SendMotion(CanMessageBuffer *buf) noexcept
 		lastBuffer->next = buf;
 	}
 	lastBuffer = buf;
+	++numPendingMotionBuffers;
 	canSenderTask.Give();
 }
 
@@ -663,7 +671,9 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 {
 	taskWaitingOnFifo1 = TaskBase::GetCallerTaskHandle();
 	const CanAddress dest = buf->id.Dst();
+	const uint32_t whenRequestSent = StepTimer::GetTimerTicks();
 	mcan_fd_send_ext_message(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength, TxBufferIndexRequest, MaxRequestSendWait);
+	CanTrace::RecordSent(buf, 0);
 	const uint32_t whenStartedWaiting = millis();
 	unsigned int fragmentsReceived = 0;
 	const CanMessageType msgType = buf->id.MsgType();								// save for possible error message
@@ -693,6 +703,7 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 				{
 					if (fragmentsReceived == 0)
 					{
+						CanTrace::RecordReply(buf, msgType, whenRequestSent);
 						reply.lcatn(buf->msg.standardReply.text, buf->msg.standardReply.GetTextLength(buf->dataLength));
 						if (extra != nullptr)
 						{
@@ -707,6 +718,7 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 					}
 					else
 					{
+						CanTrace::RecordReceived(buf, 0);
 						reply.catn(buf->msg.standardReply.text, buf->msg.standardReply.GetTextLength(buf->dataLength));
 					}
 					if (!buf->msg.standardReply.moreFollows)
@@ -719,6 +731,7 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 				}
 				else
 				{
+					CanTrace::RecordReceived(buf, 0);
 					reply.lcatf("Discarded msg src=%u typ=%u RID=%u exp %u", buf->id.Src(), (unsigned int)buf->id.MsgType(), (unsigned int)buf->msg.standardReply.requestId, rid);
 				}
 			}
@@ -736,6 +749,7 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 
 	taskWaitingOnFifo1 = nullptr;
 	CanMessageBuffer::Free(buf);
+	CanTrace::RecordTimeout(msgType, dest, whenRequestSent);
 	reply.lcatf("Response timeout: CAN addr %u, req type %u, RID=%u", dest, (unsigned int)msgType, (unsigned int)rid);
 	return GCodeResult::error;
 }
@@ -744,6 +758,7 @@ GCodeResult CanInterface::SendRequestAndGetStandardReply(CanMessageBuffer *buf,
 void CanInterface::SendResponse(CanMessageBuffer *buf) noexcept
 {
 	mcan_fd_send_ext_message(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength, TxBufferIndexResponse, MaxResponseSendWait);
+	CanTrace::RecordSent(buf, 0);
 	CanMessageBuffer::Free(buf);
 }
 
@@ -751,6 +766,7 @@ void CanInterface::SendResponse(CanMessageBuffer *buf) noexcept
 void CanInterface::SendBroadcast(CanMessageBuffer *buf) noexcept
 {
 	mcan_fd_send_ext_message(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength, TxBufferBroadcast, MaxResponseSendWait);
+	CanTrace::RecordSent(buf, 0);
 	CanMessageBuffer::Free(buf);
 }
 
@@ -758,6 +774,7 @@ void CanInterface::SendBroadcast(CanMessageBuffer *buf) noexcept
 void CanInterface::SendMessageNoReplyNoFree(CanMessageBuffer *buf) noexcept
 {
 	mcan_fd_send_ext_message(buf->id.GetWholeId(), reinterpret_cast<uint8_t*>(&(buf->msg)), buf->dataLength, TxBufferBroadcast, MaxResponseSendWait);
+	CanTrace::RecordSent(buf, CanTrace::FlagUrgent);
 }
 
 // The CanReceiver task
@@ -789,6 +806,7 @@ extern "C" [[noreturn]] void CanReceiverLoop(void *) noexcept
 					buf->dataLength = dlc2len[elem.R1.bit.DLC];
 					memcpy(buf->msg.raw, elem.data, buf->dataLength);
 
+					CanTrace::RecordReceived(buf, 0);
 					CommandProcessor::ProcessReceivedMessage(buf);
 				}
 				else
@@ -808,12 +826,14 @@ void CanInterface::DisableRemoteDrivers(const CanDriversList& drivers) noexcept
 {
 	String<1> dummy;
 	(void)SetRemoteDriverStates(drivers, dummy.GetRef(), CanMessageMultipleDrivesRequest::driverDisabled);
+	CanMotion::RemoteDriversStateChanged();
 }
 
 void CanInterface::SetRemoteDriversIdle(const CanDriversList& drivers) noexcept
 {
 	String<1> dummy;
 	(void)SetRemoteDriverStates(drivers, dummy.GetRef(), CanMessageMultipleDrivesRequest::driverIdle);
+	CanMotion::RemoteDriversStateChanged();
 }
 
 bool CanInterface::SetRemoteStandstillCurrentPercent(const CanDriversData& data, const StringRef& reply) noexcept
@@ -1037,6 +1057,8 @@ void CanInterface::Diagnostics(MessageType mtype) noexcept
 	messagesSent = 0;
 	longestWaitTime = 0;
 	longestWaitMessageType = 0;
+	CanMotion::Diagnostics(mtype);
+	CanTrace::Diagnostics(mtype);
 }
 
 GCodeResult CanInterface::WriteGpio(CanAddress boardAddress, uint8_t portNumber, float pwm, bool isServo, const GCodeBuffer& gb, const StringRef &reply) THROWS(GCodeException)
@@ -12,9 +12,14 @@
 #include <CanMessageBuffer.h>
 #include <CanMessageFormats.h>
 #include "CanInterface.h"
+#include <RepRap.h>
+#include <Platform.h>
+#include <GCodes/GCodes.h>
 
 static CanMessageBuffer *movementBufferList = nullptr;
 static CanMessageBuffer *urgentMessageBuffer = nullptr;
+static CanMessageBuffer *reservedBufferList = nullptr;				// buffers allocated by CanPrepareMove for the move about to be prepared
+static unsigned int numReservedBuffers = 0;
 
 static volatile uint32_t hiccupToInsert = 0;
 static CanDriversList driversToStop[2];
@@ -23,12 +28,32 @@ static size_t indexOfNextDriverToStop = 0;
 static volatile bool stopAllFlag = false;
 static bool doingStopAll = false;
 static LargeBitmap<CanId::MaxCanAddress + 1> boardsActiveInLastMove;
+static LargeBitmap<CanId::MaxCanAddress + 1> boardsKnownEnabled;		// boards we have sent movement messages to since remote drivers were last disabled or set idle
+static LargeBitmap<CanId::MaxCanAddress + 1> boardsReset;			// boards that have announced themselves since the last move was prepared
+static volatile bool remoteDriversStateChanged = false;
+static volatile bool boardsResetPending = false;
+static uint32_t movementMessagesSent = 0;
+static uint32_t enableOnlyMessagesSkipped = 0;
+static uint32_t prepareWaitsForBuffers = 0;
 
 void CanMotion::Init() noexcept
 {
 	movementBufferList = nullptr;
 	urgentMessageBuffer = CanMessageBuffer::Allocate();
 	boardsActiveInLastMove.ClearAll();
+	boardsKnownEnabled.ClearAll();
+}
+
+// Free the buffers reserved by CanPrepareMove
+static void FreeReservedBuffers() noexcept
+{
+	while (reservedBufferList != nullptr)
+	{
+		CanMessageBuffer * const p = reservedBufferList;
+		reservedBufferList = p->next;
+		CanMessageBuffer::Free(p);
+	}
+	numReservedBuffers = 0;
 }
 
 // This is called by DDA::Prepare at the start of preparing a movement
@@ -60,8 +85,17 @@ void CanMotion::AddMovement(const DDA& dda, const PrepParams& params, DriverId c
 
 	if (buf == nullptr)
 	{
-		// Allocate a new movement buffer
-		buf = CanMessageBuffer::Allocate();
+		// Use a buffer that CanPrepareMove reserved, or allocate a new one if there are none left
+		buf = reservedBufferList;
+		if (buf != nullptr)
+		{
+			reservedBufferList = buf->next;
+			--numReservedBuffers;
+		}
+		else
+		{
+			buf = CanMessageBuffer::Allocate();
+		}
 		if (buf == nullptr)
 		{
 			return;		//TODO error handling
@@ -105,23 +139,141 @@ void CanMotion::AddMovement(const DDA& dda, const PrepParams& params, DriverId c
 	}
 }
 
+// Return true if the movement message in this buffer has steps for any of the drivers
+static bool HasSteps(const CanMessageBuffer *buf) noexcept
+{
+	for (size_t drive = 0; drive < ARRAY_SIZE(buf->msg.move.perDrive); ++drive)
+	{
+		if (buf->msg.move.perDrive[drive].steps != 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 // This is called by DDA::Prepare when all DMs for CAN drives have been processed
 void CanMotion::FinishMovement(uint32_t moveStartTime) noexcept
 {
+	if (remoteDriversStateChanged)
+	{
+		remoteDriversStateChanged = false;
+		boardsKnownEnabled.ClearAll();
+	}
+
+	if (boardsResetPending)
+	{
+		// A board that has reset or been updated has its drivers disabled, so it needs a movement message to enable them again
+		TaskCriticalSectionLocker lock;
+		boardsResetPending = false;
+		for (CanAddress board = 0; board <= CanId::MaxCanAddress; ++board)
+		{
+			if (boardsReset.IsBitSet(board))
+			{
+				boardsKnownEnabled.ClearBit(board);
+			}
+		}
+		boardsReset.ClearAll();
+	}
+
+	FreeReservedBuffers();								// release any reserved buffers that this move didn't need
+
 	boardsActiveInLastMove.ClearAll();
 	CanMessageBuffer *buf;
 	while ((buf = movementBufferList) != nullptr)
 	{
-		boardsActiveInLastMove.SetBit(buf->id.Dst());	//TODO should we set this if there were no steps for drives on the board, just drives to be enabled?
 		movementBufferList = buf->next;
-		buf->msg.move.whenToExecute = moveStartTime;
-		CanInterface::SendMotion(buf);				// queues the buffer for sending and frees it when done
+		const CanAddress board = buf->id.Dst();
+		if (boardsKnownEnabled.IsBitSet(board) && !HasSteps(buf))
+		{
+			// This message would only enable drivers that are enabled already, e.g. a CoreXY motor that doesn't turn during a 45 degree diagonal move
+			// because it is driven by the difference between the X and Y movements. Sending it would only cost bus time, and the CAN sender waits
+			// after each movement message.
+			CanMessageBuffer::Free(buf);
+			++enableOnlyMessagesSkipped;
+		}
+		else
+		{
+			boardsActiveInLastMove.SetBit(board);		//TODO should we set this if there were no steps for drives on the board, just drives to be enabled?
+			boardsKnownEnabled.SetBit(board);
+			buf->msg.move.whenToExecute = moveStartTime;
+			CanInterface::SendMotion(buf);				// queues the buffer for sending and frees it when done
+			++movementMessagesSent;
+		}
+	}
+}
+
+// Return true if we have reserved enough buffers to prepare this move. We need one for each expansion board that it may send a movement message to,
+// which on most machines is far fewer than MaxCanBoards and is none at all for moves that only use local drivers.
+// The buffers are allocated here and held until the move is prepared, so that the other tasks that use CAN buffers can't take them in the meantime.
+bool CanMotion::CanPrepareMove(const DDA& dda) noexcept
+{
+	const Platform& platform = reprap.GetPlatform();
+	const size_t numTotalAxes = reprap.GetGCodes().GetTotalAxes();
+	LargeBitmap<CanId::MaxCanAddress + 1> boardsNeeded;
+	boardsNeeded.ClearAll();
+	unsigned int numBoardsNeeded = 0;
+	auto addBoard = [&boardsNeeded, &numBoardsNeeded](DriverId driver) noexcept
+						{
+							if (driver.IsRemote() && !boardsNeeded.IsBitSet(driver.boardAddress))
+							{
+								boardsNeeded.SetBit(driver.boardAddress);
+								++numBoardsNeeded;
+							}
+						};
+	dda.GetDrivesToPrepare().Iterate([&platform, numTotalAxes, &addBoard](unsigned int drive, unsigned int) noexcept
+										{
+											if (drive < numTotalAxes)
+											{
+												const AxisDriversConfig& config = platform.GetAxisDriversConfig(drive);
+												for (size_t i = 0; i < config.numDrivers; ++i)
+												{
+													addBoard(config.driverNumbers[i]);
+												}
+											}
+											else
+											{
+												addBoard(platform.GetExtruderDriver(LogicalDriveToExtruder(drive)));
+											}
+										}
+									);
+
+	while (numReservedBuffers < numBoardsNeeded)
+	{
+		CanMessageBuffer * const buf = CanMessageBuffer::Allocate();
+		if (buf == nullptr)
+		{
+			FreeReservedBuffers();						// let the other tasks use the buffers while we wait
+			++prepareWaitsForBuffers;
+			return false;
+		}
+		buf->next = reservedBufferList;
+		reservedBufferList = buf;
+		++numReservedBuffers;
 	}
+	return true;
+}
+
+// This is called when an expansion board announces itself after it has reset or been updated
+void CanMotion::BoardReset(CanAddress boardAddress) noexcept
+{
+	TaskCriticalSectionLocker lock;
+	boardsReset.SetBit(boardAddress);
+	boardsResetPending = true;
+}
+
+// This is called when remote drivers are disabled or set idle, after which they need to be sent a movement message again to enable them.
+// It may be called from a different task from the one that prepares moves, so we just set a flag.
+void CanMotion::RemoteDriversStateChanged() noexcept
+{
+	remoteDriversStateChanged = true;
 }
 
-bool CanMotion::CanPrepareMove() noexcept
+void CanMotion::Diagnostics(MessageType mtype) noexcept
 {
-	return CanMessageBuffer::FreeBuffers() >= MaxCanBoards;
+	reprap.GetPlatform().MessageF(mtype, "Movement messages sent %" PRIu32 ", enable-only messages skipped %" PRIu32 ", waits for buffers %" PRIu32 "\n",
+									movementMessagesSent, enableOnlyMessagesSkipped, prepareWaitsForBuffers);
+	movementMessagesSent = enableOnlyMessagesSkipped = prepareWaitsForBuffers = 0;
 }
 
 // This is called by the CanSender task to check if we have any urgent messages to send
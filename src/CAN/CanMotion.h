@@ -20,8 +20,11 @@ namespace CanMotion
 	void StartMovement(const DDA& dda) noexcept;
 	void AddMovement(const DDA& dda, const PrepParams& params, DriverId canDriver, int32_t steps, bool usePressureAdvance) noexcept;
 	void FinishMovement(uint32_t moveStartTime) noexcept;
-	bool CanPrepareMove() noexcept;
+	bool CanPrepareMove(const DDA& dda) noexcept;
 	CanMessageBuffer *GetUrgentMessage() noexcept;
+	void RemoteDriversStateChanged() noexcept;
+	void BoardReset(CanAddress boardAddress) noexcept;
+	void Diagnostics(MessageType mtype) noexcept;
 
 	// The next 4 functions may be called from the step ISR, so they can't send CAN messages directly
 	void InsertHiccup(uint32_t numClocks) noexcept;
@@ -0,0 +1,397 @@
+/*
+ * CanTrace.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "CanTrace.h"
+
+#if SUPPORT_CAN_EXPANSION
+
+#include <CanMessageBuffer.h>
+#include "Platform.h"
+#include "RepRap.h"
+#include "GCodes/GCodeBuffer/GCodeBuffer.h"
+#include "Movement/StepTimer.h"
+
+CanTrace::TypeCounts CanTrace::typeCounts[MaxMessageTypes];
+size_t CanTrace::numTypesCounted = 0;
+uint32_t CanTrace::otherTypesSent = 0;
+uint32_t CanTrace::otherTypesReceived = 0;
+uint32_t CanTrace::whenCountsReset = 0;
+
+CanTrace::Histogram CanTrace::replyTimes;
+CanTrace::Histogram CanTrace::motionLeadTimes;
+uint32_t CanTrace::numRequestTimeouts = 0;
+uint32_t CanTrace::numMotionLate = 0;
+int32_t CanTrace::minMotionLeadMicros = INT32_MAX;
+unsigned int CanTrace::maxMotionQueueDepth = 0;
+
+RingLog CanTrace::capture(sizeof(CanTrace::Entry));
+bool CanTrace::captureTimeSync = false;
+
+void CanTrace::Histogram::Clear() noexcept
+{
+	for (uint32_t& c : counts)
+	{
+		c = 0;
+	}
+}
+
+void CanTrace::Histogram::Add(uint32_t micros) noexcept
+{
+	size_t bucket = 0;
+	uint32_t limit = FirstBucketLimitMicros;
+	while (bucket + 1 < NumLatencyBuckets && micros >= limit)
+	{
+		limit <<= 1;
+		++bucket;
+	}
+	++counts[bucket];
+}
+
+// Append the nonzero buckets, labelled with their upper limits in milliseconds
+void CanTrace::Histogram::Append(const StringRef& reply) const noexcept
+{
+	bool any = false;
+	uint32_t limit = FirstBucketLimitMicros;
+	for (size_t bucket = 0; bucket < NumLatencyBuckets; ++bucket)
+	{
+		if (counts[bucket] != 0)
+		{
+			if (bucket + 1 < NumLatencyBuckets)
+			{
+				reply.catf(" <%.2fms:%" PRIu32, (double)((float)limit * 0.001), counts[bucket]);
+			}
+			else
+			{
+				reply.catf(" >=%.2fms:%" PRIu32, (double)((float)(limit >> 1) * 0.001), counts[bucket]);
+			}
+			any = true;
+		}
+		limit <<= 1;
+	}
+	if (!any)
+	{
+		reply.cat(" none");
+	}
+}
+
+/*static*/ uint32_t CanTrace::ClocksToMicros(uint32_t clocks) noexcept
+{
+	return (uint32_t)(((uint64_t)clocks * 1000000u)/StepTimer::StepClockRate);
+}
+
+// Find the counts for a message type, adding it to the table if there is room. Must be called with interrupts disabled.
+/*static*/ CanTrace::TypeCounts *CanTrace::GetCounts(uint16_t msgType) noexcept
+{
+	for (size_t i = 0; i < numTypesCounted; ++i)
+	{
+		if (typeCounts[i].msgType == msgType)
+		{
+			return &typeCounts[i];
+		}
+	}
+	if (numTypesCounted == MaxMessageTypes)
+	{
+		return nullptr;
+	}
+	TypeCounts * const tc = &typeCounts[numTypesCounted++];
+	memset(tc, 0, sizeof(TypeCounts));
+	tc->msgType = msgType;
+	return tc;
+}
+
+// Add a frame to the capture buffer if capture is enabled. Must be called with interrupts disabled.
+/*static*/ void CanTrace::Capture(const CanMessageBuffer *buf, uint8_t flags, int32_t info, unsigned int queueDepth) noexcept
+{
+	if (capture.IsEnabled() && ((flags & FlagTimeSync) == 0 || captureTimeSync))
+	{
+		Entry e;
+		e.time = StepTimer::GetTimerTicks();
+		e.info = info;
+		e.msgType = (uint16_t)buf->id.MsgType();
+		e.src = buf->id.Src();
+		e.dst = buf->id.Dst();
+		e.flags = flags;
+		e.queueDepth = (uint8_t)min<unsigned int>(queueDepth, UINT8_MAX);
+		e.spare = 0;
+		e.dataLength = buf->dataLength;
+		const size_t bytesToCopy = min<size_t>(buf->dataLength, CapturedDataBytes);
+		memcpy(e.data, buf->msg.raw, bytesToCopy);
+		memset(e.data + bytesToCopy, 0, CapturedDataBytes - bytesToCopy);
+		capture.Add(&e);
+	}
+}
+
+// Record a frame that we have just sent. This is called from several tasks, so we disable interrupts while we update the counts.
+/*static*/ void CanTrace::RecordSent(const CanMessageBuffer *buf, uint8_t flags) noexcept
+{
+	const irqflags_t irqFlags = cpu_irq_save();
+	TypeCounts * const tc = GetCounts((uint16_t)buf->id.MsgType());
+	if (tc != nullptr)
+	{
+		++tc->numSent;
+		tc->bytesSent += buf->dataLength;
+	}
+	else
+	{
+		++otherTypesSent;
+	}
+	Capture(buf, flags, 0, 0);
+	cpu_irq_restore(irqFlags);
+}
+
+// Record a frame that we have just received
+/*static*/ void CanTrace::RecordReceived(const CanMessageBuffer *buf, uint8_t flags) noexcept
+{
+	const irqflags_t irqFlags = cpu_irq_save();
+	TypeCounts * const tc = GetCounts((uint16_t)buf->id.MsgType());
+	if (tc != nullptr)
+	{
+		++tc->numReceived;
+		tc->bytesReceived += buf->dataLength;
+	}
+	else
+	{
+		++otherTypesReceived;
+	}
+	Capture(buf, flags | FlagReceived, 0, 0);
+	cpu_irq_restore(irqFlags);
+}
+
+// Record a movement message that we have just sent, and how long it is until the move is due to start.
+// If that time is negative then the expansion board will start the move late.
+/*static*/ void CanTrace::RecordMotionSent(const CanMessageBuffer *buf, uint32_t whenToExecute, unsigned int queueDepth) noexcept
+{
+	const int32_t leadClocks = (int32_t)(whenToExecute - StepTimer::GetTimerTicks());
+	const int32_t leadMicros = (leadClocks >= 0) ? (int32_t)ClocksToMicros(leadClocks) : -(int32_t)ClocksToMicros(-leadClocks);
+
+	const irqflags_t irqFlags = cpu_irq_save();
+	TypeCounts * const tc = GetCounts((uint16_t)buf->id.MsgType());
+	if (tc != nullptr)
+	{
+		++tc->numSent;
+		tc->bytesSent += buf->dataLength;
+	}
+	else
+	{
+		++otherTypesSent;
+	}
+
+	if (leadMicros < 0)
+	{
+		++numMotionLate;
+	}
+	else
+	{
+		motionLeadTimes.Add(leadMicros);
+	}
+	if (leadMicros < minMotionLeadMicros)
+	{
+		minMotionLeadMicros = leadMicros;
+	}
+	if (queueDepth > maxMotionQueueDepth)
+	{
+		maxMotionQueueDepth = queueDepth;
+	}
+	Capture(buf, FlagMotion, leadMicros, queueDepth);
+	cpu_irq_restore(irqFlags);
+}
+
+// Record the first reply to a request. The caller records any further fragments using RecordReceived.
+// The reply time is recorded against the type of the request, because all replies have the same type.
+/*static*/ void CanTrace::RecordReply(const CanMessageBuffer *buf, CanMessageType requestType, uint32_t whenRequestSent) noexcept
+{
+	const uint32_t micros = ClocksToMicros(StepTimer::GetTimerTicks() - whenRequestSent);
+
+	const irqflags_t irqFlags = cpu_irq_save();
+	TypeCounts * tc = GetCounts((uint16_t)buf->id.MsgType());
+	if (tc != nullptr)
+	{
+		++tc->numReceived;
+		tc->bytesReceived += buf->dataLength;
+	}
+	else
+	{
+		++otherTypesReceived;
+	}
+	tc = GetCounts((uint16_t)requestType);
+	if (tc != nullptr && micros > tc->maxReplyMicros)
+	{
+		tc->maxReplyMicros = micros;
+	}
+	replyTimes.Add(micros);
+	Capture(buf, FlagReceived | FlagReply, (int32_t)micros, 0);
+	cpu_irq_restore(irqFlags);
+}
+
+// Record a request that timed out. We count it against the type of the request, because there is no reply.
+/*static*/ void CanTrace::RecordTimeout(CanMessageType msgType, CanAddress dest, uint32_t whenRequestSent) noexcept
+{
+	const uint32_t micros = ClocksToMicros(StepTimer::GetTimerTicks() - whenRequestSent);
+
+	const irqflags_t irqFlags = cpu_irq_save();
+	TypeCounts * const tc = GetCounts((uint16_t)msgType);
+	if (tc != nullptr)
+	{
+		++tc->numTimeouts;
+	}
+	++numRequestTimeouts;
+
+	if (capture.IsEnabled())
+	{
+		Entry e;
+		memset(&e, 0, sizeof(e));
+		e.time = StepTimer::GetTimerTicks();
+		e.info = (int32_t)micros;
+		e.msgType = (uint16_t)msgType;
+		e.src = CanId::MasterAddress;
+		e.dst = dest;
+		e.flags = FlagTimeout;
+		capture.Add(&e);
+	}
+	cpu_irq_restore(irqFlags);
+}
+
+/*static*/ void CanTrace::ResetCounts() noexcept
+{
+	const irqflags_t irqFlags = cpu_irq_save();
+	numTypesCounted = 0;
+	otherTypesSent = otherTypesReceived = 0;
+	whenCountsReset = millis();
+	cpu_irq_restore(irqFlags);
+}
+
+// Process M954
+// C<n> set the number of capture entries, or zero to disable capture
+// T<0|1> whether to capture time sync messages, which are sent several times a second
+// R1 reset the message counts
+// F"filename" save the capture
+// With no parameters, report the capture status and the message counts for each type since they were last reset
+/*static*/ GCodeResult CanTrace::Configure(GCodeBuffer& gb, const StringRef& reply, OutputBuffer *& buf) THROWS(GCodeException)
+{
+	bool seen = false;
+	bool bval;
+	if (gb.TryGetBValue('T', bval, seen))
+	{
+		captureTimeSync = bval;
+	}
+
+	uint32_t val;
+	if (gb.TryGetLimitedUIValue('C', val, seen, MaxEntries + 1))
+	{
+		capture.Configure(val);
+	}
+
+	if (gb.Seen('R'))
+	{
+		seen = true;
+		if (gb.GetUIValue() != 0)
+		{
+			ResetCounts();
+		}
+	}
+
+#if HAS_MASS_STORAGE
+	if (gb.Seen('F'))
+	{
+		String<MaxFilenameLength> captureFileName;
+		gb.GetQuotedString(captureFileName.GetRef());
+		return WriteToFile(captureFileName.c_str(), reply);
+	}
+#endif
+
+	if (!seen)
+	{
+		// The counts for all message types don't fit in the reply, so we use an output buffer
+		if (!OutputBuffer::Allocate(buf))
+		{
+			return GCodeResult::notFinished;
+		}
+
+		if (capture.IsEnabled())
+		{
+			buf->printf("CAN capture %u entries, %" PRIu32 " recorded, time sync messages %s",
+							capture.GetNumEntries(), capture.GetNumRecorded(), (captureTimeSync) ? "captured" : "not captured");
+		}
+		else
+		{
+			buf->copy("CAN capture disabled");
+		}
+
+		// Take a copy of the counts so that we can print them without keeping interrupts disabled
+		TypeCounts counts[MaxMessageTypes];
+		const irqflags_t flags = cpu_irq_save();
+		const size_t numTypes = numTypesCounted;
+		memcpy(counts, typeCounts, numTypes * sizeof(TypeCounts));
+		const uint32_t otherSent = otherTypesSent, otherReceived = otherTypesReceived;
+		cpu_irq_restore(flags);
+
+		const uint32_t seconds = max<uint32_t>((millis() - whenCountsReset)/1000, 1);
+		buf->lcatf("Message counts over %" PRIu32 "s (type: sent/bytes received/bytes, max reply time, timeouts):", seconds);
+		for (size_t i = 0; i < numTypes; ++i)
+		{
+			const TypeCounts& tc = counts[i];
+			buf->lcatf("%u: %" PRIu32 "/%" PRIu32 " %" PRIu32 "/%" PRIu32, tc.msgType, tc.numSent, tc.bytesSent, tc.numReceived, tc.bytesReceived);
+			if (tc.maxReplyMicros != 0 || tc.numTimeouts != 0)
+			{
+				buf->catf(", %.2fms, %" PRIu32, (double)((float)tc.maxReplyMicros * 0.001), tc.numTimeouts);
+			}
+		}
+		if (otherSent != 0 || otherReceived != 0)
+		{
+			buf->lcatf("other types: %" PRIu32 " sent %" PRIu32 " received", otherSent, otherReceived);
+		}
+	}
+	return GCodeResult::ok;
+}
+
+// Print and clear the histograms. This is called from CanInterface::Diagnostics.
+/*static*/ void CanTrace::Diagnostics(MessageType mtype) noexcept
+{
+	String<StringLength256> buf;
+	const irqflags_t flags = cpu_irq_save();
+	const Histogram replies = replyTimes, leads = motionLeadTimes;
+	const uint32_t timeouts = numRequestTimeouts, late = numMotionLate;
+	const int32_t minLead = minMotionLeadMicros;
+	const unsigned int maxDepth = maxMotionQueueDepth;
+	replyTimes.Clear();
+	motionLeadTimes.Clear();
+	numRequestTimeouts = numMotionLate = 0;
+	minMotionLeadMicros = INT32_MAX;
+	maxMotionQueueDepth = 0;
+	cpu_irq_restore(flags);
+
+	buf.copy("Reply times:");
+	replies.Append(buf.GetRef());
+	buf.catf(", timeouts %" PRIu32 "\nMovement lead times:", timeouts);
+	leads.Append(buf.GetRef());
+	buf.catf(", late %" PRIu32, late);
+	if (minLead != INT32_MAX)
+	{
+		buf.catf(", min %.2fms", (double)((float)minLead * 0.001));
+	}
+	buf.catf(", max queued %u\n", maxDepth);
+	reprap.GetPlatform().Message(mtype, buf.c_str());
+}
+
+#if HAS_MASS_STORAGE
+
+// Save the capture to a file in binary form, oldest entry first. Capture continues while we do this.
+/*static*/ GCodeResult CanTrace::WriteToFile(const char *filename, const StringRef& reply) noexcept
+{
+	if (!capture.IsEnabled())
+	{
+		reply.copy("CAN capture is not enabled");
+		return GCodeResult::error;
+	}
+	return capture.WriteToFile(filename, "RRFCANT", FileVersion, CapturedDataBytes, "frames", reply);
+}
+
+#endif
+
+#endif
+
+// End
@@ -0,0 +1,120 @@
+/*
+ * CanTrace.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  This class monitors CAN bus traffic so that the bus load and latencies can be measured when sizing a CAN system.
+ *  It always keeps message and byte counts for each message type, a histogram of the times taken by expansion boards to reply to requests,
+ *  and a histogram of how far ahead of their start times movement messages are sent. The histograms are reported and cleared by M122.
+ *  Optionally it also captures the frames sent and received, with timestamps, in a ring buffer that is only allocated when capture is enabled.
+ *  Capture is configured using M954 C, and the capture can be saved in binary form using M954 F and decoded on a PC using the tool in Tools/cantrace.
+ */
+
+#ifndef SRC_CAN_CANTRACE_H_
+#define SRC_CAN_CANTRACE_H_
+
+#include "RepRapFirmware.h"
+
+#if SUPPORT_CAN_EXPANSION
+
+#include "MessageType.h"
+#include "GCodes/GCodeResult.h"
+#include "RingLog.h"
+#include <CanId.h>
+
+class CanMessageBuffer;
+
+class CanTrace
+{
+public:
+	static constexpr unsigned int MaxEntries = 1000;
+	static constexpr size_t CapturedDataBytes = 16;								// how many bytes of each frame we capture
+	static constexpr size_t MaxMessageTypes = 24;								// how many different message types we keep counts for
+	static constexpr size_t NumLatencyBuckets = 12;
+	static constexpr uint32_t FirstBucketLimitMicros = 250;						// the upper limit of the first histogram bucket, each one after that is twice as wide
+
+	// Bits in the flags field of a capture entry, also passed to the Record functions
+	static constexpr uint8_t FlagReceived = 0x01;								// the frame was received, else it was sent
+	static constexpr uint8_t FlagMotion = 0x02;									// a movement message, the info field is the time before the move is due to start
+	static constexpr uint8_t FlagReply = 0x04;									// the first reply to one of our requests, the info field is the time we waited for it
+	static constexpr uint8_t FlagTimeout = 0x08;								// a request that wasn't replied to, no data was captured
+	static constexpr uint8_t FlagTimeSync = 0x10;								// a time sync message, only captured if enabled using M954 T1
+	static constexpr uint8_t FlagUrgent = 0x20;									// an urgent message such as a Stop Movement message
+
+	static void RecordSent(const CanMessageBuffer *buf, uint8_t flags) noexcept;
+	static void RecordReceived(const CanMessageBuffer *buf, uint8_t flags) noexcept;
+	static void RecordMotionSent(const CanMessageBuffer *buf, uint32_t whenToExecute, unsigned int queueDepth) noexcept;
+	static void RecordReply(const CanMessageBuffer *buf, CanMessageType requestType, uint32_t whenRequestSent) noexcept;
+	static void RecordTimeout(CanMessageType msgType, CanAddress dest, uint32_t whenRequestSent) noexcept;
+
+	static GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply, OutputBuffer *& buf) THROWS(GCodeException);	// Process M954
+	static void Diagnostics(MessageType mtype) noexcept;						// Print and clear the histograms
+
+private:
+	// Layout of a capture entry. This is also the format of each record in the binary file, so don't change it without changing the file version.
+	struct Entry
+	{
+		uint32_t time;									// when the frame was sent or received, in step clocks
+		int32_t info;									// time in microseconds, see the flags
+		uint16_t msgType;								// the CAN message type
+		uint8_t src;									// source board address
+		uint8_t dst;									// destination board address
+		uint8_t dataLength;								// the full data length of the frame, of which we capture the first CapturedDataBytes
+		uint8_t flags;									// see the Flag constants above
+		uint8_t queueDepth;								// for movement messages, how many were waiting to be sent including this one
+		uint8_t spare;
+		uint8_t data[CapturedDataBytes];
+	};
+	static_assert(sizeof(Entry) == 32 && sizeof(Entry) <= RingLog::MaxEntrySize);
+
+	// The file has the standard RingLog header with magic "RRFCANT", and the header param field is CapturedDataBytes
+	static constexpr uint32_t FileVersion = 1;
+
+	struct TypeCounts
+	{
+		uint16_t msgType;
+		uint32_t numSent, bytesSent;
+		uint32_t numReceived, bytesReceived;
+		uint32_t maxReplyMicros;						// the longest time we waited for a reply to a request of this type
+		uint32_t numTimeouts;
+	};
+
+	class Histogram
+	{
+	public:
+		void Clear() noexcept;
+		void Add(uint32_t micros) noexcept;
+		void Append(const StringRef& reply) const noexcept;
+
+	private:
+		uint32_t counts[NumLatencyBuckets];
+	};
+
+	static TypeCounts *GetCounts(uint16_t msgType) noexcept;
+	static void Capture(const CanMessageBuffer *buf, uint8_t flags, int32_t info, unsigned int queueDepth) noexcept;
+	static uint32_t ClocksToMicros(uint32_t clocks) noexcept;
+	static void ResetCounts() noexcept;
+#if HAS_MASS_STORAGE
+	static GCodeResult WriteToFile(const char *filename, const StringRef& reply) noexcept;	// Save the capture in binary form
+#endif
+
+	static TypeCounts typeCounts[MaxMessageTypes];
+	static size_t numTypesCounted;
+	static uint32_t otherTypesSent, otherTypesReceived;	// messages whose types didn't fit in the table
+	static uint32_t whenCountsReset;					// millis() when the type counts were reset
+
+	static Histogram replyTimes;						// times taken by expansion boards to reply to requests
+	static Histogram motionLeadTimes;					// times between sending movement messages and their start times
+	static uint32_t numRequestTimeouts;
+	static uint32_t numMotionLate;						// movement messages sent after the move was due to start
+	static int32_t minMotionLeadMicros;
+	static unsigned int maxMotionQueueDepth;
+
+	static RingLog capture;
+	static bool captureTimeSync;
+};
+
+#endif
+
+#endif /* SRC_CAN_CANTRACE_H_ */
@@ -10,6 +10,7 @@
 #if SUPPORT_CAN_EXPANSION
 
 #include <CAN/CanInterface.h>
+#include <CAN/CanMotion.h>
 #include <RepRap.h>
 #include <Platform.h>
 
@@ -117,6 +118,7 @@ void ExpansionManager::ProcessAnnouncement(CanMessageBuffer *buf) noexcept
 		String<StringLength100> boardTypeAndFirmwareVersion;
 		boardTypeAndFirmwareVersion.copy(buf->msg.announce.boardTypeAndFirmwareVersion, CanMessageAnnounce::GetMaxTextLength(buf->dataLength));
 		UpdateBoardState(src, BoardState::unknown);
+		CanMotion::BoardReset(src);							// the board has reset, so its drivers are no longer enabled
 		if (board.typeName == nullptr || strcmp(board.typeName, boardTypeAndFirmwareVersion.c_str()) != 0)
 		{
 			const char *newTypeName = nullptr;
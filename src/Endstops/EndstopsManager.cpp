@@ -197,13 +197,14 @@ bool EndstopsManager::EnableAxisEndstops(AxesBitmap axes, bool forHoming) noexce
 }
 
 // Set up the active endstops for Z probing, returning true if successful
-bool EndstopsManager::EnableZProbe(size_t probeNumber, bool probingAway) noexcept
+bool EndstopsManager::EnableZProbe(size_t probeNumber, bool probingAway, bool scanning) noexcept
 {
 	activeEndstops = nullptr;
 	isHomingMove = false;
 	if (probeNumber < MaxZProbes && zProbes[probeNumber] != nullptr)
 	{
 		zProbes[probeNumber]->SetProbingAway(probingAway);
+		zProbes[probeNumber]->SetScanning(scanning);
 		AddToActive(*zProbes[probeNumber]);
 	}
 	return true;
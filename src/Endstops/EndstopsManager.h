@@ -34,7 +34,7 @@ public:
 	bool EnableAxisEndstops(AxesBitmap axes, bool forHoming) noexcept __attribute__ ((warn_unused_result));
 
 	// Set up the active endstops for Z probing returning true if successful
-	bool EnableZProbe(size_t probeNumber, bool probingAway = false) noexcept __attribute__ ((warn_unused_result));
+	bool EnableZProbe(size_t probeNumber, bool probingAway = false, bool scanning = false) noexcept __attribute__ ((warn_unused_result));
 
 	// Enable extruder endstops
 	bool EnableExtruderEndstops(ExtrudersBitmap extruders) noexcept;
@@ -90,7 +90,7 @@ void ZProbe::SetDefaults() noexcept
 	recoveryTime = 0.0;
 	tolerance = DefaultZProbeTolerance;
 	misc.parts.maxTaps = DefaultZProbeTaps;
-	misc.parts.turnHeatersOff = misc.parts.saveToConfigOverride = misc.parts.probingAway = false;
+	misc.parts.turnHeatersOff = misc.parts.saveToConfigOverride = misc.parts.probingAway = misc.parts.scanning = false;
 	type = ZProbeType::none;
 	sensor = -1;
 }
@@ -211,7 +211,8 @@ EndstopHitDetails ZProbe::CheckTriggered(bool goingSlow) noexcept
 		break;
 
 	case EndStopHit::nearStop:
-		if (!goingSlow)
+		// Reducing speed is only valid for moves without acceleration or deceleration, which a scanning move at travel speed has
+		if (!goingSlow && !misc.parts.scanning)
 		{
 			rslt.SetAction(EndstopHitAction::reduceSpeed);
 		}
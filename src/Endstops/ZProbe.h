@@ -54,6 +54,7 @@ public:
 	bool IsDeployedByUser() const noexcept { return isDeployedByUser; }
 
 	void SetProbingAway(const bool probingAway) noexcept { misc.parts.probingAway = probingAway; }
+	void SetScanning(const bool scanning) noexcept { misc.parts.scanning = scanning; }
 	GCodeResult HandleG31(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
 	void SetTriggerHeight(float height) noexcept { triggerHeight = height; }
 	void SetSaveToConfigOverride() noexcept { misc.parts.saveToConfigOverride = true; }
@@ -81,7 +82,8 @@ protected:
 			uint16_t maxTaps : 5,			// maximum probes at each point
 				probingAway : 1,			// true if we are probing away, i.e. until contact lost
 				turnHeatersOff : 1,			// true to turn heaters off while probing
-				saveToConfigOverride : 1;	// true if the trigger height should be saved to config-override.g
+				saveToConfigOverride : 1,	// true if the trigger height should be saved to config-override.g
+				scanning : 1;				// true if we are scanning the grid, so the move must not be slowed down near the threshold
 		} parts;
 		uint16_t all;
 	} misc;
@@ -0,0 +1,155 @@
+/*
+ * GCodeChannelScheduler.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "GCodeChannelScheduler.h"
+#include "GCodeBuffer/GCodeBuffer.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+GCodeChannelScheduler::GCodeChannelScheduler() noexcept : orderLength(0), orderIndex(0), turnsUsed(0), lastDiagnosticsTime(0)
+{
+	for (size_t i = 0; i < NumScheduledChannels; ++i)
+	{
+		budgets[i] = 1;
+		priorities[i] = 0;
+	}
+	budgets[GCodeChannel(GCodeChannel::File).RawValue()] = DefaultFileBudget;
+	for (uint32_t& count : commandsStarted)
+	{
+		count = 0;
+	}
+	MakeOrder();
+}
+
+// Start a new pass, keeping the configuration
+void GCodeChannelScheduler::Reset() noexcept
+{
+	orderIndex = 0;
+	turnsUsed = 0;
+}
+
+// Return true if the channel has a command to run or is running a file
+/*static*/ bool GCodeChannelScheduler::HasWork(const GCodeBuffer& gb) noexcept
+{
+	return !gb.IsCompletelyIdle()
+#if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
+		|| gb.MachineState().DoingFile()
+#endif
+		;
+}
+
+// Return the number of the channel to service next
+size_t GCodeChannelScheduler::Next(GCodeBuffer * const sources[], bool movesCanBeQueued) noexcept
+{
+	// Give the current channel another turn if it has some of its budget left and still has work to do
+	const size_t current = order[orderIndex];
+	if (turnsUsed < budgets[current] && movesCanBeQueued && sources[current] != nullptr && HasWork(*sources[current]))
+	{
+		++turnsUsed;
+		return current;
+	}
+
+	// Move on to the next channel. We must have at least one GCode source, so this can't loop indefinitely.
+	size_t next;
+	do
+	{
+		++orderIndex;
+		if (orderIndex == orderLength)
+		{
+			orderIndex = 0;
+		}
+		next = order[orderIndex];
+	} while (sources[next] == nullptr);
+
+	turnsUsed = 1;
+	return next;
+}
+
+// Build the order of visits in a pass. The pass has MaxPriority + 1 parts. The first part visits the channels with the highest priority,
+// and each part after that also visits the channels with the next lower priority, so a channel of priority N is visited N + 1 times.
+// Within each part the channels are visited in order of priority, keeping channel number order for channels of equal priority.
+void GCodeChannelScheduler::MakeOrder() noexcept
+{
+	size_t n = 0;
+	for (int lowestPrio = MaxPriority; lowestPrio >= 0; --lowestPrio)
+	{
+		for (int prio = MaxPriority; prio >= lowestPrio; --prio)
+		{
+			for (size_t i = 0; i < NumScheduledChannels; ++i)
+			{
+				if (priorities[i] == prio)
+				{
+					order[n++] = i;
+				}
+			}
+		}
+	}
+	orderLength = n;
+	Reset();
+}
+
+// Process M583. Set the budget and priority of a channel, or report them.
+// The P parameter is the channel number, so the reports give the number of each channel as well as its name.
+GCodeResult GCodeChannelScheduler::Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	if (gb.Seen('P'))
+	{
+		const size_t chan = gb.GetLimitedUIValue('P', NumScheduledChannels);
+		bool seen = false;
+		uint32_t budget = budgets[chan], priority = priorities[chan];
+		gb.TryGetLimitedUIValue('S', budget, seen, MaxBudget + 1);
+		gb.TryGetLimitedUIValue('R', priority, seen, MaxPriority + 1);
+		if (seen)
+		{
+			if (budget == 0)
+			{
+				reply.copy("Budget must be at least 1");
+				return GCodeResult::error;
+			}
+			budgets[chan] = budget;
+			if (priorities[chan] != priority)
+			{
+				priorities[chan] = priority;
+				MakeOrder();
+			}
+			return GCodeResult::ok;
+		}
+		reply.printf("Channel %u (%s): budget %u, priority %u", (unsigned int)chan, GCodeChannel(chan).ToString(), (unsigned int)budgets[chan], (unsigned int)priorities[chan]);
+		return GCodeResult::ok;
+	}
+
+	// The last part of the pass visits every channel once, in order of priority
+	reply.copy("Channels in order of priority (number:name budget/priority):");
+	for (size_t i = orderLength - NumScheduledChannels; i < orderLength; ++i)
+	{
+		const size_t chan = order[i];
+		reply.catf(" %u:%s %u/%u", (unsigned int)chan, GCodeChannel(chan).ToString(), (unsigned int)budgets[chan], (unsigned int)priorities[chan]);
+	}
+	reply.catf(", %u visits per pass", (unsigned int)orderLength);
+	return GCodeResult::ok;
+}
+
+// Report the rate at which each channel has started commands since the last call
+void GCodeChannelScheduler::Diagnostics(MessageType mtype) noexcept
+{
+	const uint32_t now = millis();
+	const float interval = (float)(now - lastDiagnosticsTime) * MillisToSeconds;
+	lastDiagnosticsTime = now;
+
+	String<StringLength256> rates;
+	for (size_t i = 0; i < NumGCodeChannels; ++i)
+	{
+		if (commandsStarted[i] != 0)
+		{
+			rates.catf(" %s %.1f", GCodeChannel(i).ToString(), (double)((float)commandsStarted[i]/interval));
+			commandsStarted[i] = 0;
+		}
+	}
+	reprap.GetPlatform().MessageF(mtype, "Commands per second:%s\n", (rates.IsEmpty()) ? " none" : rates.c_str());
+}
+
+// End
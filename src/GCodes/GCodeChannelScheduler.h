@@ -0,0 +1,57 @@
+/*
+ * GCodeChannelScheduler.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Chooses which GCodeBuffer GCodes::Spin services next.
+ *  The channels are serviced in turn. Each pass visits a channel of priority N a total of N + 1 times, so a higher priority channel
+ *  is serviced more often, while every channel is still visited at least once per pass.
+ *  Within each part of the pass the channels are visited in order of priority, then in channel number order.
+ *  On each visit a channel that has work to do keeps being serviced for up to its budget of turns in a row, provided that moves can still be queued;
+ *  otherwise it gets one turn, as do channels that are idle, so that they can still check for input.
+ *  The autopause channel is not scheduled here, it always runs first when it is active.
+ */
+
+#ifndef SRC_GCODES_GCODECHANNELSCHEDULER_H_
+#define SRC_GCODES_GCODECHANNELSCHEDULER_H_
+
+#include "RepRapFirmware.h"
+#include "GCodeChannel.h"
+#include "GCodeResult.h"
+#include "GCodeException.h"
+
+class GCodeChannelScheduler
+{
+public:
+	static constexpr unsigned int MaxBudget = 16;
+	static constexpr unsigned int MaxPriority = 3;
+	static constexpr unsigned int DefaultFileBudget = 4;
+
+	GCodeChannelScheduler() noexcept;
+
+	void Reset() noexcept;														// Start a new pass, keeping the configuration
+	size_t Next(GCodeBuffer * const sources[], bool movesCanBeQueued) noexcept;	// Return the number of the channel to service next
+	void CommandStarted(GCodeChannel chan) noexcept { ++commandsStarted[chan.RawValue()]; }
+
+	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);
+	void Diagnostics(MessageType mtype) noexcept;
+
+private:
+	static constexpr size_t NumScheduledChannels = NumGCodeChannels - 1;		// the last channel is autopause, which isn't scheduled
+
+	static bool HasWork(const GCodeBuffer& gb) noexcept;
+	void MakeOrder() noexcept;
+
+	uint8_t budgets[NumScheduledChannels];
+	uint8_t priorities[NumScheduledChannels];
+	uint8_t order[NumScheduledChannels * (MaxPriority + 1)];					// the channel numbers in the order that they are visited in each pass
+	size_t orderLength;															// the number of visits in each pass
+	size_t orderIndex;															// where we are in the pass
+	unsigned int turnsUsed;														// how many turns in a row the current channel has had
+
+	uint32_t commandsStarted[NumGCodeChannels];
+	uint32_t lastDiagnosticsTime;
+};
+
+#endif /* SRC_GCODES_GCODECHANNELSCHEDULER_H_ */
@@ -62,7 +62,8 @@ enum class GCodeState : uint8_t
 	stoppingWithHeatersOff,
 	stoppingWithHeatersOn,
 
-	// These next 9 must be contiguous
+	// These next 10 must be contiguous
+	gridProbing0,
 	gridProbing1,
 	gridProbing2a,
 	gridProbing2b,
@@ -73,6 +74,18 @@ enum class GCodeState : uint8_t
 	gridProbing6,
 	gridProbing7,
 
+	// These next 10 must be contiguous
+	gridScanning1,
+	gridScanning2,
+	gridScanning3,
+	gridScanning4,
+	gridScanning5,
+	gridScanning6,
+	gridScanning7,
+	gridScanning8,
+	gridScanning9,
+	gridScanning10,
+
 	// These next 10 must be contiguous
 	probingAtPoint0,
 	probingAtPoint1,
@@ -207,7 +207,7 @@ void GCodes::Reset() noexcept
 		auxGCode->SetCommsProperties(1);				// by default, we require a checksum on the aux port
 	}
 
-	nextGcodeSource = 0;
+	channelScheduler.Reset();
 
 #if HAS_MASS_STORAGE
 	fileToPrint.Close();
@@ -276,7 +276,7 @@ void GCodes::Reset() noexcept
 	isPowerFailPaused = false;
 #endif
 	doingToolChange = false;
-	doingManualBedProbe = false;
+	doingManualBedProbe = doingAdaptiveGridProbe = doingGridScan = false;
 #if HAS_LINUX_INTERFACE
 	lastFilePosition = noFilePosition;
 #endif
@@ -419,7 +419,8 @@ void GCodes::Spin() noexcept
 	CheckHeaterFault();
 	CheckFilament();
 
-	// Get the GCodeBuffer that we want to process a command from. Use round-robin scheduling but give priority to auto-pause.
+	// Get the GCodeBuffer that we want to process a command from. Let the scheduler choose but give priority to auto-pause.
+	// A channel only gets extra turns in a row while Move has taken the last move we generated, because otherwise another move would have to wait anyway.
 	GCodeBuffer *gbp = autoPauseGCode;
 	if (gbp->IsCompletelyIdle()
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
@@ -427,15 +428,7 @@ void GCodes::Spin() noexcept
 #endif
 	   )	// if autoPause is not active
 	{
-		do
-		{
-			gbp = gcodeSources[nextGcodeSource];
-			++nextGcodeSource;										// move on to the next gcode source ready for next time
-			if (nextGcodeSource == ARRAY_SIZE(gcodeSources) - 1)	// the last one is autoPauseGCode, so don't do it again
-			{
-				nextGcodeSource = 0;
-			}
-		} while (gbp == nullptr);									// we must have at least one GCode source, so this can't loop indefinitely
+		gbp = gcodeSources[channelScheduler.Next(gcodeSources, segmentsLeft == 0)];
 	}
 	GCodeBuffer& gb = *gbp;
 
@@ -502,6 +495,7 @@ void GCodes::StartNextGCode(GCodeBuffer& gb, const StringRef& reply) noexcept
 	}
 	else if (gb.IsReady())
 	{
+		channelScheduler.CommandStarted(gb.GetChannel());
 		bool done;
 		try
 		{
@@ -1484,6 +1478,7 @@ void GCodes::Diagnostics(MessageType mtype) noexcept
 	}
 
 	codeQueue->Diagnostics(mtype);
+	channelScheduler.Diagnostics(mtype);
 }
 
 // Lock movement and wait for pending moves to finish.
@@ -2794,6 +2789,105 @@ void GCodes::DoManualBedProbe(GCodeBuffer& gb)
 	DoManualProbe(gb, "Adjust height until the nozzle just touches the bed, then press OK", "Manual bed probing", AxesBitmap::MakeFromBits(Z_AXIS));
 }
 
+// Get the coordinates of a grid point from its index in the height map
+static void GetGridProbeCoordinates(const void *context, uint16_t pointId, float& x, float& y) noexcept
+{
+	const GridDefinition * const grid = static_cast<const GridDefinition*>(context);
+	x = grid->GetXCoordinate(pointId % grid->NumXpoints());
+	y = grid->GetYCoordinate(pointId / grid->NumXpoints());
+}
+
+// Get the X coordinate of a grid column for the grid scanner
+static float GetGridXCoordinate(const void *context, uint32_t xIndex) noexcept
+{
+	return static_cast<const HeightMap*>(context)->GetGrid().GetXCoordinate(xIndex);
+}
+
+// Store a height error found by the grid scanner in the height map
+static void SetGridHeightError(void *context, uint32_t xIndex, uint32_t yIndex, float heightError) noexcept
+{
+	static_cast<HeightMap*>(context)->SetGridHeight(xIndex, yIndex, heightError);
+}
+
+// Make the list of grid points to probe in serpentine order, leaving out points outside the probing radius
+void GCodes::BuildGridProbePath() noexcept
+{
+	probePathOptimiser.Clear();
+	for (uint32_t yIndex = 0; yIndex < defaultGrid.NumYpoints(); ++yIndex)
+	{
+		for (uint32_t i = 0; i < defaultGrid.NumXpoints(); ++i)
+		{
+			const uint32_t xIndex = (yIndex & 1) ? defaultGrid.NumXpoints() - 1 - i : i;		// odd rows are probed in decreasing X order
+			if (defaultGrid.IsInRadius(defaultGrid.GetXCoordinate(xIndex), defaultGrid.GetYCoordinate(yIndex)))
+			{
+				(void)probePathOptimiser.AddPoint(yIndex * defaultGrid.NumXpoints() + xIndex);
+			}
+		}
+	}
+}
+
+// Set the grid indices from a point in the probe path. If there are no points in the path, use the first grid point, which gridProbing1 will skip.
+void GCodes::SetGridIndices(size_t pointNumber) noexcept
+{
+	gridPointNumber = pointNumber;
+	const uint32_t pointId = (pointNumber < probePathOptimiser.GetNumPoints()) ? probePathOptimiser.GetPoint(pointNumber) : 0;
+	gridXindex = pointId % defaultGrid.NumXpoints();
+	gridYindex = pointId / defaultGrid.NumXpoints();
+}
+
+// Start scanning the next row of grid points that the Z probe can reach, returning false if there are none left
+bool GCodes::StartNextScanRow() noexcept
+{
+	const Move& move = reprap.GetMove();
+	while (gridScanRow < defaultGrid.NumYpoints())
+	{
+		const uint32_t yIndex = gridScanRow++;
+		const float y = defaultGrid.GetYCoordinate(yIndex);
+		uint32_t lowXIndex = 0;
+		uint32_t highXIndex = defaultGrid.NumXpoints();
+		while (lowXIndex < highXIndex)
+		{
+			const float x = defaultGrid.GetXCoordinate(lowXIndex);
+			if (defaultGrid.IsInRadius(x, y) && move.IsAccessibleProbePoint(x, y))
+			{
+				break;
+			}
+			++lowXIndex;
+		}
+		while (highXIndex > lowXIndex)
+		{
+			const float x = defaultGrid.GetXCoordinate(highXIndex - 1);
+			if (defaultGrid.IsInRadius(x, y) && move.IsAccessibleProbePoint(x, y))
+			{
+				break;
+			}
+			--highXIndex;
+		}
+		if (lowXIndex < highXIndex)
+		{
+			gridScanner.StartRow(yIndex, lowXIndex, highXIndex - 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+// Take a Z probe reading while scanning a row of the grid, and work out where the probe was when the reading was taken
+void GCodes::TakeGridScanReading() noexcept
+{
+	const DDA * const cdda = reprap.GetMove().GetMainDDARing().GetCurrentDDA();
+	if (cdda != nullptr && cdda->GetState() == DDA::executing)
+	{
+		const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+		const int reading = zp->GetReading();
+		float x, y;
+		if (cdda->GetXYPositionAt(StepTimer::GetTimerTicks() - GridScanLatencyMillis * (StepTimer::StepClockRate/1000), x, y))
+		{
+			gridScanner.AddReading(x + zp->GetXOffset(), reading);
+		}
+	}
+}
+
 // Start probing the grid, returning true if we didn't because of an error.
 // Prior to calling this the movement system must be locked.
 GCodeResult GCodes::ProbeGrid(GCodeBuffer& gb, const StringRef& reply)
@@ -2812,11 +2906,73 @@ GCodeResult GCodes::ProbeGrid(GCodeBuffer& gb, const StringRef& reply)
 
 	const auto zp = SetZProbeNumber(gb);			// may throw, so do this before changing the state
 
-	reprap.GetMove().AccessHeightMap().SetGrid(defaultGrid);
+	// If the A parameter is present, probe adaptively with that value as the tolerance in mm, or the default tolerance if the value is zero
+	float adaptiveTolerance = -1.0;
+	if (gb.Seen('A'))
+	{
+		adaptiveTolerance = gb.GetFValue();
+		if (adaptiveTolerance <= 0.0)
+		{
+			adaptiveTolerance = AdaptiveGridProbe::DefaultTolerance;
+		}
+	}
+
+	// If the C parameter is present, scan the grid continuously with an analog probe at that height in mm above the trigger height, or the default height if the value is zero
+	float scanMargin = -1.0;
+	if (gb.Seen('C'))
+	{
+		scanMargin = gb.GetFValue();
+		if (scanMargin <= 0.0)
+		{
+			scanMargin = DefaultGridScanMargin;
+		}
+		const ZProbeType probeType = zp->GetProbeType();
+		if (probeType != ZProbeType::analog && probeType != ZProbeType::alternateAnalog && probeType != ZProbeType::dumbModulated)
+		{
+			reply.copy("Grid scanning needs an analog Z probe");
+			return GCodeResult::error;
+		}
+		if (adaptiveTolerance > 0.0)
+		{
+			reply.copy("Grid scanning and adaptive probing can't be used together");
+			return GCodeResult::error;
+		}
+	}
+
+	HeightMap& hm = reprap.GetMove().AccessHeightMap();
+	hm.SetGrid(defaultGrid);
 	ClearBedMapping();
-	gridXindex = gridYindex = 0;
+	doingAdaptiveGridProbe = (adaptiveTolerance > 0.0);
+	doingGridScan = (scanMargin > 0.0);
+	gridProbePathSaving = 0.0;
+	if (doingGridScan)
+	{
+		// Probe the first point of the first row in the normal way, so that we can calibrate the probe readings there
+		gridScanMargin = scanMargin;
+		gridScanRow = 0;
+		gridScanner.Start(GetGridXCoordinate, SetGridHeightError, &reprap.GetMove().AccessHeightMap());
+		if (!StartNextScanRow())
+		{
+			reply.copy("The Z probe can't reach any of the grid points");
+			return GCodeResult::error;
+		}
+		gridXindex = gridScanner.GetRowStartXIndex();
+		gridYindex = gridScanner.GetRowYIndex();
+	}
+	else if (doingAdaptiveGridProbe)
+	{
+		adaptiveGridProbe.Start(defaultGrid, adaptiveTolerance);
+		(void)adaptiveGridProbe.GetNextPoint(hm, gridXindex, gridYindex);		// there is always at least one point in a valid grid
+	}
+	else
+	{
+		// Start finding the order of the grid points that needs the least travel from the current position. State gridProbing0 does the work in slices.
+		// The XY offset of the probe doesn't change the distances between points, but it does change where we start from.
+		BuildGridProbePath();
+		probePathOptimiser.StartOptimising(moveBuffer.coords[X_AXIS] + zp->GetXOffset(), moveBuffer.coords[Y_AXIS] + zp->GetYOffset(), GetGridProbeCoordinates, &defaultGrid);
+	}
 
-	gb.SetState(GCodeState::gridProbing1);
+	gb.SetState((doingGridScan || doingAdaptiveGridProbe) ? GCodeState::gridProbing1 : GCodeState::gridProbing0);
 	if (zp->GetProbeType() != ZProbeType::blTouch)
 	{
 		DeployZProbe(gb, 29);
@@ -31,11 +31,15 @@ Licence: GPL
 #include "Platform.h"		// for type EndStopHit
 #include "GCodeChannel.h"
 #include "GCodeInput.h"
+#include "GCodeChannelScheduler.h"
 #include "Trigger.h"
 #include "Tools/Filament.h"
 #include "FilamentMonitors/FilamentMonitor.h"
 #include "RestorePoint.h"
 #include "Movement/BedProbing/Grid.h"
+#include "Movement/BedProbing/AdaptiveGridProbe.h"
+#include "Movement/BedProbing/ProbePathOptimiser.h"
+#include "Movement/BedProbing/GridScanner.h"
 
 const char feedrateLetter = 'F';						// GCode feedrate
 const char extrudeLetter = 'E'; 						// GCode extrude
@@ -279,6 +283,11 @@ public:
 #endif
 
 private:
+	static constexpr float MinReportedProbePathSaving = 0.5;		// the minimum saving in seconds of probe travel time that we report
+	static constexpr float DefaultGridScanMargin = 0.5;				// the default height in mm above the trigger height at which we scan the grid
+	static constexpr uint32_t GridScanSettleMillis = 30;			// how long we let the Z probe reading settle after stopping when scanning the grid
+	static constexpr uint32_t GridScanLatencyMillis = 8;			// the average delay in the Z probe reading caused by the averaging filters
+
 	GCodes(const GCodes&) = delete;
 
 	enum class HeaterFaultState : uint8_t { noFault, pausePending, timing, stopping, stopped };
@@ -402,6 +411,10 @@ private:
 #endif
 	void ClearBedMapping();														// Stop using bed compensation
 	GCodeResult ProbeGrid(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Start probing the grid, returning true if we didn't because of an error
+	void BuildGridProbePath() noexcept;											// Make the list of grid points to probe in serpentine order
+	void SetGridIndices(size_t pointNumber) noexcept;							// Set the grid indices from a point in the probe path
+	bool StartNextScanRow() noexcept;											// Start the next row of grid points to scan, returning false if there are none left
+	void TakeGridScanReading() noexcept;										// Take a Z probe reading while scanning a row of the grid
 	ReadLockedPointer<ZProbe> SetZProbeNumber(GCodeBuffer& gb) THROWS(GCodeException);		// Set up currentZProbeNumber and return the probe
 	GCodeResult ExecuteG30(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Probes at a given position - see the comment at the head of the function itself
 	void InitialiseTaps() noexcept;												// Set up to do the first of a possibly multi-tap probe
@@ -478,7 +491,7 @@ private:
 	GCodeBuffer*& aux2GCode = gcodeSources[GCodeChannel::ToBaseType(GCodeChannel::Aux2)];				// This one is reserved for the second async serial interface
 	GCodeBuffer*& autoPauseGCode = gcodeSources[GCodeChannel::ToBaseType(GCodeChannel::Autopause)];		// ***THIS ONE MUST BE LAST*** GCode state machine used to run macros on power fail, heater faults and filament out
 
-	size_t nextGcodeSource;												// The one to check next, using round-robin scheduling
+	GCodeChannelScheduler channelScheduler;								// Chooses the source to check next
 
 	const GCodeBuffer* resourceOwners[NumResources];					// Which gcode buffer owns each resource
 
@@ -589,6 +602,17 @@ private:
 	uint32_t lastProbedTime;					// time in milliseconds that the probe was last triggered
 	volatile bool zProbeTriggered;				// Set by the step ISR when a move is aborted because the Z probe is triggered
 	size_t gridXindex, gridYindex;				// Which grid probe point is next
+	size_t gridPointNumber;						// Which point in probePathOptimiser we are probing, when not doing adaptive grid probing
+	float gridProbePathSaving;					// How many seconds of travel we expect to save by using the optimised grid probe path
+	ProbePathOptimiser probePathOptimiser;		// The grid probe points in the order we visit them
+	AdaptiveGridProbe adaptiveGridProbe;		// Chooses the grid probe points when doing adaptive grid probing
+	bool doingAdaptiveGridProbe;				// true if we are probing only the grid points that adaptiveGridProbe chooses
+	GridScanner gridScanner;					// Converts Z probe readings to heights when scanning the grid
+	float gridScanMargin;						// How far above the trigger height we scan the grid
+	float gridScanHeight;						// The Z coordinate at which we scan the grid
+	uint32_t gridScanRow;						// The next grid row to consider scanning
+	int gridScanTriggerReading;					// The Z probe reading at the trigger height
+	bool doingGridScan;							// true if we are scanning the grid continuously instead of probing each point
 	bool doingManualBedProbe;					// true if we are waiting for the user to jog the nozzle until it touches the bed
 	bool hadProbingError;						// true if there was an error probing the last point
 	bool zDatumSetByProbing;					// true if the Z position was last set by probing, not by an endstop switch or by G92
@@ -46,6 +46,7 @@
 
 #if SUPPORT_CAN_EXPANSION
 # include <CAN/CanInterface.h>
+# include <CAN/CanTrace.h>
 # include <CAN/ExpansionManager.h>
 #endif
 
@@ -2467,6 +2468,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 			result = reprap.GetHeat().ConfigureSensor(gb, reply);
 			break;
 
+		case 310: // Set/report heater warm-up power budget
+			result = reprap.GetHeat().ConfigureWarmUp(gb, reply);
+			break;
+
 		case 350: // Set/report microstepping
 			{
 				bool interp = (gb.Seen('I') && gb.GetIValue() > 0);
@@ -3399,6 +3404,19 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 			}
 			break;
 
+#if HAS_LINUX_INTERFACE
+		case 576: // Set the sizes of the rings that hold codes from the SBC, or report them
+			if (reprap.UsingLinuxInterface())
+			{
+				result = reprap.GetLinuxInterface().ConfigureCodeRings(gb, reply);
+			}
+			else
+			{
+				result = GCodeResult::errorNotSupported;
+			}
+			break;
+#endif
+
 		case 577: // Wait until endstop input is triggered
 			result = WaitForPin(gb, reply);
 			break;
@@ -3470,6 +3488,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 			result = CheckTrigger(gb, reply);
 			break;
 
+		case 583: // Set the budget and priority of a G-code channel, or report them
+			result = channelScheduler.Configure(gb, reply);
+			break;
+
 		case 584: // Set axis/extruder to stepper driver(s) mapping
 			result = DoDriveMapping(gb, reply);
 			break;
@@ -3558,6 +3580,14 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 			break;
 #endif
 
+		case 595:	// Configure movement queue
+			if ((gb.Seen('P') || gb.Seen('S')) && !LockMovementAndWaitForStandstill(gb))
+			{
+				return false;
+			}
+			result = reprap.GetMove().GetMainDDARing().ConfigureMovementQueue(gb, reply);
+			break;
+
 		// For cases 600 and 601, see 226
 
 		// M650 (set peel move parameters) and M651 (execute peel move) are no longer handled specially. Use macros to specify what they should do.
@@ -4298,6 +4328,10 @@ bool GCodes::HandleMcode(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeEx
 		case 953:	// change expansion board CAN address
 			result = CanInterface::ChangeFastTiming(gb, reply);
 			break;
+
+		case 954:	// configure CAN traffic capture and report message counts
+			result = CanTrace::Configure(gb, reply, outBuf);
+			break;
 #endif
 
 		case 997:	// Perform firmware update
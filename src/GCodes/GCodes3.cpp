@@ -261,6 +261,23 @@ GCodeResult GCodes::DefineGrid(GCodeBuffer& gb, const StringRef &reply)
 	float radius = -1.0;
 	gb.TryGetFValue('R', radius, seenR);
 
+	// The interpolation method can be changed without redefining the grid, so that it can be used with a height map loaded from file
+	HeightMap& heightMap = reprap.GetMove().AccessHeightMap();
+	if (gb.Seen('I'))
+	{
+		const uint32_t interpolation = gb.GetLimitedUIValue('I', 2);
+		heightMap.SetBicubicInterpolation(interpolation == 1);
+		if (interpolation == 1 && !heightMap.UsingBicubicInterpolation())
+		{
+			reply.copy("failed to set up bicubic interpolation");
+			return GCodeResult::error;
+		}
+		if (!seenX && !seenY && !seenR && !seenS && !seenP)
+		{
+			return GCodeResult::ok;
+		}
+	}
+
 	if (!seenX && !seenY && !seenR && !seenS && !seenP)
 	{
 		// Just print the existing grid parameters
@@ -273,6 +290,7 @@ GCodeResult GCodes::DefineGrid(GCodeBuffer& gb, const StringRef &reply)
 		{
 			reply.copy("Grid is not defined");
 		}
+		reply.catf(", %s interpolation", (heightMap.UsingBicubicInterpolation()) ? "bicubic" : "bilinear");
 		return GCodeResult::ok;
 	}
 
@@ -1250,6 +1268,24 @@ GCodeResult GCodes::ConfigureDriver(GCodeBuffer& gb, const StringRef& reply) THR
 #endif
 		}
 
+#if SUPPORT_TMC51xx || (SUPPORT_TMC22xx && !defined(__LPC17xx__))
+		if (gb.Seen('U'))								// set status register refresh intervals in milliseconds, in the order GSTAT:DRV_STATUS:MSCNT:PWM_SCALE
+		{
+			seen = true;
+			uint32_t intervals[4];
+			size_t numIntervals = ARRAY_SIZE(intervals);
+			gb.GetUnsignedArray(intervals, numIntervals, false);
+			for (size_t i = 0; i < numIntervals; ++i)
+			{
+				if (!SmartDrivers::SetRefreshInterval(drive, i, intervals[i]))
+				{
+					reply.printf("Bad refresh interval for driver %u", drive);
+					return GCodeResult::error;
+				}
+			}
+		}
+#endif
+
 		if (gb.Seen('Y'))								// set spread cycle hysteresis
 		{
 			seen = true;
@@ -1334,6 +1370,12 @@ GCodeResult GCodes::ConfigureDriver(GCodeBuffer& gb, const StringRef& reply) THR
 				}
 #endif
 
+#if SUPPORT_TMC51xx || (SUPPORT_TMC22xx && !defined(__LPC17xx__))
+				reply.catf(", refresh intervals %" PRIu32 ":%" PRIu32 ":%" PRIu32 ":%" PRIu32 "ms",
+							SmartDrivers::GetRefreshInterval(drive, 0), SmartDrivers::GetRefreshInterval(drive, 1),
+							SmartDrivers::GetRefreshInterval(drive, 2), SmartDrivers::GetRefreshInterval(drive, 3));
+#endif
+
 #if SUPPORT_TMC51xx
 				{
 					const uint32_t thigh = SmartDrivers::GetRegister(drive, SmartDriverRegister::thigh);
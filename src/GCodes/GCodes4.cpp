@@ -481,6 +481,25 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		break;
 
 	// States used for grid probing
+	case GCodeState::gridProbing0:		// optimising the order of the grid probe points
+		// We do this a slice at a time so that a large grid doesn't hold up the other input channels
+		if (probePathOptimiser.Optimise())
+		{
+			// Use the optimised order only if it is better than the serpentine order
+			const float optimisedLength = probePathOptimiser.GetCurrentLength();
+			if (optimisedLength < probePathOptimiser.GetOriginalLength())
+			{
+				gridProbePathSaving = (probePathOptimiser.GetOriginalLength() - optimisedLength)/platform.GetZProbeOrDefault(currentZProbeNumber)->GetTravelSpeed();
+			}
+			else
+			{
+				BuildGridProbePath();
+			}
+			SetGridIndices(0);
+			gb.AdvanceState();
+		}
+		break;
+
 	case GCodeState::gridProbing1:		// ready to move to next grid probe point
 		{
 			// Move to the current probe point
@@ -686,34 +705,26 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		break;
 
 	case GCodeState::gridProbing6:	// ready to compute the next probe point
+		if (doingGridScan)
+		{
+			// We have probed the first point of the grid scan, so calibrate the probe readings and scan the rest
+			gb.SetState(GCodeState::gridScanning1);
+		}
+		else
 		{
-			const HeightMap& hm = reprap.GetMove().AccessHeightMap();
-			if (gridYindex & 1)
+			HeightMap& hm = reprap.GetMove().AccessHeightMap();
+			bool done;
+			if (doingAdaptiveGridProbe)
 			{
-				// Odd row, so decreasing X
-				if (gridXindex == 0)
-				{
-					++gridYindex;
-				}
-				else
-				{
-					--gridXindex;
-				}
+				done = !adaptiveGridProbe.GetNextPoint(hm, gridXindex, gridYindex);
 			}
 			else
 			{
-				// Even row, so increasing X
-				if (gridXindex + 1 == hm.GetGrid().NumXpoints())
-				{
-					++gridYindex;
-				}
-				else
-				{
-					++gridXindex;
-				}
+				SetGridIndices(gridPointNumber + 1);
+				done = (gridPointNumber >= probePathOptimiser.GetNumPoints());
 			}
 
-			if (gridYindex == hm.GetGrid().NumYpoints())
+			if (done)
 			{
 				// Done all the points
 				gb.AdvanceState();
@@ -735,8 +746,30 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 			if (numPointsProbed >= 4)
 			{
 				reprap.GetMove().SetLatestMeshDeviation(deviation);
-				reply.printf("%" PRIu32 " points probed, min error %.3f, max error %.3f, mean %.3f, deviation %.3f\n",
-								numPointsProbed, (double)minError, (double)maxError, (double)deviation.GetMean(), (double)deviation.GetDeviationFromMean());
+				if (doingAdaptiveGridProbe)
+				{
+					// Some of the points were filled in by interpolation, so report how many we really probed
+					const unsigned int numInterpolated = adaptiveGridProbe.GetNumPointsInterpolated(reprap.GetMove().AccessHeightMap());
+					reply.printf("%" PRIu32 " points probed adaptively, %u interpolated", numPointsProbed - numInterpolated, numInterpolated);
+				}
+				else if (doingGridScan)
+				{
+					reply.printf("%" PRIu32 " points scanned", numPointsProbed);
+					if (gridScanner.GetNumPointsOutOfRange() != 0)
+					{
+						reply.catf(", %u out of range", gridScanner.GetNumPointsOutOfRange());
+					}
+				}
+				else
+				{
+					reply.printf("%" PRIu32 " points probed", numPointsProbed);
+				}
+				reply.catf(", min error %.3f, max error %.3f, mean %.3f, deviation %.3f\n",
+								(double)minError, (double)maxError, (double)deviation.GetMean(), (double)deviation.GetDeviationFromMean());
+				if (!doingAdaptiveGridProbe && gridProbePathSaving >= MinReportedProbePathSaving)
+				{
+					reply.catf("Probe path optimisation saved %.1f seconds of travel\n", (double)gridProbePathSaving);
+				}
 #if HAS_MASS_STORAGE
 # if HAS_LINUX_INTERFACE
 				if (!reprap.UsingLinuxInterface())
@@ -768,6 +801,159 @@ void GCodes::RunStateMachine(GCodeBuffer& gb, const StringRef& reply) noexcept
 		gb.SetState(GCodeState::normal);
 		break;
 
+	// States used for scanning the grid continuously with an analog Z probe. We have already probed the first point of the first row in the normal way
+	// and moved back up to the dive height, and g30zHeightError holds the height error there.
+	case GCodeState::gridScanning1:	// ready to move down to the trigger height, so that we can take a reading there
+		if (LockMovementAndWaitForStandstill(gb))
+		{
+			SetMoveBufferDefaults();
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			moveBuffer.coords[Z_AXIS] = g30zHeightError + zp->GetActualTriggerHeight();
+			moveBuffer.feedRate = zp->GetProbingSpeed();
+			NewMoveAvailable(1);
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning2:	// moving down to the trigger height
+	case GCodeState::gridScanning4:	// moving up to the scanning height
+	case GCodeState::gridScanning7:	// moving to the start of a row
+		if (LockMovementAndWaitForStandstill(gb))
+		{
+			lastProbedTime = millis();
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning3:	// stopped at the trigger height, waiting for the probe reading to settle
+		if (millis() - lastProbedTime >= GridScanSettleMillis)
+		{
+			SetMoveBufferDefaults();
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			gridScanTriggerReading = zp->GetReading();
+			gridScanHeight = g30zHeightError + zp->GetActualTriggerHeight() + gridScanMargin;
+			moveBuffer.coords[Z_AXIS] = gridScanHeight;
+			moveBuffer.feedRate = zp->GetProbingSpeed();
+			NewMoveAvailable(1);
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning5:	// stopped at the scanning height above the first point, waiting for the probe reading to settle
+		if (millis() - lastProbedTime >= GridScanSettleMillis)
+		{
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			const int scanReading = zp->GetReading();
+			if (scanReading * 10 >= zp->GetAdcValue() * 9)
+			{
+				// Small variations in the bed height would trigger the probe and stop the scanning moves
+				gb.MachineState().SetError("Z probe reading at the scanning height is too close to the threshold, use a larger C parameter");
+				gb.SetState(GCodeState::checkError);
+				RetractZProbe(gb, 29);
+			}
+			else if (!gridScanner.Calibrate(g30zHeightError, gridScanTriggerReading, scanReading, gridScanMargin))
+			{
+				gb.MachineState().SetError("Z probe reading changes too little with height to scan the grid");
+				gb.SetState(GCodeState::checkError);
+				RetractZProbe(gb, 29);
+			}
+			else
+			{
+				// We are already at the start of the first row
+				gb.SetState(GCodeState::gridScanning8);
+			}
+		}
+		break;
+
+	case GCodeState::gridScanning6:	// ready to move to the start of the next row
+		{
+			SetMoveBufferDefaults();
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			const GridDefinition& grid = reprap.GetMove().AccessHeightMap().GetGrid();
+			moveBuffer.coords[X_AXIS] = grid.GetXCoordinate(gridScanner.GetRowStartXIndex()) - zp->GetXOffset();
+			moveBuffer.coords[Y_AXIS] = grid.GetYCoordinate(gridScanner.GetRowYIndex()) - zp->GetYOffset();
+			moveBuffer.coords[Z_AXIS] = gridScanHeight;
+			moveBuffer.feedRate = zp->GetTravelSpeed();
+			NewMoveAvailable(1);
+			gb.AdvanceState();
+		}
+		break;
+
+	case GCodeState::gridScanning8:	// stopped at the start of a row, waiting for the probe reading to settle
+		{
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			if (millis() - lastProbedTime >= GridScanSettleMillis)
+			{
+				const GridDefinition& grid = reprap.GetMove().AccessHeightMap().GetGrid();
+				gridScanner.AddReading(moveBuffer.coords[X_AXIS] + zp->GetXOffset(), zp->GetReading());
+
+				// Start the move along the row. Use the Z probe as an endstop, in case the bed is higher than the scanning height.
+				// The move is at travel speed so it has acceleration and deceleration phases, therefore the probe must stop it if it triggers instead of slowing it down.
+				SetMoveBufferDefaults();
+				if (!platform.GetEndstops().EnableZProbe(currentZProbeNumber, false, true))
+				{
+					gb.MachineState().SetError("Failed to enable Z probe");
+					gb.SetState(GCodeState::checkError);
+					RetractZProbe(gb, 29);
+					break;
+				}
+				if (zp->GetTurnHeatersOff())
+				{
+					reprap.GetHeat().SuspendHeaters(true);
+				}
+				zProbeTriggered = false;
+				zp->SetProbing(true);
+				moveBuffer.checkEndstops = true;
+				moveBuffer.coords[X_AXIS] = grid.GetXCoordinate(gridScanner.GetRowEndXIndex()) - zp->GetXOffset();
+				moveBuffer.feedRate = zp->GetTravelSpeed();
+				NewMoveAvailable(1);
+				gb.AdvanceState();
+			}
+		}
+		break;
+
+	case GCodeState::gridScanning9:	// scanning a row
+		TakeGridScanReading();
+		if (LockMovementAndWaitForStandstill(gb))
+		{
+			reprap.GetHeat().SuspendHeaters(false);
+			platform.GetZProbeOrDefault(currentZProbeNumber)->SetProbing(false);
+			if (zProbeTriggered)
+			{
+				gb.MachineState().SetError("Z probe was triggered while scanning the grid, use a larger C parameter");
+				gb.SetState(GCodeState::checkError);
+				RetractZProbe(gb, 29);
+			}
+			else
+			{
+				lastProbedTime = millis();
+				gb.AdvanceState();
+			}
+		}
+		break;
+
+	case GCodeState::gridScanning10:	// stopped at the end of a row, waiting for the probe reading to settle
+		if (millis() - lastProbedTime >= GridScanSettleMillis)
+		{
+			const auto zp = platform.GetZProbeOrDefault(currentZProbeNumber);
+			gridScanner.AddReading(moveBuffer.coords[X_AXIS] + zp->GetXOffset(), zp->GetReading());
+			if (StartNextScanRow())
+			{
+				gb.SetState(GCodeState::gridScanning6);
+			}
+			else
+			{
+				// Finished scanning, so move back up to the dive height
+				SetMoveBufferDefaults();
+				moveBuffer.coords[Z_AXIS] = zp->GetStartingHeight();
+				moveBuffer.feedRate = zp->GetTravelSpeed();
+				NewMoveAvailable(1);
+				gb.SetState(GCodeState::gridProbing7);
+				RetractZProbe(gb, 29);
+			}
+		}
+		break;
+
 	// States used for G30 probing
 	case GCodeState::probingAtPoint0:
 		// Initial state when executing G30 with a P parameter. Start by moving to the dive height at the current position.
@@ -0,0 +1,190 @@
+/*
+ * AdcFilter.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Configurable filter for readings from an ADC channel, updated from the tick ISR.
+ *  Each reading passes through an optional median stage (median of the last 3 or 5 readings) to reject spikes, followed by either a boxcar
+ *  average of the last numAveraged readings or an exponential IIR filter with a time constant of 2^iirShift readings.
+ *  Every update takes constant time. The output is always scaled to be the sum of numAveraged readings, so callers don't need to know
+ *  which filter is in use.
+ */
+
+#ifndef SRC_HARDWARE_ADCFILTER_H_
+#define SRC_HARDWARE_ADCFILTER_H_
+
+#include <RepRapFirmware.h>
+
+// numAveraged must be a power of 2
+template<size_t numAveraged> class AdcFilter
+{
+public:
+	static constexpr unsigned int MaxMedianLength = 5;
+	static constexpr unsigned int MaxIirShift = 8;
+
+	AdcFilter() noexcept : sum(0)
+	{
+		Configure(1, 0);
+	}
+
+	// Set the filter type. A median length of 1 disables the median stage and an IIR shift of 0 selects the boxcar average.
+	// The filter state is restarted so that the next reading seeds all the stages again. The output keeps its current value until then.
+	void Configure(unsigned int p_medianLength, unsigned int p_iirShift) volatile noexcept
+		pre(p_medianLength == 1 || p_medianLength == 3 || p_medianLength == 5; p_iirShift <= MaxIirShift)
+	{
+		const irqflags_t flags = cpu_irq_save();
+		medianLength = (uint8_t)p_medianLength;
+		iirShift = (uint8_t)p_iirShift;
+		medianIndex = 0;
+		index = 0;
+		numReadings = 0;
+		iirAccumulator = sum << (IirFractionBits - Log2NumAveraged);
+		cpu_irq_restore(flags);
+	}
+
+	void Init(uint16_t val) volatile noexcept
+	{
+		const irqflags_t flags = cpu_irq_save();
+		sum = (uint32_t)val * (uint32_t)numAveraged;
+		iirAccumulator = (uint32_t)val << IirFractionBits;
+		latestReading = val;
+		index = medianIndex = 0;
+		numReadings = 0;
+		isValid = false;
+		for (size_t i = 0; i < numAveraged; ++i)
+		{
+			readings[i] = val;
+		}
+		for (size_t i = 0; i < MaxMedianLength; ++i)
+		{
+			medianReadings[i] = val;
+		}
+		cpu_irq_restore(flags);
+	}
+
+	// Call this to put a new reading into the filter
+	// This is only called by the ISR, so it not declared volatile to make it faster
+	void ProcessReading(uint16_t r) noexcept
+	{
+		latestReading = r;
+		if (numReadings == 0)
+		{
+			// This is the first reading since we were initialised, so seed all the stages with it to avoid a long settling time
+			for (uint16_t& mr : medianReadings)
+			{
+				mr = r;
+			}
+			for (uint16_t& br : readings)
+			{
+				br = r;
+			}
+			sum = (uint32_t)r * (uint32_t)numAveraged;
+			iirAccumulator = (uint32_t)r << IirFractionBits;
+		}
+
+		if (medianLength > 1)
+		{
+			medianReadings[medianIndex] = r;
+			++medianIndex;
+			if (medianIndex >= medianLength)
+			{
+				medianIndex = 0;
+			}
+			r = (medianLength == 3) ? MedianOf3(medianReadings[0], medianReadings[1], medianReadings[2]) : MedianOf5(medianReadings);
+		}
+
+		if (iirShift == 0)
+		{
+			sum = sum - readings[index] + r;
+			readings[index] = r;
+			++index;
+			if (index >= numAveraged)
+			{
+				index = 0;
+			}
+		}
+		else
+		{
+			iirAccumulator = iirAccumulator - (iirAccumulator >> iirShift) + (((uint32_t)r << IirFractionBits) >> iirShift);
+			sum = iirAccumulator >> (IirFractionBits - Log2NumAveraged);
+		}
+
+		if (numReadings < numAveraged)
+		{
+			++numReadings;
+			if (numReadings == numAveraged)
+			{
+				isValid = true;
+			}
+		}
+	}
+
+	// Return the raw sum, or the equivalent for the IIR filter
+	uint32_t GetSum() const volatile noexcept
+	{
+		return sum;
+	}
+
+	// Return true if we have a valid average
+	bool IsValid() const volatile noexcept
+	{
+		return isValid;
+	}
+
+	// Get the latest reading, before filtering
+	uint16_t GetLatestReading() const volatile noexcept
+	{
+		return latestReading;
+	}
+
+	unsigned int GetMedianLength() const volatile noexcept { return medianLength; }
+	unsigned int GetIirShift() const volatile noexcept { return iirShift; }
+
+	static constexpr size_t NumAveraged() noexcept { return numAveraged; }
+
+private:
+	static constexpr unsigned int IirFractionBits = 16;
+	static constexpr unsigned int Log2NumAveraged = (numAveraged <= 1) ? 0 : (numAveraged <= 2) ? 1 : (numAveraged <= 4) ? 2 : (numAveraged <= 8) ? 3
+													: (numAveraged <= 16) ? 4 : (numAveraged <= 32) ? 5 : (numAveraged <= 64) ? 6 : 7;
+	static_assert((1u << Log2NumAveraged) == numAveraged, "numAveraged must be a power of 2 no greater than 128");
+
+	static uint16_t MedianOf3(uint16_t a, uint16_t b, uint16_t c) noexcept
+	{
+		return max<uint16_t>(min<uint16_t>(a, b), min<uint16_t>(max<uint16_t>(a, b), c));
+	}
+
+	// Return the median of 5 values using a fixed network of compare-exchange operations
+	static uint16_t MedianOf5(const uint16_t values[MaxMedianLength]) noexcept
+	{
+		uint16_t p0 = values[0], p1 = values[1], p2 = values[2], p3 = values[3], p4 = values[4];
+		Order(p0, p1); Order(p3, p4); Order(p0, p3);
+		Order(p1, p4); Order(p1, p2); Order(p2, p3);
+		Order(p1, p2);
+		return p2;
+	}
+
+	static void Order(uint16_t& a, uint16_t& b) noexcept
+	{
+		if (a > b)
+		{
+			const uint16_t temp = a;
+			a = b;
+			b = temp;
+		}
+	}
+
+	uint16_t readings[numAveraged];								// the readings in the boxcar average
+	uint16_t medianReadings[MaxMedianLength];					// the last few readings, for the median stage
+	uint32_t sum;												// the filter output, scaled to be the sum of numAveraged readings
+	uint32_t iirAccumulator;									// the IIR filter state, scaled by 2^IirFractionBits
+	uint16_t latestReading;
+	uint8_t index;
+	uint8_t medianIndex;
+	uint8_t numReadings;										// the number of readings since we were initialised, up to numAveraged
+	uint8_t medianLength;										// 1 if there is no median stage, else 3 or 5
+	uint8_t iirShift;											// 0 for the boxcar average, else the IIR time constant is 2^iirShift readings
+	bool isValid;
+};
+
+#endif /* SRC_HARDWARE_ADCFILTER_H_ */
@@ -43,10 +43,11 @@ constexpr ObjectModelTableEntry FopDt::objectModelTable[] =
 	{ "i",					OBJECT_MODEL_FUNC(self->loadChangeParams.recipTi * self->loadChangeParams.kP, 1),	ObjectModelEntryFlags::none },
 	{ "overridden",			OBJECT_MODEL_FUNC(self->pidParametersOverridden),									ObjectModelEntryFlags::none },
 	{ "p",					OBJECT_MODEL_FUNC(self->loadChangeParams.kP, 1),									ObjectModelEntryFlags::none },
+	{ "predictive",			OBJECT_MODEL_FUNC(self->UsePrediction()),											ObjectModelEntryFlags::none },
 	{ "used",				OBJECT_MODEL_FUNC(self->usePid),													ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t FopDt::objectModelTableDescriptor[] = { 2, 8, 5 };
+constexpr uint8_t FopDt::objectModelTableDescriptor[] = { 2, 8, 6 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(FopDt)
 
@@ -56,7 +57,7 @@ DEFINE_GET_OBJECT_MODEL_TABLE(FopDt)
 // Set up sensible defaults here in case the user enables the heater without specifying values for all the parameters.
 FopDt::FopDt() noexcept
 	: gain(DefaultHotEndHeaterGain), timeConstant(DefaultHotEndHeaterTimeConstant), deadTime(DefaultHotEndHeaterDeadTime), maxPwm(1.0), standardVoltage(0.0),
-	  enabled(false), usePid(true), inverted(false), pidParametersOverridden(false)
+	  enabled(false), usePid(true), usePrediction(false), inverted(false), pidParametersOverridden(false)
 {
 }
 
@@ -88,6 +89,24 @@ bool FopDt::SetParameters(float pg, float ptc, float pdt, float pMaxPwm, float t
 	return false;
 }
 
+// Estimate how long it will take to heat from the current temperature to the target temperature at the specified PWM.
+// Return zero if we are already there, or a negative value if the target can't be reached at that PWM.
+float FopDt::GetHeatingTime(float currentTemperature, float targetTemperature, float pwm) const noexcept
+{
+	const float maxRise = gain * pwm;
+	const float currentRise = currentTemperature - NormalAmbientTemperature;
+	const float targetRise = targetTemperature - NormalAmbientTemperature;
+	if (targetRise <= currentRise)
+	{
+		return 0.0;
+	}
+	if (targetRise >= maxRise)
+	{
+		return -1.0;
+	}
+	return deadTime + timeConstant * logf((maxRise - currentRise)/(maxRise - targetRise));
+}
+
 // Get the PID parameters as reported by M301
 M301PidParameters FopDt::GetM301PidParameters(bool forLoadChange) const noexcept
 {
@@ -116,7 +135,7 @@ bool FopDt::WriteParameters(FileStore *f, size_t heater) const noexcept
 {
 	String<StringLength256> scratchString;
 	scratchString.printf("M307 H%u A%.1f C%.1f D%.1f S%.2f V%.1f B%d\n",
-							heater, (double)gain, (double)timeConstant, (double)deadTime, (double)maxPwm, (double)standardVoltage, (usePid) ? 0 : 1);
+							heater, (double)gain, (double)timeConstant, (double)deadTime, (double)maxPwm, (double)standardVoltage, (!usePid) ? 1 : (usePrediction) ? 2 : 0);
 	bool ok = f->Write(scratchString.c_str());
 	if (ok && pidParametersOverridden)
 	{
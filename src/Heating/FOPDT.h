@@ -50,9 +50,12 @@ public:
 	float GetMaxPwm() const noexcept { return maxPwm; }
 	float GetVoltage() const noexcept { return standardVoltage; }
 	bool UsePid() const noexcept { return usePid; }
+	bool UsePrediction() const noexcept { return usePid && usePrediction; }
+	void SetUsePrediction(bool b) noexcept { usePrediction = b; }
 	bool IsInverted() const noexcept { return inverted; }
 	bool IsEnabled() const noexcept { return enabled; }
 	bool ArePidParametersOverridden() const noexcept { return pidParametersOverridden; }
+	float GetHeatingTime(float currentTemperature, float targetTemperature, float pwm) const noexcept;
 	M301PidParameters GetM301PidParameters(bool forLoadChange) const noexcept;
 	void SetM301PidParameters(const M301PidParameters& params) noexcept;
 
@@ -82,6 +85,7 @@ private:
 	float standardVoltage;					// power voltage reading at which tuning was done, or 0 if unknown
 	bool enabled;
 	bool usePid;
+	bool usePrediction;						// true to compensate for the dead time using a Smith predictor
 	bool inverted;
 	bool pidParametersOverridden;
 
@@ -0,0 +1,207 @@
+/*
+ * FopDtEstimator.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "FopDtEstimator.h"
+#include <cmath>
+
+constexpr float ReferenceTemperature = 25.0;		// the temperature that the model is linearised about
+constexpr float ForgettingFactor = 0.995;			// per window, so the estimators effectively remember the last 200 windows
+constexpr float InitialCovariance = 100.0;
+constexpr float MaxCovarianceTrace = 1.0e4;			// we stop forgetting old data when the covariance gets this large, to avoid windup when there is no excitation
+constexpr float ResidualFilterFactor = 0.02;		// weight given to the latest residual when updating the mean square residual
+constexpr float WindowsPerDeadTime = 4.0;			// the number of windows in the expected dead time
+
+void FopDtEstimator::RlsEstimator::Init() noexcept
+{
+	for (size_t i = 0; i < NumParameters; ++i)
+	{
+		theta[i] = 0.0;
+		for (size_t j = 0; j < NumParameters; ++j)
+		{
+			p[i][j] = (i == j) ? InitialCovariance : 0.0;
+		}
+	}
+	meanSquareResidual = 0.0;
+}
+
+void FopDtEstimator::RlsEstimator::Update(const float x[NumParameters], float y) noexcept
+{
+	// Calculate the a-priori residual and the gain vector
+	float residual = y;
+	float px[NumParameters];
+	float denominator = 0.0;
+	float trace = 0.0;
+	for (size_t i = 0; i < NumParameters; ++i)
+	{
+		residual -= theta[i] * x[i];
+		float sum = 0.0;
+		for (size_t j = 0; j < NumParameters; ++j)
+		{
+			sum += p[i][j] * x[j];
+		}
+		px[i] = sum;
+		denominator += x[i] * sum;
+		trace += p[i][i];
+	}
+
+	const float lambda = (trace < MaxCovarianceTrace) ? ForgettingFactor : 1.0;
+	denominator += lambda;
+
+	// Update the parameters and the covariance, keeping the covariance symmetric
+	for (size_t i = 0; i < NumParameters; ++i)
+	{
+		theta[i] += px[i] * residual/denominator;
+		for (size_t j = i; j < NumParameters; ++j)
+		{
+			const float newP = (p[i][j] - px[i] * px[j]/denominator)/lambda;
+			p[i][j] = p[j][i] = newP;
+		}
+	}
+
+	meanSquareResidual += (residual * residual - meanSquareResidual) * ResidualFilterFactor;
+}
+
+// Restart the identification. The dead time guess is used to choose the averaging window and the candidate dead times.
+void FopDtEstimator::Reset(float deadTimeGuess, float sampleInterval) noexcept
+{
+	const long samples = lrintf(deadTimeGuess/(WindowsPerDeadTime * sampleInterval));
+	samplesPerWindow = (samples < 1) ? 1 : (samples > 65535) ? 65535 : (uint16_t)samples;
+	windowTime = samplesPerWindow * sampleInterval;
+
+	// Choose the candidate dead times to cover a range of about 0.6 to 1.6 times the guess
+	const unsigned int nominalDelay = (unsigned int)lrintf(deadTimeGuess/windowTime);
+	unsigned int delay = (unsigned int)lrintf(nominalDelay * 0.6);
+	for (size_t i = 0; i < NumCandidates; ++i)
+	{
+		candidateDelays[i] = (uint8_t)delay;
+		candidates[i].Init();
+		delay = (i == 0) ? nominalDelay : (unsigned int)lrintf(nominalDelay * 1.6);
+		if (delay <= candidateDelays[i])
+		{
+			delay = candidateDelays[i] + 1;
+		}
+		if (delay > PwmHistoryLength - 1)
+		{
+			delay = PwmHistoryLength - 1;
+		}
+	}
+
+	for (float& f : pwmHistory)
+	{
+		f = 0.0;
+	}
+	pwmHistoryIndex = 0;
+	windowTemperatureSum = windowPwmSum = 0.0;
+	lastWindowTemperature = 0.0;
+	samplesThisWindow = 0;
+	numWindows = 0;
+}
+
+// Add a temperature sample and the PWM that was applied to the heater since the previous sample
+void FopDtEstimator::AddSample(float temperature, float pwm) noexcept
+{
+	windowTemperatureSum += temperature;
+	windowPwmSum += pwm;
+	++samplesThisWindow;
+	if (samplesThisWindow < samplesPerWindow)
+	{
+		return;
+	}
+
+	const float windowTemperature = windowTemperatureSum/samplesPerWindow;
+	const float windowPwm = windowPwmSum/samplesPerWindow;
+	windowTemperatureSum = windowPwmSum = 0.0;
+	samplesThisWindow = 0;
+
+	if (numWindows != 0)
+	{
+		const float y = windowTemperature - lastWindowTemperature;
+		for (size_t i = 0; i < NumCandidates; ++i)
+		{
+			const unsigned int delay = candidateDelays[i];
+			if (numWindows > delay)
+			{
+				// pwmHistory[pwmHistoryIndex] holds the PWM for the previous window, so this gets the PWM 'delay' windows before that
+				const float x[NumParameters] =
+				{
+					pwmHistory[(pwmHistoryIndex + PwmHistoryLength - delay) % PwmHistoryLength],
+					ReferenceTemperature - lastWindowTemperature,
+					1.0
+				};
+				candidates[i].Update(x, y);
+			}
+		}
+	}
+
+	pwmHistoryIndex = (pwmHistoryIndex + 1) % PwmHistoryLength;
+	pwmHistory[pwmHistoryIndex] = windowPwm;
+	lastWindowTemperature = windowTemperature;
+	++numWindows;
+}
+
+// Get the current estimate of the model, returning false if we don't have one yet
+bool FopDtEstimator::GetEstimate(Estimate& est) const noexcept
+{
+	if (numWindows < MinWindows + candidateDelays[NumCandidates - 1])
+	{
+		return false;
+	}
+
+	// Find the candidate with the smallest residual
+	size_t best = 0;
+	for (size_t i = 1; i < NumCandidates; ++i)
+	{
+		if (candidates[i].meanSquareResidual < candidates[best].meanSquareResidual)
+		{
+			best = i;
+		}
+	}
+
+	const RlsEstimator& rls = candidates[best];
+	const float a = rls.theta[0], b = rls.theta[1], c = rls.theta[2];
+	if (a <= 0.0 || b <= 0.0)
+	{
+		return false;										// the model is not physically meaningful
+	}
+
+	est.gain = a/b;
+	est.timeConstant = windowTime/b;
+	est.ambientTemperature = ReferenceTemperature + c/b;
+
+	// Refine the dead time by fitting a parabola to the residuals if the best one is not at the end of the range.
+	// Simulation shows that this estimate of the dead time is only accurate to about 20%, but the gain and time constant are much better.
+	float delay = (float)candidateDelays[best];
+	if (best != 0 && best + 1 < NumCandidates)
+	{
+		const float x0 = candidateDelays[best - 1], x1 = candidateDelays[best], x2 = candidateDelays[best + 1];
+		const float r0 = candidates[best - 1].meanSquareResidual, r1 = rls.meanSquareResidual, r2 = candidates[best + 1].meanSquareResidual;
+		const float numerator = (x1 - x0) * (x1 - x0) * (r1 - r2) - (x1 - x2) * (x1 - x2) * (r1 - r0);
+		const float denominator = (x1 - x0) * (r1 - r2) - (x1 - x2) * (r1 - r0);
+		if (denominator != 0.0)
+		{
+			const float vertex = x1 - 0.5 * numerator/denominator;
+			if (vertex > x0 && vertex < x2)
+			{
+				delay = vertex;
+			}
+		}
+	}
+	est.deadTime = delay * windowTime;
+
+	// Estimate the relative standard errors of the gain and time constant from the covariance and residual, and derive a confidence from them
+	const float variance = rls.meanSquareResidual;
+	const float relVarA = rls.p[0][0] * variance/(a * a);
+	const float relVarB = rls.p[1][1] * variance/(b * b);
+	const float relCovAB = rls.p[0][1] * variance/(a * b);
+	const float relErrorGain = sqrtf(fabsf(relVarA + relVarB - 2.0 * relCovAB));
+	const float relErrorTimeConstant = sqrtf(relVarB);
+	const float worstRelError = (relErrorGain > relErrorTimeConstant) ? relErrorGain : relErrorTimeConstant;
+	est.confidence = (worstRelError >= 0.1) ? 0.0 : 1.0 - 10.0 * worstRelError;
+	return true;
+}
+
+// End
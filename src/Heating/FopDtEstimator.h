@@ -0,0 +1,77 @@
+/*
+ * FopDtEstimator.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Online identification of a first order process with dead time from the temperature and PWM of a heater in normal use.
+ *  The samples from the heater are averaged over a window whose length depends on the expected dead time, then each window is fed to
+ *  recursive least squares estimators of the discrete model
+ *    T[k] - T[k-1] = a * u[k-1-d] - b * (T[k-1] - 25) + c
+ *  where T is the average temperature and u is the average PWM in a window, and d is the dead time in windows. We run one estimator for each of
+ *  a few candidate dead times and use the one with the smallest residual. The gain is then a/b, the time constant is window time/b and the
+ *  ambient temperature is 25 + c/b. Memory use is constant and the estimates keep adapting because older samples are progressively forgotten.
+ */
+
+#ifndef SRC_HEATING_FOPDTESTIMATOR_H_
+#define SRC_HEATING_FOPDTESTIMATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class FopDtEstimator
+{
+public:
+	struct Estimate
+	{
+		float gain;
+		float timeConstant;
+		float deadTime;
+		float ambientTemperature;
+		float confidence;			// 0 = no confidence, 1 = very confident
+	};
+
+	FopDtEstimator() noexcept { Reset(1.0, 1.0); }
+
+	// Restart the identification. The dead time guess is used to choose the averaging window and the candidate dead times.
+	void Reset(float deadTimeGuess, float sampleInterval) noexcept;
+
+	// Add a temperature sample and the PWM that was applied to the heater since the previous sample
+	void AddSample(float temperature, float pwm) noexcept;
+
+	// Get the current estimate of the model, returning false if we don't have one yet
+	bool GetEstimate(Estimate& est) const noexcept;
+
+	uint32_t GetNumWindows() const noexcept { return numWindows; }
+
+private:
+	static constexpr size_t NumCandidates = 3;				// number of candidate dead times
+	static constexpr size_t PwmHistoryLength = 16;			// number of windows of PWM history we keep, which limits the largest candidate dead time
+	static constexpr size_t NumParameters = 3;
+	static constexpr unsigned int MinWindows = 40;			// the minimum number of windows before we report an estimate
+
+	// A single recursive least squares estimator of the parameters a, b, c
+	struct RlsEstimator
+	{
+		float theta[NumParameters];							// the parameter estimates
+		float p[NumParameters][NumParameters];				// the covariance matrix, up to a scale factor of the residual variance
+		float meanSquareResidual;							// exponentially weighted mean square a-priori residual
+
+		void Init() noexcept;
+		void Update(const float x[NumParameters], float y) noexcept;
+	};
+
+	RlsEstimator candidates[NumCandidates];
+	float pwmHistory[PwmHistoryLength];						// average PWM in recent windows, used as a delay line
+	float windowTemperatureSum;
+	float windowPwmSum;
+	float lastWindowTemperature;							// average temperature in the previous window
+	float windowTime;										// length of a window in seconds
+	uint32_t numWindows;									// number of complete windows since we were reset
+	uint16_t samplesPerWindow;
+	uint16_t samplesThisWindow;
+	uint8_t pwmHistoryIndex;								// index of the most recent entry in pwmHistory
+	uint8_t candidateDelays[NumCandidates];					// the candidate dead times in windows, in increasing order
+};
+
+#endif /* SRC_HEATING_FOPDTESTIMATOR_H_ */
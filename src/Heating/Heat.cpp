@@ -25,6 +25,7 @@ Licence: GPL
 #include "RepRap.h"
 #include "Sensors/TemperatureSensor.h"
 #include "GCodes/GCodeBuffer/GCodeBuffer.h"
+#include "Tasks.h"
 #include <TaskPriorities.h>
 
 #if SUPPORT_DHT_SENSOR
@@ -42,6 +43,11 @@ Licence: GPL
 constexpr uint32_t HeaterTaskStackWords = 400;			// task stack size in dwords, must be large enough for auto tuning
 static Task<HeaterTaskStackWords> heaterTask;
 
+constexpr uint32_t WarmUpScheduleIntervalMillis = 1000;	// how often we share out the heater power budget
+constexpr float WarmUpStartMargin = 10.0;				// how many seconds early we start a deferred heater, to allow for model errors
+constexpr float UnreachableWarmUpTime = 1.0e6;			// the warm-up time we use for a heater that can't reach its target at full power
+constexpr uint32_t SpiBatchLockTimeoutMillis = 20;		// how long we wait for the SPI mutex before polling the SPI sensors individually
+
 extern "C" [[noreturn]] void HeaterTaskStart(void * pvParameters) noexcept
 {
 	reprap.GetHeat().HeaterTask();
@@ -93,9 +99,10 @@ constexpr ObjectModelTableEntry Heat::objectModelTable[] =
 	{ "coldExtrudeTemperature",	OBJECT_MODEL_FUNC((self->coldExtrude) ? 0.0f : self->extrusionMinTemp, 1),		ObjectModelEntryFlags::none },
 	{ "coldRetractTemperature", OBJECT_MODEL_FUNC((self->coldExtrude) ? 0.0f : self->retractionMinTemp, 1),		ObjectModelEntryFlags::none },
 	{ "heaters",				OBJECT_MODEL_FUNC_NOSELF(&heatersArrayDescriptor),								ObjectModelEntryFlags::live },
+	{ "powerBudget",			OBJECT_MODEL_FUNC(self->powerBudget, 1),										ObjectModelEntryFlags::none },
 };
 
-constexpr uint8_t Heat::objectModelTableDescriptor[] = { 1, 5 };
+constexpr uint8_t Heat::objectModelTableDescriptor[] = { 1, 6 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Heat)
 
@@ -105,7 +112,7 @@ ReadWriteLock Heat::heatersLock;
 ReadWriteLock Heat::sensorsLock;
 
 Heat::Heat() noexcept
-	: sensorCount(0), sensorsRoot(nullptr), coldExtrude(false), heaterBeingTuned(-1), lastHeaterTuned(-1)
+	: sensorCount(0), sensorsRoot(nullptr), powerBudget(0.0), lastWarmUpScheduleTime(0), spiBatchLockFailures(0), coldExtrude(false), heaterBeingTuned(-1), lastHeaterTuned(-1)
 {
 	for (int8_t& h : bedHeaters)
 	{
@@ -278,16 +285,7 @@ void Heat::Exit() noexcept
 	uint32_t lastWakeTime = xTaskGetTickCount();
 	for (;;)
 	{
-		// Walk the sensor list and poll all sensors
-		{
-			ReadLocker lock(sensorsLock);
-			TemperatureSensor *currentSensor = sensorsRoot;
-			while (currentSensor != nullptr)
-			{
-				currentSensor->Poll();
-				currentSensor = currentSensor->GetNext();
-			}
-		}
+		PollSensors();
 
 		// Spin the heaters
 		{
@@ -299,6 +297,13 @@ void Heat::Exit() noexcept
 					h->Spin();
 				}
 			}
+
+			// Share out the power budget between the heaters
+			if (powerBudget > 0.0 && millis() - lastWarmUpScheduleTime >= WarmUpScheduleIntervalMillis)
+			{
+				lastWarmUpScheduleTime = millis();
+				ScheduleWarmUp();
+			}
 		}
 
 		// See if we have finished tuning a PID
@@ -360,6 +365,49 @@ void Heat::Exit() noexcept
 }
 
 
+// Walk the sensor list and poll all sensors.
+// The sensors on the shared SPI bus are polled first, back to back while we hold the SPI mutex, so that we take the mutex once per sample
+// interval instead of once per sensor. This keeps the bus free for longer between batches and adding more SPI sensors doesn't add more
+// waits for the mutex. If we can't get the mutex in time, each sensor tries to get it for itself as before.
+void Heat::PollSensors() noexcept
+{
+	ReadLocker lock(sensorsLock);
+
+	bool haveSpiSensors = false;
+	for (TemperatureSensor *currentSensor = sensorsRoot; currentSensor != nullptr; currentSensor = currentSensor->GetNext())
+	{
+		if (currentSensor->UsesSharedSpi())
+		{
+			haveSpiSensors = true;
+			break;
+		}
+	}
+
+	if (haveSpiSensors)
+	{
+		MutexLocker spiLock(Tasks::GetSpiMutex(), SpiBatchLockTimeoutMillis);
+		if (!spiLock)
+		{
+			++spiBatchLockFailures;
+		}
+		for (TemperatureSensor *currentSensor = sensorsRoot; currentSensor != nullptr; currentSensor = currentSensor->GetNext())
+		{
+			if (currentSensor->UsesSharedSpi())
+			{
+				currentSensor->Poll();
+			}
+		}
+	}
+
+	for (TemperatureSensor *currentSensor = sensorsRoot; currentSensor != nullptr; currentSensor = currentSensor->GetNext())
+	{
+		if (!currentSensor->UsesSharedSpi())
+		{
+			currentSensor->Poll();
+		}
+	}
+}
+
 /* static */ void Heat::EnsureSensorsTask() noexcept
 {
 	TaskCriticalSectionLocker lock; // make sure we don't create the task more than once
@@ -420,6 +468,99 @@ void Heat::Exit() noexcept
 	}
 }
 
+// Get the predicted time for a heater to reach its target temperature at full power
+static float GetWarmUpTime(const Heater *h) noexcept
+{
+	const float target = (h->GetStatus() == HeaterStatus::active) ? h->GetActiveTemperature() : h->GetStandbyTemperature();
+	const float t = h->GetModel().GetHeatingTime(h->GetTemperature(), target, h->GetModel().GetMaxPwm());
+	return (t < 0.0) ? UnreachableWarmUpTime : t;
+}
+
+// Share the power budget between the heaters. This is called with the heaters lock held.
+// Heaters that are maintaining their temperatures get the power they are using first. Heaters that are warming up are then served in order of
+// decreasing predicted heat-up time at full power. Any heater that would reach its target well before the slowest one is held off until it needs
+// to start, so that all the heaters reach their targets at about the same time and the heaters that take longest get the most power early on.
+// Heaters whose rated power is unknown are not limited, and neither is their power accounted for.
+// Only LocalHeater::Spin applies the limit, so M310 refuses a rated power for heaters on expansion boards and we leave them out here.
+void Heat::ScheduleWarmUp() noexcept
+{
+	static_assert(MaxHeaters <= 32, "Too many heaters for warm-up bitmap");
+
+	float availablePower = powerBudget;
+	uint32_t warmingHeaters = 0;
+	for (size_t heater = 0; heater < MaxHeaters; ++heater)
+	{
+		Heater * const h = heaters[heater];
+		if (h != nullptr)
+		{
+			if (h->GetRatedPower() > 0.0 && h->IsHeaterEnabled() && h->IsLocal())
+			{
+				const HeaterStatus status = h->GetStatus();
+				if (status == HeaterStatus::active || status == HeaterStatus::standby)
+				{
+					const float target = (status == HeaterStatus::active) ? h->GetActiveTemperature() : h->GetStandbyTemperature();
+					if (h->GetTemperature() + TEMPERATURE_CLOSE_ENOUGH < target)
+					{
+						warmingHeaters |= 1ul << heater;
+						continue;
+					}
+					availablePower -= h->GetRatedPower() * h->GetAveragePWM();
+				}
+			}
+			h->SetPowerLimit(1.0);
+		}
+	}
+
+	// Find the longest predicted heat-up time of the heaters that are warming up and can reach their targets
+	float longestTime = 0.0;
+	for (size_t heater = 0; heater < MaxHeaters; ++heater)
+	{
+		if ((warmingHeaters & (1ul << heater)) != 0)
+		{
+			const float t = GetWarmUpTime(heaters[heater]);
+			if (t > longestTime && t < UnreachableWarmUpTime)
+			{
+				longestTime = t;
+			}
+		}
+	}
+
+	// Serve the warming heaters in order of decreasing heat-up time. Heaters that can't reach their targets at full power come first.
+	while (warmingHeaters != 0)
+	{
+		size_t slowestHeater = 0;
+		float slowestTime = 0.0;
+		bool found = false;
+		for (size_t heater = 0; heater < MaxHeaters; ++heater)
+		{
+			if ((warmingHeaters & (1ul << heater)) != 0)
+			{
+				const float t = GetWarmUpTime(heaters[heater]);
+				if (!found || t > slowestTime)
+				{
+					slowestHeater = heater;
+					slowestTime = t;
+					found = true;
+				}
+			}
+		}
+
+		warmingHeaters &= ~(1ul << slowestHeater);
+		Heater * const h = heaters[slowestHeater];
+		if (slowestTime + WarmUpStartMargin < longestTime)
+		{
+			h->SetPowerLimit(0.0);					// hold this heater off for now because it would reach its target too early
+		}
+		else
+		{
+			const float wantedPower = h->GetRatedPower() * h->GetModel().GetMaxPwm();
+			const float grantedPower = constrain<float>(availablePower, 0.0, wantedPower);
+			h->SetPowerLimit(grantedPower/h->GetRatedPower());
+			availablePower -= grantedPower;
+		}
+	}
+}
+
 void Heat::Diagnostics(MessageType mtype) noexcept
 {
 	Platform& platform = reprap.GetPlatform();
@@ -433,7 +574,8 @@ void Heat::Diagnostics(MessageType mtype) noexcept
 	{
 		platform.MessageF(mtype, " %d", chamberHeater);
 	}
-	platform.Message(mtype, "\n");
+	platform.MessageF(mtype, "\nSPI sensor batch lock failures %" PRIu32 "\n", spiBatchLockFailures);
+	spiBatchLockFailures = 0;
 
 	for (size_t heater : ARRAY_INDICES(heaters))
 	{
@@ -819,6 +961,12 @@ GCodeResult Heat::TuneHeater(GCodeBuffer& gb, const StringRef& reply) THROWS(GCo
 		const auto h = FindHeater(heater);
 		if (h.IsNotNull())
 		{
+			if (gb.Seen('L'))
+			{
+				// Online model identification
+				return h->ConfigureModelIdentification(gb.GetUIValue(), reply);
+			}
+
 			gb.MustSee('S');
 			const float temperature = gb.GetFValue();
 			const float maxPwm = (gb.Seen('P')) ? gb.GetFValue() : h->GetModel().GetMaxPwm();
@@ -864,6 +1012,79 @@ GCodeResult Heat::TuneHeater(GCodeBuffer& gb, const StringRef& reply) THROWS(GCo
 	}
 }
 
+// Process M310
+GCodeResult Heat::ConfigureWarmUp(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	if (gb.Seen('H'))
+	{
+		const unsigned int heater = gb.GetUIValue();
+		const auto h = FindHeater(heater);
+		if (h.IsNull())
+		{
+			reply.printf("Heater %u not found", heater);
+			return GCodeResult::error;
+		}
+
+		if (gb.Seen('W'))
+		{
+			const float power = max<float>(gb.GetFValue(), 0.0);
+			if (power > 0.0 && !h->IsLocal())
+			{
+				reply.printf("Heater %u is on an expansion board, so its power can't be scheduled", heater);
+				return GCodeResult::error;
+			}
+			h->SetRatedPower(power);
+			if (power == 0.0)
+			{
+				h->SetPowerLimit(1.0);
+			}
+		}
+		else
+		{
+			reply.printf("Heater %u rated power %.1fW, power limit %d%%", heater, (double)h->GetRatedPower(), (int)lrintf(h->GetPowerLimit() * 100.0));
+		}
+		return GCodeResult::ok;
+	}
+
+	if (gb.Seen('P'))
+	{
+		powerBudget = max<float>(gb.GetFValue(), 0.0);
+		if (powerBudget == 0.0)
+		{
+			// Remove any limits that the scheduler set
+			ReadLocker lock(heatersLock);
+			for (Heater *h : heaters)
+			{
+				if (h != nullptr)
+				{
+					h->SetPowerLimit(1.0);
+				}
+			}
+		}
+		reprap.HeatUpdated();
+		return GCodeResult::ok;
+	}
+
+	if (powerBudget > 0.0)
+	{
+		reply.printf("Heater power budget %.1fW", (double)powerBudget);
+		ReadLocker lock(heatersLock);
+		for (size_t heater = 0; heater < MaxHeaters; ++heater)
+		{
+			const Heater * const h = heaters[heater];
+			if (h != nullptr && h->GetRatedPower() > 0.0)
+			{
+				reply.catf(", heater %u %.1fW limit %d%%", heater, (double)h->GetRatedPower(), (int)lrintf(h->GetPowerLimit() * 100.0));
+			}
+		}
+	}
+	else
+	{
+		reply.copy("Warm-up scheduling is disabled");
+	}
+	return GCodeResult::ok;
+}
+
 // Process M308
 GCodeResult Heat::ConfigureSensor(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
 {
@@ -926,9 +1147,15 @@ GCodeResult Heat::ConfigureSensor(GCodeBuffer& gb, const StringRef& reply) THROW
 		return rslt;
 	}
 
-	// Modifying or reporting on an existing sensor
-	const auto sensor = FindSensor(sensorNum);
-	if (sensor.IsNull())
+	// Modifying or reporting on an existing sensor.
+	// We need the write lock, because the Heat task must not poll the sensor while its configuration and any lookup table are being changed.
+	WriteLocker lock(sensorsLock);
+	TemperatureSensor *sensor = sensorsRoot;
+	while (sensor != nullptr && sensor->GetSensorNumber() != sensorNum)
+	{
+		sensor = sensor->GetNext();
+	}
+	if (sensor == nullptr)
 	{
 		reply.printf("Sensor %u does not exist", sensorNum);
 		return GCodeResult::error;
@@ -81,6 +81,7 @@ public:
 	GCodeResult ConfigureSensor(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);		// Create a sensor or change the parameters for an existing sensor
 	GCodeResult SetPidParameters(unsigned int heater, GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException); // Set the P/I/D parameters for a heater
 	GCodeResult HandleM143(GCodeBuffer &gb, const StringRef &reply) THROWS(GCodeException);	// Configure heater protection (M143)
+	GCodeResult ConfigureWarmUp(GCodeBuffer &gb, const StringRef &reply) THROWS(GCodeException);	// Configure the warm-up power budget (M310)
 
 	void SensorsTask() noexcept;
 	static void EnsureSensorsTask() noexcept;
@@ -155,6 +156,8 @@ private:
 	void DeleteSensor(unsigned int sn) noexcept;
 	void InsertSensor(TemperatureSensor *newSensor) noexcept;
 	void SetTemperature(int heater, float t, bool activeNotStandby) THROWS(GCodeException);
+	void ScheduleWarmUp() noexcept;
+	void PollSensors() noexcept;
 
 	static ReadWriteLock heatersLock;
 
@@ -166,6 +169,9 @@ private:
 
 	float extrusionMinTemp;										// Minimum temperature to allow regular extrusion
 	float retractionMinTemp;									// Minimum temperature to allow regular retraction
+	float powerBudget;											// Total heater power available in watts, or 0 if warm-up scheduling is disabled
+	uint32_t lastWarmUpScheduleTime;							// When we last shared out the power budget
+	uint32_t spiBatchLockFailures;								// How many times we couldn't get the SPI mutex to poll the SPI sensors as a batch
 	bool coldExtrude;											// Is cold extrusion allowed?
 	int8_t bedHeaters[MaxBedHeaters];							// Indices of the hot bed heaters to use or -1 if none is available
 	int8_t chamberHeaters[MaxChamberHeaters];					// Indices of the chamber heaters to use or -1 if none is available
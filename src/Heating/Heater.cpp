@@ -62,7 +62,7 @@ DEFINE_GET_OBJECT_MODEL_TABLE(Heater)
 
 Heater::Heater(unsigned int num) noexcept
 	: heaterNumber(num), sensorNumber(-1), activeTemperature(0.0), standbyTemperature(0.0),
-	  maxTempExcursion(DefaultMaxTempExcursion), maxHeatingFaultTime(DefaultMaxHeatingFaultTime),
+	  maxTempExcursion(DefaultMaxTempExcursion), maxHeatingFaultTime(DefaultMaxHeatingFaultTime), ratedPower(0.0), powerLimit(1.0),
 	  active(false)
 {
 }
@@ -106,7 +106,7 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 		td = model.GetDeadTime(),
 		maxPwm = model.GetMaxPwm(),
 		voltage = model.GetVoltage();
-	int32_t dontUsePid = model.UsePid() ? 0 : 1;
+	int32_t dontUsePid = (!model.UsePid()) ? 1 : (model.UsePrediction()) ? 2 : 0;		// B0 = PID, B1 = bang-bang, B2 = PID with dead time compensation
 	int32_t inversionParameter = 0;
 
 	gb.TryGetFValue('A', gain, seen);
@@ -120,7 +120,11 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 	if (seen)
 	{
 		const bool inverseTemperatureControl = (inversionParameter == 1 || inversionParameter == 3);
-		const GCodeResult rslt = SetModel(gain, tc, td, maxPwm, voltage, dontUsePid == 0, inverseTemperatureControl, reply);
+		const GCodeResult rslt = SetModel(gain, tc, td, maxPwm, voltage, dontUsePid != 1, inverseTemperatureControl, reply);
+		if (rslt == GCodeResult::ok || rslt == GCodeResult::warning)
+		{
+			model.SetUsePrediction(dontUsePid == 2);				// only change the mode if the new model was accepted
+		}
 		if (rslt != GCodeResult::ok)
 		{
 			return rslt;
@@ -133,8 +137,9 @@ GCodeResult Heater::SetOrReportModel(unsigned int heater, GCodeBuffer& gb, const
 	else
 	{
 		const char* const mode = (!model.UsePid()) ? "bang-bang"
-									: (model.ArePidParametersOverridden()) ? "custom PID"
-										: "PID";
+									: (model.ArePidParametersOverridden()) ? ((model.UsePrediction()) ? "custom PID with dead time compensation" : "custom PID")
+										: (model.UsePrediction()) ? "PID with dead time compensation"
+											: "PID";
 		reply.printf("Heater %u model: gain %.1f, time constant %.1f, dead time %.1f, max PWM %.2f, calibration voltage %.1f, mode %s", heater,
 					 (double)model.GetGain(), (double)model.GetTimeConstant(), (double)model.GetDeadTime(), (double)model.GetMaxPwm(), (double)model.GetVoltage(), mode);
 		if (model.IsInverted())
@@ -44,8 +44,10 @@ public:
 	virtual void Spin() noexcept = 0;
 	virtual GCodeResult StartAutoTune(float targetTemp, float maxPwm, const StringRef& reply) noexcept = 0;	// Start an auto tune cycle for this PID
 	virtual void GetAutoTuneStatus(const StringRef& reply) const = 0;	// Get the auto tune status or last result
+	virtual GCodeResult ConfigureModelIdentification(unsigned int action, const StringRef& reply) noexcept = 0;	// Start, stop, report or apply online model identification
 	virtual void Suspend(bool sus) noexcept = 0;						// Suspend the heater to conserve power or while doing Z probing
 	virtual float GetAccumulator() const noexcept = 0;					// Get the inertial term accumulator
+	virtual bool IsLocal() const noexcept { return true; }				// Is the heater driven by this board?
 
 #if SUPPORT_CAN_EXPANSION
 	virtual void UpdateRemoteStatus(CanAddress src, const CanHeaterReport& report) noexcept = 0;
@@ -81,6 +83,11 @@ public:
 
 	void SetDefaultMonitors() noexcept;
 
+	float GetRatedPower() const noexcept { return ratedPower; }			// Get the power drawn at full PWM, in watts, or 0 if not known
+	void SetRatedPower(float p) noexcept { ratedPower = p; }
+	float GetPowerLimit() const noexcept { return powerLimit; }			// Get the maximum PWM allowed by the warm-up scheduler
+	void SetPowerLimit(float p) noexcept { powerLimit = p; }
+
 protected:
 	DECLARE_OBJECT_MODEL
 	OBJECT_MODEL_ARRAY(monitors)
@@ -129,6 +136,8 @@ private:
 	float standbyTemperature;						// The required standby temperature
 	float maxTempExcursion;							// The maximum temperature excursion permitted while maintaining the setpoint
 	float maxHeatingFaultTime;						// How long a heater fault is permitted to persist before a heater fault is raised
+	float ratedPower;								// The power drawn at full PWM in watts, or 0 if not known
+	float powerLimit;								// The maximum PWM allowed by the warm-up scheduler
 
 	bool active;									// Are we active or standby?
 };
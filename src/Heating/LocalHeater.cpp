@@ -16,6 +16,7 @@
 // Private constants
 const uint32_t InitialTuningReadingInterval = 250;	// the initial reading interval in milliseconds
 const uint32_t TempSettleTimeout = 20000;	// how long we allow the initial temperature to settle
+const float MinIdentifiedModelConfidence = 0.5;	// the minimum confidence in an identified model before we allow it to be used
 
 // Static class variables
 
@@ -40,7 +41,7 @@ float tuningVoltageAccumulator;				// sum of the voltage readings we take during
 
 // Member functions and constructors
 
-LocalHeater::LocalHeater(unsigned int heaterNum) noexcept : Heater(heaterNum), mode(HeaterMode::off)
+LocalHeater::LocalHeater(unsigned int heaterNum) noexcept : Heater(heaterNum), estimator(nullptr), identifying(false), estimatorResetPending(false), mode(HeaterMode::off)
 {
 	ResetHeater();
 	SetHeater(0.0);							// set up the pin even if the heater is not enabled (for PCCB)
@@ -54,6 +55,7 @@ LocalHeater::~LocalHeater() noexcept
 {
 	SwitchOff();
 	port.Release();
+	delete estimator;
 }
 
 float LocalHeater::GetTemperature() const noexcept
@@ -192,9 +194,16 @@ void LocalHeater::SwitchOff() noexcept
 // This is called when the heater model has been updated. Returns true if successful.
 GCodeResult LocalHeater::UpdateModel(const StringRef& reply) noexcept
 {
+	ResetPredictor();
 	return GCodeResult::ok;
 }
 
+// Restart the dead time compensation model from the current temperature
+void LocalHeater::ResetPredictor() noexcept
+{
+	predictor.Reset(temperature, NormalAmbientTemperature, GetModel().GetDeadTime(), HeatSampleIntervalMillis * MillisToSeconds);
+}
+
 // This is the main heater control loop function
 void LocalHeater::Spin() noexcept
 {
@@ -241,6 +250,17 @@ void LocalHeater::Spin() noexcept
 		previousTemperatures[previousTemperatureIndex] = temperature;
 		previousTemperaturesGood = (previousTemperaturesGood << 1) | 1;
 
+		// If we are identifying the model, pass it the new temperature and the PWM that was applied up to when we read it
+		if (identifying)
+		{
+			if (estimatorResetPending)
+			{
+				estimator->Reset(GetModel().GetDeadTime(), HeatSampleIntervalMillis * MillisToSeconds);
+				estimatorResetPending = false;
+			}
+			estimator->AddSample(temperature, lastPwm);
+		}
+
 		if (GetModel().IsEnabled())
 		{
 			// Get the target temperature and the error
@@ -326,6 +346,7 @@ void LocalHeater::Spin() noexcept
 				if (mode <= HeaterMode::suspended)
 				{
 					lastPwm = 0.0;
+					ResetPredictor();
 				}
 				else
 				{
@@ -336,15 +357,25 @@ void LocalHeater::Spin() noexcept
 						const bool inLoadMode = (mode == HeaterMode::stable) || fabsf(error) < 3.0;		// use standard PID when maintaining temperature
 						const PidParameters& params = GetModel().GetPidParameters(inLoadMode);
 
-						// If the P and D terms together demand that the heater is full on or full off, disregard the I term
-						const float errorMinusDterm = error - (params.tD * derivative);
+						// If dead time compensation is enabled, control the temperature that the model predicts the sensor will see one dead time from now
+						float controlTemperature = temperature, controlDerivative = derivative;
+						if (GetModel().UsePrediction())
+						{
+							controlTemperature += predictor.GetTemperatureCorrection();
+							controlDerivative += predictor.GetRateCorrection();
+						}
+						const float controlError = targetTemperature - controlTemperature;
+
+						// If the P and D terms together demand that the heater is full on or full off, disregard the I term.
+						// The predictor provides the anticipation that the D term provides in plain PID, so we don't use both.
+						const float errorMinusDterm = (GetModel().UsePrediction()) ? controlError : controlError - (params.tD * derivative);
 						const float pPlusD = params.kP * errorMinusDterm;
-						const float expectedPwm = constrain<float>((temperature - NormalAmbientTemperature)/GetModel().GetGain(), 0.0, GetModel().GetMaxPwm());
+						const float expectedPwm = constrain<float>((controlTemperature - NormalAmbientTemperature)/GetModel().GetGain(), 0.0, GetModel().GetMaxPwm());
 						if (pPlusD + expectedPwm > GetModel().GetMaxPwm())
 						{
 							lastPwm = GetModel().GetMaxPwm();
 							// If we are heating up, preset the I term to the expected PWM at this temperature, ready for the switch over to PID
-							if (mode == HeaterMode::heating && error > 0.0 && derivative > 0.0)
+							if (mode == HeaterMode::heating && controlError > 0.0 && controlDerivative > 0.0)
 							{
 								iAccumulator = expectedPwm;
 							}
@@ -355,12 +386,18 @@ void LocalHeater::Spin() noexcept
 						}
 						else
 						{
-							const float errorToUse = error;
+							const float errorToUse = controlError;
 							iAccumulator = constrain<float>
 											(iAccumulator + (errorToUse * params.kP * params.recipTi * HeatSampleIntervalMillis * MillisToSeconds),
 												0.0, GetModel().GetMaxPwm());
 							lastPwm = constrain<float>(pPlusD + iAccumulator, 0.0, GetModel().GetMaxPwm());
 						}
+
+						// Apply any limit set by the warm-up scheduler
+						lastPwm = min<float>(lastPwm, GetPowerLimit());
+
+						// Advance the model using the PWM we are about to apply, before any voltage compensation because the model gain is for the calibration voltage
+						predictor.Update(lastPwm, GetModel().GetGain(), GetModel().GetTimeConstant());
 	#if HAS_VOLTAGE_MONITOR
 						// Scale the PID based on the current voltage vs. the calibration voltage
 						if (lastPwm < 1.0 && GetModel().GetVoltage() >= 10.0)				// if heater is not fully on and we know the voltage we tuned the heater at
@@ -379,7 +416,7 @@ void LocalHeater::Spin() noexcept
 					else
 					{
 						// Using bang-bang mode
-						lastPwm = (error > 0.0) ? GetModel().GetMaxPwm() : 0.0;
+						lastPwm = (error > 0.0) ? min<float>(GetModel().GetMaxPwm(), GetPowerLimit()) : 0.0;
 					}
 
 					// Check if the generated PWM signal needs to be inverted for inverse temperature control
@@ -537,6 +574,111 @@ void LocalHeater::GetAutoTuneStatus(const StringRef& reply) const noexcept
 	}
 }
 
+// Start, stop, report or apply online model identification.
+// Action 0 stops identification, 1 starts it or reports the progress if already started, 2 replaces the heater model by the identified one.
+// This runs on the Main task but the Heat task feeds the estimator, so we only start and stop identification by setting flags that the Heat task acts on.
+GCodeResult LocalHeater::ConfigureModelIdentification(unsigned int action, const StringRef& reply) noexcept
+{
+	switch (action)
+	{
+	case 0:
+		if (identifying)
+		{
+			ReportModelIdentification(reply);
+			identifying = false;
+			reply.cat(", identification stopped");
+		}
+		else
+		{
+			reply.printf("Heater %u model identification is not running", GetHeaterNumber());
+		}
+		return GCodeResult::ok;
+
+	case 1:
+		if (!identifying)
+		{
+			if (!GetModel().IsEnabled() || GetModel().IsInverted())
+			{
+				reply.printf("Heater %u model cannot be identified while the heater is disabled or uses inverted temperature control", GetHeaterNumber());
+				return GCodeResult::error;
+			}
+
+			if (estimator == nullptr)
+			{
+				// We don't normally allow dynamic memory allocation when running, but this is normally done from config.g and is only done on request
+				estimator = new FopDtEstimator;
+			}
+			estimatorResetPending = true;
+			identifying = true;										// set this last so that the Heat task resets the estimator before it uses it
+			reply.printf("Heater %u model identification started", GetHeaterNumber());
+		}
+		else
+		{
+			ReportModelIdentification(reply);
+		}
+		return GCodeResult::ok;
+
+	case 2:
+		{
+			FopDtEstimator::Estimate est;
+			uint32_t numWindows;
+			if (!identifying || !GetIdentifiedModel(est, numWindows))
+			{
+				reply.printf("Heater %u has no identified model", GetHeaterNumber());
+				return GCodeResult::error;
+			}
+			if (est.confidence < MinIdentifiedModelConfidence)
+			{
+				reply.printf("Heater %u identified model confidence %d%% is too low to use", GetHeaterNumber(), (int)(est.confidence * 100.0));
+				return GCodeResult::error;
+			}
+
+			// The identification used the PWM that was actually applied, so the model is correct for the current supply voltage
+			const float voltage =
+#if HAS_VOLTAGE_MONITOR
+									reprap.GetPlatform().GetCurrentPowerVoltage();
+#else
+									0.0;
+#endif
+			const FopDt& oldModel = GetModel();
+			return SetModel(est.gain, est.timeConstant, est.deadTime, oldModel.GetMaxPwm(), voltage, oldModel.UsePid(), oldModel.IsInverted(), reply);
+		}
+
+	default:
+		reply.copy("Invalid L parameter");
+		return GCodeResult::error;
+	}
+}
+
+void LocalHeater::ReportModelIdentification(const StringRef& reply) const noexcept
+{
+	FopDtEstimator::Estimate est;
+	uint32_t numWindows;
+	if (GetIdentifiedModel(est, numWindows))
+	{
+		reply.printf("Heater %u identified model: gain %.1f, time constant %.1f, dead time %.1f, ambient %.1f" DEGREE_SYMBOL "C, confidence %d%%",
+						GetHeaterNumber(), (double)est.gain, (double)est.timeConstant, (double)est.deadTime, (double)est.ambientTemperature,
+						(int)(est.confidence * 100.0));
+	}
+	else
+	{
+		reply.printf("Heater %u model identification has insufficient data (%" PRIu32 " averaging windows)", GetHeaterNumber(), numWindows);
+	}
+}
+
+// Get a consistent copy of the estimate. The Heat task updates the estimator, so stop it running while we read it.
+bool LocalHeater::GetIdentifiedModel(FopDtEstimator::Estimate& est, uint32_t& numWindows) const noexcept
+{
+	TaskCriticalSectionLocker lock;
+	if (estimator == nullptr || estimatorResetPending)
+	{
+		numWindows = 0;
+		return false;
+	}
+	numWindows = estimator->GetNumWindows();
+	return estimator->GetEstimate(est);
+}
+
 /* Notes on the auto tune algorithm
  *
  * Most 3D printer firmwares use the strm-Hgglund relay tuning method (sometimes called Ziegler-Nichols + relay).
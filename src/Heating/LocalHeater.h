@@ -14,6 +14,8 @@
 
 #include "Heater.h"
 #include "FOPDT.h"
+#include "SmithPredictor.h"
+#include "FopDtEstimator.h"
 #include "TemperatureError.h"
 #include "Hardware/IoPorts.h"
 #include "GCodes/GCodeResult.h"
@@ -40,6 +42,7 @@ public:
 	float GetAccumulator() const noexcept override;			// Return the integral accumulator
 	GCodeResult StartAutoTune(float targetTemp, float maxPwm, const StringRef& reply) noexcept override;	// Start an auto tune cycle for this PID
 	void GetAutoTuneStatus(const StringRef& reply) const noexcept override;	// Get the auto tune status or last result
+	GCodeResult ConfigureModelIdentification(unsigned int action, const StringRef& reply) noexcept override;	// Start, stop, report or apply online model identification
 	void Suspend(bool sus) noexcept override;				// Suspend the heater to conserve power or while doing Z probing
 
 #if SUPPORT_CAN_EXPANSION
@@ -66,6 +69,9 @@ private:
 	void DisplayBuffer(const char *intro) noexcept;			// Debug helper
 	float GetExpectedHeatingRate() const noexcept;			// Get the minimum heating rate we expect
 	void RaiseHeaterFault(const char *format, ...) noexcept;
+	void ResetPredictor() noexcept;							// Restart the dead time compensation model from the current temperature
+	void ReportModelIdentification(const StringRef& reply) const noexcept;
+	bool GetIdentifiedModel(FopDtEstimator::Estimate& est, uint32_t& numWindows) const noexcept;
 
 	PwmPort port;											// The port that drives the heater
 	float temperature;										// The current temperature
@@ -76,6 +82,10 @@ private:
 	float averagePWM;										// The running average of the PWM, after scaling.
 	uint32_t timeSetHeating;								// When we turned on the heater
 	uint32_t lastSampleTime;								// Time when the temperature was last sampled by Spin()
+	SmithPredictor predictor;								// Dead time compensation, used if the model has prediction enabled
+	FopDtEstimator *estimator;								// Online model identification. Allocated when first needed and then kept, because the Heat task may be using it.
+	volatile bool identifying;								// True if the Heat task should pass samples to the estimator
+	volatile bool estimatorResetPending;					// True if the Heat task should reset the estimator before passing it the next sample
 
 	uint16_t heatingFaultCount;								// Count of questionable heating behaviours
 
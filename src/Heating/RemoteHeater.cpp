@@ -139,6 +139,12 @@ void RemoteHeater::GetAutoTuneStatus(const StringRef& reply) const noexcept
 	reply.copy("remote heater auto tune not implemented");
 }
 
+GCodeResult RemoteHeater::ConfigureModelIdentification(unsigned int action, const StringRef& reply) noexcept
+{
+	reply.copy("remote heater model identification not implemented");
+	return GCodeResult::error;
+}
+
 void RemoteHeater::Suspend(bool sus) noexcept
 {
 	CanMessageBuffer * const buf = CanMessageBuffer::Allocate();
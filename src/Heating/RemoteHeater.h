@@ -30,7 +30,9 @@ public:
 	float GetAccumulator() const noexcept override;			// Return the integral accumulator
 	GCodeResult StartAutoTune(float targetTemp, float maxPwm, const StringRef& reply) noexcept override;	// Start an auto tune cycle for this PID
 	void GetAutoTuneStatus(const StringRef& reply) const noexcept override;	// Get the auto tune status or last result
+	GCodeResult ConfigureModelIdentification(unsigned int action, const StringRef& reply) noexcept override;
 	void Suspend(bool sus) noexcept override;				// Suspend the heater to conserve power or while doing Z probing
+	bool IsLocal() const noexcept override { return false; }
 	void UpdateRemoteStatus(CanAddress src, const CanHeaterReport& report) noexcept override;
 
 protected:
@@ -32,19 +32,21 @@ GCodeResult LinearAnalogSensor::Configure(GCodeBuffer& gb, const StringRef& repl
 		changed = true;
 		filtered = gb.GetIValue() >= 1;
 	}
+	TryConfigureAdcFilter(gb, changed);
 
 	if (changed)
 	{
 		CalcDerivedParameters();
-		if (adcFilterChannel >= 0)
-		{
-			reprap.GetPlatform().GetAdcFilter(adcFilterChannel).Init(0);
-		}
+		InitAdcFilter(adcFilterChannel, 0);
 	}
 	else
 	{
 		CopyBasicDetails(reply);
 		reply.catf(", %sfiltered, range %.1f to %.1f", (filtered) ? "" : "un", (double)lowTemp, (double)highTemp);
+		if (filtered)
+		{
+			AppendAdcFilterDetails(reply);
+		}
 	}
 	return GCodeResult::ok;
 }
@@ -53,7 +55,7 @@ void LinearAnalogSensor::Poll() noexcept
 {
 	if (filtered && adcFilterChannel >= 0)
 	{
-		const volatile ThermistorAveragingFilter& tempFilter = reprap.GetPlatform().GetAdcFilter(adcFilterChannel);
+		const volatile ThermistorAdcFilter& tempFilter = reprap.GetPlatform().GetAdcFilter(adcFilterChannel);
 		if (tempFilter.IsValid())
 		{
 			const int32_t averagedTempReading = tempFilter.GetSum()/(ThermistorAverageReadings >> AdcOversampleBits);
@@ -7,9 +7,11 @@
 
 #include "SensorWithPort.h"
 #include "GCodes/GCodeBuffer/GCodeBuffer.h"
+#include "Platform.h"
+#include "RepRap.h"
 
 SensorWithPort::SensorWithPort(unsigned int sensorNum, const char *type) noexcept
-	: TemperatureSensor(sensorNum, type)
+	: TemperatureSensor(sensorNum, type), adcFilterMedianLength(1), adcFilterIirShift(0)
 {
 }
 
@@ -47,4 +49,40 @@ void SensorWithPort::CopyBasicDetails(const StringRef& reply) const noexcept
 	reply.catf(", reading %.1f, last error: %s", (double)GetStoredReading(), TemperatureErrorString(GetLastError()));
 }
 
+// Configure the ADC filter from the Q (median length) and K (IIR filter shift) parameters
+void SensorWithPort::TryConfigureAdcFilter(GCodeBuffer& gb, bool& seen)
+{
+	if (gb.Seen('Q'))
+	{
+		const uint32_t medianLength = gb.GetUIValue();
+		if (medianLength != 1 && medianLength != 3 && medianLength != 5)
+		{
+			throw GCodeException(gb.GetLineNumber(), -1, "Median filter length must be 1, 3 or 5");
+		}
+		adcFilterMedianLength = (uint8_t)medianLength;
+		seen = true;
+	}
+	if (gb.Seen('K'))
+	{
+		adcFilterIirShift = (uint8_t)gb.GetLimitedUIValue('K', ThermistorAdcFilter::MaxIirShift + 1);
+		seen = true;
+	}
+}
+
+// Set up the ADC filter with our filter parameters and reset it
+void SensorWithPort::InitAdcFilter(int filterChannel, uint16_t initialValue) const noexcept
+{
+	if (filterChannel >= 0)
+	{
+		volatile ThermistorAdcFilter& filter = reprap.GetPlatform().GetAdcFilter(filterChannel);
+		filter.Configure(adcFilterMedianLength, adcFilterIirShift);
+		filter.Init(initialValue);
+	}
+}
+
+void SensorWithPort::AppendAdcFilterDetails(const StringRef& reply) const noexcept
+{
+	reply.catf(" Q:%u K:%u", adcFilterMedianLength, adcFilterIirShift);
+}
+
 // End
@@ -22,7 +22,16 @@ protected:
 	// Copy the basic details to the reply buffer. This hides the version in the base class.
 	void CopyBasicDetails(const StringRef& reply) const noexcept;
 
+	// Configure the filter for readings from the ADC channel of the port, for sensors that use one
+	void TryConfigureAdcFilter(GCodeBuffer& gb, bool& seen) THROWS(GCodeException);
+	void InitAdcFilter(int filterChannel, uint16_t initialValue) const noexcept;
+	void AppendAdcFilterDetails(const StringRef& reply) const noexcept;
+
 	IoPort port;
+
+private:
+	uint8_t adcFilterMedianLength;										// 1, 3 or 5
+	uint8_t adcFilterIirShift;											// 0 for a boxcar average, else the IIR filter time constant is 2^adcFilterIirShift readings
 };
 
 #endif /* SRC_HEATING_SENSORS_SENSORWITHPORT_H_ */
@@ -35,14 +35,17 @@ void SpiTemperatureSensor::InitSpi() noexcept
 	lastReadingTime = millis();
 }
 
-// Send and receive 1 to 8 bytes of data and return the result as a single 32-bit word
+// Send and receive 1 to 8 bytes of data and return the result as a single 32-bit word.
+// The caller may already hold the SPI mutex, see Heat::PollSensors.
 TemperatureError SpiTemperatureSensor::DoSpiTransaction(const uint8_t dataOut[], size_t nbytes, uint32_t& rslt) const noexcept
 {
 	uint8_t rawBytes[8];
 	spi_status_t sts;
 	{
-		MutexLocker lock(Tasks::GetSpiMutex(), 10);
-		if (!lock)
+		// If the Heat task is polling a batch of sensors then it already holds the SPI mutex, so don't try to take it again
+		const bool batched = (Tasks::GetSpiMutex()->GetHolder() == RTOSIface::GetCurrentTask());
+		MutexLocker lock((batched) ? nullptr : Tasks::GetSpiMutex(), 10);
+		if (!batched && !lock)
 		{
 			return TemperatureError::busBusy;
 		}
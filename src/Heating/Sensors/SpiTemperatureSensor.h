@@ -13,6 +13,9 @@
 
 class SpiTemperatureSensor : public SensorWithPort
 {
+public:
+	bool UsesSharedSpi() const noexcept override { return true; }
+
 protected:
 	SpiTemperatureSensor(unsigned int sensorNum, const char *name, uint8_t spiMode, uint32_t clockFrequency) noexcept;
 	bool ConfigurePort(GCodeBuffer& gb, const StringRef& reply, bool& seen);
@@ -85,6 +85,7 @@ public:
 	// Try to get a temperature reading
 	virtual void Poll() noexcept = 0;
 	virtual bool PollInTask() noexcept { return false; };		// Classes implementing this method need to also call Heat::EnsureSensorsTask() after succesful configuration
+	virtual bool UsesSharedSpi() const noexcept { return false; }	// true if Poll() does transactions on the shared SPI bus
 
 protected:
 	DECLARE_OBJECT_MODEL
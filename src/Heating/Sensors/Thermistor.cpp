@@ -7,6 +7,7 @@
  */
 
 #include "Thermistor.h"
+#include "ThermistorTable.h"
 #include "Platform.h"
 #include "RepRap.h"
 #include "GCodes/GCodeBuffer/GCodeBuffer.h"
@@ -22,14 +23,20 @@
 // Create an instance with default values
 Thermistor::Thermistor(unsigned int sensorNum, bool p_isPT1000) noexcept
 	: SensorWithPort(sensorNum, (p_isPT1000) ? "PT1000" : "Thermistor"),
-	  r25(DefaultR25), beta(DefaultBeta), shC(DefaultShc), seriesR(DefaultThermistorSeriesR), adcFilterChannel(-1), isPT1000(p_isPT1000)
+	  r25(DefaultR25), beta(DefaultBeta), shC(DefaultShc), seriesR(DefaultThermistorSeriesR), adcFilterChannel(-1), isPT1000(p_isPT1000), useTable(false)
 #if !HAS_VREF_MONITOR || defined(DUET3)
 	  , adcLowOffset(0), adcHighOffset(0)
 #endif
+	  , table(nullptr)
 {
 	CalcDerivedParameters();
 }
 
+Thermistor::~Thermistor() noexcept
+{
+	delete table;
+}
+
 // Configure the temperature sensor
 GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool& changed)
 {
@@ -50,6 +57,11 @@ GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool&
 		}
 		gb.TryGetFValue('C', shC, changed);
 		gb.TryGetFValue('T', r25, changed);
+		if (gb.Seen('U'))
+		{
+			useTable = (gb.GetUIValue() != 0);
+			changed = true;
+		}
 		if (changed)
 		{
 			CalcDerivedParameters();
@@ -70,14 +82,12 @@ GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool&
 #endif
 
 	TryConfigureSensorName(gb, changed);
+	TryConfigureAdcFilter(gb, changed);
 
 	if (changed)
 	{
 		adcFilterChannel = reprap.GetPlatform().GetAveragingFilterIndex(port);
-		if (adcFilterChannel >= 0)
-		{
-			reprap.GetPlatform().GetAdcFilter(adcFilterChannel).Init((1u << AdcBits) - 1);
-		}
+		InitAdcFilter(adcFilterChannel, (1u << AdcBits) - 1);
 	}
 	else
 	{
@@ -89,11 +99,12 @@ GCodeResult Thermistor::Configure(GCodeBuffer& gb, const StringRef& reply, bool&
 		}
 		else
 		{
-			reply.catf(", T:%.1f B:%.1f C:%.2e R:%.1f", (double)r25, (double)beta, (double)shC, (double)seriesR);
+			reply.catf(", T:%.1f B:%.1f C:%.2e R:%.1f U:%d", (double)r25, (double)beta, (double)shC, (double)seriesR, (useTable) ? 1 : 0);
 		}
 #if !HAS_VREF_MONITOR || defined(DUET3)
 		reply.catf(" L:%d H:%d", adcLowOffset, adcHighOffset);
 #endif
+		AppendAdcFilterDetails(reply);
 	}
 
 	return GCodeResult::ok;
@@ -106,7 +117,7 @@ void Thermistor::Poll() noexcept
 	bool tempFilterValid;
 	if (adcFilterChannel >= 0)
 	{
-		const volatile ThermistorAveragingFilter& tempFilter = reprap.GetPlatform().GetAdcFilter(adcFilterChannel);
+		const volatile ThermistorAdcFilter& tempFilter = reprap.GetPlatform().GetAdcFilter(adcFilterChannel);
 		averagedTempReading = tempFilter.GetSum()/(tempFilter.NumAveraged() >> Thermistor::AdcOversampleBits);
 		tempFilterValid = tempFilter.IsValid();
 	}
@@ -118,8 +129,8 @@ void Thermistor::Poll() noexcept
 
 #if HAS_VREF_MONITOR
 	// Use the actual VSSA and VREF values read by the ADC
-	const volatile ThermistorAveragingFilter& vrefFilter = reprap.GetPlatform().GetAdcFilter(VrefFilterIndex);
-	const volatile ThermistorAveragingFilter& vssaFilter = reprap.GetPlatform().GetAdcFilter(VssaFilterIndex);
+	const volatile ThermistorAdcFilter& vrefFilter = reprap.GetPlatform().GetAdcFilter(VrefFilterIndex);
+	const volatile ThermistorAdcFilter& vssaFilter = reprap.GetPlatform().GetAdcFilter(VssaFilterIndex);
 	if (tempFilterValid && vrefFilter.IsValid() && vssaFilter.IsValid())
 	{
 # ifdef DUET3
@@ -199,9 +210,7 @@ void Thermistor::Poll() noexcept
 				else
 				{
 					// Else it's a thermistor
-					const float logResistance = log(resistance);
-					const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
-					const float temp =  (recipT > 0.0) ? (1.0/recipT) + ABS_ZERO : BadErrorTemperature;
+					const float temp = CalcTemperature(resistance);
 
 					if (temp < MinimumConnectedTemperature)
 					{
@@ -223,12 +232,46 @@ void Thermistor::Poll() noexcept
 	}
 }
 
-// Calculate shA and shB from the other parameters
+// Convert thermistor resistance to temperature, using the lookup table if we have one and the resistance is within its range
+float Thermistor::CalcTemperature(float resistance) const noexcept
+{
+	float temp;
+	if (table != nullptr && table->Lookup(resistance, temp))
+	{
+		return temp;
+	}
+
+	const float logResistance = log(resistance);
+	const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
+	return (recipT > 0.0) ? (1.0/recipT) + ABS_ZERO : BadErrorTemperature;
+}
+
+// Calculate shA and shB from the other parameters, and build the lookup table if we are using one.
+// The caller must hold the sensors write lock if the sensor is in the sensor list, because CalcTemperature uses the table.
 void Thermistor::CalcDerivedParameters() noexcept
 {
 	shB = 1.0/beta;
 	const float lnR25 = logf(r25);
 	shA = 1.0/(25.0 - ABS_ZERO) - shB * lnR25 - shC * lnR25 * lnR25 * lnR25;
+
+	if (useTable && !isPT1000)
+	{
+		if (table == nullptr)
+		{
+			table = new ThermistorTable;
+		}
+		if (!table->Build(shA, shB, shC))
+		{
+			// The parameters don't describe a thermistor that the table can represent, so fall back to the equation
+			delete table;
+			table = nullptr;
+		}
+	}
+	else
+	{
+		delete table;
+		table = nullptr;
+	}
 }
 
 // End
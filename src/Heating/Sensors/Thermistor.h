@@ -10,6 +10,8 @@
 
 #include "SensorWithPort.h"
 
+class ThermistorTable;
+
 // The Steinhart-Hart equation for thermistor resistance is:
 // 1/T = A + B ln(R) + C [ln(R)]^3
 //
@@ -22,6 +24,7 @@ class Thermistor : public SensorWithPort
 {
 public:
 	Thermistor(unsigned int sensorNum, bool p_isPT1000) noexcept;					// create an instance with default values
+	~Thermistor() noexcept override;
 	GCodeResult Configure(GCodeBuffer& gb, const StringRef& reply, bool& changed) override THROWS(GCodeException); // configure the sensor from M305 parameters
 	void Poll() noexcept override;
 	const char *GetShortSensorType() const noexcept override { return (isPT1000) ? TypeNamePT1000 : TypeNameThermistor; }
@@ -33,12 +36,14 @@ private:
 	// For the theory behind ADC oversampling, see http://www.atmel.com/Images/doc8003.pdf
 	static constexpr unsigned int AdcOversampleBits = 2;							// we use 2-bit oversampling
 
-	void CalcDerivedParameters() noexcept;											// calculate shA and shB
+	void CalcDerivedParameters() noexcept;											// calculate shA and shB, and build the lookup table if we are using one
+	float CalcTemperature(float resistance) const noexcept;						// convert resistance to temperature
 
 	// The following are configurable parameters
 	float r25, beta, shC, seriesR;													// parameters declared in the M305 command
 	int8_t adcFilterChannel;
 	bool isPT1000;																	// true if it is a PT1000 sensor, not a thermistor
+	bool useTable;																	// true if we convert resistance to temperature using a lookup table
 
 // Duet 3 VRef calibration doesn't work well on the MB6HC v0.6 or v1.0 so provide calibration adjustment
 #if !HAS_VREF_MONITOR || defined(DUET3)
@@ -47,6 +52,7 @@ private:
 
 	// The following are derived from the configurable parameters
 	float shA, shB;																	// derived parameters
+	ThermistorTable *table;															// lookup table, or nullptr if not using one or it couldn't be built
 
 	static constexpr int32_t OversampledAdcRange = 1u << (AdcBits + AdcOversampleBits);	// The readings we pass in should be in range 0..(AdcRange - 1)
 };
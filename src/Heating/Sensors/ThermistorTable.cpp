@@ -0,0 +1,112 @@
+/*
+ * ThermistorTable.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "ThermistorTable.h"
+#include <cmath>
+#include <cstring>
+
+constexpr float AbsoluteZero = -273.15;
+
+// Return an approximation to log2(f) for positive normal f. This is exact when f is a power of 2 and linear in between.
+inline float ThermistorTable::ApproxLog2(float f) noexcept
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	const int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127;
+	const float mantissaFraction = (float)(bits & 0x007FFFFF) * (1.0/8388608.0);
+	return (float)exponent + mantissaFraction;
+}
+
+// Return the value whose approximate log2 is u
+inline float ThermistorTable::InverseApproxLog2(float u) noexcept
+{
+	const float exponent = floorf(u);
+	return ldexpf(1.0 + (u - exponent), (int)exponent);
+}
+
+// Convert resistance to temperature using the Steinhart-Hart equation
+float ThermistorTable::Calculate(float shA, float shB, float shC, float resistance) noexcept
+{
+	const float logResistance = logf(resistance);
+	const float recipT = shA + shB * logResistance + shC * logResistance * logResistance * logResistance;
+	return (recipT > 0.0) ? (1.0/recipT) + AbsoluteZero : AbsoluteZero;
+}
+
+// Build the table from the Steinhart-Hart coefficients, returning false if the range can't be covered
+bool ThermistorTable::Build(float shA, float shB, float shC) noexcept
+{
+	numEntries = 0;
+
+	// Find the resistances at the ends of the temperature range. We use bisection on ln(R) because when C is nonzero there is no simple formula.
+	float logResistanceLimits[2];
+	const float temperatureLimits[2] = { MaxTemperature, MinTemperature };
+	for (size_t i = 0; i < 2; ++i)
+	{
+		const float recipT = 1.0/(temperatureLimits[i] - AbsoluteZero);
+		float low = -10.0, high = 30.0;						// ln(R) range to search, about 45 microohms to 10 teraohms
+		for (unsigned int iteration = 0; iteration < 40; ++iteration)
+		{
+			const float mid = 0.5 * (low + high);
+			if (shA + shB * mid + shC * mid * mid * mid < recipT)
+			{
+				low = mid;
+			}
+			else
+			{
+				high = mid;
+			}
+		}
+		logResistanceLimits[i] = 0.5 * (low + high);
+	}
+
+	if (!(logResistanceLimits[1] > logResistanceLimits[0]))
+	{
+		return false;										// resistance doesn't decrease with temperature, so this isn't an NTC thermistor
+	}
+
+	firstOctave = (int32_t)floorf(ApproxLog2(expf(logResistanceLimits[0])));
+	const int32_t lastOctave = (int32_t)ceilf(ApproxLog2(expf(logResistanceLimits[1])));
+	const int32_t numOctaves = lastOctave - firstOctave;
+	if (numOctaves < 1 || numOctaves > (int32_t)TableSize - 1)
+	{
+		return false;
+	}
+
+	entriesPerOctave = (uint16_t)((TableSize - 1)/(size_t)numOctaves);
+	const size_t entriesNeeded = (size_t)numOctaves * entriesPerOctave + 1;
+	for (size_t i = 0; i < entriesNeeded; ++i)
+	{
+		const float resistance = InverseApproxLog2((float)firstOctave + (float)i/(float)entriesPerOctave);
+		const long scaledTemperature = lrintf(Calculate(shA, shB, shC, resistance) * TemperatureScale);
+		temperatures[i] = (int16_t)((scaledTemperature < INT16_MIN) ? INT16_MIN : (scaledTemperature > INT16_MAX) ? INT16_MAX : scaledTemperature);
+	}
+	numEntries = (uint16_t)entriesNeeded;
+	return true;
+}
+
+// Convert resistance to temperature in Celsius, returning false if the resistance is outside the range of the table
+bool ThermistorTable::Lookup(float resistance, float& temperature) const noexcept
+{
+	if (!(resistance > 0.0) || numEntries < 2)
+	{
+		return false;
+	}
+
+	const float position = (ApproxLog2(resistance) - (float)firstOctave) * (float)entriesPerOctave;
+	if (position < 0.0 || position >= (float)(numEntries - 1))
+	{
+		return false;
+	}
+
+	const size_t index = (size_t)position;
+	const float fraction = position - (float)index;
+	const float t0 = temperatures[index];
+	temperature = (t0 + ((float)temperatures[index + 1] - t0) * fraction) * (1.0/TemperatureScale);
+	return true;
+}
+
+// End
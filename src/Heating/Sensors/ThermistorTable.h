@@ -0,0 +1,47 @@
+/*
+ * ThermistorTable.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Lookup table to convert thermistor resistance to temperature without evaluating logarithms.
+ *  The table is indexed by a piecewise linear approximation to log2(resistance), which we get directly from the bits of the floating point
+ *  representation. The approximation is exact at powers of two and we put a whole number of table entries in each octave, so that the
+ *  kinks in the approximation coincide with table entries and linear interpolation between entries remains accurate.
+ */
+
+#ifndef SRC_HEATING_SENSORS_THERMISTORTABLE_H_
+#define SRC_HEATING_SENSORS_THERMISTORTABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class ThermistorTable
+{
+public:
+	static constexpr size_t TableSize = 128;
+	static constexpr float MinTemperature = -10.0;			// the lowest temperature that the table needs to cover
+	static constexpr float MaxTemperature = 400.0;			// the highest temperature that the table needs to cover
+
+	// Build the table from the Steinhart-Hart coefficients, returning false if the range can't be covered
+	bool Build(float shA, float shB, float shC) noexcept;
+
+	// Convert resistance to temperature in Celsius, returning false if the resistance is outside the range of the table
+	bool Lookup(float resistance, float& temperature) const noexcept;
+
+	// Convert resistance to temperature using the Steinhart-Hart equation, returning absolute zero if the result is meaningless
+	static float Calculate(float shA, float shB, float shC, float resistance) noexcept;
+
+private:
+	static constexpr float TemperatureScale = 32.0;			// the table holds temperatures in units of 1/32C
+
+	static float ApproxLog2(float f) noexcept;
+	static float InverseApproxLog2(float u) noexcept;
+
+	int32_t firstOctave;									// the integer part of ApproxLog2 of the resistance for the first table entry
+	uint16_t entriesPerOctave;
+	uint16_t numEntries;									// the number of entries in use
+	int16_t temperatures[TableSize];						// temperatures in units of 1/TemperatureScale Celsius
+};
+
+#endif /* SRC_HEATING_SENSORS_THERMISTORTABLE_H_ */
@@ -0,0 +1,84 @@
+/*
+ * SmithPredictor.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "SmithPredictor.h"
+#include <cmath>
+
+// Restart the model from a steady state at the specified temperature.
+// The dead time is quantised to a whole number of sample intervals and then spread over the history entries.
+void SmithPredictor::Reset(float temperature, float ambientTemperature, float deadTime, float sampleInterval) noexcept
+{
+	interval = sampleInterval;
+	modelRise = (temperature > ambientTemperature) ? temperature - ambientTemperature : 0.0;
+	modelRate = 0.0;
+
+	const unsigned int deadTimeSamples = (deadTime > sampleInterval) ? (unsigned int)lrintf(deadTime/sampleInterval) : 1;
+	samplesPerSlot = (uint16_t)((deadTimeSamples + MaxHistory - 2)/(MaxHistory - 1));			// round up so that we don't need more than MaxHistory entries
+	historyLength = (uint8_t)((deadTimeSamples + samplesPerSlot/2)/samplesPerSlot + 1);
+	if (historyLength < 2)
+	{
+		historyLength = 2;
+	}
+	else if (historyLength > MaxHistory)
+	{
+		historyLength = MaxHistory;
+	}
+
+	for (float& h : history)
+	{
+		h = modelRise;
+	}
+	samplesSinceStore = 0;
+	oldestIndex = 0;
+}
+
+// Advance the model by one sample interval, during which the specified PWM was applied
+void SmithPredictor::Update(float pwm, float gain, float timeConstant) noexcept
+{
+	modelRate = (gain * pwm - modelRise)/timeConstant;
+	modelRise += modelRate * interval;
+
+	++samplesSinceStore;
+	if (samplesSinceStore >= samplesPerSlot)
+	{
+		history[oldestIndex] = modelRise;
+		++oldestIndex;
+		if (oldestIndex == historyLength)
+		{
+			oldestIndex = 0;
+		}
+		samplesSinceStore = 0;
+	}
+}
+
+// Get the model temperature rise one dead time ago, interpolating between the two oldest history entries.
+// The oldest entry is (historyLength - 1) * samplesPerSlot + samplesSinceStore samples old and the next one is samplesPerSlot samples younger.
+float SmithPredictor::GetDelayedRise() const noexcept
+{
+	const float oldest = history[oldestIndex];
+	const float next = history[(oldestIndex + 1 == historyLength) ? 0 : oldestIndex + 1];
+	return oldest + (next - oldest) * (float)samplesSinceStore/(float)samplesPerSlot;
+}
+
+float SmithPredictor::GetDelayedRate() const noexcept
+{
+	const float oldest = history[oldestIndex];
+	const float next = history[(oldestIndex + 1 == historyLength) ? 0 : oldestIndex + 1];
+	return (next - oldest)/((float)samplesPerSlot * interval);
+}
+
+float SmithPredictor::GetTemperatureCorrection() const noexcept
+{
+	return modelRise - GetDelayedRise();
+}
+
+float SmithPredictor::GetRateCorrection() const noexcept
+{
+	return modelRate - GetDelayedRate();
+}
+
+// End
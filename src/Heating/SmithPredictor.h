@@ -0,0 +1,50 @@
+/*
+ * SmithPredictor.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Dead time compensation for heater control using the first order process with dead time model.
+ *  The predictor runs the model alongside the real heater and returns the difference between the model temperature now and the
+ *  model temperature one dead time ago. Adding this to the measured temperature gives a forecast of what the heater temperature
+ *  will be once the effects of the PWM already applied have reached the sensor, so the PID controller can act on that instead.
+ *  Model errors in gain or ambient temperature cancel out in the steady state, because then the undelayed and delayed model temperatures are equal.
+ */
+
+#ifndef SRC_HEATING_SMITHPREDICTOR_H_
+#define SRC_HEATING_SMITHPREDICTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class SmithPredictor
+{
+public:
+	SmithPredictor() noexcept { Reset(0.0, 0.0, 0.0, 1.0); }
+
+	// Restart the model from a steady state at the specified temperature
+	void Reset(float temperature, float ambientTemperature, float deadTime, float sampleInterval) noexcept;
+
+	// Advance the model by one sample interval, during which the specified PWM was applied
+	void Update(float pwm, float gain, float timeConstant) noexcept;
+
+	float GetTemperatureCorrection() const noexcept;		// the amount to add to the measured temperature to get the predicted temperature
+	float GetRateCorrection() const noexcept;				// the amount to add to the measured temperature rate of change to get the predicted rate
+
+private:
+	static constexpr size_t MaxHistory = 8;					// the number of stored model temperatures, which limits the delay line resolution
+
+	float GetDelayedRise() const noexcept;
+	float GetDelayedRate() const noexcept;
+
+	float modelRise;										// model temperature rise above ambient now
+	float modelRate;										// model rate of change of temperature now
+	float interval;											// sample interval in seconds
+	float history[MaxHistory];								// model temperature rise at regular intervals, used as a delay line
+	uint16_t samplesPerSlot;								// number of sample intervals between entries in the history
+	uint16_t samplesSinceStore;								// number of sample intervals since we last added an entry to the history
+	uint8_t historyLength;									// number of entries in the history that we use
+	uint8_t oldestIndex;									// index of the oldest entry in the history
+};
+
+#endif /* SRC_HEATING_SMITHPREDICTOR_H_ */
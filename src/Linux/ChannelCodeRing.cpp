@@ -0,0 +1,153 @@
+/*
+ * ChannelCodeRing.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "ChannelCodeRing.h"
+
+#if HAS_LINUX_INTERFACE
+
+ChannelCodeRing::ChannelCodeRing() noexcept
+	: buffer(nullptr), size(MinSize), readPointer(0), writePointer(0), endPointer(0), numCodes(0), wrapped(false),
+	  codesQueued(0), codesRejected(0), timesStarved(0), bytesUsed(0), maxBytesUsed(0)
+{
+}
+
+// Change the size of the ring. The new buffer is allocated when the next code arrives. Returns false if there are codes waiting.
+bool ChannelCodeRing::SetSize(size_t newSize) noexcept
+{
+	if (numCodes != 0)
+	{
+		return false;
+	}
+
+	newSize = constrain<size_t>(newSize, MinSize, MaxSize) & ~(sizeof(uint32_t) - 1);
+	if (newSize != size)
+	{
+		delete[] buffer;
+		buffer = nullptr;
+		size = newSize;
+	}
+	return true;
+}
+
+// Return the size of the largest code, including its header, that can be stored
+size_t ChannelCodeRing::FreeSpace() const noexcept
+{
+	return (numCodes == 0) ? size
+			: (wrapped) ? readPointer - writePointer
+				: max<size_t>(size - writePointer, readPointer);
+}
+
+// Store a code, returning false if there is no room for it
+bool ChannelCodeRing::Put(const char *data, size_t length) noexcept
+{
+	const size_t spaceNeeded = sizeof(BufferedCodeHeader) + TransferCodec::AddPadding(length);
+	if (numCodes == 0)
+	{
+		readPointer = writePointer = 0;
+		wrapped = false;
+	}
+
+	// Codes are never split, so if this one doesn't fit at the end then wrap round to the start
+	if (wrapped)
+	{
+		if (readPointer - writePointer < spaceNeeded)
+		{
+			return false;
+		}
+	}
+	else if (size - writePointer < spaceNeeded)
+	{
+		if (readPointer < spaceNeeded)
+		{
+			return false;
+		}
+		endPointer = writePointer;
+		writePointer = 0;
+		wrapped = true;
+	}
+
+	if (buffer == nullptr)
+	{
+		buffer = new uint32_t[size/sizeof(uint32_t)];
+	}
+
+	BufferedCodeHeader * const header = reinterpret_cast<BufferedCodeHeader*>(Data() + writePointer);
+	header->isPending = true;
+	header->padding = 0;
+	header->length = length;
+	memcpy(Data() + writePointer + sizeof(BufferedCodeHeader), data, length);
+	writePointer += spaceNeeded;
+	++numCodes;
+
+	++codesQueued;
+	bytesUsed += spaceNeeded;
+	if (bytesUsed > maxBytesUsed)
+	{
+		maxBytesUsed = bytesUsed;
+	}
+	return true;
+}
+
+// Get the oldest code, or null if there is none
+const char *ChannelCodeRing::Peek(size_t& length) const noexcept
+{
+	if (numCodes == 0)
+	{
+		return nullptr;
+	}
+	const BufferedCodeHeader * const header = reinterpret_cast<const BufferedCodeHeader*>(Data() + readPointer);
+	length = header->length;
+	return Data() + readPointer + sizeof(BufferedCodeHeader);
+}
+
+// Discard the oldest code
+void ChannelCodeRing::Pop() noexcept
+{
+	if (numCodes != 0)
+	{
+		const BufferedCodeHeader * const header = reinterpret_cast<const BufferedCodeHeader*>(Data() + readPointer);
+		const size_t spaceUsed = sizeof(BufferedCodeHeader) + TransferCodec::AddPadding(header->length);
+		readPointer += spaceUsed;
+		bytesUsed -= spaceUsed;
+		--numCodes;
+		if (wrapped && readPointer == endPointer)
+		{
+			readPointer = 0;
+			wrapped = false;
+		}
+		if (numCodes == 0)
+		{
+			readPointer = writePointer = 0;
+			wrapped = false;
+			bytesUsed = 0;
+		}
+	}
+}
+
+void ChannelCodeRing::Clear() noexcept
+{
+	readPointer = writePointer = 0;
+	numCodes = 0;
+	wrapped = false;
+	bytesUsed = 0;
+}
+
+void ChannelCodeRing::AppendStatistics(const StringRef& reply) const noexcept
+{
+	reply.catf("%u/%u bytes, %" PRIu32 " codes, %" PRIu32 " resent, %" PRIu32 " starved",
+				(unsigned int)maxBytesUsed, (unsigned int)size, codesQueued, codesRejected, timesStarved);
+}
+
+void ChannelCodeRing::ClearStatistics() noexcept
+{
+	codesQueued = codesRejected = timesStarved = 0;
+	maxBytesUsed = bytesUsed;
+}
+
+#endif
+
+// End
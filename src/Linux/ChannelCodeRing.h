@@ -0,0 +1,63 @@
+/*
+ * ChannelCodeRing.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  A ring of binary G-codes received from the SBC for one G-code channel, waiting to be executed.
+ *  The codes are stored as sent by the SBC, which is already the parsed form that BinaryParser uses, so taking the next one is just a copy.
+ *  Each channel has its own ring so that codes for a channel that isn't ready to run them, such as a daemon that is waiting,
+ *  don't stop the space used by other channels being freed. The buffer is only allocated when the first code for the channel arrives.
+ */
+
+#ifndef SRC_LINUX_CHANNELCODERING_H_
+#define SRC_LINUX_CHANNELCODERING_H_
+
+#include "RepRapFirmware.h"
+
+#if HAS_LINUX_INTERFACE
+
+#include "LinuxMessageFormats.h"
+
+class ChannelCodeRing
+{
+public:
+	static constexpr size_t MinSize = MaxCodeBufferSize + sizeof(BufferedCodeHeader);		// big enough for any code
+	static constexpr size_t MaxSize = 32768;
+
+	ChannelCodeRing() noexcept;
+
+	size_t GetSize() const noexcept { return size; }
+	bool SetSize(size_t newSize) noexcept;							// Returns false if there are codes waiting
+	bool IsEmpty() const noexcept { return numCodes == 0; }
+	size_t FreeSpace() const noexcept;								// Return the size of the largest code, including its header, that can be stored
+
+	bool Put(const char *data, size_t length) noexcept;				// Store a code, returning false if there is no room for it
+	const char *Peek(size_t& length) const noexcept;				// Get the oldest code, or null if there is none
+	void Pop() noexcept;											// Discard the oldest code
+	void Clear() noexcept;
+
+	// Flow control statistics
+	void Starved() noexcept { ++timesStarved; }						// Called when the channel was ready for another code but the ring was empty
+	void Rejected() noexcept { ++codesRejected; }					// Called when a code was sent back to the SBC to be resent later
+	bool HasStatistics() const noexcept { return codesQueued != 0 || codesRejected != 0; }
+	void AppendStatistics(const StringRef& reply) const noexcept;
+	void ClearStatistics() noexcept;
+
+private:
+	uint32_t *buffer;												// the storage, allocated when the first code arrives
+	size_t size;													// the size of the storage in bytes
+	size_t readPointer, writePointer;
+	size_t endPointer;												// where the codes stop before wrapping round, if they have wrapped
+	unsigned int numCodes;
+	bool wrapped;
+
+	uint32_t codesQueued, codesRejected, timesStarved;
+	size_t bytesUsed, maxBytesUsed;
+
+	char *Data() const noexcept { return reinterpret_cast<char *>(buffer); }
+};
+
+#endif
+
+#endif /* SRC_LINUX_CHANNELCODERING_H_ */
@@ -146,32 +146,36 @@ extern "C" void SBC_SPI_HANDLER() noexcept
 	}
 }
 
+// The SPI slave ends each exchange when NSS goes high, so the SBC may clock fewer bytes than we set up and we can support pipelined transfers
+constexpr bool SupportsPipelinedTransfers = true;
 #else
 # include "LPC/Linux/DataTransfer_LPC.hpp"
+
+// The SSP only ends an exchange when all the bytes we set up have been clocked, so the header exchange must always be the same length
+constexpr bool SupportsPipelinedTransfers = false;
 #endif
 /*-----------------------------------------------------------------------------------*/
 
 // Static data. Note, the startup code we use doesn't make any provision for initialising non-cached memory, other than to zero. So don't specify initial value here
-__nocache TransferHeader DataTransfer::rxHeader;
-__nocache TransferHeader DataTransfer::txHeader;
+__nocache TransferArea DataTransfer::rxArea;
+__nocache TransferArea DataTransfer::txArea;
 __nocache uint32_t DataTransfer::rxResponse;
 __nocache uint32_t DataTransfer::txResponse;
-__nocache uint32_t DataTransfer::rxBuffer32[LinuxTransferBufferSize / 4];
-__nocache uint32_t DataTransfer::txBuffer32[LinuxTransferBufferSize / 4];
 
-DataTransfer::DataTransfer() noexcept : state(SpiState::ExchangingData), lastTransferTime(0), lastTransferNumber(0), failedTransfers(0),
-	rxPointer(0), txPointer(0), packetId(0)
+DataTransfer::DataTransfer() noexcept : state(SpiState::ExchangingData), lastTransferTime(0), lastTransferNumber(0),
+	longHeaderExchange(false), dataSentWithHeader(false), failedTransfers(0), numTransfers(0), numShortTransfers(0),
+	reader(rxBuffer()), writer(txBuffer())
 {
 	rxResponse = TransferResponse::Success;
 	txResponse = TransferResponse::Success;
 	// Prepare RX header
-	rxHeader.sequenceNumber = 0;
+	rxArea.header.sequenceNumber = 0;
 
 	// Prepare TX header
-	txHeader.formatCode = LinuxFormatCode;
-	txHeader.protocolVersion = LinuxProtocolVersion;
-	txHeader.numPackets = 0;
-	txHeader.sequenceNumber = 0;
+	txArea.header.formatCode = LinuxFormatCode;
+	txArea.header.protocolVersion = LinuxProtocolVersion;
+	txArea.header.numPackets = 0;
+	txArea.header.sequenceNumber = 0;
 }
 
 void DataTransfer::Init() noexcept
@@ -213,34 +217,24 @@ void DataTransfer::Diagnostics(MessageType mtype) noexcept
 {
 	reprap.GetPlatform().MessageF(mtype, "State: %d, failed transfers: %u\n", (int)state, failedTransfers);
 	reprap.GetPlatform().MessageF(mtype, "Last transfer: %" PRIu32 "ms ago\n", millis() - lastTransferTime);
-	reprap.GetPlatform().MessageF(mtype, "RX/TX seq numbers: %d/%d\n", (int)rxHeader.sequenceNumber, (int)txHeader.sequenceNumber);
+	reprap.GetPlatform().MessageF(mtype, "RX/TX seq numbers: %d/%d\n", (int)rxArea.header.sequenceNumber, (int)txArea.header.sequenceNumber);
+	reprap.GetPlatform().MessageF(mtype, "Protocol version %u features %02x, transfers %u of which %u without data exchange\n",
+									(unsigned int)TransferCodec::GetProtocolVersion(txArea.header), (unsigned int)(txArea.header.protocolVersion >> 8), numTransfers, numShortTransfers);
+	reprap.GetPlatform().MessageF(mtype, "Compact object model responses %" PRIu32 ", %" PRIu32 " bytes of JSON sent as %" PRIu32 ", %" PRIu32 " sent as JSON\n",
+									omEncoder.GetNumEncoded(), omEncoder.GetTextBytes(), omEncoder.GetEncodedBytes(), omEncoder.GetNumFailed());
+	omEncoder.ClearStatistics();
 	reprap.GetPlatform().MessageF(mtype, "SPI underruns %u, overruns %u\n", spiTxUnderruns, spiRxOverruns);
+	numTransfers = numShortTransfers = 0;
 }
 
 const PacketHeader *DataTransfer::ReadPacket() noexcept
 {
-	if (rxPointer >= rxHeader.dataLength)
-	{
-		return nullptr;
-	}
-
-	const PacketHeader *header = reinterpret_cast<const PacketHeader*>(rxBuffer() + rxPointer);
-	rxPointer += sizeof(PacketHeader);
-	return header;
+	return reader.ReadPacket();
 }
 
 const char *DataTransfer::ReadData(size_t dataLength) noexcept
 {
-	const char *data = rxBuffer() + rxPointer;
-	rxPointer += AddPadding(dataLength);
-	return data;
-}
-
-template<typename T> const T *DataTransfer::ReadDataHeader() noexcept
-{
-	const T *header = reinterpret_cast<const T*>(rxBuffer() + rxPointer);
-	rxPointer += sizeof(T);
-	return header;
+	return reader.ReadData(dataLength);
 }
 
 void DataTransfer::ReadGetObjectModel(size_t packetLength, StringRef &key, StringRef &flags) noexcept
@@ -395,7 +389,7 @@ bool DataTransfer::ReadMessage(MessageType& type, OutputBuffer *buf) noexcept
 void DataTransfer::ExchangeHeader() noexcept
 {
 	state = SpiState::ExchangingHeader;
-	setup_spi(&rxHeader, &txHeader, sizeof(TransferHeader));
+	setup_spi(&rxArea, &txArea, TransferCodec::HeaderExchangeLength(SupportsPipelinedTransfers));
 }
 
 void DataTransfer::ExchangeResponse(uint32_t response) noexcept
@@ -407,7 +401,7 @@ void DataTransfer::ExchangeResponse(uint32_t response) noexcept
 
 void DataTransfer::ExchangeData() noexcept
 {
-	size_t bytesToExchange = max<size_t>(rxHeader.dataLength, txHeader.dataLength);
+	size_t bytesToExchange = max<size_t>(rxArea.header.dataLength, txArea.header.dataLength);
 	state = SpiState::ExchangingData;
 	setup_spi(rxBuffer(), txBuffer(), bytesToExchange);
 }
@@ -453,8 +447,8 @@ bool DataTransfer::IsReady() noexcept
 		{
 		case SpiState::ExchangingHeader:
 		{
-			// (1) Exchanged transfer headers
-			const uint32_t headerResponse = *reinterpret_cast<const uint32_t*>(&rxHeader);
+			// (1) Exchanged transfer headers, and in a pipelined transfer the first part of the data too
+			const uint32_t headerResponse = *reinterpret_cast<const uint32_t*>(&rxArea.header);
 			if (headerResponse == TransferResponse::BadResponse)
 			{
 				// Linux wants to restart the transfer
@@ -462,34 +456,27 @@ bool DataTransfer::IsReady() noexcept
 				break;
 			}
 
-			const uint16_t checksum = CRC16(reinterpret_cast<const char *>(&rxHeader), sizeof(TransferHeader) - sizeof(uint16_t));
-			if (rxHeader.checksumHeader != checksum)
+			const uint16_t checksum = TransferCodec::HeaderChecksum(rxArea.header);
+			if (rxArea.header.checksumHeader != checksum)
 			{
 				if (reprap.Debug(moduleLinuxInterface))
 				{
-					reprap.GetPlatform().MessageF(DebugMessage, "Bad header checksum (expected %04" PRIx32 ", got %04" PRIx32 ")\n", (uint32_t)rxHeader.checksumHeader, (uint32_t)checksum);
+					reprap.GetPlatform().MessageF(DebugMessage, "Bad header checksum (expected %04" PRIx32 ", got %04" PRIx32 ")\n", (uint32_t)rxArea.header.checksumHeader, (uint32_t)checksum);
 				}
 				ExchangeResponse(TransferResponse::BadHeaderChecksum);
 				break;
 			}
 
-			if (rxHeader.formatCode != LinuxFormatCode)
+			const TransferResponse response = TransferCodec::CheckHeader(rxArea.header);
+			if (response != TransferResponse::Success)
 			{
-				ExchangeResponse(TransferResponse::BadFormat);
-				break;
-			}
-			if (rxHeader.protocolVersion != LinuxProtocolVersion)
-			{
-				ExchangeResponse(TransferResponse::BadProtocolVersion);
-				break;
-			}
-			if (rxHeader.dataLength > LinuxTransferBufferSize)
-			{
-				ExchangeResponse(TransferResponse::BadDataLength);
+				ExchangeResponse(response);
 				break;
 			}
 
-			ExchangeResponse(TransferResponse::Success);
+			// If the SBC has restarted then it won't have clocked the pipelined header exchange
+			dataSentWithHeader = TransferCodec::DataSentWithHeader(rxArea.header, txArea.header, longHeaderExchange && !LinuxHadReset());
+			ExchangeResponse((dataSentWithHeader) ? CheckData() : TransferResponse::Success);
 			break;
 		}
 
@@ -497,28 +484,25 @@ bool DataTransfer::IsReady() noexcept
 			// (2) Exchanged response to transfer header
 			if (rxResponse == TransferResponse::Success && txResponse == TransferResponse::Success)
 			{
-				if (rxHeader.dataLength != 0 || txHeader.dataLength != 0)
+				if (dataSentWithHeader || (rxArea.header.dataLength == 0 && txArea.header.dataLength == 0))
 				{
-					// Perform the actual data transfer
-					ExchangeData();
-				}
-				else
-				{
-					// Everything OK
-					rxPointer = txPointer = 0;
-					packetId = 0;
-					state = SpiState::ProcessingData;
+					// Everything OK, either there is no data or it was exchanged along with the headers
+					TransferComplete(true);
 					return true;
 				}
+
+				// Perform the actual data transfer
+				ExchangeData();
 			}
 			else if (rxResponse == TransferResponse::BadResponse)
 			{
 				// Linux wants to restart the transfer
 				ResetTransfer(false);
 			}
-			else if (rxResponse == TransferResponse::BadHeaderChecksum || txResponse == TransferResponse::BadHeaderChecksum)
+			else if (rxResponse == TransferResponse::BadHeaderChecksum || txResponse == TransferResponse::BadHeaderChecksum
+					|| (dataSentWithHeader && (rxResponse == TransferResponse::BadDataChecksum || txResponse == TransferResponse::BadDataChecksum)))
 			{
-				// Failed to exchange header, restart the full transfer
+				// Failed to exchange header or the data sent with it, restart the full transfer
 				ExchangeHeader();
 			}
 			else
@@ -531,7 +515,7 @@ bool DataTransfer::IsReady() noexcept
 		case SpiState::ExchangingData:
 		{
 			// (3) Exchanged data
-			if (rxBuffer32[0] == TransferResponse::BadResponse)
+			if (rxArea.data[0] == TransferResponse::BadResponse)
 			{
 				if (reprap.Debug(moduleLinuxInterface))
 				{
@@ -541,18 +525,7 @@ bool DataTransfer::IsReady() noexcept
 				break;
 			}
 
-			const uint16_t checksum = CRC16(rxBuffer(), rxHeader.dataLength);
-			if (rxHeader.checksumData != checksum)
-			{
-				if (reprap.Debug(moduleLinuxInterface))
-				{
-					reprap.GetPlatform().MessageF(DebugMessage, "Bad data checksum (expected %04" PRIx32 ", got %04" PRIx32 ")\n", (uint32_t)rxHeader.checksumData, (uint32_t)checksum);
-				}
-				ExchangeResponse(TransferResponse::BadDataChecksum);
-				break;
-			}
-
-			ExchangeResponse(TransferResponse::Success);
+			ExchangeResponse(CheckData());
 			break;
 		}
 
@@ -561,9 +534,7 @@ bool DataTransfer::IsReady() noexcept
 			if (rxResponse == TransferResponse::Success && txResponse == TransferResponse::Success)
 			{
 				// Everything OK
-				rxPointer = txPointer = 0;
-				packetId = 0;
-				state = SpiState::ProcessingData;
+				TransferComplete(false);
 				return true;
 			}
 
@@ -606,7 +577,8 @@ bool DataTransfer::IsReady() noexcept
 	else if (!IsConnected())
 	{
 		// The Linux interface is no longer connected...
-		rxHeader.sequenceNumber = 0;
+		rxArea.header.sequenceNumber = 0;
+		longHeaderExchange = false;
 
 		// The SBC expects a high transfer ready pin level when it establishes a new connection
 		if (!transferReadyHigh)
@@ -618,24 +590,62 @@ bool DataTransfer::IsReady() noexcept
 	return false;
 }
 
+// Check the checksum of the data received
+TransferResponse DataTransfer::CheckData() const noexcept
+{
+	const uint16_t checksum = TransferCodec::CRC16(rxBuffer(), rxArea.header.dataLength);
+	if (rxArea.header.checksumData != checksum)
+	{
+		if (reprap.Debug(moduleLinuxInterface))
+		{
+			reprap.GetPlatform().MessageF(DebugMessage, "Bad data checksum (expected %04" PRIx32 ", got %04" PRIx32 ")\n", (uint32_t)rxArea.header.checksumData, (uint32_t)checksum);
+		}
+		return TransferResponse::BadDataChecksum;
+	}
+	return TransferResponse::Success;
+}
+
+// Both ends have acknowledged the transfer, so get ready to process the data received and to write the data for the next transfer
+void DataTransfer::TransferComplete(bool shortTransfer) noexcept
+{
+	reader.Reset(rxArea.header.dataLength);
+	writer.Reset();
+
+	// If the SBC restarted or stopped accepting compact object model responses then its decoder state is lost
+	if (LinuxHadReset() || !TransferCodec::HasFeature(rxArea.header, LinuxFeatureCompactObjectModel))
+	{
+		omEncoder.Reset();
+	}
+	++numTransfers;
+	if (shortTransfer)
+	{
+		++numShortTransfers;
+	}
+	state = SpiState::ProcessingData;
+}
+
 void DataTransfer::StartNextTransfer() noexcept
 {
-	lastTransferNumber = rxHeader.sequenceNumber;
+	lastTransferNumber = rxArea.header.sequenceNumber;
+
+	// The SBC has received the header we just sent, so it will clock a pipelined header exchange if that said version 3.
+	// Send version 3 again only if the SBC sent it to us too. Likewise acknowledge the optional features that the SBC asked for and we support.
+	longHeaderExchange = (TransferCodec::GetProtocolVersion(txArea.header) == LinuxPipelinedProtocolVersion);
+	txArea.header.protocolVersion = ((SupportsPipelinedTransfers && TransferCodec::GetProtocolVersion(rxArea.header) == LinuxPipelinedProtocolVersion)
+										? LinuxPipelinedProtocolVersion : LinuxProtocolVersion)
+									| (rxArea.header.protocolVersion & LinuxSupportedFeatures);
 
 	// Reset RX transfer header
-	rxHeader.formatCode = InvalidFormatCode;
-	rxHeader.numPackets = 0;
-	rxHeader.protocolVersion = 0;
-	rxHeader.dataLength = 0;
-	rxHeader.checksumData = 0;
-	rxHeader.checksumHeader = 0;
+	rxArea.header.formatCode = InvalidFormatCode;
+	rxArea.header.numPackets = 0;
+	rxArea.header.protocolVersion = 0;
+	rxArea.header.dataLength = 0;
+	rxArea.header.checksumData = 0;
+	rxArea.header.checksumHeader = 0;
 
 	// Set up TX transfer header
-	txHeader.numPackets = packetId;
-	txHeader.sequenceNumber++;
-	txHeader.dataLength = txPointer;
-	txHeader.checksumData = CRC16(txBuffer(), txPointer);
-	txHeader.checksumHeader = CRC16(reinterpret_cast<const char *>(&txHeader), sizeof(TransferHeader) - sizeof(uint16_t));
+	txArea.header.sequenceNumber++;
+	TransferCodec::FinishHeader(txArea.header, writer.GetNumPackets(), txBuffer(), writer.GetDataLength());
 
 	// Begin SPI transfer
 	ExchangeHeader();
@@ -643,6 +653,31 @@ void DataTransfer::StartNextTransfer() noexcept
 
 bool DataTransfer::WriteObjectModel(OutputBuffer *data) noexcept
 {
+	// Send a compact response if the SBC accepts them. If the response isn't JSON, e.g. it is an error message, or it is too long then send it as it is.
+	if (TransferCodec::HasFeature(rxArea.header, LinuxFeatureCompactObjectModel))
+	{
+		omEncoder.Begin();
+		bool encoded = true;
+		for (const OutputBuffer *buf = data; buf != nullptr && encoded; buf = buf->Next())
+		{
+			encoded = omEncoder.Feed(buf->UnreadData(), buf->BytesLeft());
+		}
+
+		if (encoded && omEncoder.End())
+		{
+			if (!CanWritePacket(omEncoder.GetEncodedLength()))
+			{
+				return false;
+			}
+
+			(void)WritePacketHeader(FirmwareRequest::CompactObjectModel, omEncoder.GetEncodedLength());
+			omEncoder.Write(writer.GetWritePointer());
+			writer.Advance(omEncoder.GetEncodedLength());
+			OutputBuffer::ReleaseAll(data);
+			return true;
+		}
+	}
+
 	// Try to write the packet header. This packet type cannot deal with truncated messages
 	if (!CanWritePacket(data->Length()))
 	{
@@ -826,9 +861,9 @@ bool DataTransfer::WriteHeightMap() noexcept
 	// Write Z points
 	if (numPoints != 0)
 	{
-		float *zPoints = reinterpret_cast<float*>(txBuffer() + txPointer);
+		float *zPoints = reinterpret_cast<float*>(writer.GetWritePointer());
 		reprap.GetMove().SaveHeightMapToArray(zPoints);
-		txPointer += numPoints * sizeof(float);
+		writer.Advance(numPoints * sizeof(float));
 	}
 	return true;
 }
@@ -1038,82 +1073,6 @@ bool DataTransfer::WriteWaitForAcknowledgement(GCodeChannel channel) noexcept
 	return true;
 }
 
-PacketHeader *DataTransfer::WritePacketHeader(FirmwareRequest request, size_t dataLength, uint16_t resendPacketId) noexcept
-{
-	// Make sure to stay aligned if the last packet ended with a string
-	txPointer = AddPadding(txPointer);
-
-	// Write the next packet data
-	PacketHeader *header = reinterpret_cast<PacketHeader*>(txBuffer() + txPointer);
-	header->request = static_cast<uint16_t>(request);
-	header->id = packetId++;
-	header->length = dataLength;
-	header->resendPacketId = resendPacketId;
-	txPointer += sizeof(PacketHeader);
-	return header;
-}
-
-void DataTransfer::WriteData(const char *data, size_t length) noexcept
-{
-	// Strings can be concatenated here, don't add any padding yet
-	memcpy(txBuffer() + txPointer, data, length);
-	txPointer += length;
-}
-
-template<typename T> T *DataTransfer::WriteDataHeader() noexcept
-{
-	T *header = reinterpret_cast<T*>(txBuffer() + txPointer);
-	txPointer += sizeof(T);
-	return header;
-}
-
-uint16_t DataTransfer::CRC16(const char *buffer, size_t length) const noexcept
-{
-	static const uint16_t crc16_table[] =
-	{
-		0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
-		0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
-		0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
-		0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
-		0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
-		0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
-		0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
-		0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
-		0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
-		0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
-		0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
-		0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
-		0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
-		0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
-		0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
-		0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
-		0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
-		0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
-		0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
-		0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
-		0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
-		0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
-		0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
-		0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
-		0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
-		0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
-		0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
-		0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
-		0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
-		0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
-		0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
-		0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
-	};
-
-	uint16_t Crc = 65535;
-	for (size_t i = 0; i < length; i++)
-	{
-		const uint16_t x = (uint16_t)(Crc ^ buffer[i]);
-		Crc = (uint16_t)((Crc >> 8) ^ crc16_table[x & 0x00FF]);
-	}
-
-	return Crc;
-}
 
 
 #ifdef __LPC17xx__
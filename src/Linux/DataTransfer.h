@@ -15,6 +15,7 @@
 #include <GCodes/GCodeFileInfo.h>
 #include <GCodes/GCodeChannel.h>
 #include "LinuxMessageFormats.h"
+#include "ObjectModelCodec.h"
 #include <MessageType.h>
 
 class BinaryGCodeBuffer;
@@ -84,44 +85,44 @@ private:
 	// Transfer properties
 	uint32_t lastTransferTime;
 	uint16_t lastTransferNumber;
+	bool longHeaderExchange;																// true if the SBC will clock the pipelined header exchange, see TransferCodec.h
+	bool dataSentWithHeader;																// true if the data of the current transfer was exchanged along with the headers
 	unsigned int failedTransfers;
+	unsigned int numTransfers, numShortTransfers;											// transfers completed and how many of them didn't need a data exchange
 
 	// Transfer buffers
 	// These must be in non-cached memory because we DMA to/from them, see http://ww1.microchip.com/downloads/en/DeviceDoc/Managing-Cache-Coherency-on-Cortex-M7-Based-MCUs-DS90003195A.pdf
 	// This in turn means that we must declare them static, so we can only have one DataTransfer instance
-	static __nocache TransferHeader rxHeader;
-	static __nocache TransferHeader txHeader;
+	// Each header is immediately followed by its data so that the SPI exchange of a pipelined transfer header can include the first part of the data
+	static __nocache TransferArea rxArea;
+	static __nocache TransferArea txArea;
 	static __nocache uint32_t rxResponse;
 	static __nocache uint32_t txResponse;
-	static __nocache uint32_t rxBuffer32[LinuxTransferBufferSize / 4];
-	static __nocache uint32_t txBuffer32[LinuxTransferBufferSize / 4];
 
-	static inline char * rxBuffer() { return reinterpret_cast<char *>(rxBuffer32); }
-	static inline char * txBuffer() { return reinterpret_cast<char *>(txBuffer32); }
+	static inline char * rxBuffer() { return rxArea.Data(); }
+	static inline char * txBuffer() { return txArea.Data(); }
 
-	size_t rxPointer, txPointer;
-
-	// Packet properties
-	uint16_t packetId;
+	PacketReader reader;
+	PacketWriter writer;
+	ObjectModelEncoder omEncoder;															// used when the SBC accepts compact object model responses
 
 	void ExchangeHeader() noexcept;
 	void ExchangeResponse(uint32_t response) noexcept;
 	void ExchangeData() noexcept;
 	void ResetTransfer(bool ownRequest) noexcept;
-	uint16_t CRC16(const char *buffer, size_t length) const noexcept;
+	TransferResponse CheckData() const noexcept;
+	void TransferComplete(bool shortTransfer) noexcept;
 
-	template<typename T> const T *ReadDataHeader() noexcept;
+	template<typename T> const T *ReadDataHeader() noexcept { return reader.ReadDataHeader<T>(); }
 
 	// Always keep enough tx space to allow resend requests in case RRF runs out of
 	// resources and cannot process an incoming request right away
-	size_t FreeTxSpace() const noexcept { return LinuxTransferBufferSize - txPointer - rxHeader.numPackets * sizeof(PacketHeader); }
+	size_t FreeTxSpace() const noexcept { return writer.FreeSpace(rxArea.header.numPackets * sizeof(PacketHeader)); }
 
 	bool CanWritePacket(size_t dataLength = 0) const noexcept;
-	PacketHeader *WritePacketHeader(FirmwareRequest request, size_t dataLength = 0, uint16_t resendPacktId = 0) noexcept;
-	void WriteData(const char *data, size_t length) noexcept;
-	template<typename T> T *WriteDataHeader() noexcept;
-
-	size_t AddPadding(size_t length) const noexcept;
+	PacketHeader *WritePacketHeader(FirmwareRequest request, size_t dataLength = 0, uint16_t resendPacketId = 0) noexcept;
+	void WriteData(const char *data, size_t length) noexcept { writer.WriteData(data, length); }
+	template<typename T> T *WriteDataHeader() noexcept { return writer.WriteDataHeader<T>(); }
 
 	bool IapDataExchange(size_t len);
 };
@@ -133,12 +134,12 @@ inline bool DataTransfer::IsConnected() const noexcept
 
 inline bool DataTransfer::LinuxHadReset() const noexcept
 {
-	return lastTransferNumber + 1 != rxHeader.sequenceNumber;
+	return lastTransferNumber + 1 != rxArea.header.sequenceNumber;
 }
 
 inline size_t DataTransfer::PacketsToRead() const noexcept
 {
-	return rxHeader.numPackets;
+	return rxArea.header.numPackets;
 }
 
 inline void DataTransfer::ResendPacket(const PacketHeader *packet) noexcept
@@ -148,13 +149,12 @@ inline void DataTransfer::ResendPacket(const PacketHeader *packet) noexcept
 
 inline bool DataTransfer::CanWritePacket(size_t dataLength) const noexcept
 {
-	return FreeTxSpace() >= sizeof(PacketHeader) + dataLength;
+	return writer.CanWritePacket(dataLength, rxArea.header.numPackets * sizeof(PacketHeader));
 }
 
-inline size_t DataTransfer::AddPadding(size_t length) const noexcept
+inline PacketHeader *DataTransfer::WritePacketHeader(FirmwareRequest request, size_t dataLength, uint16_t resendPacketId) noexcept
 {
-	size_t padding = 4 - length % 4;
-	return length + ((padding == 4) ? 0 : padding);
+	return writer.WritePacketHeader(static_cast<uint16_t>(request), dataLength, resendPacketId);
 }
 
 #endif	// HAS_LINUX_INTERFACE
@@ -0,0 +1,245 @@
+/*
+ * FileChunkCache.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "FileChunkCache.h"
+
+#if HAS_LINUX_INTERFACE
+
+FileChunkCache::FileChunkCache() noexcept : fileLength(0), fetching(nullptr), discardFetch(false), hits(0), misses(0), fetched(0), unused(0)
+{
+	for (Chunk& chunk : chunks)
+	{
+		chunk.state = ChunkState::empty;
+	}
+}
+
+// Find the chunk that holds the byte at the specified offset
+FileChunkCache::Chunk *FileChunkCache::Find(uint32_t offset) noexcept
+{
+	const uint32_t chunkOffset = offset - (offset % MaxFileChunkSize);
+	for (Chunk& chunk : chunks)
+	{
+		if (chunk.state != ChunkState::empty && chunk.offset == chunkOffset && !(&chunk == fetching && discardFetch))
+		{
+			return &chunk;
+		}
+	}
+	return nullptr;
+}
+
+const FileChunkCache::Chunk *FileChunkCache::Find(uint32_t offset) const noexcept
+{
+	return const_cast<FileChunkCache*>(this)->Find(offset);
+}
+
+// Copy the data at the specified offset if we have it, returning true if we did.
+// We copy at most to the end of the chunk that holds the first byte, so we may return less data than was asked for even if the file has more.
+// A read that starts at the beginning of a file is a new read of it, and the file may have been replaced since we last read it under the same name,
+// e.g. when an expansion board firmware update is aborted and the user uploads a new firmware file and tries again. So we never serve it from the cache.
+bool FileChunkCache::Get(const char *fname, uint32_t offset, uint32_t length, char *buffer, int32_t& dataLength, uint32_t& fLength) noexcept
+{
+	if (offset == 0)
+	{
+		Clear();
+		return false;
+	}
+
+	if (!filename.Equals(fname))
+	{
+		return false;
+	}
+
+	Chunk * const chunk = Find(offset);
+	if (chunk == nullptr || chunk->state != ChunkState::valid)
+	{
+		return false;
+	}
+
+	const uint32_t start = offset - chunk->offset;
+	if ((int32_t)start >= chunk->dataLength)
+	{
+		return false;													// the chunk ends before the offset, so let the SBC report the end of the file
+	}
+
+	dataLength = min<int32_t>(chunk->dataLength - (int32_t)start, (int32_t)length);
+	memcpy(buffer, chunk->data + start, dataLength);
+	fLength = fileLength;
+	chunk->used = true;
+	++hits;
+	return true;
+}
+
+// Return true if the chunk holding the data at the offset is going to arrive without being requested again
+bool FileChunkCache::IsBeingFetched(const char *fname, uint32_t offset) const noexcept
+{
+	if (!filename.Equals(fname))
+	{
+		return false;
+	}
+	const Chunk * const chunk = Find(offset);
+	return chunk != nullptr && (chunk->state == ChunkState::wanted || chunk->state == ChunkState::fetching);
+}
+
+// Data ending at nextOffset has been read, so drop the chunks before that and schedule the chunk holding nextOffset and the ones after it.
+// If the file length has changed then the file has been replaced, so the chunks we have are from the old file.
+void FileChunkCache::ReadAhead(const char *fname, uint32_t nextOffset, uint32_t fLength) noexcept
+{
+	if (!filename.Equals(fname) || fLength != fileLength)
+	{
+		Clear();
+		filename.copy(fname);
+	}
+	fileLength = fLength;
+
+	const uint32_t firstOffset = nextOffset - (nextOffset % MaxFileChunkSize);
+	for (Chunk& chunk : chunks)
+	{
+		if (chunk.state != ChunkState::fetching && chunk.state != ChunkState::empty && chunk.offset < firstOffset)
+		{
+			Discard(chunk);
+		}
+	}
+
+	for (size_t i = 0; i < NumChunks; ++i)
+	{
+		const uint32_t offset = firstOffset + i * MaxFileChunkSize;
+		if (offset >= fileLength)
+		{
+			break;
+		}
+		if (Find(offset) == nullptr)
+		{
+			Chunk *freeChunk = nullptr;
+			for (Chunk& chunk : chunks)
+			{
+				if (chunk.state == ChunkState::empty)
+				{
+					freeChunk = &chunk;
+					break;
+				}
+			}
+			if (freeChunk == nullptr)
+			{
+				break;
+			}
+			freeChunk->offset = offset;
+			freeChunk->state = ChunkState::wanted;
+		}
+	}
+}
+
+// Get the next chunk to fetch, if any. Chunks are fetched in file order and one at a time.
+bool FileChunkCache::GetNextFetch(const char *&fname, uint32_t& offset, uint32_t& length) const noexcept
+{
+	if (fetching != nullptr)
+	{
+		return false;
+	}
+
+	const Chunk *next = nullptr;
+	for (const Chunk& chunk : chunks)
+	{
+		if (chunk.state == ChunkState::wanted && (next == nullptr || chunk.offset < next->offset))
+		{
+			next = &chunk;
+		}
+	}
+	if (next == nullptr)
+	{
+		return false;
+	}
+
+	fname = filename.c_str();
+	offset = next->offset;
+	length = MaxFileChunkSize;
+	return true;
+}
+
+// The request for the chunk returned by GetNextFetch has been sent
+void FileChunkCache::FetchStarted() noexcept
+{
+	const char *fname;
+	uint32_t offset, length;
+	if (GetNextFetch(fname, offset, length))
+	{
+		fetching = Find(offset);
+		fetching->state = ChunkState::fetching;
+		discardFetch = false;
+	}
+}
+
+// Where to store the chunk being fetched when it arrives
+char *FileChunkCache::FetchBuffer() noexcept
+{
+	return (fetching != nullptr) ? fetching->data : nullptr;
+}
+
+// The chunk being fetched has been stored in FetchBuffer
+void FileChunkCache::FetchDone(int32_t dataLength, uint32_t fLength) noexcept
+{
+	if (fetching != nullptr)
+	{
+		if (dataLength >= 0 && !discardFetch && fLength != fileLength)
+		{
+			// The file has been replaced since we scheduled this chunk, so none of the chunks we have or want are from the current file
+			fetching->state = ChunkState::empty;
+			fetching = nullptr;
+			discardFetch = false;
+			Clear();
+			return;
+		}
+
+		if (discardFetch || dataLength < 0)
+		{
+			fetching->state = ChunkState::empty;
+		}
+		else
+		{
+			fetching->state = ChunkState::valid;
+			fetching->dataLength = dataLength;
+			fetching->used = false;
+			++fetched;
+		}
+		fetching = nullptr;
+		discardFetch = false;
+	}
+}
+
+void FileChunkCache::Clear() noexcept
+{
+	for (Chunk& chunk : chunks)
+	{
+		if (&chunk == fetching)
+		{
+			discardFetch = true;
+		}
+		else
+		{
+			Discard(chunk);
+		}
+	}
+	filename.Clear();
+}
+
+void FileChunkCache::Discard(Chunk& chunk) noexcept
+{
+	if (chunk.state == ChunkState::valid && !chunk.used)
+	{
+		++unused;
+	}
+	chunk.state = ChunkState::empty;
+}
+
+void FileChunkCache::Diagnostics(const StringRef& reply) noexcept
+{
+	reply.printf("File chunk cache: %" PRIu32 " hits, %" PRIu32 " misses, %" PRIu32 " fetched ahead, %" PRIu32 " unused", hits, misses, fetched, unused);
+	hits = misses = fetched = unused = 0;
+}
+
+#endif
+
+// End
@@ -0,0 +1,82 @@
+/*
+ * FileChunkCache.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Read-ahead cache of chunks of a file read from the SBC, e.g. an expansion board firmware file.
+ *  When a chunk has been served, the following chunks of the same file are requested from the SBC in the background,
+ *  so that the next call to LinuxInterface::GetFileChunk usually finds its chunk already here instead of waiting for a round trip.
+ *  Chunks are always MaxFileChunkSize long and aligned to multiples of that in the file, so that a read of any length at any offset
+ *  can be served from the chunk that holds its first byte, even if that is only part of what the caller asked for.
+ *  Only one chunk is fetched at a time, because the SBC's response doesn't say which chunk it holds.
+ *  The cache is identified only by the filename, so it is cleared when a read starts at the beginning of a file or the file length changes,
+ *  in case the file has been replaced by one with the same name.
+ *  This class does no locking, the caller must hold LinuxInterface's file chunk mutex.
+ */
+
+#ifndef SRC_LINUX_FILECHUNKCACHE_H_
+#define SRC_LINUX_FILECHUNKCACHE_H_
+
+#include "RepRapFirmware.h"
+
+#if HAS_LINUX_INTERFACE
+
+#include "LinuxMessageFormats.h"
+
+constexpr size_t MaxFileChunkSize = 448;	// Maximum size of file chunks for reading files from the SBC. Should be a multiple of sizeof(CanMessageFirmwareUpdateResponse::data) for best CAN performance
+
+class FileChunkCache
+{
+public:
+#ifndef __LPC17xx__
+	static constexpr size_t NumChunks = 4;
+#else
+	static constexpr size_t NumChunks = 2;
+#endif
+
+	FileChunkCache() noexcept;
+
+	// Functions used by the task that wants the file
+	bool Get(const char *filename, uint32_t offset, uint32_t length, char *buffer, int32_t& dataLength, uint32_t& fileLength) noexcept;	// Copy a chunk if we have it
+	bool IsBeingFetched(const char *filename, uint32_t offset) const noexcept;
+	void ReadAhead(const char *filename, uint32_t nextOffset, uint32_t fileLength) noexcept;	// Schedule the chunks after some data that was read
+
+	// Functions used by the SBC task
+	bool GetNextFetch(const char *&filename, uint32_t& offset, uint32_t& length) const noexcept;	// Get the next chunk to fetch, if any
+	void FetchStarted() noexcept;										// The request for the chunk returned by GetNextFetch has been sent
+	char *FetchBuffer() noexcept;										// Where to store the chunk being fetched when it arrives
+	void FetchDone(int32_t dataLength, uint32_t fileLength) noexcept;	// The chunk being fetched has been stored
+	void Clear() noexcept;
+
+	void Missed() noexcept { ++misses; }								// Called when a chunk had to be fetched while the caller waited
+	void Diagnostics(const StringRef& reply) noexcept;
+
+private:
+	enum class ChunkState : uint8_t { empty, wanted, fetching, valid };
+
+	struct Chunk
+	{
+		uint32_t offset;												// always a multiple of MaxFileChunkSize
+		int32_t dataLength;												// the length we got, which is less than MaxFileChunkSize only at the end of the file
+		ChunkState state;
+		bool used;
+		char data[MaxFileChunkSize];
+	};
+
+	Chunk *Find(uint32_t offset) noexcept;
+	const Chunk *Find(uint32_t offset) const noexcept;
+	void Discard(Chunk& chunk) noexcept;
+
+	String<MaxFilenameLength> filename;
+	uint32_t fileLength;
+	Chunk chunks[NumChunks];
+	Chunk *fetching;													// the chunk being fetched, or null
+	bool discardFetch;													// true if the cache was cleared while a chunk was being fetched
+
+	uint32_t hits, misses, fetched, unused;
+};
+
+#endif
+
+#endif /* SRC_LINUX_FILECHUNKCACHE_H_ */
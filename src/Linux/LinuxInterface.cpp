@@ -24,14 +24,17 @@
 #endif
 
 LinuxInterface::LinuxInterface() : transfer(new DataTransfer()), wasConnected(false), numDisconnects(0),
-	reportPause(false), rxPointer(0), txPointer(0), txLength(0), sendBufferUpdate(true),
-	iapWritePointer(IAP_IMAGE_START), gcodeReply(new OutputStack())
+	reportPause(false), sendBufferUpdate(true),
+	iapWritePointer(IAP_IMAGE_START), waitingForReadAhead(false), fileChunkRequest(FileChunkRequest::none), gcodeReply(new OutputStack())
 {
+	// The file being printed needs the most buffering, the other channels only need to hold a code or two at a time
+	codeRings[GCodeChannel(GCodeChannel::File).RawValue()].SetSize(SpiCodeBufferSize);
 }
 
 void LinuxInterface::Init()
 {
 	gcodeReplyMutex.Create("LinuxReply");
+	fileChunkMutex.Create("LinuxFileChunk");
 	transfer->Init();
 	transfer->StartNextTransfer();
 }
@@ -44,6 +47,7 @@ void LinuxInterface::Spin()
 		if (transfer->IsReady())
 		{
 			// Process incoming packets
+			Bitmap<uint32_t> channelsFull;						// channels that have refused a code in this transfer, so later codes for them must be refused too
 			for (size_t i = 0; i < transfer->PacketsToRead(); i++)
 			{
 				const PacketHeader * const packet = transfer->ReadPacket();
@@ -78,28 +82,23 @@ void LinuxInterface::Spin()
 				// Perform a G/M/T-code
 				case LinuxRequest::Code:
 				{
-					// Check if the code overlaps. If so, restart from the beginning
-					if (txPointer + sizeof(BufferedCodeHeader) + packet->length > SpiCodeBufferSize)
+					// Store the code in the ring for its channel. If there is no room, ask for it to be sent again later.
+					const char * const data = transfer->ReadData(packet->length);
+					const uint8_t channel = reinterpret_cast<const CodeHeader*>(data)->channel;
+					if (channel >= NumGCodeChannels || packet->length > MaxCodeBufferSize)
 					{
-						if (rxPointer == txPointer)
-						{
-							rxPointer = 0;
-						}
-						txLength = txPointer;
-						txPointer = 0;
-						sendBufferUpdate = true;
+						REPORT_INTERNAL_ERROR;
+						break;
 					}
 
-					// Store the buffer header
-					BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader*>(codeBuffer + txPointer);
-					bufHeader->isPending = true;
-					bufHeader->length = packet->length;
-					txPointer += sizeof(BufferedCodeHeader);
-
-					// Store the code content
-					size_t dataLength = packet->length;
-					memcpy(codeBuffer + txPointer, transfer->ReadData(packet->length), dataLength);
-					txPointer += dataLength;
+					ChannelCodeRing& ring = codeRings[channel];
+					if (channelsFull.IsBitSet(channel) || !ring.Put(data, packet->length))
+					{
+						channelsFull.SetBit(channel);
+						ring.Rejected();
+						packetAcknowledged = false;
+						sendBufferUpdate = true;
+					}
 					break;
 				}
 
@@ -320,9 +319,41 @@ void LinuxInterface::Spin()
 
 				// Return a file chunk
 				case LinuxRequest::FileChunk:
-					transfer->ReadFileChunk(requestedFileChunk, requestedFileDataLength, requestedFileLength);
-					requestedFileSemaphore.Give();
+				{
+					MutexLocker lock(fileChunkMutex);
+					if (fileChunkRequest == FileChunkRequest::readAhead)
+					{
+						int32_t dataLength;
+						uint32_t fileLength;
+						transfer->ReadFileChunk(fileChunkCache.FetchBuffer(), dataLength, fileLength);
+						fileChunkCache.FetchDone(dataLength, fileLength);
+						if (waitingForReadAhead)
+						{
+							// If the waiting task wants this chunk then it can have it now. If reading it failed then ask for it again.
+							if (fileChunkCache.Get(requestedFileName.c_str(), requestedFileOffset, requestedFileLength, requestedFileChunk, requestedFileDataLength, requestedFileSize))
+							{
+								waitingForReadAhead = false;
+								requestedFileName.Clear();
+								requestedFileSemaphore.Give();
+							}
+							else
+							{
+								waitingForReadAhead = fileChunkCache.IsBeingFetched(requestedFileName.c_str(), requestedFileOffset);
+							}
+						}
+					}
+					else if (fileChunkRequest == FileChunkRequest::waiting)
+					{
+						transfer->ReadFileChunk(requestedFileChunk, requestedFileDataLength, requestedFileSize);
+						requestedFileSemaphore.Give();
+					}
+					else
+					{
+						(void)transfer->ReadData(packet->length);		// we didn't ask for this
+					}
+					fileChunkRequest = FileChunkRequest::none;
 					break;
+				}
 
 				// Evaluate an expression
 				case LinuxRequest::EvaluateExpression:
@@ -410,17 +441,40 @@ void LinuxInterface::Spin()
 			// Notify DSF about the available buffer space
 			if (sendBufferUpdate || transfer->LinuxHadReset())
 			{
-				const uint16_t bufferSpace = (txLength == 0) ? max<uint16_t>(rxPointer, SpiCodeBufferSize - txPointer) : rxPointer - txPointer;
-				sendBufferUpdate = !transfer->WriteCodeBufferUpdate(bufferSpace);
+				// DSF only knows about one buffer, so tell it the least space that the file channel or any channel holding codes has.
+				// An empty ring always has room for at least one code. If DSF sends more codes to an idle channel than will fit, we ask for them again later.
+				size_t bufferSpace = codeRings[GCodeChannel(GCodeChannel::File).RawValue()].FreeSpace();
+				for (const ChannelCodeRing& ring : codeRings)
+				{
+					if (!ring.IsEmpty())
+					{
+						bufferSpace = min<size_t>(bufferSpace, ring.FreeSpace());
+					}
+				}
+				sendBufferUpdate = !transfer->WriteCodeBufferUpdate(min<size_t>(bufferSpace, UINT16_MAX));
 			}
 
 			if (!writingIap)					// it's not safe to access GCodes once we have started writing the IAP
 			{
-				// Get another chunk of the file being requested
-				if (!requestedFileName.IsEmpty() && !reprap.GetGCodes().IsFlashing() &&
-					transfer->WriteFileChunkRequest(requestedFileName.c_str(), requestedFileOffset, requestedFileLength))
+				// Get another chunk of the file being requested, or else read ahead into the cache. Only one request can be outstanding.
+				if (fileChunkRequest == FileChunkRequest::none && !reprap.GetGCodes().IsFlashing())
 				{
-					requestedFileName.Clear();
+					MutexLocker lock(fileChunkMutex);
+					const char *filename;
+					uint32_t offset, length;
+					if (!requestedFileName.IsEmpty() && !waitingForReadAhead)
+					{
+						if (transfer->WriteFileChunkRequest(requestedFileName.c_str(), requestedFileOffset, requestedFileLength))
+						{
+							requestedFileName.Clear();
+							fileChunkRequest = FileChunkRequest::waiting;
+						}
+					}
+					else if (fileChunkCache.GetNextFetch(filename, offset, length) && transfer->WriteFileChunkRequest(filename, offset, length))
+					{
+						fileChunkCache.FetchStarted();
+						fileChunkRequest = FileChunkRequest::readAhead;
+					}
 				}
 
 				// Deal with code channel requests
@@ -504,14 +558,25 @@ void LinuxInterface::Spin()
 			wasConnected = false;
 			numDisconnects++;
 
-			rxPointer = txPointer = txLength = 0;
+			for (ChannelCodeRing& ring : codeRings)
+			{
+				ring.Clear();
+			}
 			sendBufferUpdate = true;
 			iapWritePointer = IAP_IMAGE_START;
 
-			if (!requestedFileName.IsEmpty())
 			{
-				requestedFileDataLength = -1;
-				requestedFileSemaphore.Give();
+				MutexLocker lock(fileChunkMutex);
+				if (!requestedFileName.IsEmpty() || fileChunkRequest == FileChunkRequest::waiting)
+				{
+					requestedFileName.Clear();
+					requestedFileDataLength = -1;
+					requestedFileSemaphore.Give();
+				}
+				waitingForReadAhead = false;
+				fileChunkRequest = FileChunkRequest::none;
+				fileChunkCache.FetchDone(-1, 0);
+				fileChunkCache.Clear();
 			}
 
 			// Don't cache any messages if they cannot be sent
@@ -549,7 +614,38 @@ void LinuxInterface::Diagnostics(MessageType mtype)
 	reprap.GetPlatform().Message(mtype, "=== Linux interface ===\n");
 	transfer->Diagnostics(mtype);
 	reprap.GetPlatform().MessageF(mtype, "Number of disconnects: %" PRIu32 "\n", numDisconnects);
-	reprap.GetPlatform().MessageF(mtype, "Buffer RX/TX: %d/%d-%d\n", (int)rxPointer, (int)txPointer, (int)txLength);
+	{
+		String<StringLength100> cacheStats;
+		{
+			MutexLocker lock(fileChunkMutex);
+			fileChunkCache.Diagnostics(cacheStats.GetRef());
+		}
+		reprap.GetPlatform().MessageF(mtype, "%s\n", cacheStats.c_str());
+	}
+
+	// Report the flow control statistics of the code rings that have been used, one line per channel
+	bool found = false;
+	for (size_t i = 0; i < NumGCodeChannels; ++i)
+	{
+		ChannelCodeRing& ring = codeRings[i];
+		if (ring.HasStatistics())
+		{
+			if (!found)
+			{
+				reprap.GetPlatform().Message(mtype, "Code rings (max used/size, codes, resent, starved):\n");
+				found = true;
+			}
+			String<StringLength100> reply;
+			reply.printf(" %s ", GCodeChannel(i).ToString());
+			ring.AppendStatistics(reply.GetRef());
+			ring.ClearStatistics();
+			reprap.GetPlatform().MessageF(mtype, "%s\n", reply.c_str());
+		}
+	}
+	if (!found)
+	{
+		reprap.GetPlatform().Message(mtype, "Code rings: none used\n");
+	}
 }
 
 bool LinuxInterface::IsConnected() const
@@ -567,68 +663,88 @@ bool LinuxInterface::FillBuffer(GCodeBuffer &gb)
 		return false;
 	}
 
-	if (rxPointer != txPointer || txLength != 0)
+	ChannelCodeRing& ring = codeRings[gb.GetChannel().RawValue()];
+	size_t length;
+	const char * const code = ring.Peek(length);
+	if (code == nullptr)
 	{
-		bool updateRxPointer = true;
-		uint16_t readPointer = rxPointer;
-		do
+		// Only count the times we ran out of codes while executing a file, otherwise an idle channel would count too
+		if (gb.IsDoingFile())
 		{
-			BufferedCodeHeader * const bufHeader = reinterpret_cast<BufferedCodeHeader*>(codeBuffer + readPointer);
-			readPointer += sizeof(BufferedCodeHeader);
-			const CodeHeader * const header = reinterpret_cast<const CodeHeader*>(codeBuffer + readPointer);
-			readPointer += bufHeader->length;
-
-			if (bufHeader->isPending)
-			{
-				if (gb.GetChannel().RawValue() == header->channel)
-				{
-					gb.PutAndDecode(reinterpret_cast<const char *>(header), bufHeader->length, true);
-					bufHeader->isPending = false;
-
-					if (updateRxPointer)
-					{
-						sendBufferUpdate = true;
+			ring.Starved();
+		}
+		return false;
+	}
 
-						rxPointer = readPointer;
-						if (rxPointer == txLength)
-						{
-							rxPointer = txLength = 0;
-						}
-						else if (rxPointer == txPointer && txLength == 0)
-						{
-							rxPointer = txPointer = 0;
-						}
-					}
+	gb.PutAndDecode(code, length, true);
+	ring.Pop();
+	sendBufferUpdate = true;
+	return true;
+}
 
-					return true;
-				}
-				else
-				{
-					updateRxPointer = false;
-				}
-			}
+// Process M576. Set the sizes of the rings that hold codes from the SBC for each channel, or report them and the flow control statistics.
+GCodeResult LinuxInterface::ConfigureCodeRings(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	if (gb.Seen('S'))
+	{
+		const uint32_t newSize = gb.GetUIValue();
+		const size_t chan = gb.GetLimitedUIValue('P', NumGCodeChannels);
+		if (newSize < ChannelCodeRing::MinSize || newSize > ChannelCodeRing::MaxSize)
+		{
+			reply.printf("Code ring size must be between %u and %u bytes", (unsigned int)ChannelCodeRing::MinSize, (unsigned int)ChannelCodeRing::MaxSize);
+			return GCodeResult::error;
+		}
+		if (!codeRings[chan].SetSize(newSize))
+		{
+			reply.printf("Channel %s has codes waiting, try again later", GCodeChannel(chan).ToString());
+			return GCodeResult::error;
+		}
+		sendBufferUpdate = true;
+		return GCodeResult::ok;
+	}
 
-			if (readPointer == txLength)
-			{
-				readPointer = 0;
-			}
-		} while (readPointer != txPointer);
+	reply.copy("Code ring sizes:");
+	for (size_t i = 0; i < NumGCodeChannels; ++i)
+	{
+		reply.catf(" %u:%s %u", (unsigned int)i, GCodeChannel(i).ToString(), (unsigned int)codeRings[i].GetSize());
 	}
-	return false;
+	return GCodeResult::ok;
 }
 
-// Read a file chunk from the SBC. When a response has been received, the current thread is woken up again.
-// If an error occurred, the number of bytes read is -1
+// Read a file chunk from the SBC. If it isn't in the cache then the current thread waits until it has been received.
+// If an error occurred, the number of bytes read is -1. After each successful read the following chunks are read ahead into the cache.
 const char *LinuxInterface::GetFileChunk(const char *filename, uint32_t offset, uint32_t maxLength, int32_t& dataLength, uint32_t& fileLength)
 {
-	requestedFileName.copy(filename);
-	requestedFileLength = min<uint32_t>(maxLength, MaxFileChunkSize);
-	requestedFileOffset = offset;
+	const uint32_t length = min<uint32_t>(maxLength, MaxFileChunkSize);
+	bool mustWait;
+	{
+		MutexLocker lock(fileChunkMutex);
+		mustWait = !fileChunkCache.Get(filename, offset, length, requestedFileChunk, requestedFileDataLength, requestedFileSize);
+		if (mustWait)
+		{
+			requestedFileName.copy(filename);
+			requestedFileLength = length;
+			requestedFileOffset = offset;
+			waitingForReadAhead = fileChunkCache.IsBeingFetched(filename, offset);
+			if (!waitingForReadAhead)
+			{
+				fileChunkCache.Missed();
+			}
+		}
+	}
 
-	requestedFileSemaphore.Take();
+	if (mustWait)
+	{
+		requestedFileSemaphore.Take();
+	}
 
 	dataLength = requestedFileDataLength;
-	fileLength = requestedFileLength;
+	fileLength = requestedFileSize;
+	if (dataLength > 0)
+	{
+		MutexLocker lock(fileChunkMutex);
+		fileChunkCache.ReadAhead(filename, offset + dataLength, fileLength);
+	}
 	return requestedFileChunk;
 }
 
@@ -673,53 +789,11 @@ void LinuxInterface::HandleGCodeReply(MessageType mt, OutputBuffer *buffer)
 
 void LinuxInterface::InvalidateBufferChannel(GCodeChannel channel)
 {
-	if (rxPointer != txPointer || txLength != 0)
+	ChannelCodeRing& ring = codeRings[channel.RawValue()];
+	if (!ring.IsEmpty())
 	{
-		bool updateRxPointer = true;
-		uint16_t readPointer = rxPointer;
-		do
-		{
-			BufferedCodeHeader *bufHeader = reinterpret_cast<BufferedCodeHeader*>(codeBuffer + readPointer);
-			readPointer += sizeof(BufferedCodeHeader);
-
-			if (bufHeader->isPending)
-			{
-				const CodeHeader *header = reinterpret_cast<const CodeHeader*>(codeBuffer + readPointer);
-				if (header->channel == channel.RawValue())
-				{
-					bufHeader->isPending = false;
-				}
-				else
-				{
-					updateRxPointer = false;
-				}
-			}
-			readPointer += bufHeader->length;
-
-			if (readPointer == txLength)
-			{
-				readPointer = 0;
-			}
-
-			if (updateRxPointer)
-			{
-				sendBufferUpdate = true;
-				rxPointer = readPointer;
-				if (rxPointer == 0)
-				{
-					txLength = 0;
-				}
-				else if (rxPointer == txPointer && txLength == 0)
-				{
-					rxPointer = txPointer = 0;
-					break;
-				}
-			}
-		} while (readPointer != txPointer);
-
-		// TODO It might make sense to reorder out-of-order blocks here to create a larger chunk of free buffer space.
-		// An alternative could be to limit the buffered codes per size per channel in DCS - yet we must avoid segmentation as much as possible
-		// Segmentation could become a problem if a lot of codes from different channels keep coming in and one or more codes cannot be put into GB(s)
+		ring.Clear();
+		sendBufferUpdate = true;
 	}
 }
 
@@ -13,7 +13,10 @@
 #include "GCodes/GCodeChannel.h"
 #include "GCodes/GCodeFileInfo.h"
 #include "LinuxMessageFormats.h"
+#include "ChannelCodeRing.h"
+#include "FileChunkCache.h"
 #include "MessageType.h"
+#include "GCodes/GCodeResult.h"
 
 class Platform;
 
@@ -23,8 +26,6 @@ class GCodeBuffer;
 class OutputBuffer;
 class OutputStack;
 
-constexpr size_t MaxFileChunkSize = 448;	// Maximum size of file chunks for reading files from the SBC. Should be a multiple of sizeof(CanMessageFirmwareUpdateResponse::data) for best CAN performance
-
 // G-Code input class for an SPI channel
 class LinuxInterface
 {
@@ -38,6 +39,7 @@ public:
 	bool IsConnected() const;
 
 	bool FillBuffer(GCodeBuffer &gb);		// Try to fill up the G-code buffer with the next available G-code
+	GCodeResult ConfigureCodeRings(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// Process M576
 
 	void SetPauseReason(FilePosition position, PrintPausedReason reason);	// Notify Linux that the print has been paused
 	const char *GetFileChunk(const char *filename, uint32_t offset, uint32_t maxLength, int32_t& bytesRead, uint32_t &fileLength); 	// Request a file chunk and resume the given task when it has been received
@@ -52,17 +54,24 @@ private:
 	PrintPausedReason pauseReason;
 	bool reportPause;
 
-	char codeBuffer[SpiCodeBufferSize];
-	uint16_t rxPointer, txPointer, txLength;
+	ChannelCodeRing codeRings[NumGCodeChannels];	// codes received from the SBC waiting to be executed
 	bool sendBufferUpdate;
 
 	uint32_t iapWritePointer;
 
+	// File chunks are requested one at a time, either because a task is waiting for the chunk or to read ahead into the cache
+	enum class FileChunkRequest : uint8_t { none, waiting, readAhead };
+
 	String<FILENAME_MAX> requestedFileName;
 	uint32_t requestedFileOffset, requestedFileLength;
 	BinarySemaphore requestedFileSemaphore;
 	char requestedFileChunk[MaxFileChunkSize];
 	int32_t requestedFileDataLength;
+	uint32_t requestedFileSize;
+	bool waitingForReadAhead;						// true if the waiting task wants the chunk that is being read ahead
+	FileChunkRequest fileChunkRequest;				// the request that has been sent and not yet answered
+	Mutex fileChunkMutex;
+	FileChunkCache fileChunkCache;
 
 	Mutex gcodeReplyMutex;
 	OutputStack *gcodeReply;
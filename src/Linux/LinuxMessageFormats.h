@@ -14,19 +14,7 @@
 
 #include "RepRapFirmware.h"
 #include "MessageType.h"
-
-constexpr uint8_t LinuxFormatCode = 0x5F;
-constexpr uint8_t InvalidFormatCode = 0xC9;			// must be different from any other format code
-
-constexpr uint16_t LinuxProtocolVersion = 2;
-
-#ifndef __LPC17xx__
-constexpr size_t LinuxTransferBufferSize = 8192;	// maximum length of a data transfer. Must be a multiple of 4 and kept in sync with Duet Control Server!
-#else
-constexpr size_t LinuxTransferBufferSize = 4096;    // maximum length of a data transfer. Must be a multiple of 4 and kept in sync with Duet Control Server!
-#endif
-
-static_assert(LinuxTransferBufferSize % sizeof(uint32_t) == 0, "LinuxTransferBufferSize must be a whole number of dwords");
+#include "TransferCodec.h"
 
 #ifndef __LPC17xx__
 constexpr size_t MaxCodeBufferSize = 256;			// maximum length of a G/M/T-code in binary encoding
@@ -90,43 +78,12 @@ struct MessageHeader
 	uint16_t padding;
 };
 
-struct PacketHeader
-{
-	uint16_t request;
-	uint16_t id;
-	uint16_t length;
-	uint16_t resendPacketId;
-};
-
 struct StringHeader
 {
 	uint16_t length;
 	uint16_t padding;
 };
 
-struct TransferHeader
-{
-	uint8_t formatCode;
-	uint8_t numPackets;
-	uint16_t protocolVersion;
-	uint16_t sequenceNumber;
-	uint16_t dataLength;
-	uint16_t checksumData;
-	uint16_t checksumHeader;
-};
-
-enum TransferResponse : uint32_t
-{
-	Success = 1,
-	BadFormat = 2,
-	BadProtocolVersion = 3,
-	BadDataLength = 4,
-	BadHeaderChecksum = 5,
-	BadDataChecksum = 6,
-
-	BadResponse = 0xFEFEFEFE
-};
-
 // RepRapFirmware to Linux
 struct AbortFileHeader
 {
@@ -191,7 +148,8 @@ enum class FirmwareRequest : uint16_t
 	FileChunk = 10,						// Request another chunk of a file
 	EvaluationResult = 11,				// Response to an expression evaluation request
 	DoCode = 12,						// Perform a G/M/T-code from a code input
-	WaitForMessageAcknowledgment = 13	// Wait for a message to be acknowledged
+	WaitForMessageAcknowledgment = 13,	// Wait for a message to be acknowledged
+	CompactObjectModel = 14				// Response to an object model request in the compact encoding, see ObjectModelCodec.h
 };
 
 enum class PrintPausedReason : uint8_t
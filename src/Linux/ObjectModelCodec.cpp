@@ -0,0 +1,566 @@
+/*
+ * ObjectModelCodec.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "ObjectModelCodec.h"
+#include <cstring>
+#include <new>
+
+size_t CompactCodec::WriteVarint(uint8_t *p, uint64_t val) noexcept
+{
+	size_t n = 0;
+	do
+	{
+		uint8_t b = val & 0x7F;
+		val >>= 7;
+		if (val != 0)
+		{
+			b |= 0x80;
+		}
+		if (p != nullptr)
+		{
+			p[n] = b;
+		}
+		++n;
+	} while (val != 0);
+	return n;
+}
+
+size_t CompactCodec::ReadVarint(const uint8_t *p, const uint8_t *end, uint64_t& val) noexcept
+{
+	val = 0;
+	for (size_t n = 0; n < 10 && p + n < end; ++n)
+	{
+		val |= (uint64_t)(p[n] & 0x7F) << (7 * n);
+		if ((p[n] & 0x80) == 0)
+		{
+			return n + 1;
+		}
+	}
+	return 0;
+}
+
+// Return the length of the token in a message that is not a delta, i.e. not keyDefine or copy, or 0 if it is not valid
+size_t CompactCodec::TokenLength(const uint8_t *p, const uint8_t *end) noexcept
+{
+	if (p >= end)
+	{
+		return 0;
+	}
+
+	uint64_t val;
+	size_t len;
+	switch ((CompactToken)*p)
+	{
+	case CompactToken::objectStart:
+	case CompactToken::objectEnd:
+	case CompactToken::arrayStart:
+	case CompactToken::arrayEnd:
+	case CompactToken::nullValue:
+	case CompactToken::falseValue:
+	case CompactToken::trueValue:
+		return 1;
+
+	case CompactToken::integer:
+	case CompactToken::keyRef:
+		len = ReadVarint(p + 1, end, val);
+		return (len == 0) ? 0 : 1 + len;
+
+	case CompactToken::decimal:
+		len = (p + 1 < end) ? ReadVarint(p + 2, end, val) : 0;
+		return (len == 0) ? 0 : 2 + len;
+
+	case CompactToken::rawNumber:
+		len = ReadVarint(p + 1, end, val);
+		return (len == 0 || val > (uint64_t)(end - p - 1 - len)) ? 0 : 1 + len + val;
+
+	case CompactToken::string:
+	case CompactToken::keyString:
+		if (end - p < 3)
+		{
+			return 0;
+		}
+		len = p[1] | (p[2] << 8);
+		return (len > (size_t)(end - p - 3)) ? 0 : 3 + len;
+
+	default:
+		return 0;
+	}
+}
+
+ObjectModelEncoder::ObjectModelEncoder() noexcept
+	: tables(nullptr), currentLength(0), previousLength(0), encodedLength(0), textLength(0), stringStart(0), numKeys(0), keyPoolUsed(0),
+	  currentIndex(0), depth(0), haveString(false), resetPending(true), lexState(LexState::failed), literalLength(0),
+	  numEncoded(0), numFailed(0), textBytes(0), encodedBytes(0)
+{
+}
+
+ObjectModelEncoder::~ObjectModelEncoder()
+{
+	delete tables;
+}
+
+// The decoder has lost its state, so start again. We keep our key table because the key IDs are sent when the keys are defined.
+void ObjectModelEncoder::Reset() noexcept
+{
+	previousLength = 0;
+	resetPending = true;
+	if (tables != nullptr)
+	{
+		memset(tables->keysSent, 0, sizeof(tables->keysSent));
+	}
+}
+
+// Start encoding a new response
+void ObjectModelEncoder::Begin() noexcept
+{
+	if (tables == nullptr)
+	{
+		tables = new (std::nothrow) Tables;
+		if (tables == nullptr)
+		{
+			lexState = LexState::failed;
+			return;
+		}
+		memset(tables->keyHash, 0xFF, sizeof(tables->keyHash));
+		memset(tables->keysSent, 0, sizeof(tables->keysSent));
+		numKeys = keyPoolUsed = 0;
+		previousLength = 0;
+	}
+
+	currentLength = encodedLength = textLength = 0;
+	depth = 0;
+	haveString = false;
+	literalLength = 0;
+	lexState = LexState::idle;
+}
+
+// Encode more of the response, returning false if it can't be encoded
+bool ObjectModelEncoder::Feed(const char *text, size_t length) noexcept
+{
+	textLength += length;
+	while (length != 0)
+	{
+		const char c = *text++;
+		--length;
+		switch (lexState)
+		{
+		case LexState::failed:
+			return false;
+
+		case LexState::inString:
+			if (c == '"')
+			{
+				if (!EndString())
+				{
+					return false;
+				}
+				lexState = LexState::idle;
+			}
+			else
+			{
+				if (c == '\\')
+				{
+					lexState = LexState::inEscape;
+				}
+				if (!Put(c))
+				{
+					return false;
+				}
+			}
+			continue;
+
+		case LexState::inEscape:
+			lexState = LexState::inString;
+			if (!Put(c))
+			{
+				return false;
+			}
+			continue;
+
+		case LexState::inLiteral:
+			if (c != ',' && c != '}' && c != ']' && c != ':' && c != ' ' && c != '\n' && c != '\r' && c != '\t')
+			{
+				if (literalLength == MaxLiteralLength)
+				{
+					return Fail();
+				}
+				literal[literalLength++] = c;
+				continue;
+			}
+			if (!EndLiteral())
+			{
+				return false;
+			}
+			break;							// go on to handle the delimiter
+
+		case LexState::idle:
+			break;
+		}
+
+		if (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+		{
+			continue;
+		}
+
+		const bool wasString = haveString;
+		haveString = false;
+		bool ok = true;
+		switch (c)
+		{
+		case '{':
+			++depth;
+			ok = PutToken(CompactToken::objectStart);
+			break;
+
+		case '[':
+			++depth;
+			ok = PutToken(CompactToken::arrayStart);
+			break;
+
+		case '}':
+		case ']':
+			if (depth == 0)
+			{
+				return Fail();
+			}
+			--depth;
+			ok = PutToken((c == '}') ? CompactToken::objectEnd : CompactToken::arrayEnd);
+			break;
+
+		case ':':
+			if (!wasString)
+			{
+				return Fail();
+			}
+			ok = MakeKey();
+			break;
+
+		case '"':
+			stringStart = currentLength;
+			ok = PutToken(CompactToken::string) && Put(0) && Put(0);
+			lexState = LexState::inString;
+			break;
+
+		case ',':
+			break;
+
+		default:
+			literal[0] = c;
+			literalLength = 1;
+			lexState = LexState::inLiteral;
+			break;
+		}
+
+		if (!ok)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Finish the response, returning false if it is incomplete. Works out how long the message to write will be.
+bool ObjectModelEncoder::End() noexcept
+{
+	if (lexState == LexState::inLiteral && !EndLiteral())
+	{
+		return false;
+	}
+	if (lexState != LexState::idle || depth != 0 || currentLength == 0)
+	{
+		return Fail();
+	}
+
+	// Measure the message using a copy of the keys sent, because a key that is used more than once is only defined the first time
+	uint32_t keysSent[KeyBitmapWords];
+	memcpy(keysSent, tables->keysSent, sizeof(keysSent));
+	encodedLength = sizeof(CompactObjectModelHeader) + Encode(nullptr, keysSent);
+	return true;
+}
+
+// Write the message, after which it is the one that the next message is a delta against
+void ObjectModelEncoder::Write(char *dst) noexcept
+{
+	CompactObjectModelHeader * const header = reinterpret_cast<CompactObjectModelHeader*>(dst);
+	header->length = encodedLength - sizeof(CompactObjectModelHeader);
+	header->flags = (resetPending) ? CompactObjectModelHeader::ResetFlag : 0;
+	header->padding = 0;
+	(void)Encode(reinterpret_cast<uint8_t *>(dst + sizeof(CompactObjectModelHeader)), tables->keysSent);
+
+	resetPending = false;
+	currentIndex ^= 1;
+	previousLength = currentLength;
+	currentLength = 0;
+	lexState = LexState::failed;					// Begin must be called before the next response
+
+	++numEncoded;
+	textBytes += textLength;
+	encodedBytes += encodedLength;
+}
+
+bool ObjectModelEncoder::Fail() noexcept
+{
+	if (lexState != LexState::failed)
+	{
+		lexState = LexState::failed;
+		++numFailed;
+	}
+	return false;
+}
+
+bool ObjectModelEncoder::Put(uint8_t b) noexcept
+{
+	if (currentLength == MaxEncodedLength)
+	{
+		return Fail();
+	}
+	Current()[currentLength++] = b;
+	return true;
+}
+
+bool ObjectModelEncoder::PutVarint(uint64_t val) noexcept
+{
+	if (currentLength + CompactCodec::WriteVarint(nullptr, val) > MaxEncodedLength)
+	{
+		return Fail();
+	}
+	currentLength += CompactCodec::WriteVarint(Current() + currentLength, val);
+	return true;
+}
+
+// We have reached the closing quote of a string, so fill in its length
+bool ObjectModelEncoder::EndString() noexcept
+{
+	const size_t length = currentLength - stringStart - 3;
+	if (length > 0xFFFF)
+	{
+		return Fail();
+	}
+	Current()[stringStart + 1] = (uint8_t)length;
+	Current()[stringStart + 2] = (uint8_t)(length >> 8);
+	haveString = true;
+	return true;
+}
+
+// The string we just stored was followed by a colon, so replace it by a key reference
+bool ObjectModelEncoder::MakeKey() noexcept
+{
+	uint8_t * const tok = Current() + stringStart;
+	const size_t length = tok[1] | (tok[2] << 8);
+	const uint16_t id = FindOrAddKey(reinterpret_cast<const char *>(tok + 3), length);
+	if (id == NoKey)
+	{
+		tok[0] = (uint8_t)CompactToken::keyString;
+		return true;
+	}
+	currentLength = stringStart;
+	return PutToken(CompactToken::keyRef) && PutVarint(id);
+}
+
+// Return the ID of a key, adding it to the table if it is new. Returns NoKey if the table is full.
+uint16_t ObjectModelEncoder::FindOrAddKey(const char *key, size_t length) noexcept
+{
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < length; ++i)
+	{
+		hash = (hash ^ (uint8_t)key[i]) * 16777619u;
+	}
+
+	size_t slot = hash & (KeyHashSize - 1);
+	for (;;)
+	{
+		const uint16_t id = tables->keyHash[slot];
+		if (id == NoKey)
+		{
+			break;
+		}
+		const char * const k = tables->keyPool + tables->keyOffsets[id];
+		if (strncmp(k, key, length) == 0 && k[length] == 0)
+		{
+			return id;
+		}
+		slot = (slot + 1) & (KeyHashSize - 1);
+	}
+
+	if (numKeys == MaxKeys || keyPoolUsed + length + 1 > KeyPoolSize)
+	{
+		return NoKey;
+	}
+	const uint16_t id = numKeys++;
+	tables->keyOffsets[id] = keyPoolUsed;
+	memcpy(tables->keyPool + keyPoolUsed, key, length);
+	tables->keyPool[keyPoolUsed + length] = 0;
+	keyPoolUsed += length + 1;
+	tables->keyHash[slot] = id;
+	return id;
+}
+
+// Literal numbers and words end at the next delimiter
+bool ObjectModelEncoder::EndLiteral() noexcept
+{
+	lexState = LexState::idle;
+	literal[literalLength] = 0;
+	if (strcmp(literal, "null") == 0)
+	{
+		return PutToken(CompactToken::nullValue);
+	}
+	if (strcmp(literal, "false") == 0)
+	{
+		return PutToken(CompactToken::falseValue);
+	}
+	if (strcmp(literal, "true") == 0)
+	{
+		return PutToken(CompactToken::trueValue);
+	}
+
+	// See if it is a number of the form -123.456 with up to 18 digits that we can send as an integer and a number of decimal places
+	const char *p = literal;
+	const bool negative = (*p == '-');
+	if (negative)
+	{
+		++p;
+	}
+	bool exact = (*p >= '0' && *p <= '9') && !(p[0] == '0' && p[1] >= '0' && p[1] <= '9');
+	int64_t mantissa = 0;
+	unsigned int numDigits = 0, places = 0;
+	bool seenPoint = false;
+	for (; exact && *p != 0; ++p)
+	{
+		if (*p >= '0' && *p <= '9' && numDigits < 18)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			++numDigits;
+			if (seenPoint)
+			{
+				++places;
+			}
+		}
+		else if (*p == '.' && !seenPoint && p[1] != 0)
+		{
+			seenPoint = true;
+		}
+		else
+		{
+			exact = false;
+		}
+	}
+
+	if (exact && !(negative && mantissa == 0))
+	{
+		if (negative)
+		{
+			mantissa = -mantissa;
+		}
+		if (places == 0)
+		{
+			return PutToken(CompactToken::integer) && PutVarint(CompactCodec::ZigZag(mantissa));
+		}
+		return PutToken(CompactToken::decimal) && Put(places) && PutVarint(CompactCodec::ZigZag(mantissa));
+	}
+
+	// Send any other number as text, but reject anything else because it isn't JSON
+	for (size_t i = 0; i < literalLength; ++i)
+	{
+		if (strchr("0123456789+-.eE", literal[i]) == nullptr)
+		{
+			return Fail();
+		}
+	}
+	if (!PutToken(CompactToken::rawNumber) || !PutVarint(literalLength))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < literalLength; ++i)
+	{
+		if (!Put(literal[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Write the message as a delta against the previous one, or just measure it if dst is null.
+// Tokens are compared with the token at the same position in the previous message. Runs that are the same are sent as a copy count.
+size_t ObjectModelEncoder::Encode(uint8_t *dst, uint32_t *keysSent) const noexcept
+{
+	const uint8_t * const current = Current();
+	const uint8_t * const currentEnd = current + currentLength;
+	const uint8_t * const previous = Previous();
+	const uint8_t * const previousEnd = previous + previousLength;
+	const uint8_t *p = current;
+	const uint8_t *q = previous;
+	size_t length = 0;
+	size_t run = 0;
+	while (p < currentEnd)
+	{
+		const size_t tokenLength = CompactCodec::TokenLength(p, currentEnd);
+		const size_t previousTokenLength = (q < previousEnd) ? CompactCodec::TokenLength(q, previousEnd) : 0;
+		if (tokenLength == previousTokenLength && memcmp(p, q, tokenLength) == 0)
+		{
+			++run;
+		}
+		else
+		{
+			if (run != 0)
+			{
+				if (dst != nullptr)
+				{
+					dst[length] = (uint8_t)CompactToken::copy;
+				}
+				length += 1 + CompactCodec::WriteVarint((dst == nullptr) ? nullptr : dst + length + 1, run);
+				run = 0;
+			}
+			length += WriteLiteral((dst == nullptr) ? nullptr : dst + length, p, tokenLength, keysSent);
+		}
+		p += tokenLength;
+		q += previousTokenLength;
+	}
+
+	if (run != 0)
+	{
+		if (dst != nullptr)
+		{
+			dst[length] = (uint8_t)CompactToken::copy;
+		}
+		length += 1 + CompactCodec::WriteVarint((dst == nullptr) ? nullptr : dst + length + 1, run);
+	}
+	return length;
+}
+
+// Write a token that is not copied from the previous message. The first reference to a key that the decoder doesn't know defines it.
+size_t ObjectModelEncoder::WriteLiteral(uint8_t *dst, const uint8_t *tok, size_t length, uint32_t *keysSent) const noexcept
+{
+	if ((CompactToken)tok[0] == CompactToken::keyRef)
+	{
+		uint64_t id;
+		(void)CompactCodec::ReadVarint(tok + 1, tok + length, id);
+		if ((keysSent[id >> 5] & (1u << (id & 31))) == 0)
+		{
+			keysSent[id >> 5] |= 1u << (id & 31);
+			const char * const key = tables->keyPool + tables->keyOffsets[id];
+			const size_t keyLength = strlen(key);
+			size_t n = 1;
+			n += CompactCodec::WriteVarint((dst == nullptr) ? nullptr : dst + n, id);
+			n += CompactCodec::WriteVarint((dst == nullptr) ? nullptr : dst + n, keyLength);
+			if (dst != nullptr)
+			{
+				dst[0] = (uint8_t)CompactToken::keyDefine;
+				memcpy(dst + n, key, keyLength);
+			}
+			return n + keyLength;
+		}
+	}
+
+	if (dst != nullptr)
+	{
+		memcpy(dst, tok, length);
+	}
+	return length;
+}
+
+// End
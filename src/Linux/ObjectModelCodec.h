@@ -0,0 +1,152 @@
+/*
+ * ObjectModelCodec.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Compact encoding of object model responses sent to the SBC.
+ *
+ *  The encoder takes the JSON text produced by ObjectModel::ReportAsJson and converts it to a stream of typed tokens:
+ *  - numbers become integers or scaled decimals, so "-12.50" is sent as the value -1250 with 2 decimal places and decodes to the same text;
+ *  - keys are interned. The first time the decoder needs a key it is sent with its ID, after that only the ID is sent;
+ *  - commas and colons are not sent, the decoder inserts them.
+ *  Each message is a delta against the previous compact message: runs of tokens that are the same as the tokens at the same place
+ *  in the previous message are replaced by a copy count. Object model responses that are requested repeatedly have the same
+ *  structure each time, so usually only the values that changed are sent.
+ *
+ *  So the decoder must process every compact message in the order they were sent, including responses that it no longer wants.
+ *  The first message after the encoder is reset has the reset flag set, and the decoder must then discard its keys and previous message.
+ */
+
+#ifndef SRC_LINUX_OBJECTMODELCODEC_H_
+#define SRC_LINUX_OBJECTMODELCODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Header of a compact object model packet
+struct CompactObjectModelHeader
+{
+	uint16_t length;					// length of the token data that follows
+	uint8_t flags;
+	uint8_t padding;
+
+	static constexpr uint8_t ResetFlag = 0x01;		// discard the keys and the previous message before decoding this one
+};
+
+// Tokens used in the compact encoding. Multi-byte values are little-endian. Varints are LEB128, signed values are zigzag encoded first.
+enum class CompactToken : uint8_t
+{
+	objectStart = 1,
+	objectEnd,
+	arrayStart,
+	arrayEnd,
+	nullValue,
+	falseValue,
+	trueValue,
+	integer,							// followed by signed varint
+	decimal,							// followed by byte number of decimal places, then signed varint value scaled by 10^places
+	rawNumber,							// followed by varint length and the text of a number we can't represent exactly in the other forms
+	string,								// followed by uint16 length and the string text, with any escape sequences as in the JSON
+	keyRef,								// followed by varint key ID
+	keyString,							// followed by uint16 length and the key text, used when the key table is full
+
+	// The following are only used in the data sent, not in the previous message that the delta is computed against
+	keyDefine,							// followed by varint key ID, varint length and the key text. Defines the key, then used as keyRef.
+	copy,								// followed by varint count of tokens to copy from the previous message
+};
+
+// Helper functions shared by the encoder and the decoder
+class CompactCodec
+{
+public:
+	static size_t WriteVarint(uint8_t *p, uint64_t val) noexcept;
+	static size_t ReadVarint(const uint8_t *p, const uint8_t *end, uint64_t& val) noexcept;	// returns 0 if not valid
+	static uint64_t ZigZag(int64_t val) noexcept { return ((uint64_t)val << 1) ^ (uint64_t)(val >> 63); }
+	static int64_t UnZigZag(uint64_t val) noexcept { return (int64_t)(val >> 1) ^ -(int64_t)(val & 1); }
+
+	// Return the length of the token in a message that is not a delta, i.e. not keyDefine or copy, or 0 if it is not valid
+	static size_t TokenLength(const uint8_t *p, const uint8_t *end) noexcept;
+};
+
+class ObjectModelEncoder
+{
+public:
+#ifndef __LPC17xx__
+	static constexpr size_t MaxEncodedLength = 4096;		// longest token stream we keep, longer responses are sent as JSON
+	static constexpr size_t MaxKeys = 512;
+	static constexpr size_t KeyPoolSize = 4096;
+#else
+	static constexpr size_t MaxEncodedLength = 2048;
+	static constexpr size_t MaxKeys = 256;
+	static constexpr size_t KeyPoolSize = 2048;
+#endif
+
+	ObjectModelEncoder() noexcept;
+	~ObjectModelEncoder();
+	ObjectModelEncoder(const ObjectModelEncoder&) = delete;
+
+	void Reset() noexcept;									// the decoder has lost its state, so start again
+	void Begin() noexcept;									// start encoding a new response
+	bool Feed(const char *text, size_t length) noexcept;	// encode more of the response, returning false if it can't be encoded
+	bool End() noexcept;									// finish the response, returning false if it is incomplete
+	size_t GetEncodedLength() const noexcept { return encodedLength; }	// the length to write, including the CompactObjectModelHeader
+	void Write(char *dst) noexcept;							// write the message, after which it is the one that the next is a delta against
+
+	// Statistics
+	uint32_t GetNumEncoded() const noexcept { return numEncoded; }
+	uint32_t GetNumFailed() const noexcept { return numFailed; }
+	uint32_t GetTextBytes() const noexcept { return textBytes; }
+	uint32_t GetEncodedBytes() const noexcept { return encodedBytes; }
+	void ClearStatistics() noexcept { numEncoded = numFailed = textBytes = encodedBytes = 0; }
+
+private:
+	static constexpr uint16_t NoKey = 0xFFFF;
+	static constexpr size_t KeyHashSize = MaxKeys * 2;		// must be a power of 2
+	static constexpr size_t MaxLiteralLength = 31;
+	static constexpr size_t KeyBitmapWords = (MaxKeys + 31)/32;
+
+	enum class LexState : uint8_t { idle, inString, inEscape, inLiteral, failed };
+
+	// The storage, allocated when first used
+	struct Tables
+	{
+		uint8_t tokens[2][MaxEncodedLength];				// the message being encoded, and the previous message
+		char keyPool[KeyPoolSize];
+		uint16_t keyOffsets[MaxKeys];
+		uint16_t keyHash[KeyHashSize];
+		uint32_t keysSent[KeyBitmapWords];				// the keys that the decoder knows
+	};
+
+	bool Put(uint8_t b) noexcept;
+	bool PutToken(CompactToken tok) noexcept { return Put((uint8_t)tok); }
+	bool PutVarint(uint64_t val) noexcept;
+	bool EndString() noexcept;
+	bool MakeKey() noexcept;
+	bool EndLiteral() noexcept;
+	uint16_t FindOrAddKey(const char *key, size_t length) noexcept;
+	bool Fail() noexcept;
+	size_t Encode(uint8_t *dst, uint32_t *keysSent) const noexcept;	// write the delta to dst, or just measure it if dst is null
+	size_t WriteLiteral(uint8_t *dst, const uint8_t *tok, size_t length, uint32_t *keysSent) const noexcept;
+
+	uint8_t *Current() const noexcept { return tables->tokens[currentIndex]; }
+	uint8_t *Previous() const noexcept { return tables->tokens[currentIndex ^ 1]; }
+
+	Tables *tables;
+	size_t currentLength, previousLength;
+	size_t encodedLength;
+	size_t textLength;
+	size_t stringStart;										// where the last string token starts, if it might turn out to be a key
+	size_t numKeys, keyPoolUsed;
+	unsigned int currentIndex;
+	unsigned int depth;
+	bool haveString;										// true if the last token is a string that may be a key
+	bool resetPending;										// true if the next message must tell the decoder to discard its state
+	LexState lexState;
+	size_t literalLength;
+	char literal[MaxLiteralLength + 1];
+
+	uint32_t numEncoded, numFailed, textBytes, encodedBytes;
+};
+
+#endif /* SRC_LINUX_OBJECTMODELCODEC_H_ */
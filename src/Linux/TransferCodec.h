@@ -0,0 +1,199 @@
+/*
+ * TransferCodec.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  The framing of the SPI transfers between RepRapFirmware and the SBC, and the packet writer and reader used to fill and parse the transfer data.
+ *
+ *  In protocol version 2 each transfer takes four SPI exchanges: the transfer headers, the responses to them, the data, and the responses to that.
+ *  Protocol version 3 is pipelined: the header exchange also carries the first PipelinedDataLength bytes of the data in each direction,
+ *  directly following the header. If the data in both directions fits in that then the single response exchange acknowledges both the header
+ *  and the data, so a short transfer takes two SPI exchanges instead of four. Longer transfers continue with a data exchange as in version 2.
+ *  The SBC clocks the longer header exchange only if the last header it received from us said version 3, and we send version 3 only if the last
+ *  header we received said so. A transfer is pipelined if the header exchange was the longer one and both the headers exchanged in it say version 3.
+ *  So nothing changes when either end knows only version 2, or when the SPI hardware can't end an exchange before all the bytes set up have been clocked.
+ *
+ *  The top byte of the protocol version holds flags for optional features. As with version 3, the SBC sets a flag to say that it supports
+ *  the feature and we set it in the next header we send to acknowledge that we will use the feature.
+ */
+
+#ifndef SRC_LINUX_TRANSFERCODEC_H_
+#define SRC_LINUX_TRANSFERCODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr uint8_t LinuxFormatCode = 0x5F;
+constexpr uint8_t InvalidFormatCode = 0xC9;			// must be different from any other format code
+
+constexpr uint16_t LinuxProtocolVersion = 2;
+constexpr uint16_t LinuxPipelinedProtocolVersion = 3;
+constexpr uint16_t LinuxProtocolVersionMask = 0x00FF;
+constexpr uint16_t LinuxFeatureCompactObjectModel = 0x0100;	// the SBC accepts compact object model responses, see ObjectModelCodec.h
+constexpr uint16_t LinuxSupportedFeatures = LinuxFeatureCompactObjectModel;
+
+#ifndef __LPC17xx__
+constexpr size_t LinuxTransferBufferSize = 8192;	// maximum length of a data transfer. Must be a multiple of 4 and kept in sync with Duet Control Server!
+#else
+constexpr size_t LinuxTransferBufferSize = 4096;    // maximum length of a data transfer. Must be a multiple of 4 and kept in sync with Duet Control Server!
+#endif
+
+static_assert(LinuxTransferBufferSize % sizeof(uint32_t) == 0, "LinuxTransferBufferSize must be a whole number of dwords");
+
+constexpr size_t PipelinedDataLength = 512;			// how much data is sent along with the transfer header in protocol version 3
+
+static_assert(PipelinedDataLength % sizeof(uint32_t) == 0 && PipelinedDataLength <= LinuxTransferBufferSize, "Bad PipelinedDataLength");
+
+struct PacketHeader
+{
+	uint16_t request;
+	uint16_t id;
+	uint16_t length;
+	uint16_t resendPacketId;
+};
+
+struct TransferHeader
+{
+	uint8_t formatCode;
+	uint8_t numPackets;
+	uint16_t protocolVersion;
+	uint16_t sequenceNumber;
+	uint16_t dataLength;
+	uint16_t checksumData;
+	uint16_t checksumHeader;
+};
+
+enum TransferResponse : uint32_t
+{
+	Success = 1,
+	BadFormat = 2,
+	BadProtocolVersion = 3,
+	BadDataLength = 4,
+	BadHeaderChecksum = 5,
+	BadDataChecksum = 6,
+
+	BadResponse = 0xFEFEFEFE
+};
+
+// The memory that one direction of a transfer is exchanged from. The data immediately follows the header so that
+// a pipelined header exchange places the first part of the data where it belongs, without needing to copy it.
+struct TransferArea
+{
+	TransferHeader header;
+	uint32_t data[LinuxTransferBufferSize / 4];
+
+	char *Data() noexcept { return reinterpret_cast<char *>(data); }
+	const char *Data() const noexcept { return reinterpret_cast<const char *>(data); }
+};
+
+static_assert(offsetof(TransferArea, data) == sizeof(TransferHeader), "Transfer data must follow the header");
+
+class TransferCodec
+{
+public:
+	static uint16_t CRC16(const char *buffer, size_t length) noexcept;
+	static size_t AddPadding(size_t length) noexcept;
+
+	// Fill in the fields of a header that describe the data, and the checksums
+	static void FinishHeader(TransferHeader& header, uint8_t numPackets, const char *data, size_t dataLength) noexcept;
+
+	static uint16_t HeaderChecksum(const TransferHeader& header) noexcept;
+	static uint16_t GetProtocolVersion(const TransferHeader& header) noexcept { return header.protocolVersion & LinuxProtocolVersionMask; }
+	static bool HasFeature(const TransferHeader& header, uint16_t feature) noexcept { return (header.protocolVersion & feature) != 0; }
+	static bool IsSupportedProtocolVersion(uint16_t version) noexcept;
+
+	// Check a received header whose checksum is correct, returning the response to send
+	static TransferResponse CheckHeader(const TransferHeader& header) noexcept;
+
+	// Return true if the data in both directions was exchanged along with these headers, so that no data exchange is needed
+	static bool DataSentWithHeader(const TransferHeader& rxHeader, const TransferHeader& txHeader, bool longHeaderExchange) noexcept;
+
+	// Return the number of bytes to set up for the header exchange
+	static constexpr size_t HeaderExchangeLength(bool pipelined) noexcept { return sizeof(TransferHeader) + ((pipelined) ? PipelinedDataLength : 0); }
+};
+
+// Class to write packets to the data of a transfer
+class PacketWriter
+{
+public:
+	explicit PacketWriter(char *p_buffer) noexcept : buffer(p_buffer), pointer(0), packetId(0) { }
+
+	void Reset() noexcept { pointer = 0; packetId = 0; }
+	size_t GetDataLength() const noexcept { return pointer; }
+	uint16_t GetNumPackets() const noexcept { return packetId; }
+
+	// Return the free space, less the space reserved for other packets such as resend requests
+	size_t FreeSpace(size_t reserved) const noexcept { return (pointer + reserved < LinuxTransferBufferSize) ? LinuxTransferBufferSize - pointer - reserved : 0; }
+	bool CanWritePacket(size_t dataLength, size_t reserved) const noexcept { return FreeSpace(reserved) >= sizeof(PacketHeader) + dataLength; }
+
+	PacketHeader *WritePacketHeader(uint16_t request, size_t dataLength = 0, uint16_t resendPacketId = 0) noexcept;
+	void WriteData(const char *data, size_t length) noexcept;
+	template<typename T> T *WriteDataHeader() noexcept;
+
+	// Get a pointer to write data to directly, then call Advance when it has been written
+	char *GetWritePointer() const noexcept { return buffer + pointer; }
+	void Advance(size_t length) noexcept { pointer += length; }
+
+private:
+	char *buffer;
+	size_t pointer;
+	uint16_t packetId;
+};
+
+// Class to read packets from the data of a transfer
+class PacketReader
+{
+public:
+	explicit PacketReader(const char *p_buffer) noexcept : buffer(p_buffer), pointer(0), dataLength(0) { }
+
+	void Reset(size_t p_dataLength) noexcept { pointer = 0; dataLength = p_dataLength; }
+
+	const PacketHeader *ReadPacket() noexcept;								// Return the next packet header or null. Advances the read pointer to the packet's data
+	const char *ReadData(size_t length) noexcept;							// Read the packet data and advance to the next packet (if any)
+	template<typename T> const T *ReadDataHeader() noexcept;
+
+private:
+	const char *buffer;
+	size_t pointer;
+	size_t dataLength;
+};
+
+inline size_t TransferCodec::AddPadding(size_t length) noexcept
+{
+	const size_t padding = 4 - length % 4;
+	return length + ((padding == 4) ? 0 : padding);
+}
+
+inline uint16_t TransferCodec::HeaderChecksum(const TransferHeader& header) noexcept
+{
+	return CRC16(reinterpret_cast<const char *>(&header), sizeof(TransferHeader) - sizeof(uint16_t));
+}
+
+inline bool TransferCodec::IsSupportedProtocolVersion(uint16_t version) noexcept
+{
+	version &= LinuxProtocolVersionMask;
+	return version == LinuxProtocolVersion || version == LinuxPipelinedProtocolVersion;
+}
+
+inline bool TransferCodec::DataSentWithHeader(const TransferHeader& rxHeader, const TransferHeader& txHeader, bool longHeaderExchange) noexcept
+{
+	return longHeaderExchange && GetProtocolVersion(rxHeader) == LinuxPipelinedProtocolVersion && GetProtocolVersion(txHeader) == LinuxPipelinedProtocolVersion
+		&& rxHeader.dataLength <= PipelinedDataLength && txHeader.dataLength <= PipelinedDataLength;
+}
+
+template<typename T> inline T *PacketWriter::WriteDataHeader() noexcept
+{
+	T * const header = reinterpret_cast<T*>(buffer + pointer);
+	pointer += sizeof(T);
+	return header;
+}
+
+template<typename T> inline const T *PacketReader::ReadDataHeader() noexcept
+{
+	const T * const header = reinterpret_cast<const T*>(buffer + pointer);
+	pointer += sizeof(T);
+	return header;
+}
+
+#endif /* SRC_LINUX_TRANSFERCODEC_H_ */
@@ -0,0 +1,203 @@
+/*
+ * AdaptiveGridProbe.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "AdaptiveGridProbe.h"
+
+// Start adaptive probing of the grid
+void AdaptiveGridProbe::Start(const GridDefinition& grid, float p_tolerance) noexcept
+{
+	numX = grid.NumXpoints();
+	numY = grid.NumYpoints();
+	tolerance = p_tolerance;
+	requested.ClearAll();
+	numCells = 0;
+	numPointsRequested = 0;
+
+	// Choose the largest power of 2 coarse step, up to the limit, that gives us at least two coarse cells in each direction
+	coarseStep = MaxCoarseStep;
+	while (coarseStep > 1 && (2 * coarseStep > numX - 1 || 2 * coarseStep > numY - 1))
+	{
+		coarseStep >>= 1;
+	}
+
+	numCoarseCellsX = max<uint32_t>((numX - 1 + coarseStep - 1)/coarseStep, 1);
+	const uint32_t numCoarseCellsY = max<uint32_t>((numY - 1 + coarseStep - 1)/coarseStep, 1);
+	numCoarseCells = numCoarseCellsX * numCoarseCellsY;
+	nextCoarseCell = 0;
+}
+
+// Get the next grid point to probe, filling in any cells that are flat enough from the points already probed.
+// Return false if there are no more points to probe.
+bool AdaptiveGridProbe::GetNextPoint(HeightMap& hm, size_t& xIndex, size_t& yIndex) noexcept
+{
+	for (;;)
+	{
+		if (numCells == 0)
+		{
+			if (nextCoarseCell == numCoarseCells)
+			{
+				return false;
+			}
+			PushNextCoarseCell();
+		}
+
+		// Make sure that the corners of the cell have been probed. Visit them in an order that avoids crossing the cell.
+		const Cell c = cells[numCells - 1];
+		if (   TryPoint(c.x0, c.y0, xIndex, yIndex) || TryPoint(c.x1, c.y0, xIndex, yIndex)
+			|| TryPoint(c.x1, c.y1, xIndex, yIndex) || TryPoint(c.x0, c.y1, xIndex, yIndex)
+		   )
+		{
+			return true;
+		}
+
+		// If the cell has no interior or edge points then there is nothing more to do
+		if (c.x1 - c.x0 <= 1 && c.y1 - c.y0 <= 1)
+		{
+			--numCells;
+			continue;
+		}
+
+		// Probe the centre
+		const uint16_t xm = (c.x0 + c.x1)/2, ym = (c.y0 + c.y1)/2;
+		if (TryPoint(xm, ym, xIndex, yIndex))
+		{
+			return true;
+		}
+
+		// See whether the centre height agrees with the interpolated height. If any of the points is missing because it couldn't be probed, split the cell.
+		float cornerHeights[4], centreHeight;
+		if (   hm.GetGridHeight(c.x0, c.y0, cornerHeights[0]) && hm.GetGridHeight(c.x1, c.y0, cornerHeights[1])
+			&& hm.GetGridHeight(c.x0, c.y1, cornerHeights[2]) && hm.GetGridHeight(c.x1, c.y1, cornerHeights[3])
+			&& hm.GetGridHeight(xm, ym, centreHeight)
+		   )
+		{
+			const float xFrac = (c.x1 > c.x0) ? (float)(xm - c.x0)/(float)(c.x1 - c.x0) : 0.0;
+			const float yFrac = (c.y1 > c.y0) ? (float)(ym - c.y0)/(float)(c.y1 - c.y0) : 0.0;
+			const float bottom = cornerHeights[0] + xFrac * (cornerHeights[1] - cornerHeights[0]);
+			const float top = cornerHeights[2] + xFrac * (cornerHeights[3] - cornerHeights[2]);
+			if (fabsf(centreHeight - (bottom + yFrac * (top - bottom))) <= tolerance)
+			{
+				FillTopCell(hm, cornerHeights);
+				--numCells;
+				continue;
+			}
+		}
+		SplitTopCell();
+	}
+}
+
+// Return the number of points in the height map that were filled in by interpolation
+unsigned int AdaptiveGridProbe::GetNumPointsInterpolated(const HeightMap& hm) const noexcept
+{
+	unsigned int count = 0;
+	for (uint32_t y = 0; y < numY; ++y)
+	{
+		for (uint32_t x = 0; x < numX; ++x)
+		{
+			float height;
+			if (!requested.IsBitSet(y * numX + x) && hm.GetGridHeight(x, y, height))
+			{
+				++count;
+			}
+		}
+	}
+	return count;
+}
+
+// If the point has not been requested already, request it and return true
+bool AdaptiveGridProbe::TryPoint(uint16_t x, uint16_t y, size_t& xIndex, size_t& yIndex) noexcept
+{
+	const size_t index = y * numX + x;
+	if (index >= MaxGridProbePoints || requested.IsBitSet(index))
+	{
+		return false;
+	}
+	requested.SetBit(index);
+	++numPointsRequested;
+	xIndex = x;
+	yIndex = y;
+	return true;
+}
+
+void AdaptiveGridProbe::PushCell(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) noexcept
+{
+	if (numCells < MaxCells)					// this should always be true because the coarse step limits how many times we split a cell
+	{
+		Cell& c = cells[numCells++];
+		c.x0 = x0;
+		c.y0 = y0;
+		c.x1 = x1;
+		c.y1 = y1;
+	}
+}
+
+// Push the next coarse cell. The coarse cells are visited in serpentine order to reduce travel.
+void AdaptiveGridProbe::PushNextCoarseCell() noexcept
+{
+	const uint32_t row = nextCoarseCell/numCoarseCellsX;
+	uint32_t column = nextCoarseCell % numCoarseCellsX;
+	if (row & 1)
+	{
+		column = numCoarseCellsX - 1 - column;
+	}
+	++nextCoarseCell;
+
+	const uint16_t x0 = column * coarseStep, y0 = row * coarseStep;
+	PushCell(x0, y0, min<uint32_t>(x0 + coarseStep, numX - 1), min<uint32_t>(y0 + coarseStep, numY - 1));
+}
+
+// Replace the top cell by the cells we get by splitting it at its centre
+void AdaptiveGridProbe::SplitTopCell() noexcept
+{
+	const Cell c = cells[--numCells];
+	const uint16_t xm = (c.x0 + c.x1)/2, ym = (c.y0 + c.y1)/2;
+	const bool splitX = (c.x1 - c.x0 > 1), splitY = (c.y1 - c.y0 > 1);
+
+	// Push them in reverse order of processing, so that we finish near the start of the next cell
+	if (splitY)
+	{
+		if (splitX)
+		{
+			PushCell(c.x0, ym, xm, c.y1);
+			PushCell(xm, ym, c.x1, c.y1);
+			PushCell(xm, c.y0, c.x1, ym);
+			PushCell(c.x0, c.y0, xm, ym);
+		}
+		else
+		{
+			PushCell(c.x0, ym, c.x1, c.y1);
+			PushCell(c.x0, c.y0, c.x1, ym);
+		}
+	}
+	else
+	{
+		PushCell(xm, c.y0, c.x1, c.y1);
+		PushCell(c.x0, c.y0, xm, c.y1);
+	}
+}
+
+// Fill in the heights of the points in the top cell that we haven't probed, by bilinear interpolation between the corners
+void AdaptiveGridProbe::FillTopCell(HeightMap& hm, const float cornerHeights[4]) noexcept
+{
+	const Cell& c = cells[numCells - 1];
+	for (uint16_t y = c.y0; y <= c.y1; ++y)
+	{
+		const float yFrac = (c.y1 > c.y0) ? (float)(y - c.y0)/(float)(c.y1 - c.y0) : 0.0;
+		for (uint16_t x = c.x0; x <= c.x1; ++x)
+		{
+			if (!requested.IsBitSet(y * numX + x))
+			{
+				const float xFrac = (c.x1 > c.x0) ? (float)(x - c.x0)/(float)(c.x1 - c.x0) : 0.0;
+				const float bottom = cornerHeights[0] + xFrac * (cornerHeights[1] - cornerHeights[0]);
+				const float top = cornerHeights[2] + xFrac * (cornerHeights[3] - cornerHeights[2]);
+				hm.SetGridHeight(x, y, bottom + yFrac * (top - bottom));
+			}
+		}
+	}
+}
+
+// End
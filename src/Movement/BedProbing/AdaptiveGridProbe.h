@@ -0,0 +1,64 @@
+/*
+ * AdaptiveGridProbe.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Chooses the order of grid points for adaptive G29 probing.
+ *  We divide the grid into coarse cells and probe the corners and then the centre of each one. If the centre height agrees with the
+ *  bilinear interpolation of the corner heights to within the tolerance, the rest of the points in the cell are filled in by interpolation.
+ *  Otherwise the cell is split into four at its centre and each part is treated the same way, down to single grid cells.
+ *  So flat areas of the bed need few probe points, while areas with more variation get probed at the full grid resolution.
+ */
+
+#ifndef SRC_MOVEMENT_BEDPROBING_ADAPTIVEGRIDPROBE_H_
+#define SRC_MOVEMENT_BEDPROBING_ADAPTIVEGRIDPROBE_H_
+
+#include "Grid.h"
+
+class AdaptiveGridProbe
+{
+public:
+	AdaptiveGridProbe() noexcept : numCells(0), nextCoarseCell(0), numCoarseCells(0) { }
+
+	// Start adaptive probing of the grid
+	void Start(const GridDefinition& grid, float p_tolerance) noexcept;
+
+	// Get the next grid point to probe, filling in any cells that are flat enough from the points already probed.
+	// Return false if there are no more points to probe.
+	bool GetNextPoint(HeightMap& hm, size_t& xIndex, size_t& yIndex) noexcept;
+
+	// Return the number of points that we asked to be probed, including any that were skipped because they were unreachable
+	unsigned int GetNumPointsRequested() const noexcept { return numPointsRequested; }
+
+	// Return the number of points in the height map that were filled in by interpolation
+	unsigned int GetNumPointsInterpolated(const HeightMap& hm) const noexcept;
+
+	static constexpr float DefaultTolerance = 0.02;					// the default maximum interpolation error in mm
+
+private:
+	struct Cell
+	{
+		uint16_t x0, y0, x1, y1;									// the grid indices of the corners
+	};
+
+	static constexpr uint16_t MaxCoarseStep = 4;					// the maximum number of grid spacings in a coarse cell
+	static constexpr size_t MaxCells = 32;							// enough for one coarse cell and three subcells at each level of splitting
+
+	bool TryPoint(uint16_t x, uint16_t y, size_t& xIndex, size_t& yIndex) noexcept;
+	void PushCell(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1) noexcept;
+	void PushNextCoarseCell() noexcept;
+	void SplitTopCell() noexcept;
+	void FillTopCell(HeightMap& hm, const float cornerHeights[4]) noexcept;
+
+	LargeBitmap<MaxGridProbePoints> requested;						// which points we have asked to be probed
+	Cell cells[MaxCells];											// stack of cells still to be processed
+	size_t numCells;
+	uint32_t numX, numY;
+	uint32_t nextCoarseCell, numCoarseCells, numCoarseCellsX;
+	unsigned int numPointsRequested;
+	float tolerance;
+	uint16_t coarseStep;
+};
+
+#endif /* SRC_MOVEMENT_BEDPROBING_ADAPTIVEGRIDPROBE_H_ */
@@ -0,0 +1,118 @@
+/*
+ * BicubicSlopeTable.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "BicubicSlopeTable.h"
+
+BicubicSlopeTable::BicubicSlopeTable(size_t p_maxPoints) noexcept
+	: slopes(new PointSlopes[p_maxPoints]), maxPoints(p_maxPoints), numX(0)
+{
+}
+
+// Compute the slopes from the heights of a numX by numY grid stored a row at a time, returning false if the grid is too large
+bool BicubicSlopeTable::Build(const float *heights, uint32_t p_numX, uint32_t numY) noexcept
+{
+	if ((size_t)p_numX * numY > maxPoints || p_numX < 2 || numY < 2)
+	{
+		return false;
+	}
+	numX = p_numX;
+
+	// First pass: the X and Y slopes
+	for (uint32_t y = 0; y < numY; ++y)
+	{
+		for (uint32_t x = 0; x < numX; ++x)
+		{
+			PointSlopes& ps = slopes[y * numX + x];
+			ps.dx = Slope(heights + y * numX, x, numX, 1);
+			ps.dy = Slope(heights + x, y, numY, numX);
+		}
+	}
+
+	// Second pass: the cross slopes, which are the Y slopes of the X slopes
+	for (uint32_t y = 0; y < numY; ++y)
+	{
+		for (uint32_t x = 0; x < numX; ++x)
+		{
+			const PointSlopes *const column = slopes + x;
+			const uint32_t stride = numX;
+			float dxy;
+			if (y != 0 && y + 1 != numY)
+			{
+				dxy = (column[(y + 1) * stride].dx - column[(y - 1) * stride].dx) * 0.5;
+			}
+			else if (numY < 3)
+			{
+				dxy = column[stride].dx - column[0].dx;
+			}
+			else if (y == 0)
+			{
+				dxy = (-3.0 * column[0].dx + 4.0 * column[stride].dx - column[2 * stride].dx) * 0.5;
+			}
+			else
+			{
+				dxy = (3.0 * column[y * stride].dx - 4.0 * column[(y - 1) * stride].dx + column[(y - 2) * stride].dx) * 0.5;
+			}
+			slopes[y * numX + x].dxy = dxy;
+		}
+	}
+	return true;
+}
+
+// Estimate the slope per grid spacing at element n of a line of num values that are stride apart.
+// We use central differences inside the grid and second order one-sided differences at the edges, so the slopes of a quadratic are exact everywhere.
+/*static*/ float BicubicSlopeTable::Slope(const float *values, uint32_t n, uint32_t num, uint32_t stride) noexcept
+{
+	if (n != 0 && n + 1 != num)
+	{
+		return (values[(n + 1) * stride] - values[(n - 1) * stride]) * 0.5;
+	}
+	if (num < 3)
+	{
+		return values[stride] - values[0];						// only two points, so the best we can do is a straight line
+	}
+	return (n == 0)
+			? (-3.0 * values[0] + 4.0 * values[stride] - values[2 * stride]) * 0.5
+				: (3.0 * values[n * stride] - 4.0 * values[(n - 1) * stride] + values[(n - 2) * stride]) * 0.5;
+}
+
+// Interpolate the height within the grid cell whose lower left corner is at the specified indices. The fractions must be in the range 0 to 1.
+float BicubicSlopeTable::Interpolate(const float *heights, uint32_t xIndex, uint32_t yIndex, float xFrac, float yFrac) const noexcept
+{
+	const uint32_t index00 = yIndex * numX + xIndex;
+	const uint32_t index10 = index00 + 1;
+	const uint32_t index01 = index00 + numX;
+	const uint32_t index11 = index01 + 1;
+
+	// Hermite basis functions in X: weights for the value at 0, the value at 1, the slope at 0 and the slope at 1
+	const float xFrac2 = xFrac * xFrac;
+	const float xFrac3 = xFrac2 * xFrac;
+	const float bx1 = 3.0 * xFrac2 - 2.0 * xFrac3;
+	const float bx0 = 1.0 - bx1;
+	const float bx3 = xFrac3 - xFrac2;
+	const float bx2 = xFrac - xFrac2 + bx3;
+
+	// The same in Y
+	const float yFrac2 = yFrac * yFrac;
+	const float yFrac3 = yFrac2 * yFrac;
+	const float by1 = 3.0 * yFrac2 - 2.0 * yFrac3;
+	const float by0 = 1.0 - by1;
+	const float by3 = yFrac3 - yFrac2;
+	const float by2 = yFrac - yFrac2 + by3;
+
+	// Interpolate the heights and Y slopes along the bottom and top edges of the cell, then interpolate between them
+	const PointSlopes& s00 = slopes[index00];
+	const PointSlopes& s10 = slopes[index10];
+	const PointSlopes& s01 = slopes[index01];
+	const PointSlopes& s11 = slopes[index11];
+	const float bottom = bx0 * heights[index00] + bx1 * heights[index10] + bx2 * s00.dx + bx3 * s10.dx;
+	const float top = bx0 * heights[index01] + bx1 * heights[index11] + bx2 * s01.dx + bx3 * s11.dx;
+	const float bottomSlope = bx0 * s00.dy + bx1 * s10.dy + bx2 * s00.dxy + bx3 * s10.dxy;
+	const float topSlope = bx0 * s01.dy + bx1 * s11.dy + bx2 * s01.dxy + bx3 * s11.dxy;
+	return by0 * bottom + by1 * top + by2 * bottomSlope + by3 * topSlope;
+}
+
+// End
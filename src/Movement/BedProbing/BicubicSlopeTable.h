@@ -0,0 +1,50 @@
+/*
+ * BicubicSlopeTable.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Table of slopes for bicubic interpolation of a height map.
+ *  We use bicubic Hermite interpolation within each grid cell, with the X, Y and cross slopes at each grid point estimated by central differences,
+ *  which is the same as Catmull-Rom spline interpolation along the grid lines. At the edges of the grid we use second order one-sided differences.
+ *  The surface passes through the grid heights, is continuous in slope across cell boundaries and reproduces quadratic bed shapes exactly,
+ *  provided that the grid has at least 3 points in each direction. On the smoothly curved synthetic bed in Tools/meshinterpolation it is more
+ *  accurate than bilinear interpolation of a grid with twice as many points in each direction; how much this holds for a real bed depends on its shape.
+ *  The slopes are computed once when the height map is loaded or probed, so evaluating a point costs one table lookup per cell corner and
+ *  a few multiply-adds. The table needs 12 bytes per grid point, so it is only allocated if bicubic interpolation is selected.
+ */
+
+#ifndef SRC_MOVEMENT_BEDPROBING_BICUBICSLOPETABLE_H_
+#define SRC_MOVEMENT_BEDPROBING_BICUBICSLOPETABLE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class BicubicSlopeTable
+{
+public:
+	explicit BicubicSlopeTable(size_t p_maxPoints) noexcept;
+	~BicubicSlopeTable() noexcept { delete[] slopes; }
+	BicubicSlopeTable(const BicubicSlopeTable&) = delete;
+	BicubicSlopeTable& operator=(const BicubicSlopeTable&) = delete;
+
+	// Compute the slopes from the heights of a numX by numY grid stored a row at a time, returning false if the grid is too large
+	bool Build(const float *heights, uint32_t numX, uint32_t numY) noexcept;
+
+	// Interpolate the height within the grid cell whose lower left corner is at the specified indices. The fractions must be in the range 0 to 1.
+	float Interpolate(const float *heights, uint32_t xIndex, uint32_t yIndex, float xFrac, float yFrac) const noexcept;
+
+private:
+	static float Slope(const float *values, uint32_t n, uint32_t num, uint32_t stride) noexcept;
+
+	struct PointSlopes
+	{
+		float dx, dy, dxy;								// slopes per grid spacing
+	};
+
+	PointSlopes *slopes;
+	size_t maxPoints;
+	uint32_t numX;
+};
+
+#endif /* SRC_MOVEMENT_BEDPROBING_BICUBICSLOPETABLE_H_ */
@@ -9,6 +9,7 @@
 #include "Platform.h"
 #include "RepRap.h"
 #include "Storage/FileStore.h"
+#include "BicubicSlopeTable.h"
 #include <Math/Deviation.h>
 
 #include <cmath>
@@ -246,7 +247,7 @@ void GridDefinition::PrintError(float originalXrange, float originalYrange, cons
 // Increase the version number in the following string whenever we change the format of the height map file.
 const char * const HeightMap::HeightMapComment = "RepRapFirmware height map file v2";
 
-HeightMap::HeightMap() noexcept : useMap(false) { }
+HeightMap::HeightMap() noexcept : bicubicTable(nullptr), useMap(false), useBicubic(false) { }
 
 void HeightMap::SetGrid(const GridDefinition& gd) noexcept
 {
@@ -278,6 +279,18 @@ void HeightMap::SetGridHeight(size_t index, float height) noexcept
 	}
 }
 
+// Get the height of a grid point, returning false if it is not set
+bool HeightMap::GetGridHeight(size_t xIndex, size_t yIndex, float& height) const noexcept
+{
+	const size_t index = yIndex * def.numX + xIndex;
+	if (index < MaxGridProbePoints && gridHeightSet.IsBitSet(index))
+	{
+		height = gridHeights[index];
+		return true;
+	}
+	return false;
+}
+
 // Return the minimum number of segments for a move by this X or Y amount
 // Note that deltaX and deltaY may be negative
 unsigned int HeightMap::GetMinimumSegments(float deltaX, float deltaY) const noexcept
@@ -288,7 +301,8 @@ unsigned int HeightMap::GetMinimumSegments(float deltaX, float deltaY) const noe
 	const float yDistance = fabsf(deltaY);
 	unsigned int ySegments = (yDistance > 0.0) ? (unsigned int)(yDistance * def.recipYspacing + 0.4) : 1;
 
-	return max<unsigned int>(xSegments, ySegments);
+	const unsigned int segments = max<unsigned int>(xSegments, ySegments);
+	return (useBicubic) ? segments * BicubicSegmentsPerSpacing : segments;
 }
 
 #if HAS_MASS_STORAGE
@@ -504,10 +518,38 @@ unsigned int HeightMap::GetStatistics(Deviation& deviation, float& minError, flo
 // Try to turn mesh compensation on or off and report the state achieved
 bool HeightMap::UseHeightMap(bool b) noexcept
 {
-	useMap = b && def.IsValid();
+	const bool newUseMap = b && def.IsValid();
+	if (newUseMap && useBicubic && !BuildBicubicTable())		// build the slope table before the map is used
+	{
+		useBicubic = false;
+	}
+	useMap = newUseMap;
 	return useMap;
 }
 
+// Select bicubic or bilinear interpolation. If the map is in use, build the slope table before we switch to bicubic.
+void HeightMap::SetBicubicInterpolation(bool b) noexcept
+{
+	if (!b)
+	{
+		useBicubic = false;
+	}
+	else if (!useBicubic)
+	{
+		if (bicubicTable == nullptr)
+		{
+			bicubicTable = new BicubicSlopeTable(MaxGridProbePoints);
+		}
+		useBicubic = !useMap || BuildBicubicTable();
+	}
+}
+
+// Compute the slopes for bicubic interpolation from the grid heights, returning true if successful
+bool HeightMap::BuildBicubicTable() noexcept
+{
+	return bicubicTable != nullptr && def.IsValid() && bicubicTable->Build(gridHeights, def.numX, def.numY);
+}
+
 // Compute the height error at the specified point
 float HeightMap::GetInterpolatedHeightError(float x, float y) const noexcept
 {
@@ -535,7 +577,9 @@ float HeightMap::GetInterpolatedHeightError(float x, float y) const noexcept
 	const float yFloor = floor(yf);
 	const int32_t yIndex = (int32_t)yFloor;
 
-	return InterpolateXY(xIndex, yIndex, xf - xFloor, yf - yFloor);
+	return (useBicubic)
+			? bicubicTable->Interpolate(gridHeights, xIndex, yIndex, xf - xFloor, yf - yFloor)
+				: InterpolateXY(xIndex, yIndex, xf - xFloor, yf - yFloor);
 }
 
 float HeightMap::InterpolateXY(uint32_t xIndex, uint32_t yIndex, float xFrac, float yFrac) const noexcept
@@ -16,6 +16,7 @@
 
 class DataTransfer;
 class Deviation;
+class BicubicSlopeTable;
 
 // This class defines the bed probing grid
 class GridDefinition INHERIT_OBJECT_MODEL
@@ -77,6 +78,7 @@ public:
 	void ClearGridHeights() noexcept;											// Clear all grid height corrections
 	void SetGridHeight(size_t xIndex, size_t yIndex, float height) noexcept;	// Set the height of a grid point
 	void SetGridHeight(size_t index, float height) noexcept;					// Set the height of a grid point
+	bool GetGridHeight(size_t xIndex, size_t yIndex, float& height) const noexcept;	// Get the height of a grid point, returning false if it is not set
 
 #if HAS_MASS_STORAGE
 	bool SaveToFile(FileStore *f, const char *fname, float zOffset) noexcept	// Save the grid to file returning true if an error occurred
@@ -98,6 +100,9 @@ public:
 	bool UseHeightMap(bool b) noexcept;
 	bool UsingHeightMap() const noexcept { return useMap; }
 
+	void SetBicubicInterpolation(bool b) noexcept;								// Select bicubic or bilinear interpolation
+	bool UsingBicubicInterpolation() const noexcept { return useBicubic; }
+
 	unsigned int GetStatistics(Deviation& deviation, float& minError, float& maxError) const noexcept;
 																	// Return number of points probed, mean and RMS deviation, min and max error
 	void ExtrapolateMissing() noexcept;								// Extrapolate missing points to ensure consistency
@@ -115,11 +120,16 @@ private:
 #if HAS_MASS_STORAGE || HAS_LINUX_INTERFACE
 	String<MaxFilenameLength> fileName;								// The name of the file that this height map was loaded from or saved to
 #endif
+	BicubicSlopeTable *bicubicTable;								// The slopes for bicubic interpolation, allocated when first needed
 	bool useMap;													// True to do bed compensation
+	bool useBicubic;												// True to use bicubic interpolation instead of bilinear
 
 	uint32_t GetMapIndex(uint32_t xIndex, uint32_t yIndex) const noexcept { return (yIndex * def.NumXpoints()) + xIndex; }
 
 	float InterpolateXY(uint32_t xIndex, uint32_t yIndex, float xFrac, float yFrac) const noexcept;
+	bool BuildBicubicTable() noexcept;
+
+	static constexpr unsigned int BicubicSegmentsPerSpacing = 2;	// Segments per grid spacing when using bicubic interpolation, to follow the curvature within a cell
 };
 
 #endif /* SRC_MOVEMENT_GRID_H_ */
@@ -0,0 +1,96 @@
+/*
+ * GridScanner.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "GridScanner.h"
+#include <cmath>
+
+// Set up the conversion from readings to height errors, returning false if the reading doesn't change enough with height
+bool GridScanner::Calibrate(float p_referenceHeightError, int p_triggerReading, int p_scanReading, float scanMargin) noexcept
+{
+	referenceHeightError = p_referenceHeightError;
+	triggerReading = p_triggerReading;
+	scanReading = p_scanReading;
+	sensitivity = (float)(triggerReading - scanReading)/scanMargin;
+	return sensitivity >= MinSensitivity;
+}
+
+// Start a new scan of the grid, forgetting which rows have been done
+void GridScanner::Start(GetXCoordinateFunction p_getXCoordinate, SetHeightFunction p_setHeight, void *p_context) noexcept
+{
+	getXCoordinate = p_getXCoordinate;
+	setHeight = p_setHeight;
+	context = p_context;
+	numRowsStarted = 0;
+	numPointsOutOfRange = 0;
+}
+
+// Start scanning the points from lowXIndex to highXIndex in a row. Alternate rows are scanned in opposite directions.
+void GridScanner::StartRow(uint32_t p_yIndex, uint32_t lowXIndex, uint32_t highXIndex) noexcept
+{
+	yIndex = p_yIndex;
+	lowIndex = lowXIndex;
+	highIndex = highXIndex;
+	forwards = (numRowsStarted & 1) == 0;
+	++numRowsStarted;
+	nextXIndex = GetRowStartXIndex();
+	haveLastReading = false;
+	rowFinished = false;
+}
+
+// Add a reading taken with the probe at X coordinate x, storing the heights of any grid points that the probe has now passed
+void GridScanner::AddReading(float x, int reading) noexcept
+{
+	if (!haveLastReading)
+	{
+		lastX = x;
+		lastReading = (float)reading;
+		haveLastReading = true;
+	}
+
+	while (!rowFinished)
+	{
+		// Allow a little tolerance so that the reading we take when stationary at the start or end of the row counts as being at the grid point
+		const float gridX = getXCoordinate(context, nextXIndex);
+		if ((forwards) ? x < gridX - 0.01 : x > gridX + 0.01)
+		{
+			break;
+		}
+
+		const float span = x - lastX;
+		const float fraction = (fabsf(span) > 0.001) ? (gridX - lastX)/span : 1.0;
+		const float readingAtPoint = lastReading + fraction * ((float)reading - lastReading);
+
+		// Readings above the trigger value are unlikely because the probe would have stopped the move, but they can't be trusted anyway
+		const float heightChange = (readingAtPoint - (float)scanReading)/sensitivity;
+		if (readingAtPoint <= (float)triggerReading && heightChange >= -MaxExtrapolation)
+		{
+			setHeight(context, nextXIndex, yIndex, referenceHeightError + heightChange);
+		}
+		else
+		{
+			++numPointsOutOfRange;
+		}
+
+		if (nextXIndex == GetRowEndXIndex())
+		{
+			rowFinished = true;
+		}
+		else if (forwards)
+		{
+			++nextXIndex;
+		}
+		else
+		{
+			--nextXIndex;
+		}
+	}
+
+	lastX = x;
+	lastReading = (float)reading;
+}
+
+// End
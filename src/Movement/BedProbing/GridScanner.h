@@ -0,0 +1,67 @@
+/*
+ * GridScanner.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Converts the readings of an analog Z probe taken while moving along a row of the grid at constant height into height map values.
+ *  Before scanning we probe the first grid point in the normal way, then take readings with the probe stationary at the trigger height
+ *  and at the scanning height above that point. We assume that the reading varies linearly with height between those two, and that the
+ *  same relationship extends a short distance beyond them.
+ *  Each time the probe passes a grid point, we interpolate between the readings taken either side of it and convert the result to a height.
+ *  The grid coordinates are fetched and the heights stored through callbacks supplied by the caller, so this class doesn't need to know about the height map.
+ */
+
+#ifndef SRC_MOVEMENT_BEDPROBING_GRIDSCANNER_H_
+#define SRC_MOVEMENT_BEDPROBING_GRIDSCANNER_H_
+
+#include <cstdint>
+
+class GridScanner
+{
+public:
+	typedef float (*GetXCoordinateFunction)(const void *context, uint32_t xIndex);
+	typedef void (*SetHeightFunction)(void *context, uint32_t xIndex, uint32_t yIndex, float heightError);
+
+	GridScanner() noexcept : getXCoordinate(nullptr), setHeight(nullptr), context(nullptr), numRowsStarted(0), numPointsOutOfRange(0), rowFinished(true) { }
+
+	// Set up the conversion from readings to height errors, returning false if the reading doesn't change enough with height
+	bool Calibrate(float p_referenceHeightError, int p_triggerReading, int p_scanReading, float scanMargin) noexcept;
+
+	// Start a new scan of the grid, forgetting which rows have been done
+	void Start(GetXCoordinateFunction p_getXCoordinate, SetHeightFunction p_setHeight, void *p_context) noexcept;
+
+	// Start scanning the points from lowXIndex to highXIndex in a row. Alternate rows are scanned in opposite directions.
+	void StartRow(uint32_t p_yIndex, uint32_t lowXIndex, uint32_t highXIndex) noexcept;
+
+	uint32_t GetRowYIndex() const noexcept { return yIndex; }
+	uint32_t GetRowStartXIndex() const noexcept { return (forwards) ? lowIndex : highIndex; }
+	uint32_t GetRowEndXIndex() const noexcept { return (forwards) ? highIndex : lowIndex; }
+	bool IsRowFinished() const noexcept { return rowFinished; }
+
+	// Add a reading taken with the probe at X coordinate x, storing the heights of any grid points that the probe has now passed
+	void AddReading(float x, int reading) noexcept;
+
+	float GetSensitivity() const noexcept { return sensitivity; }
+	unsigned int GetNumPointsOutOfRange() const noexcept { return numPointsOutOfRange; }
+
+	static constexpr float MinSensitivity = 5.0;				// the minimum change in reading per mm that we accept
+	static constexpr float MaxExtrapolation = 1.0;				// how far in mm below the scanning height we trust the calibration
+
+private:
+	GetXCoordinateFunction getXCoordinate;
+	SetHeightFunction setHeight;
+	void *context;
+	float referenceHeightError;									// the height error at the point where we calibrated
+	float sensitivity;											// the increase in reading per mm decrease in height
+	float lastX, lastReading;
+	int triggerReading, scanReading;
+	unsigned int numRowsStarted;
+	unsigned int numPointsOutOfRange;
+	uint32_t yIndex, lowIndex, highIndex, nextXIndex;
+	bool forwards;
+	bool haveLastReading;
+	bool rowFinished;
+};
+
+#endif /* SRC_MOVEMENT_BEDPROBING_GRIDSCANNER_H_ */
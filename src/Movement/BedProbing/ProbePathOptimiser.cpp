@@ -0,0 +1,166 @@
+/*
+ * ProbePathOptimiser.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "ProbePathOptimiser.h"
+#include <utility>			// for std::swap
+
+static inline float Distance(float x0, float y0, float x1, float y1) noexcept
+{
+	return sqrtf(fsquare(x1 - x0) + fsquare(y1 - y0));
+}
+
+// Add a point, returning false if there is no room
+bool ProbePathOptimiser::AddPoint(uint16_t pointId) noexcept
+{
+	if (numPoints < MaxPoints)
+	{
+		points[numPoints++] = pointId;
+		return true;
+	}
+	return false;
+}
+
+// Return the length of the path that visits the points in their current order from the starting position
+float ProbePathOptimiser::GetPathLength(float startX, float startY, GetCoordinatesFunction getCoordinates, const void *context) const noexcept
+{
+	float length = 0.0;
+	float lastX = startX, lastY = startY;
+	for (size_t i = 0; i < numPoints; ++i)
+	{
+		float x, y;
+		getCoordinates(context, points[i], x, y);
+		length += Distance(lastX, lastY, x, y);
+		lastX = x;
+		lastY = y;
+	}
+	return length;
+}
+
+// Start reordering the points to reduce the length of the path from the starting position
+void ProbePathOptimiser::StartOptimising(float p_startX, float p_startY, GetCoordinatesFunction p_getCoordinates, const void *p_context) noexcept
+{
+	getCoordinates = p_getCoordinates;
+	context = p_context;
+	startX = lastX = p_startX;
+	startY = lastY = p_startY;
+	originalLength = GetPathLength(startX, startY, getCoordinates, context);
+	nextIndex = 0;
+	twoOptChecksDone = 0;
+	improved = false;
+	phase = Phase::nearestNeighbour;
+}
+
+// Do a limited amount of the optimisation, returning true when it has finished. The result may be longer than the original order.
+bool ProbePathOptimiser::Optimise() noexcept
+{
+	uint32_t checksDone = 0;
+
+	// Build a nearest neighbour path in place
+	while (phase == Phase::nearestNeighbour)
+	{
+		if (nextIndex >= numPoints)
+		{
+			phase = Phase::twoOpt;
+			nextIndex = 0;
+			improved = false;
+			break;
+		}
+		if (checksDone >= MaxChecksPerCall)
+		{
+			return false;
+		}
+
+		const size_t i = nextIndex;
+		size_t nearest = i;
+		float nearestDistance = 0.0;
+		for (size_t j = i; j < numPoints; ++j)
+		{
+			float x, y;
+			getCoordinates(context, points[j], x, y);
+			const float d = Distance(lastX, lastY, x, y);
+			if (j == i || d < nearestDistance)
+			{
+				nearest = j;
+				nearestDistance = d;
+			}
+		}
+		checksDone += numPoints - i;
+		std::swap(points[i], points[nearest]);
+		getCoordinates(context, points[i], lastX, lastY);
+		++nextIndex;
+	}
+
+	// Improve it using 2-opt moves. Reversing points[i..j] replaces the edges (i-1, i) and (j, j+1) by (i-1, j) and (i, j+1).
+	// Point i-1 is the starting position when i is zero, and there is no edge after j when j is the last point.
+	while (phase == Phase::twoOpt)
+	{
+		if (nextIndex + 1 >= numPoints)
+		{
+			if (!improved)
+			{
+				phase = Phase::finished;
+				break;
+			}
+			nextIndex = 0;											// start another pass
+			improved = false;
+		}
+		if (twoOptChecksDone >= MaxTwoOptChecks)
+		{
+			phase = Phase::finished;
+			break;
+		}
+		if (checksDone >= MaxChecksPerCall)
+		{
+			return false;
+		}
+
+		const size_t i = nextIndex;
+		float prevX, prevY, ix, iy;
+		if (i == 0)
+		{
+			prevX = startX;
+			prevY = startY;
+		}
+		else
+		{
+			getCoordinates(context, points[i - 1], prevX, prevY);
+		}
+		getCoordinates(context, points[i], ix, iy);
+		const float oldFirstEdge = Distance(prevX, prevY, ix, iy);
+
+		for (size_t j = i + 1; j < numPoints; ++j)
+		{
+			++checksDone;
+			++twoOptChecksDone;
+			float jx, jy;
+			getCoordinates(context, points[j], jx, jy);
+			float delta = Distance(prevX, prevY, jx, jy) - oldFirstEdge;
+			if (j + 1 < numPoints)
+			{
+				float nextX, nextY;
+				getCoordinates(context, points[j + 1], nextX, nextY);
+				delta += Distance(ix, iy, nextX, nextY) - Distance(jx, jy, nextX, nextY);
+			}
+
+			if (delta < -0.001)
+			{
+				// Reverse points[i..j]
+				for (size_t lo = i, hi = j; lo < hi; ++lo, --hi)
+				{
+					std::swap(points[lo], points[hi]);
+				}
+				improved = true;
+				break;								// the first edge has changed, so move on to the next i
+			}
+		}
+		++nextIndex;
+	}
+
+	return true;
+}
+
+// End
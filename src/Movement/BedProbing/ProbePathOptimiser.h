@@ -0,0 +1,66 @@
+/*
+ * ProbePathOptimiser.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Orders a set of probe points to reduce the total XY travel needed to visit them from a starting position.
+ *  We build a nearest neighbour path and then improve it using 2-opt moves, i.e. reversing sections of the path, until no reversal helps
+ *  or we have used up our computation budget. The path is open, because we don't need to return to the start.
+ *  The points are identified by 16-bit IDs and their coordinates are fetched through a callback, so that we don't need to store them.
+ *  The work is done in slices by repeated calls to Optimise, so that a large grid doesn't hold up the task that is optimising it.
+ */
+
+#ifndef SRC_MOVEMENT_BEDPROBING_PROBEPATHOPTIMISER_H_
+#define SRC_MOVEMENT_BEDPROBING_PROBEPATHOPTIMISER_H_
+
+#include "RepRapFirmware.h"
+
+class ProbePathOptimiser
+{
+public:
+	typedef void (*GetCoordinatesFunction)(const void *context, uint16_t pointId, float& x, float& y);
+
+	ProbePathOptimiser() noexcept : numPoints(0), phase(Phase::finished) { }
+
+	void Clear() noexcept { numPoints = 0; phase = Phase::finished; }
+	bool AddPoint(uint16_t pointId) noexcept;								// add a point, returning false if there is no room
+
+	size_t GetNumPoints() const noexcept { return numPoints; }
+	uint16_t GetPoint(size_t n) const noexcept pre(n < numPoints) { return points[n]; }
+
+	// Return the length of the path that visits the points in their current order from the starting position
+	float GetPathLength(float startX, float startY, GetCoordinatesFunction getCoordinates, const void *context) const noexcept;
+
+	// Start reordering the points to reduce the length of the path from the starting position
+	void StartOptimising(float p_startX, float p_startY, GetCoordinatesFunction p_getCoordinates, const void *p_context) noexcept;
+
+	// Do a limited amount of the optimisation, returning true when it has finished. The result may be longer than the original order.
+	bool Optimise() noexcept;
+
+	float GetOriginalLength() const noexcept { return originalLength; }	// the path length when StartOptimising was called
+	float GetCurrentLength() const noexcept { return GetPathLength(startX, startY, getCoordinates, context); }
+
+private:
+	enum class Phase : uint8_t { nearestNeighbour, twoOpt, finished };
+
+	static constexpr size_t MaxPoints = MaxGridProbePoints;
+	static constexpr uint32_t MaxTwoOptChecks = 100000;						// limits the total time taken to optimise a large grid
+	static constexpr uint32_t MaxChecksPerCall = 2000;						// limits the time taken by each call to Optimise
+
+	uint16_t points[MaxPoints];
+	size_t numPoints;
+
+	// Optimisation state
+	GetCoordinatesFunction getCoordinates;
+	const void *context;
+	float startX, startY;
+	float originalLength;
+	float lastX, lastY;														// the end of the nearest neighbour path so far
+	size_t nextIndex;														// the next point to place, or the next first point of a 2-opt reversal
+	uint32_t twoOptChecksDone;
+	Phase phase;
+	bool improved;															// true if a 2-opt move has been made in this pass
+};
+
+#endif /* SRC_MOVEMENT_BEDPROBING_PROBEPATHOPTIMISER_H_ */
@@ -1181,6 +1181,9 @@ inline void DDA::AdjustAcceleration() noexcept
 // This must not be called with interrupts disabled, because it calls Platform::EnableDrive.
 void DDA::Prepare(uint8_t simMode, float extrusionPending[]) noexcept
 {
+	whenPrepared = StepTimer::GetTimerTicks();
+	flags.startedLate = false;
+
 	if (   flags.xyMoving
 		&& reprap.GetMove().IsDRCenabled()
 		&& topSpeed > startSpeed && topSpeed > endSpeed
@@ -1766,6 +1769,7 @@ pre(state == frozen)
 	if ((int32_t)(tim - afterPrepare.moveStartTime ) > 25)
 	{
 		afterPrepare.moveStartTime = tim;			// this move is late starting, so record the actual start time
+		flags.startedLate = true;
 	}
 	state = executing;
 
@@ -2073,6 +2077,50 @@ int32_t DDA::GetStepsTaken(size_t drive) const noexcept
 	return (dmp != nullptr) ? dmp->GetNetStepsTaken() : 0;
 }
 
+// Get the Cartesian XY position at the specified step clock time while this move is executing, returning false if we can't calculate it.
+// We calculate the distance moved from the planned speed profile, so the result isn't valid if the move has been slowed down because an endstop or Z probe is near to triggering.
+// Times before the start of the move give the start position.
+bool DDA::GetXYPositionAt(uint32_t when, float& x, float& y) const noexcept
+{
+	if (state != executing || !flags.xyMoving || flags.goingSlow)
+	{
+		return false;
+	}
+
+	const int32_t clocksMoving = (int32_t)(when - afterPrepare.moveStartTime);
+	float distanceMoved;
+	if (clocksMoving <= 0)
+	{
+		distanceMoved = 0.0;
+	}
+	else if ((uint32_t)clocksMoving >= clocksNeeded)
+	{
+		distanceMoved = totalDistance;
+	}
+	else
+	{
+		const float timeMoving = (float)clocksMoving * (1.0/(float)StepTimer::StepClockRate);
+		const float accelTime = (topSpeed - startSpeed)/acceleration;
+		if (timeMoving < accelTime)
+		{
+			distanceMoved = (startSpeed + 0.5 * acceleration * timeMoving) * timeMoving;
+		}
+		else
+		{
+			const float timeLeft = (float)(clocksNeeded - (uint32_t)clocksMoving) * (1.0/(float)StepTimer::StepClockRate);
+			const float decelTime = (topSpeed - endSpeed)/deceleration;
+			distanceMoved = (timeLeft < decelTime)
+							? totalDistance - (endSpeed + 0.5 * deceleration * timeLeft) * timeLeft
+								: 0.5 * (startSpeed + topSpeed) * accelTime + topSpeed * (timeMoving - accelTime);
+		}
+	}
+
+	const float distanceLeft = totalDistance - distanceMoved;
+	x = endCoordinates[X_AXIS] - directionVector[X_AXIS] * distanceLeft;
+	y = endCoordinates[Y_AXIS] - directionVector[Y_AXIS] * distanceLeft;
+	return true;
+}
+
 void DDA::LimitSpeedAndAcceleration(float maxSpeed, float maxAcceleration) noexcept
 {
 	if (requestedSpeed > maxSpeed)
@@ -2091,6 +2139,40 @@ void DDA::LimitSpeedAndAcceleration(float maxSpeed, float maxAcceleration) noexc
 
 #if SUPPORT_CAN_EXPANSION
 
+// Return the logical drives that Prepare may send movement messages for, so that the caller can check that there are enough CAN buffers for the boards concerned.
+// This may include drives that turn out not to need a message, but it must not leave out any that do.
+DriversBitmap DDA::GetDrivesToPrepare() const noexcept
+{
+	DriversBitmap drives;
+	if (flags.isLeadscrewAdjustmentMove)
+	{
+		drives.SetBit(Z_AXIS);
+		return drives;
+	}
+
+	const Kinematics& kin = reprap.GetMove().GetKinematics();
+	const size_t numTotalAxes = reprap.GetGCodes().GetTotalAxes();
+	for (size_t drive = 0; drive < MaxAxesPlusExtruders; ++drive)
+	{
+		if (drive < numTotalAxes)
+		{
+			if (   endPoint[drive] != prev->endPoint[drive]
+				|| (flags.isDeltaMovement && kin.GetMotionType(drive) == MotionType::segmentFreeDelta)
+			   )
+			{
+				// Prepare also enables the motors of any connected axes
+				drives.SetBit(drive);
+				kin.GetConnectedAxes(drive).Iterate([&drives](unsigned int axis, unsigned int) noexcept { drives.SetBit(axis); });
+			}
+		}
+		else if (directionVector[drive] != 0.0)
+		{
+			drives.SetBit(drive);
+		}
+	}
+	return drives;
+}
+
 // Prepare a remote extruder, returning the number of steps we are going to do before allowing for pressure advance.
 // This replicates some of the functionality that DriveMovement::PrepareExtruder does for local extruder drives.
 int32_t DDA::PrepareRemoteExtruder(size_t drive, float& extrusionPending, float speedChange) const noexcept
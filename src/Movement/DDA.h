@@ -59,6 +59,8 @@ public:
 	bool IsPrintingMove() const noexcept { return flags.isPrintingMove; }			// Return true if this involves both XY movement and extrusion
 	bool UsingStandardFeedrate() const noexcept { return flags.usingStandardFeedrate; }
 	bool IsCheckingEndstops() const noexcept { return flags.checkEndstops; }
+	bool HadLookaheadUnderrun() const noexcept { return flags.hadLookaheadUnderrun; }
+	bool StartedLate() const noexcept { return flags.startedLate; }
 
 	DDAState GetState() const noexcept { return state; }
 	DDA* GetNext() const noexcept { return next; }
@@ -67,6 +69,7 @@ public:
 
 #if SUPPORT_CAN_EXPANSION
 	uint32_t InsertHiccup(uint32_t now) noexcept;
+	DriversBitmap GetDrivesToPrepare() const noexcept;								// Get the logical drives that Prepare may send movement messages for
 #else
 	void InsertHiccup(uint32_t now) noexcept;
 #endif
@@ -79,6 +82,8 @@ public:
 	FilePosition GetFilePosition() const noexcept { return filePos; }
 	float GetRequestedSpeed() const noexcept { return requestedSpeed; }
 	float GetTopSpeed() const noexcept { return topSpeed; }
+	float GetStartSpeed() const noexcept { return startSpeed; }
+	float GetEndSpeed() const noexcept { return endSpeed; }
 	float GetAcceleration() const noexcept { return acceleration; }
 	float GetDeceleration() const noexcept { return deceleration; }
 	float GetVirtualExtruderPosition() const noexcept { return virtualExtruderPosition; }
@@ -90,6 +95,9 @@ public:
 	// Filament monitor support
 	int32_t GetStepsTaken(size_t drive) const noexcept;
 
+	// Z probe scanning support
+	bool GetXYPositionAt(uint32_t when, float& x, float& y) const noexcept;
+
 	float GetProportionDone(bool moveWasAborted) const noexcept;					// Return the proportion of extrusion for the complete multi-segment move already done
 	float GetInitialUserX() const noexcept { return initialUserX; }
 	float GetInitialUserY() const noexcept { return initialUserY; }
@@ -109,10 +117,11 @@ public:
 #endif
 
 #if SUPPORT_IOBITS
-	uint32_t GetMoveStartTime() const noexcept { return afterPrepare.moveStartTime; }
 	IoBits_t GetIoBits() const noexcept { return laserPwmOrIoBits.ioBits; }
 #endif
 
+	uint32_t GetMoveStartTime() const noexcept { return afterPrepare.moveStartTime; }
+	uint32_t GetWhenPrepared() const noexcept { return whenPrepared; }
 	uint32_t GetMoveFinishTime() const noexcept { return afterPrepare.moveStartTime + clocksNeeded; }
 
 #if HAS_SMART_DRIVERS
@@ -217,7 +226,8 @@ private:
 					 continuousRotationShortcut : 1, // True if continuous rotation axes take shortcuts
 					 checkEndstops : 1,				// True if this move monitors endstops or Z probe
 					 controlLaser : 1,				// True if this move controls the laser or iobits
-					 reduceAcceleration : 1;		// True if we should use low acceleration for this move
+					 reduceAcceleration : 1,		// True if we should use low acceleration for this move
+					 startedLate : 1;				// True if this move wasn't prepared in time so it started later than planned
 		};
 		uint16_t all;								// so that we can print all the flags at once for debugging
 	} flags;
@@ -247,6 +257,7 @@ private:
 	float proportionDone;							// what proportion of the extrusion in the G1 or G0 move of which this is a part has been done after this segment is complete
 	float initialUserX, initialUserY;				// if this is a segment of an arc move, the user X and Y coordinates at the start
 	uint32_t clocksNeeded;
+	uint32_t whenPrepared;							// the step clock time at which Prepare was called, for the move trace
 
 	union
 	{
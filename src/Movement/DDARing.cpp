@@ -8,13 +8,20 @@
 #include "DDARing.h"
 #include "RepRap.h"
 #include "Move.h"
+#include "MoveTrace.h"
+#include "StepTimingStats.h"
 
 #if SUPPORT_CAN_EXPANSION
 # include "CAN/CanMotion.h"
 #endif
 
-constexpr uint32_t UsualMinimumPreparedTime = StepTimer::StepClockRate/10;			// 100ms
-constexpr uint32_t AbsoluteMinimumPreparedTime = StepTimer::StepClockRate/20;		// 50ms
+constexpr uint32_t DefaultMinimumPreparedTime = StepTimer::StepClockRate/10;		// 100ms
+constexpr uint32_t DefaultLookaheadTime = StepTimer::StepClockRate/2;				// 500ms
+constexpr uint32_t MaxMinimumPreparedTime = 1000;									// maximum value of M595 R parameter in milliseconds
+constexpr uint32_t MaxLookaheadTime = 5000;											// maximum value of M595 L parameter in milliseconds
+
+DDA *DDARing::freeDdas = nullptr;
+unsigned int DDARing::numFreeDdas = 0;
 
 DDARing::DDARing() noexcept : scheduledMoves(0), completedMoves(0), numHiccups(0)
 {
@@ -24,6 +31,8 @@ DDARing::DDARing() noexcept : scheduledMoves(0), completedMoves(0), numHiccups(0
 void DDARing::Init1(unsigned int numDdas) noexcept
 {
 	numDdasInRing = numDdas;
+	minimumPreparedTime = DefaultMinimumPreparedTime;
+	lookaheadTime = DefaultLookaheadTime;
 
 	// Build the DDA ring
 	DDA *dda = new DDA(nullptr);
@@ -47,7 +56,8 @@ void DDARing::Init1(unsigned int numDdas) noexcept
 void DDARing::Init2() noexcept
 {
 	stepErrors = 0;
-	numLookaheadUnderruns = numPrepareUnderruns = numLookaheadErrors = 0;
+	numLookaheadUnderruns = numPrepareUnderruns = numLookaheadErrors = numRingFull = 0;
+	ringWasFull = false;
 
 	// Put the origin on the lookahead ring with default velocity in the previous position to the first one that will be used.
 	// Do this by calling SetLiveCoordinates and SetPositions, so that the motor coordinates will be correct too even on a delta.
@@ -90,6 +100,118 @@ void DDARing::Exit() noexcept
 	}
 }
 
+// Process M595. If the P or S parameter is present then movement must be locked and the machine at standstill when this is called.
+GCodeResult DDARing::ConfigureMovementQueue(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException)
+{
+	bool seen = false;
+	uint32_t val;
+	if (gb.TryGetLimitedUIValue('R', val, seen, MaxMinimumPreparedTime + 1))
+	{
+		minimumPreparedTime = max<uint32_t>(val, 10) * (StepTimer::StepClockRate/1000);
+	}
+	if (gb.TryGetLimitedUIValue('L', val, seen, MaxLookaheadTime + 1))
+	{
+		lookaheadTime = max<uint32_t>(val, 10) * (StepTimer::StepClockRate/1000);
+	}
+	if (gb.TryGetLimitedUIValue('T', val, seen, MoveTrace::MaxEntries + 1))
+	{
+		MoveTrace::Configure(val);
+	}
+#if HAS_MASS_STORAGE
+	if (gb.Seen('F'))
+	{
+		String<MaxFilenameLength> traceFileName;
+		gb.GetQuotedString(traceFileName.GetRef());
+		return MoveTrace::WriteToFile(traceFileName.c_str(), reply);
+	}
+#endif
+
+	bool seenSize = false;
+	uint32_t numDdasWanted = numDdasInRing;
+	uint32_t numDmsWanted = DriveMovement::NumCreated();
+	gb.TryGetLimitedUIValue('P', numDdasWanted, seenSize, MaxDdaRingLength + 1);
+	gb.TryGetLimitedUIValue('S', numDmsWanted, seenSize, MaxDms + 1);
+	if (seenSize)
+	{
+		if (numDdasWanted < MinDdaRingLength)
+		{
+			reply.printf("Movement queue length must be at least %u", MinDdaRingLength);
+			return GCodeResult::error;
+		}
+
+		RecycleDDAs();
+		if (!IsIdle() || getPointer != addPointer || checkPointer != addPointer)
+		{
+			reply.copy("Movement queue is not empty");
+			return GCodeResult::error;
+		}
+
+		ResizeRing(numDdasWanted);
+		if (numDmsWanted > DriveMovement::NumCreated())
+		{
+			DriveMovement::InitialAllocate(numDmsWanted - DriveMovement::NumCreated());		// DMs are never deleted, so we can only add more
+		}
+	}
+	else if (!seen)
+	{
+		reply.printf("Movement queue length %u (%u spare), DMs %u of which %d free, prepare ahead %" PRIu32 "ms, lookahead %" PRIu32 "ms, trace ",
+						numDdasInRing, numFreeDdas, DriveMovement::NumCreated(), DriveMovement::NumFree(),
+						minimumPreparedTime/(StepTimer::StepClockRate/1000), lookaheadTime/(StepTimer::StepClockRate/1000));
+		if (MoveTrace::IsEnabled())
+		{
+			reply.catf("%u entries", MoveTrace::GetNumEntries());
+		}
+		else
+		{
+			reply.cat("disabled");
+		}
+	}
+	return GCodeResult::ok;
+}
+
+// Change the number of DDAs in the ring. The ring must be empty and numDdas must be at least MinDdaRingLength.
+// We keep the DDA before addPointer in the ring because it holds the current machine position.
+// DDAs that we remove are put in a pool so that we can reuse them if the ring is enlarged again, because we never free memory once it has been allocated.
+void DDARing::ResizeRing(unsigned int numDdas) noexcept
+{
+	while (numDdasInRing < numDdas)
+	{
+		DDA * const newDda = AllocateDda();
+		DDA * const nextDda = addPointer->GetNext();
+		newDda->SetNext(nextDda);
+		newDda->SetPrevious(addPointer);
+		nextDda->SetPrevious(newDda);
+		addPointer->SetNext(newDda);
+		++numDdasInRing;
+	}
+
+	while (numDdasInRing > numDdas)
+	{
+		DDA * const oldDda = addPointer->GetNext();		// this can't be addPointer->GetPrevious() because we always leave at least MinDdaRingLength DDAs in the ring
+		DDA * const nextDda = oldDda->GetNext();
+		addPointer->SetNext(nextDda);
+		nextDda->SetPrevious(addPointer);
+		oldDda->SetNext(freeDdas);
+		oldDda->SetPrevious(nullptr);
+		freeDdas = oldDda;
+		++numFreeDdas;
+		--numDdasInRing;
+	}
+}
+
+// Get a DDA from the pool if there is one, else create a new one
+/*static*/ DDA *DDARing::AllocateDda() noexcept
+{
+	DDA * const dda = freeDdas;
+	if (dda != nullptr)
+	{
+		freeDdas = dda->GetNext();
+		--numFreeDdas;
+		return dda;
+	}
+	return new DDA(nullptr);
+}
+
 void DDARing::RecycleDDAs() noexcept
 {
 	// Recycle the DDAs for completed moves, checking for DDA errors to print if Move debug is enabled
@@ -115,14 +237,31 @@ void DDARing::RecycleDDAs() noexcept
 	}
 }
 
+// Return true if there is no DDA free to add a move to
+bool DDARing::IsFull() const noexcept
+{
+	return addPointer->GetState() != DDA::empty
+		|| addPointer->GetNext()->GetState() == DDA::provisional;		// function Prepare needs to access the endpoints in the previous move, so don't change them
+}
+
+// Count the number of times that we found the ring full, counting each run of consecutive checks only once
+void DDARing::CountRingFull() noexcept
+{
+	const bool full = IsFull();
+	if (full && !ringWasFull)
+	{
+		++numRingFull;
+	}
+	ringWasFull = full;
+}
+
 bool DDARing::CanAddMove() const noexcept
 {
-	 if (   addPointer->GetState() == DDA::empty
-		 && addPointer->GetNext()->GetState() != DDA::provisional		// function Prepare needs to access the endpoints in the previous move, so don't change them
-		)
+	 if (!IsFull())
 	 {
-			// In order to react faster to speed and extrusion rate changes, only add more moves if the total duration of
-			// all un-frozen moves is less than 2 seconds, or the total duration of all but the first un-frozen move is less than 0.5 seconds.
+			// In order to react faster to speed and extrusion rate changes, only add more moves if the total duration of all but the first
+			// un-frozen move is less than the lookahead time (default 0.5 seconds), or the total duration of all un-frozen moves is less than
+			// 4 times the lookahead time. So the lookahead window is defined by time rather than by the number of moves, subject to the ring length.
 			const DDA *dda = addPointer;
 			uint32_t unPreparedTime = 0;
 			uint32_t prevMoveTime = 0;
@@ -137,8 +276,9 @@ bool DDARing::CanAddMove() const noexcept
 				prevMoveTime = dda->GetClocksNeeded();
 			}
 
-			return (unPreparedTime < StepTimer::StepClockRate/2 || unPreparedTime + prevMoveTime < 2 * StepTimer::StepClockRate);
+			return (unPreparedTime < lookaheadTime || unPreparedTime + prevMoveTime < 4 * lookaheadTime);
 	 }
+
 	 return false;
 }
 
@@ -192,6 +332,7 @@ void DDARing::Spin(uint8_t simulationMode, bool shouldStartMove) noexcept
 		if (cdda != nullptr)
 		{
 			simulationTime += (float)cdda->GetClocksNeeded()/StepTimer::StepClockRate;
+			currentMoveStartTime = cdda->GetMoveStartTime();			// so that the move trace shows the planned time
 			cdda->Complete();
 			CurrentMoveCompleted();
 		}
@@ -277,11 +418,11 @@ void DDARing::PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, unsig
 	// Try to avoid preparing deceleration-only moves too early
 	while (	  firstUnpreparedMove->GetState() == DDA::provisional
 		   && DriveMovement::NumFree() >= (int)MaxAxesPlusExtruders	// check that we won't run out of DMs
-		   && moveTimeLeft < (int32_t)UsualMinimumPreparedTime		// prepare moves one eighth of a second ahead of when they will be needed
+		   && moveTimeLeft < (int32_t)minimumPreparedTime			// prepare moves some time ahead of when they will be needed (default 100ms)
 		   && alreadyPrepared * 2 < numDdasInRing					// but don't prepare more than half the ring
-		   && (firstUnpreparedMove->IsGoodToPrepare() || moveTimeLeft < (int32_t)AbsoluteMinimumPreparedTime)
+		   && (firstUnpreparedMove->IsGoodToPrepare() || moveTimeLeft < (int32_t)(minimumPreparedTime/2))
 #if SUPPORT_CAN_EXPANSION
-		   && CanMotion::CanPrepareMove()
+		   && CanMotion::CanPrepareMove(*firstUnpreparedMove)
 #endif
 		  )
 	{
@@ -341,10 +482,12 @@ void DDARing::Interrupt(Platform& p) noexcept
 	DDA* cdda = currentDda;								// capture volatile variable
 	if (cdda != nullptr)
 	{
+		uint32_t stepCalls = 0;
 		for (;;)
 		{
 			// Generate a step for the current move
 			cdda->StepDrivers(p);						// check endstops if necessary and step the drivers
+			++stepCalls;
 			if (cdda->GetState() == DDA::completed)
 			{
 				OnMoveCompleted(cdda, p);
@@ -368,6 +511,8 @@ void DDARing::Interrupt(Platform& p) noexcept
 			{
 				// Force a break by updating the move start time.
 				++numHiccups;
+				++StepTimingStats::numOverruns;
+				StepTimingStats::stepsPerIsr.Add(stepCalls);
 #if SUPPORT_CAN_EXPANSION
 				uint32_t cumulativeHiccupTime = 0;
 #endif
@@ -389,6 +534,7 @@ void DDARing::Interrupt(Platform& p) noexcept
 				}
 			}
 		}
+		StepTimingStats::stepsPerIsr.Add(stepCalls);
 	}
 }
 
@@ -411,6 +557,8 @@ void DDARing::OnMoveCompleted(DDA *cdda, Platform& p) noexcept
 // This is called from the step ISR when the current move has been completed
 void DDARing::CurrentMoveCompleted() noexcept
 {
+	MoveTrace::RecordCompletedMove(*currentDda, currentMoveStartTime);
+
 	// Save the current motor coordinates, and the machine Cartesian coordinates if known
 	liveCoordinatesValid = currentDda->FetchEndPosition(const_cast<int32_t*>(liveEndPoints), const_cast<float *>(liveCoordinates));
 	liveCoordinatesChanged = true;
@@ -771,10 +919,11 @@ void DDARing::Diagnostics(MessageType mtype, const char *prefix) noexcept
 {
 	const DDA * const cdda = currentDda;
 	reprap.GetPlatform().MessageF(mtype,
-									"=== %sDDARing ===\nScheduled moves: %" PRIu32 ", completed moves: %" PRIu32 ", StepErrors: %u, LaErrors: %u, Underruns: %u, %u  CDDA state: %d\n",
+									"=== %sDDARing ===\nScheduled moves: %" PRIu32 ", completed moves: %" PRIu32 ", StepErrors: %u, LaErrors: %u, Underruns: %u, %u  CDDA state: %d\n"
+									"Queue length: %u, times full: %u\n",
 									prefix, scheduledMoves, completedMoves, stepErrors, numLookaheadErrors, numLookaheadUnderruns, numPrepareUnderruns,
-									(cdda == nullptr) ? -1 : (int)cdda->GetState());
-	stepErrors = numLookaheadUnderruns = numPrepareUnderruns = numLookaheadErrors = 0;
+									(cdda == nullptr) ? -1 : (int)cdda->GetState(), numDdasInRing, numRingFull);
+	stepErrors = numLookaheadUnderruns = numPrepareUnderruns = numLookaheadErrors = numRingFull = 0;
 }
 
 #if SUPPORT_LASER
@@ -20,9 +20,11 @@ public:
 	void Init1(unsigned int numDdas) noexcept;
 	void Init2() noexcept;
 	void Exit() noexcept;
+	GCodeResult ConfigureMovementQueue(GCodeBuffer& gb, const StringRef& reply) THROWS(GCodeException);	// process M595
 
 	void RecycleDDAs() noexcept;
 	bool CanAddMove() const noexcept;
+	void CountRingFull() noexcept;												// Update the count of times the ring was found full
 	bool AddStandardMove(const RawMove &nextMove, bool doMotorMapping) noexcept __attribute__ ((hot));	// Set up a new move, returning true if it represents real movement
 	bool AddSpecialMove(float feedRate, const float coords[MaxDriversPerAxis]) noexcept;
 #if SUPPORT_ASYNC_MOVES
@@ -86,9 +88,15 @@ public:
 private:
 	bool StartNextMove(Platform& p, uint32_t startTime) noexcept __attribute__ ((hot));	// Start the next move, returning true if laser or IObits need to be controlled
 	void PrepareMoves(DDA *firstUnpreparedMove, int32_t moveTimeLeft, unsigned int alreadyPrepared, uint8_t simulationMode) noexcept;
+	bool IsFull() const noexcept;
+	void ResizeRing(unsigned int numDdas) noexcept;									// Change the number of DDAs in the ring, which must be empty
 
+	static DDA *AllocateDda() noexcept;													// Get a DDA from the pool, or create a new one
 	static void TimerCallback(CallbackParameter p) noexcept;
 
+	static DDA *freeDdas;														// Pool of DDAs that have been removed from a ring, linked through their 'next' fields
+	static unsigned int numFreeDdas;											// How many DDAs there are in the pool
+
 	DDA* volatile currentDda;
 	DDA* addPointer;
 	DDA* volatile getPointer;
@@ -100,6 +108,11 @@ private:
 	volatile int32_t liveEndPoints[MaxAxesPlusExtruders];						// The XYZ endpoints of the last completed move in motor coordinates
 
 	unsigned int numDdasInRing;
+	uint32_t minimumPreparedTime;												// How far ahead we prepare moves, in step clocks
+	uint32_t lookaheadTime;														// The minimum duration of un-prepared moves that we try to keep for lookahead, in step clocks
+	uint32_t currentMoveStartTime;												// When the current move started, for the move trace
+	unsigned int numRingFull;													// How many times we had to stop adding moves because the ring was full
+	bool ringWasFull;															// True if the ring was full last time we checked
 
 	uint32_t scheduledMoves;													// Move counters for the code queue
 	volatile uint32_t completedMoves;											// This one is modified by an ISR, hence volatile
@@ -137,6 +150,7 @@ pre(ddaRingGetPointer->GetState() == DDA::frozen)
 	}
 	currentDda = cdda;
 	cdda->Start(p, startTime);
+	currentMoveStartTime = cdda->GetMoveStartTime();
 #if SUPPORT_LASER || SUPPORT_IOBITS
 	return cdda->ControlLaser();
 #else
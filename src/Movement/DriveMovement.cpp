@@ -18,6 +18,7 @@
 DriveMovement *DriveMovement::freeList = nullptr;
 int DriveMovement::numFree = 0;
 int DriveMovement::minFree = 0;
+unsigned int DriveMovement::numCreated = 0;
 
 void DriveMovement::InitialAllocate(unsigned int num) noexcept
 {
@@ -25,6 +26,7 @@ void DriveMovement::InitialAllocate(unsigned int num) noexcept
 	{
 		freeList = new DriveMovement(freeList);
 		++numFree;
+		++numCreated;
 		--num;
 	}
 	ResetMinFree();
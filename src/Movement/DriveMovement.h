@@ -155,6 +155,7 @@ public:
 	static void InitialAllocate(unsigned int num) noexcept;
 	static int NumFree() noexcept { return numFree; }
 	static int MinFree() noexcept { return minFree; }
+	static unsigned int NumCreated() noexcept { return numCreated; }
 	static void ResetMinFree() noexcept { minFree = numFree; }
 	static DriveMovement *Allocate(size_t drive, DMState st) noexcept;
 	static void Release(DriveMovement *item) noexcept;
@@ -166,6 +167,7 @@ private:
 	static DriveMovement *freeList;
 	static int numFree;
 	static int minFree;
+	static unsigned int numCreated;
 
 	// Parameters common to Cartesian, delta and extruder moves
 
@@ -39,6 +39,7 @@
 #include "GCodes/GCodeBuffer/GCodeBuffer.h"
 #include "Tools/Tool.h"
 #include "Endstops/ZProbe.h"
+#include "StepTimingStats.h"
 #include <TaskPriorities.h>
 
 #if SUPPORT_IOBITS
@@ -73,6 +74,30 @@ static constexpr ObjectModelArrayDescriptor extrudersArrayDescriptor =
 	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(&reprap.GetPlatform(), 4); }
 };
 
+static constexpr ObjectModelArrayDescriptor isrTimeArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t { return TimingHistogram::NumBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue
+		{ return ExpressionValue((int32_t)StepTimingStats::isrCycles.GetCount(context.GetLastIndex())); }
+};
+
+static constexpr ObjectModelArrayDescriptor latenessArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t { return TimingHistogram::NumBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue
+		{ return ExpressionValue((int32_t)StepTimingStats::lateness.GetCount(context.GetLastIndex())); }
+};
+
+static constexpr ObjectModelArrayDescriptor stepsPerIsrArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext&) noexcept -> size_t { return TimingHistogram::NumBuckets; },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue
+		{ return ExpressionValue((int32_t)StepTimingStats::stepsPerIsr.GetCount(context.GetLastIndex())); }
+};
+
 constexpr ObjectModelTableEntry Move::objectModelTable[] =
 {
 	// Within each group, these entries must be in alphabetical order
@@ -87,6 +112,7 @@ constexpr ObjectModelTableEntry Move::objectModelTable[] =
 	{ "kinematics",				OBJECT_MODEL_FUNC(self->kinematics),													ObjectModelEntryFlags::none },
 	{ "printingAcceleration",	OBJECT_MODEL_FUNC(self->maxPrintingAcceleration, 1),									ObjectModelEntryFlags::none },
 	{ "speedFactor",			OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().GetSpeedFactor(), 2),						ObjectModelEntryFlags::none },
+	{ "stepTiming",				OBJECT_MODEL_FUNC(self, 10),															ObjectModelEntryFlags::live },
 	{ "travelAcceleration",		OBJECT_MODEL_FUNC(self->maxTravelAcceleration, 1),										ObjectModelEntryFlags::none },
 	{ "virtualEPos",			OBJECT_MODEL_FUNC_NOSELF(reprap.GetGCodes().GetVirtualExtruderPosition(), 5),			ObjectModelEntryFlags::live },
 	{ "workspaceNumber",		OBJECT_MODEL_FUNC_NOSELF((int32_t)reprap.GetGCodes().GetWorkplaceCoordinateSystemNumber()),	ObjectModelEntryFlags::none },
@@ -141,9 +167,18 @@ constexpr ObjectModelTableEntry Move::objectModelTable[] =
 	{ "tanXY",					OBJECT_MODEL_FUNC(self->tanXY, 4),														ObjectModelEntryFlags::none },
 	{ "tanXZ",					OBJECT_MODEL_FUNC(self->tanXZ, 4),														ObjectModelEntryFlags::none },
 	{ "tanYZ",					OBJECT_MODEL_FUNC(self->tanYZ, 4),														ObjectModelEntryFlags::none },
+
+	// 10. move.stepTiming members. The histograms have logarithmic buckets, see class TimingHistogram.
+	{ "isrTime",				OBJECT_MODEL_FUNC_NOSELF(&isrTimeArrayDescriptor),										ObjectModelEntryFlags::live },
+	{ "lateness",				OBJECT_MODEL_FUNC_NOSELF(&latenessArrayDescriptor),										ObjectModelEntryFlags::live },
+	{ "maxIsrTime",				OBJECT_MODEL_FUNC_NOSELF((int32_t)StepTimingStats::CyclesToMicroseconds(StepTimingStats::isrCycles.GetMax())),	ObjectModelEntryFlags::live },
+	{ "maxLateness",			OBJECT_MODEL_FUNC_NOSELF((int32_t)StepTimingStats::lateness.GetMax()),					ObjectModelEntryFlags::live },
+	{ "maxStepsPerIsr",			OBJECT_MODEL_FUNC_NOSELF((int32_t)StepTimingStats::stepsPerIsr.GetMax()),				ObjectModelEntryFlags::live },
+	{ "overruns",				OBJECT_MODEL_FUNC_NOSELF((int32_t)StepTimingStats::numOverruns),						ObjectModelEntryFlags::live },
+	{ "stepsPerIsr",			OBJECT_MODEL_FUNC_NOSELF(&stepsPerIsrArrayDescriptor),									ObjectModelEntryFlags::live },
 };
 
-constexpr uint8_t Move::objectModelTableDescriptor[] = { 10, 13, 3, 2, 4 + SUPPORT_LASER, 3, 2, 2, 5 + (HAS_MASS_STORAGE || HAS_LINUX_INTERFACE), 2, 3 };
+constexpr uint8_t Move::objectModelTableDescriptor[] = { 11, 14, 3, 2, 4 + SUPPORT_LASER, 3, 2, 2, 5 + (HAS_MASS_STORAGE || HAS_LINUX_INTERFACE), 2, 3, 7 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Move)
 
@@ -232,6 +267,7 @@ void Move::Spin() noexcept
 #endif
 
 	// See if we can add another move to the ring
+	mainDDARing.CountRingFull();
 	bool canAddMove = (
 #if SUPPORT_ROLAND
 						  !reprap.GetRoland()->Active() &&
@@ -421,6 +457,7 @@ void Move::Diagnostics(MessageType mtype) noexcept
 						DriveMovement::NumFree(), DriveMovement::MinFree(), longestGcodeWaitInterval);
 	longestGcodeWaitInterval = 0;
 	DriveMovement::ResetMinFree();
+	StepTimingStats::Diagnostics(mtype);
 
 #if defined(__ALLIGATOR__)
 	// Motor Fault Diagnostic
@@ -431,7 +468,7 @@ void Move::Diagnostics(MessageType mtype) noexcept
 	String<StringLength50> bedCompString;
 	if (usingMesh)
 	{
-		bedCompString.copy("mesh");
+		bedCompString.copy((heightMap.UsingBicubicInterpolation()) ? "mesh (bicubic)" : "mesh");
 	}
 	else if (probePoints.GetNumBedCompensationPoints() != 0)
 	{
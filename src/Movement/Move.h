@@ -30,23 +30,31 @@
 #if SAME70
 
 constexpr unsigned int DdaRingLength = 60;
+constexpr unsigned int MaxDdaRingLength = 200;
 constexpr unsigned int AuxDdaRingLength = 5;
 constexpr unsigned int NumDms = (DdaRingLength/2 * 12) + (AuxDdaRingLength * 3);	// allow enough for plenty of CAN expansion
+constexpr unsigned int MaxDms = 2 * NumDms;										// upper limit on DMs that M595 may create
 
 #elif SAM4E || SAM4S
 
 constexpr unsigned int DdaRingLength = 40;
+constexpr unsigned int MaxDdaRingLength = 100;
 constexpr unsigned int AuxDdaRingLength = 3;
 const unsigned int NumDms = (DdaRingLength/2 * 8) + (AuxDdaRingLength * 3);		// suitable for e.g. a delta + 5 input hot end
+const unsigned int MaxDms = (3 * NumDms)/2;										// upper limit on DMs that M595 may create
 
 #else
 
 // We are more memory-constrained on the SAM3X
 const unsigned int DdaRingLength = 20;
+const unsigned int MaxDdaRingLength = 40;
 const unsigned int NumDms = 20 * 5;												// suitable for e.g. a delta + 2-input hot end
+const unsigned int MaxDms = NumDms + 20;										// there is little spare RAM, so allow only a few more DMs to be created
 
 #endif
 
+constexpr unsigned int MinDdaRingLength = 4;									// the lookahead and DDA recycling code needs a few spare DDAs in the ring
+
 constexpr uint32_t MovementStartDelayClocks = StepTimer::StepClockRate/100;		// 10ms delay between preparing the first move and starting it
 
 // This is the master movement class.  It controls all movement in the machine.
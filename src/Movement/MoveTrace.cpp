@@ -0,0 +1,86 @@
+/*
+ * MoveTrace.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "MoveTrace.h"
+#include "DDA.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+RingLog MoveTrace::trace(sizeof(MoveTrace::Entry));
+
+// Record a move that has just been completed. Called from the step ISR, or from the Move task when simulating.
+/*static*/ void MoveTrace::RecordCompletedMove(const DDA& dda, uint32_t startTime) noexcept
+{
+	if (trace.IsEnabled())
+	{
+		Entry e;
+		e.startTime = startTime;
+		e.plannedClocks = dda.GetClocksNeeded();
+		e.actualClocks = dda.GetMoveFinishTime() - startTime;
+		e.prepareLeadClocks = startTime - dda.GetWhenPrepared();
+		e.requestedSpeed = dda.GetRequestedSpeed();
+		e.startSpeed = dda.GetStartSpeed();
+		e.topSpeed = dda.GetTopSpeed();
+		e.endSpeed = dda.GetEndSpeed();
+		e.distance = dda.GetTotalDistance();
+		e.filePos = dda.GetFilePosition();
+		e.flags = ((dda.HadLookaheadUnderrun()) ? FlagLookaheadUnderrun : 0)
+				| ((dda.StartedLate()) ? FlagStartedLate : 0)
+				| ((dda.IsPrintingMove()) ? FlagPrintingMove : 0)
+				| ((dda.IsCheckingEndstops()) ? FlagCheckingEndstops : 0);
+		e.spare = 0;
+		trace.Add(&e);
+	}
+}
+
+// Print the trace in CSV format, oldest entry first.
+// If more moves complete while we are printing then some of the entries may be overwritten before we print them, in which case we skip them.
+/*static*/ void MoveTrace::Print(MessageType mtype) noexcept
+{
+	Platform& p = reprap.GetPlatform();
+	if (!trace.IsEnabled())
+	{
+		p.Message(mtype, "Move tracing is not enabled, use M595 T to enable it\n");
+		return;
+	}
+
+	const uint32_t total = trace.GetNumRecorded();
+	const uint32_t first = trace.GetOldestSequenceNumber();
+	const unsigned int count = total - first;
+	p.MessageF(mtype, "Move trace, %" PRIu32 " moves recorded, last %u shown\n"
+					  "startTime,plannedClocks,actualClocks,prepareLeadClocks,requestedSpeed,startSpeed,topSpeed,endSpeed,distance,filePos,flags\n",
+					  total, count);
+	Entry e;
+	for (uint32_t seq = first; seq < total; ++seq)
+	{
+		if (!trace.GetEntry(seq, &e))
+		{
+			continue;											// the entry has been overwritten
+		}
+		p.MessageF(mtype, "%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIi32 ",%.1f,%.1f,%.1f,%.1f,%.3f,%" PRIu32 ",%02x\n",
+					e.startTime, e.plannedClocks, e.actualClocks, (int32_t)e.prepareLeadClocks,
+					(double)e.requestedSpeed, (double)e.startSpeed, (double)e.topSpeed, (double)e.endSpeed, (double)e.distance,
+					e.filePos, e.flags);
+	}
+}
+
+#if HAS_MASS_STORAGE
+
+// Save the trace to a file in binary form, oldest entry first. Tracing continues while we do this.
+/*static*/ GCodeResult MoveTrace::WriteToFile(const char *filename, const StringRef& reply) noexcept
+{
+	if (!trace.IsEnabled())
+	{
+		reply.copy("Move tracing is not enabled");
+		return GCodeResult::error;
+	}
+	return trace.WriteToFile(filename, "RRFMTRC", FileVersion, 0, "moves", reply);
+}
+
+#endif
+
+// End
@@ -0,0 +1,68 @@
+/*
+ * MoveTrace.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  This class records the timing and speeds of recently completed moves so that the planner and the lookahead can be analysed.
+ *  The trace buffer is only allocated when tracing is enabled using M595 T. The trace can be printed using M122 P100,
+ *  or saved in binary form using M595 F and then decoded on a PC using the tool in Tools/movetrace.
+ */
+
+#ifndef SRC_MOVEMENT_MOVETRACE_H_
+#define SRC_MOVEMENT_MOVETRACE_H_
+
+#include "RepRapFirmware.h"
+#include "MessageType.h"
+#include "GCodes/GCodeResult.h"
+#include "RingLog.h"
+
+class DDA;
+
+class MoveTrace
+{
+public:
+	static constexpr unsigned int MaxEntries = 1000;
+
+	static void Configure(unsigned int numEntries) noexcept { trace.Configure(numEntries); }	// Set the number of entries, or zero to disable tracing
+	static unsigned int GetNumEntries() noexcept { return trace.GetNumEntries(); }
+	static bool IsEnabled() noexcept { return trace.IsEnabled(); }
+
+	static void RecordCompletedMove(const DDA& dda, uint32_t startTime) noexcept;		// Called from the step ISR when a move completes
+	static void Print(MessageType mtype) noexcept;										// Print the trace in CSV format, oldest first
+#if HAS_MASS_STORAGE
+	static GCodeResult WriteToFile(const char *filename, const StringRef& reply) noexcept;	// Save the trace in binary form
+#endif
+
+	// Bits in the flags field of a trace entry
+	static constexpr uint16_t FlagLookaheadUnderrun = 0x0001;							// the lookahead queue wasn't long enough to optimise this move
+	static constexpr uint16_t FlagStartedLate = 0x0002;									// the move wasn't prepared in time so it started late
+	static constexpr uint16_t FlagPrintingMove = 0x0004;								// the move included both XY movement and extrusion
+	static constexpr uint16_t FlagCheckingEndstops = 0x0008;							// the move was checking endstops or a Z probe
+
+private:
+	// Layout of a trace entry. This is also the format of each record in the binary file, so don't change it without changing the file version.
+	struct Entry
+	{
+		uint32_t startTime;								// when the move started, in step clocks
+		uint32_t plannedClocks;							// how long the move was planned to take
+		uint32_t actualClocks;							// how long the move took, including any hiccups
+		uint32_t prepareLeadClocks;						// how long before the move started it was prepared
+		float requestedSpeed;							// the speed that the user asked for
+		float startSpeed;								// the planned start speed
+		float topSpeed;									// the planned top speed
+		float endSpeed;									// the planned end speed
+		float distance;									// the length of the move
+		uint32_t filePos;								// the file position after the command that generated this move
+		uint16_t flags;									// see the Flag constants above
+		uint16_t spare;
+	};
+	static_assert(sizeof(Entry) == 48 && sizeof(Entry) <= RingLog::MaxEntrySize);
+
+	// The file has the standard RingLog header with magic "RRFMTRC", and the header param field is unused
+	static constexpr uint32_t FileVersion = 1;
+
+	static RingLog trace;
+};
+
+#endif /* SRC_MOVEMENT_MOVETRACE_H_ */
@@ -8,6 +8,7 @@
 #include "StepTimer.h"
 #include <RTOSIface/RTOSIface.h>
 #include "Move.h"
+#include "StepTimingStats.h"
 
 #ifdef __LPC17xx__
 # ifdef LPC_DEBUG
@@ -21,6 +22,8 @@ StepTimer * volatile StepTimer::pendingList = nullptr;
 
 void StepTimer::Init() noexcept
 {
+	StepTimingStats::Init();
+
 	// Timer interrupt for stepper motors
 	// The clock rate we use is a compromise. Too fast and the 64-bit square roots take a long time to execute. Too slow and we lose resolution.
 	// On Duet WiFi/Ethernet, Duet Maestro and legacy Duets we use a clock prescaler of 128 which gives
@@ -166,6 +169,13 @@ void StepTimer::DisableTimerInterrupt() noexcept
 	StepTimer * tmr = pendingList;
 	if (tmr != nullptr)
 	{
+		// Record how late we are. With 16-bit timers the interrupt may occur a multiple of 65536 ticks early, in which case we ignore it.
+		const int32_t howLate = (int32_t)(GetTimerTicks() - tmr->whenDue);
+		if (howLate >= 0)
+		{
+			StepTimingStats::lateness.Add((uint32_t)howLate);
+		}
+
 		for (;;)
 		{
 			StepTimer * const nextTimer = tmr->next;
@@ -213,7 +223,9 @@ void STEP_TC_HANDLER() noexcept
 #ifdef TIMER_DEBUG
 		++numTimerInterruptsExecuted;
 #endif
+		const uint32_t startCycles = StepTimingStats::GetCycleCount();
 		StepTimer::Interrupt();
+		StepTimingStats::isrCycles.Add(StepTimingStats::GetCycleCount() - startCycles);
 	}
 }
 
@@ -0,0 +1,97 @@
+/*
+ * StepTimingStats.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "StepTimingStats.h"
+#include "StepTimer.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+void TimingHistogram::Clear() volatile noexcept
+{
+	for (size_t i = 0; i < NumBuckets; ++i)
+	{
+		counts[i] = 0;
+	}
+	maxValue = 0;
+}
+
+// Append the non-zero bucket counts to a string in the form " <upper limit>:<count>"
+void TimingHistogram::AppendCounts(const StringRef& str) const volatile noexcept
+{
+	bool any = false;
+	for (size_t i = 0; i < NumBuckets; ++i)
+	{
+		const uint32_t count = counts[i];
+		if (count != 0)
+		{
+			if (i + 1 == NumBuckets)
+			{
+				str.catf(" >=%u:%" PRIu32, 1u << (i - 1), count);
+			}
+			else
+			{
+				str.catf(" <%u:%" PRIu32, 1u << i, count);
+			}
+			any = true;
+		}
+	}
+	if (!any)
+	{
+		str.cat(" none");
+	}
+}
+
+namespace StepTimingStats
+{
+	volatile TimingHistogram isrCycles;
+	volatile TimingHistogram lateness;
+	volatile TimingHistogram stepsPerIsr;
+	volatile uint32_t numOverruns = 0;
+
+	void Init() noexcept
+	{
+		// Enable the DWT cycle counter
+		CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+#if SAME70
+		DWT->LAR = 0xC5ACCE55;							// the Cortex M7 requires the DWT to be unlocked before we can write to it
+#endif
+		DWT->CYCCNT = 0;
+		DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+		Clear();
+	}
+
+	void Clear() noexcept
+	{
+		isrCycles.Clear();
+		lateness.Clear();
+		stepsPerIsr.Clear();
+		numOverruns = 0;
+	}
+
+	uint32_t CyclesToMicroseconds(uint32_t cycles) noexcept
+	{
+		return cycles/(SystemCoreClock/1000000);
+	}
+
+	void Diagnostics(MessageType mtype) noexcept
+	{
+		Platform& p = reprap.GetPlatform();
+		String<StringLength256> buf;
+		buf.printf("Step ISR max %" PRIu32 "us, max lateness %" PRIu32 " clocks, max steps/ISR %" PRIu32 ", overruns %" PRIu32 "\nISR cycles:",
+					CyclesToMicroseconds(isrCycles.GetMax()), lateness.GetMax(), stepsPerIsr.GetMax(), numOverruns);
+		isrCycles.AppendCounts(buf.GetRef());
+		p.MessageF(mtype, "%s\n", buf.c_str());
+		buf.copy("Lateness:");
+		lateness.AppendCounts(buf.GetRef());
+		buf.cat("\nSteps/ISR:");
+		stepsPerIsr.AppendCounts(buf.GetRef());
+		p.MessageF(mtype, "%s\n", buf.c_str());
+		Clear();
+	}
+}
+
+// End
@@ -0,0 +1,60 @@
+/*
+ * StepTimingStats.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Histograms of step interrupt timing, used to find out how much timing headroom we have.
+ *  ISR durations are measured in CPU cycles using the DWT cycle counter. Lateness is measured in step clocks.
+ */
+
+#ifndef SRC_MOVEMENT_STEPTIMINGSTATS_H_
+#define SRC_MOVEMENT_STEPTIMINGSTATS_H_
+
+#include "RepRapFirmware.h"
+#include "MessageType.h"
+
+// Histogram with logarithmic buckets. Bucket 0 counts zero values, bucket n (n > 0) counts values in the range 2^(n-1) to 2^n - 1.
+// The last bucket also counts all larger values.
+class TimingHistogram
+{
+public:
+	static constexpr size_t NumBuckets = 16;
+
+	void Clear() volatile noexcept;
+	void Add(uint32_t val) volatile noexcept __attribute__ ((hot));
+	uint32_t GetCount(size_t bucket) const volatile noexcept { return counts[bucket]; }
+	uint32_t GetMax() const volatile noexcept { return maxValue; }
+	void AppendCounts(const StringRef& str) const volatile noexcept;		// append the non-zero bucket counts to a string
+
+private:
+	uint32_t counts[NumBuckets];
+	uint32_t maxValue;
+};
+
+inline void TimingHistogram::Add(uint32_t val) volatile noexcept
+{
+	const size_t bucket = (val == 0) ? 0 : min<size_t>(32 - __builtin_clz(val), NumBuckets - 1);
+	++counts[bucket];
+	if (val > maxValue)
+	{
+		maxValue = val;
+	}
+}
+
+namespace StepTimingStats
+{
+	void Init() noexcept;												// Enable the cycle counter and clear the histograms
+	void Clear() noexcept;
+	void Diagnostics(MessageType mtype) noexcept;						// Report and clear the histograms
+
+	inline uint32_t GetCycleCount() noexcept { return DWT->CYCCNT; }
+	uint32_t CyclesToMicroseconds(uint32_t cycles) noexcept;
+
+	extern volatile TimingHistogram isrCycles;							// duration of each step interrupt in CPU cycles
+	extern volatile TimingHistogram lateness;							// how late each step interrupt was compared with the scheduled time, in step clocks
+	extern volatile TimingHistogram stepsPerIsr;						// how many times DDA::StepDrivers was called by each step interrupt
+	extern volatile uint32_t numOverruns;								// how many times we exceeded MaxStepInterruptTime and had to insert a hiccup
+}
+
+#endif /* SRC_MOVEMENT_STEPTIMINGSTATS_H_ */
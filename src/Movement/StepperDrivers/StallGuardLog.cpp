@@ -0,0 +1,178 @@
+/*
+ * StallGuardLog.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "StallGuardLog.h"
+
+#if HAS_STALL_DETECT
+
+#include "Movement/Move.h"
+#include "Platform.h"
+#include "RepRap.h"
+
+RingLog StallGuardLog::loadLog(sizeof(StallGuardLog::Entry));
+DriversBitmap StallGuardLog::loggedDrivers;
+uint32_t StallGuardLog::sampleInterval = 0;
+uint32_t StallGuardLog::intervalMillis = StallGuardLog::DefaultIntervalMillis;
+uint32_t StallGuardLog::lastSampleTimes[NumDirectDrivers] = { 0 };
+uint32_t StallGuardLog::numSummarised = 0;
+uint32_t StallGuardLog::lastSummaryTime = 0;
+bool StallGuardLog::summariesToEventLog = false;
+
+// Set the drivers to log and the number of entries, or zero entries to disable logging.
+/*static*/ void StallGuardLog::Configure(DriversBitmap drivers, unsigned int num, uint32_t p_intervalMillis) noexcept
+{
+	numSummarised = 0;
+	loggedDrivers = drivers;
+	intervalMillis = p_intervalMillis;
+	sampleInterval = p_intervalMillis * (StepTimer::StepClockRate/1000);
+	loadLog.Configure(num);
+}
+
+// Record a StallGuard reading. Called from the TMC2660 ISR or the TMC51xx task each time the driver status has been read.
+/*static*/ void StallGuardLog::RecordLoad(size_t driver, uint32_t sgResult, uint8_t flags) noexcept
+{
+	const uint32_t now = StepTimer::GetTimerTicks();
+	if (now - lastSampleTimes[driver] < sampleInterval)
+	{
+		return;
+	}
+	lastSampleTimes[driver] = now;
+
+	Entry e;
+	e.time = now;
+	e.sgResult = (uint16_t)sgResult;
+	e.driver = (uint8_t)driver;
+	e.x = e.y = 0.0;
+	const DDA * const dda = reprap.GetMove().GetMainDDARing().GetCurrentDDA();
+	if (dda != nullptr)
+	{
+		e.filePos = dda->GetFilePosition();
+		if (dda->IsCheckingEndstops())
+		{
+			flags |= FlagCheckingEndstops;
+		}
+		if (dda->GetXYPositionAt(now, e.x, e.y))
+		{
+			flags |= FlagPositionValid;
+		}
+	}
+	else
+	{
+		e.filePos = noFilePosition;
+	}
+	e.flags = flags;
+
+	loadLog.Add(&e);
+}
+
+// Write a summary of the readings received since the last summary to the event log, if enabled
+/*static*/ void StallGuardLog::Spin() noexcept
+{
+	if (!summariesToEventLog || !loadLog.IsEnabled() || millis() - lastSummaryTime < SummaryIntervalMillis)
+	{
+		return;
+	}
+	lastSummaryTime = millis();
+
+	const uint32_t total = loadLog.GetNumRecorded();
+	uint32_t seq = max<uint32_t>(numSummarised, loadLog.GetOldestSequenceNumber());		// skip any entries that have been overwritten
+	if (seq == total)
+	{
+		return;
+	}
+
+	struct DriverSummary
+	{
+		uint32_t count, sum;
+		uint16_t minLoad, maxLoad;
+		uint32_t minFilePos;
+	};
+	DriverSummary summaries[NumDirectDrivers];
+	for (DriverSummary& ds : summaries)
+	{
+		ds.count = ds.sum = 0;
+		ds.minLoad = UINT16_MAX;
+		ds.maxLoad = 0;
+		ds.minFilePos = noFilePosition;
+	}
+
+	Entry e;
+	for (; seq < total && loadLog.GetEntry(seq, &e); ++seq)
+	{
+		if ((e.flags & FlagStandstill) == 0 && e.driver < NumDirectDrivers)		// the reading is not a load measurement at standstill
+		{
+			DriverSummary& ds = summaries[e.driver];
+			++ds.count;
+			ds.sum += e.sgResult;
+			if (e.sgResult < ds.minLoad)
+			{
+				ds.minLoad = e.sgResult;
+				ds.minFilePos = e.filePos;
+			}
+			if (e.sgResult > ds.maxLoad)
+			{
+				ds.maxLoad = e.sgResult;
+			}
+		}
+	}
+	numSummarised = total;
+
+	String<FormatStringLength> msg;
+	msg.copy("StallGuard readings (min/mean/max):");
+	bool any = false;
+	for (size_t driver = 0; driver < NumDirectDrivers; ++driver)
+	{
+		const DriverSummary& ds = summaries[driver];
+		if (ds.count != 0)
+		{
+			any = true;
+			msg.catf(" driver %u %u/%" PRIu32 "/%u", (unsigned int)driver, ds.minLoad, ds.sum/ds.count, ds.maxLoad);
+			if (ds.minFilePos != noFilePosition)
+			{
+				msg.catf(" min at %" PRIu32, ds.minFilePos);
+			}
+		}
+	}
+	if (any)
+	{
+		msg.cat('\n');
+		reprap.GetPlatform().Message(LogMessage, msg.c_str());
+	}
+}
+
+/*static*/ void StallGuardLog::AppendStatus(const StringRef& reply) noexcept
+{
+	if (!loadLog.IsEnabled())
+	{
+		reply.lcat("StallGuard load logging is disabled");
+	}
+	else
+	{
+		reply.lcatf("StallGuard load logging %u entries, interval %" PRIu32 "ms, %" PRIu32 " recorded, summaries to event log %s, drivers",
+						loadLog.GetNumEntries(), intervalMillis, loadLog.GetNumRecorded(), (summariesToEventLog) ? "on" : "off");
+		loggedDrivers.Iterate([&reply](unsigned int driver, unsigned int) noexcept { reply.catf(" %u", driver); });
+	}
+}
+
+#if HAS_MASS_STORAGE
+
+// Save the log to a file in binary form, oldest entry first. Logging continues while we do this.
+/*static*/ GCodeResult StallGuardLog::WriteToFile(const char *filename, const StringRef& reply) noexcept
+{
+	if (!loadLog.IsEnabled())
+	{
+		reply.copy("StallGuard load logging is not enabled");
+		return GCodeResult::error;
+	}
+	return loadLog.WriteToFile(filename, "RRFSGLD", FileVersion, intervalMillis, "StallGuard readings", reply);
+}
+
+#endif
+
+#endif
+
+// End
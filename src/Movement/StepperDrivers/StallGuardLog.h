@@ -0,0 +1,84 @@
+/*
+ * StallGuardLog.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  This class records the StallGuard load readings of selected drivers, together with the XY position and file position of the move being executed,
+ *  so that stall detection sensitivity can be tuned and changes in mechanical load can be tracked over time.
+ *  Logging is configured using M915 L, and the buffer is only allocated when logging is enabled. The log can be saved in binary form using M915 K
+ *  and decoded on a PC using the tool in Tools/sgload, and a summary of the readings can be written to the event log once a second.
+ *  Readings are supplied by the TMC2660 and TMC51xx drivers. The TMC22xx drivers that we support don't have StallGuard.
+ */
+
+#ifndef SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_
+#define SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_
+
+#include "RepRapFirmware.h"
+
+#if HAS_STALL_DETECT
+
+#include "GCodes/GCodeResult.h"
+#include "RingLog.h"
+
+class StallGuardLog
+{
+public:
+	// Each entry uses 20 bytes of RAM, so the maximum log size depends on how much RAM the processor has
+#if SAME70
+	static constexpr unsigned int MaxEntries = 2000;
+#elif SAME5x
+	static constexpr unsigned int MaxEntries = 1000;
+#else
+	static constexpr unsigned int MaxEntries = 500;
+#endif
+	static constexpr uint32_t DefaultIntervalMillis = 10;
+
+	static void Configure(DriversBitmap drivers, unsigned int numEntries, uint32_t intervalMillis) noexcept;	// Set the drivers and number of entries, or zero entries to disable logging
+	static void SetSummariesToEventLog(bool on) noexcept { summariesToEventLog = on; }
+	static bool IsEnabled() noexcept { return loadLog.IsEnabled(); }
+	static bool IsLogging(size_t driver) noexcept { return loadLog.IsEnabled() && loggedDrivers.IsBitSet(driver); }
+
+	static void RecordLoad(size_t driver, uint32_t sgResult, uint8_t flags) noexcept;	// Called from the driver ISR or task when DRV_STATUS has been read
+	static void Spin() noexcept;														// Write summaries to the event log if enabled
+	static void AppendStatus(const StringRef& reply) noexcept;
+#if HAS_MASS_STORAGE
+	static GCodeResult WriteToFile(const char *filename, const StringRef& reply) noexcept;	// Save the log in binary form
+#endif
+
+	// Bits in the flags field of a log entry. The caller of RecordLoad provides the driver status flags.
+	static constexpr uint8_t FlagStandstill = 0x01;				// the driver reported standstill
+	static constexpr uint8_t FlagStalled = 0x02;					// the driver reported a stall
+	static constexpr uint8_t FlagPositionValid = 0x04;			// the X and Y fields hold the position of the current move
+	static constexpr uint8_t FlagCheckingEndstops = 0x08;			// the move was checking endstops, e.g. a homing move
+
+private:
+	// Layout of a log entry. This is also the format of each record in the binary file, so don't change it without changing the file version.
+	struct Entry
+	{
+		uint32_t time;									// when the reading was received, in step clocks
+		uint32_t filePos;								// the file position of the command that generated the current move, or noFilePosition
+		float x, y;										// the machine XY position at that time, if FlagPositionValid is set
+		uint16_t sgResult;								// the StallGuard reading, lower values mean higher load
+		uint8_t driver;									// the local driver number
+		uint8_t flags;									// see the Flag constants above
+	};
+	static_assert(sizeof(Entry) == 20 && sizeof(Entry) <= RingLog::MaxEntrySize);
+
+	// The file has the standard RingLog header with magic "RRFSGLD", and the header param field is the minimum interval between readings from each driver
+	static constexpr uint32_t FileVersion = 1;
+	static constexpr uint32_t SummaryIntervalMillis = 1000;
+
+	static RingLog loadLog;
+	static DriversBitmap loggedDrivers;
+	static uint32_t sampleInterval;						// minimum interval between readings from each driver, in step clocks
+	static uint32_t intervalMillis;
+	static uint32_t lastSampleTimes[NumDirectDrivers];
+	static uint32_t numSummarised;						// how many entries we have included in summaries
+	static uint32_t lastSummaryTime;
+	static bool summariesToEventLog;
+};
+
+#endif
+
+#endif /* SRC_MOVEMENT_STEPPERDRIVERS_STALLGUARDLOG_H_ */
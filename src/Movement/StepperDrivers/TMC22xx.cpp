@@ -11,6 +11,8 @@
 #if SUPPORT_TMC22xx
 
 #include "TMC22xx.h"
+#include "TmcRegisterScheduler.h"
+#include "TmcShadowRegisters.h"
 #include "RepRap.h"
 #include "Movement/Move.h"
 #include "Movement/StepTimer.h"
@@ -260,6 +262,8 @@ public:
 
 	bool SetRegister(SmartDriverRegister reg, uint32_t regVal) noexcept;
 	uint32_t GetRegister(SmartDriverRegister reg) const noexcept;
+	bool SetRefreshInterval(unsigned int regIndex, uint32_t interval) noexcept { return scheduler.SetRefreshInterval(regIndex, interval); }
+	uint32_t GetRefreshInterval(unsigned int regIndex) const noexcept { return scheduler.GetRefreshInterval(regIndex); }
 
 	float GetStandstillCurrentPercent() const noexcept;
 	void SetStandstillCurrentPercent(float percent) noexcept;
@@ -314,6 +318,9 @@ private:
 	static constexpr unsigned int ReadMsCnt = 2;
 	static constexpr unsigned int ReadPwmScale = 3;
 
+	static const uint16_t DefaultRefreshIntervals[NumReadRegisters];	// how often we read each register by default, in milliseconds
+	static constexpr uint16_t MaxDrvStatusDelay = 20;		// the longest we defer reading DRV_STATUS to send pending writes, in milliseconds
+
 	volatile uint32_t writeRegisters[NumWriteRegisters];	// the values we want the TMC22xx writable registers to have
 	volatile uint32_t readRegisters[NumReadRegisters];		// the last values read from the TMC22xx readable registers
 	volatile uint32_t accumulatedReadRegisters[NumReadRegisters];
@@ -326,6 +333,8 @@ private:
 	uint32_t microstepShiftFactor;							// how much we need to shift 1 left by to get the current microstepping
 	uint32_t motorCurrent;									// the configured motor current
 	uint32_t maxOpenLoadStepInterval;						// the maximum step pulse interval for which we consider open load detection to be reliable
+	TmcRegisterScheduler scheduler;							// decides which register to read or write in each transaction
+	TmcShadowRegisters<NumWriteRegisters> shadowRegisters;	// the register values we last sent to the driver
 
 #if TMC22xx_HAS_MUX
 	static Uart * const uart;								// the UART that controls all drivers
@@ -348,7 +357,7 @@ private:
 	Pin enablePin;											// the enable pin of this driver, if it has its own
 	uint8_t driverNumber;									// the number of this driver as addressed by the UART multiplexer
 	uint8_t standstillCurrentFraction;						// divide this by 256 to get the motor current standstill fraction
-	uint8_t registerToRead;									// the next register we need to read
+	uint8_t registerToRead;									// the register we are reading
 	uint8_t lastIfCount;									// the value of the IFCNT register last time we read it
 	volatile uint8_t writeRegCRCs[NumWriteRegisters];		// CRCs of the messages needed to update the registers
 	static const uint8_t ReadRegCRCs[NumReadRegisters];		// CRCs of the messages needed to read the registers
@@ -406,6 +415,14 @@ const uint8_t TmcDriverState::ReadRegCRCs[NumReadRegisters] =
 	CRCAddByte(InitialSendCRC, ReadRegNumbers[3])
 };
 
+const uint16_t TmcDriverState::DefaultRefreshIntervals[NumReadRegisters] =
+{
+	200,				// GSTAT
+	0,					// DRV_STATUS, as often as possible
+	200,				// MSCNT
+	500					// PWM_SCALE
+};
+
 // State structures for all drivers
 static TmcDriverState driverStates[MaxSmartDrivers];
 
@@ -478,9 +495,10 @@ void TmcDriverState::UpdateMaxOpenLoadStepInterval() noexcept
 	}
 }
 
-// Set a register value and flag it for updating
+// Set a register value and flag it for updating if the driver doesn't already have that value
 void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
 {
+	const bool alreadyPending = (registersToUpdate & (1u << regIndex)) != 0;
 	registersToUpdate &= ~(1u << regIndex);								// make sure it is not updated while we are changing it
 	uint8_t crc = InitialSendCRC;
 	crc = CRCAddByte(crc, WriteRegNumbers[regIndex] | 0x80);
@@ -491,7 +509,10 @@ void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
 	const irqflags_t flags = cpu_irq_save();
 	writeRegisters[regIndex] = regVal;
 	writeRegCRCs[regIndex] = crc;
-	registersToUpdate |= (1u << regIndex);								// flag it for sending
+	if (shadowRegisters.NeedsWrite(regIndex, regVal, alreadyPending))
+	{
+		registersToUpdate |= (1u << regIndex);							// flag it for sending
+	}
 	cpu_irq_restore(flags);
 	if (regIndex == WriteGConf || regIndex == WriteTpwmthrs)
 	{
@@ -524,6 +545,7 @@ pre(!driversPowered)
 
 	enabled = false;
 	registersToUpdate = 0;
+	shadowRegisters.Init();
 	motorCurrent = 0;
 	standstillCurrentFraction = (uint8_t)min<uint32_t>((DefaultStandstillCurrentPercent * 256)/100, 255);
 	UpdateRegister(WriteGConf, DefaultGConfReg);
@@ -539,6 +561,7 @@ pre(!driversPowered)
 	}
 	registerBeingUpdated = 0;
 	registerToRead = 0;
+	scheduler.Init(NumReadRegisters, DefaultRefreshIntervals, ReadDrvStat, MaxDrvStatusDelay, millis());
 	lastIfCount = 0;
 	readErrors = writeErrors = numReads = numTimeouts = 0;
 }
@@ -551,6 +574,7 @@ inline void TmcDriverState::SetAxisNumber(size_t p_axisNumber) noexcept
 // Write all registers. This is called when the drivers are known to be powered up.
 inline void TmcDriverState::WriteAll() noexcept
 {
+	shadowRegisters.InvalidateAll();
 	registersToUpdate = (1u << NumWriteRegisters) - 1;
 }
 
@@ -779,8 +803,13 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply) noexcept
 		reply.cat(" ok");
 	}
 
-	reply.catf(", read errors %u, write errors %u, ifcount %u, reads %u, timeouts %u", readErrors, writeErrors, lastIfCount, numReads, numTimeouts);
+	reply.catf(", read errors %u, write errors %u, ifcount %u, reads %u, timeouts %u, writes issued %" PRIu32 " suppressed %" PRIu32,
+				readErrors, writeErrors, lastIfCount, numReads, numTimeouts, shadowRegisters.GetNumIssued(), shadowRegisters.GetNumSuppressed());
 	readErrors = writeErrors = numReads = numTimeouts = 0;
+	shadowRegisters.ResetCounts();
+	uint32_t maxGap;
+	const uint32_t refreshRate = scheduler.GetPriorityRefreshRate(millis(), maxGap);
+	reply.catf(", DRV_STATUS refresh %" PRIu32 "Hz max gap %" PRIu32 "ms", refreshRate, maxGap);
 }
 
 // This is called by the ISR when the SPI transfer has completed
@@ -821,12 +850,7 @@ inline void TmcDriverState::TransferDone() noexcept
 			}
 			readRegisters[registerToRead] = regVal;
 			accumulatedReadRegisters[registerToRead] |= regVal;
-
-			++registerToRead;
-			if (registerToRead == NumReadRegisters)
-			{
-				registerToRead = 0;
-			}
+			scheduler.ReadCompleted(registerToRead, millis());
 			++numReads;
 		}
 		else
@@ -886,10 +910,12 @@ inline void TmcDriverState::StartTransfer() noexcept
 	SetUartMux();
 #endif
 
-	// Find which register to send. The common case is when no registers need to be updated.
-	if (registersToUpdate == 0)
+	// Find which register to send. Pending writes go first unless DRV_STATUS is overdue.
+	const unsigned int regIndexToRead = scheduler.ChooseNext(millis(), registersToUpdate != 0);
+	if (regIndexToRead != TmcRegisterScheduler::WriteNext)
 	{
 		registerBeingUpdated = 0;
+		registerToRead = regIndexToRead;
 
 		// Read a register
 		const irqflags_t flags = cpu_irq_save();		// avoid race condition
@@ -910,6 +936,7 @@ inline void TmcDriverState::StartTransfer() noexcept
 		registerBeingUpdated = 1u << regNum;
 		uart->UART_CR = UART_CR_RSTRX | UART_CR_RSTTX;	// reset transmitter and receiver
 		SetupDMASend(WriteRegNumbers[regNum], writeRegisters[regNum], writeRegCRCs[regNum]);	// set up the PDC
+		shadowRegisters.Issued(regNum, writeRegisters[regNum]);
 		uart->UART_IER = UART_IER_ENDRX;				// enable end-of-transfer interrupt
 		uart->UART_CR = UART_CR_RXEN | UART_CR_TXEN;	// enable transmitter and receiver
 		transferStartedTime = millis();
@@ -1242,6 +1269,16 @@ namespace SmartDrivers
 		return (driver < numTmc22xxDrivers) ? driverStates[driver].GetRegister(reg) : 0;
 	}
 
+	bool SetRefreshInterval(size_t driver, unsigned int regIndex, uint32_t interval) noexcept
+	{
+		return (driver < numTmc22xxDrivers) && driverStates[driver].SetRefreshInterval(regIndex, interval);
+	}
+
+	uint32_t GetRefreshInterval(size_t driver, unsigned int regIndex) noexcept
+	{
+		return (driver < numTmc22xxDrivers) ? driverStates[driver].GetRefreshInterval(regIndex) : 0;
+	}
+
 };	// end namespace
 
 #endif
@@ -60,6 +60,10 @@ namespace SmartDrivers
 	void SetStandstillCurrentPercent(size_t drive, float percent) noexcept;
 	bool SetRegister(size_t driver, SmartDriverRegister reg, uint32_t regVal) noexcept;
 	uint32_t GetRegister(size_t driver, SmartDriverRegister reg) noexcept;
+
+	// Status register refresh intervals in milliseconds. The registers are numbered 0 = GSTAT, 1 = DRV_STATUS, 2 = MSCNT, 3 = PWM_SCALE.
+	bool SetRefreshInterval(size_t driver, unsigned int regIndex, uint32_t interval) noexcept;
+	uint32_t GetRefreshInterval(size_t driver, unsigned int regIndex) noexcept;
 };
 
 #endif
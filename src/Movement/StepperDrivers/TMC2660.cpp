@@ -10,6 +10,8 @@
 #if SUPPORT_TMC2660
 
 #include "TMC2660.h"
+#include "TmcShadowRegisters.h"
+#include "StallGuardLog.h"
 #include "RepRap.h"
 #include "Movement/Move.h"
 #include "Movement/StepTimer.h"
@@ -205,7 +207,7 @@ constexpr uint32_t MinimumOpenLoadCsBits = CurrentToCsBits(MinimumOpenLoadMotorC
 class TmcDriverState
 {
 public:
-	void Init(uint32_t driverNumber, uint32_t p_pin) noexcept;
+	void Init(uint32_t p_driverNumber, uint32_t p_pin) noexcept;
 	void SetAxisNumber(size_t p_axisNumber) noexcept;
 	void WriteAll() noexcept;
 	bool UpdatePending() const noexcept { return registersToUpdate != 0; }
@@ -237,6 +239,7 @@ public:
 
 private:
 	bool SetChopConf(uint32_t newVal) noexcept;
+	void UpdateRegister(size_t regIndex, uint32_t regVal) noexcept;
 
 	void ResetLoadRegisters() noexcept
 	{
@@ -261,6 +264,7 @@ private:
 	uint32_t pin;											// the pin number that drives the chip select pin of this driver
 	uint32_t configuredChopConfReg;							// the configured chopper control register, in the Enabled state
 	volatile uint32_t registersToUpdate;					// bitmap of register values that need to be sent to the driver chip
+	TmcShadowRegisters<NumRegisters> shadowRegisters;		// the register values we last sent to the driver
 	DriversBitmap driverBit;								// bitmap of just this driver number
 	uint32_t axisNumber;									// the axis number of this driver as used to index the DriveMovements in the DDA
 	uint32_t microstepShiftFactor;							// how much we need to shift 1 left by to get the current microstepping
@@ -273,6 +277,7 @@ private:
 	volatile uint32_t accumulatedStatus;
 	bool enabled;
 	volatile uint8_t rdselState;							// 0-3 = actual RDSEL value, 0xFF = unknown
+	uint8_t driverNumber;									// the number of this driver
 };
 
 // State structures for all drivers
@@ -408,11 +413,12 @@ static TmcDriverState * volatile currentDriver = nullptr;	// volatile because th
 }
 
 // Initialise the state of the driver and its CS pin
-void TmcDriverState::Init(uint32_t driverNumber, uint32_t p_pin) noexcept
+void TmcDriverState::Init(uint32_t p_driverNumber, uint32_t p_pin) noexcept
 pre(!driversPowered)
 {
-	axisNumber = driverNumber;												// assume straight through mapping at initialisation
-	driverBit = DriversBitmap::MakeFromBits(driverNumber);
+	axisNumber = p_driverNumber;												// assume straight through mapping at initialisation
+	driverNumber = p_driverNumber;
+	driverBit = DriversBitmap::MakeFromBits(p_driverNumber);
 	pin = p_pin;
 	pinMode(pin, OUTPUT_HIGH);
 	enabled = false;
@@ -423,6 +429,7 @@ pre(!driversPowered)
 	registers[StallGuardConfig] = defaultSgscConfReg;
 	registers[DriveConfig] = defaultDrvConfReg;
 	registersToUpdate = UpdateAllRegisters;
+	shadowRegisters.Init();
 	accumulatedStatus = lastReadStatus = 0;
 	rdselState = 0xFF;
 	mstepPosition = 0xFFFFFFFF;
@@ -441,9 +448,22 @@ inline void TmcDriverState::SetAxisNumber(size_t p_axisNumber) noexcept
 // Write all registers. This is called when the drivers are known to be powered up.
 inline void TmcDriverState::WriteAll() noexcept
 {
+	shadowRegisters.InvalidateAll();
 	registersToUpdate = UpdateAllRegisters;
 }
 
+// Set a register value and flag it for updating if the driver doesn't already have that value
+void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
+{
+	const irqflags_t flags = cpu_irq_save();
+	registers[regIndex] = regVal;
+	if (shadowRegisters.NeedsWrite(regIndex, regVal, (registersToUpdate & (1u << regIndex)) != 0))
+	{
+		registersToUpdate |= 1u << regIndex;
+	}
+	cpu_irq_restore(flags);
+}
+
 bool TmcDriverState::SetRegister(SmartDriverRegister reg, uint32_t regVal) noexcept
 {
 	switch(reg)
@@ -452,8 +472,7 @@ bool TmcDriverState::SetRegister(SmartDriverRegister reg, uint32_t regVal) noexc
 		return SetChopConf(regVal);
 
 	case SmartDriverRegister::coolStep:
-		registers[SmartEnable] = TMC_REG_SMARTEN | (regVal & 0xFFFF);
-		registersToUpdate |= 1u << SmartEnable;
+		UpdateRegister(SmartEnable, TMC_REG_SMARTEN | (regVal & 0xFFFF));
 		return true;
 
 	case SmartDriverRegister::toff:
@@ -576,8 +595,7 @@ bool TmcDriverState::SetMicrostepping(uint32_t shift, bool interpolate) noexcept
 	{
 		drvCtrlReg &= ~TMC_DRVCTRL_INTPOL;
 	}
-	registers[DriveControl] = drvCtrlReg;
-	registersToUpdate |= 1u << DriveControl;
+	UpdateRegister(DriveControl, drvCtrlReg);
 	return true;
 }
 
@@ -585,8 +603,7 @@ bool TmcDriverState::SetMicrostepping(uint32_t shift, bool interpolate) noexcept
 void TmcDriverState::SetCurrent(float current) noexcept
 {
 	const uint32_t csBits = CurrentToCsBits(current);
-	registers[StallGuardConfig] = (registers[StallGuardConfig] & ~TMC_SGCSCONF_CS_MASK) | TMC_SGCSCONF_CS(csBits);
-	registersToUpdate |= 1u << StallGuardConfig;
+	UpdateRegister(StallGuardConfig, (registers[StallGuardConfig] & ~TMC_SGCSCONF_CS_MASK) | TMC_SGCSCONF_CS(csBits));
 }
 
 // Enable or disable the driver
@@ -612,15 +629,14 @@ void TmcDriverState::Enable(bool en) noexcept
 			registers[DriveConfig] = (registers[DriveConfig] & ~TMC_DRVCONF_RDSEL_MASK) | TMC_DRVCONF_RDSEL_0;		// read the microstep position when drive is disabled
 		}
 		rdselState = 0xFF;
-		registersToUpdate |= 1 << DriveConfig;
+		registersToUpdate |= 1 << DriveConfig;					// always send this, because we need to find out which RDSEL value is in use
 		cpu_irq_restore(flags);
 	}
 }
 
 void TmcDriverState::UpdateChopConfRegister() noexcept
 {
-	registers[ChopperControl] = (enabled) ? configuredChopConfReg : (configuredChopConfReg & ~TMC_CHOPCONF_TOFF_MASK);
-	registersToUpdate |= (1u << ChopperControl);
+	UpdateRegister(ChopperControl, (enabled) ? configuredChopConfReg : (configuredChopConfReg & ~TMC_CHOPCONF_TOFF_MASK));
 }
 
 // Read the status
@@ -645,21 +661,12 @@ uint32_t TmcDriverState::ReadAccumulatedStatus(uint32_t bitsToKeep) noexcept
 void TmcDriverState::SetStallDetectThreshold(int sgThreshold) noexcept
 {
 	const uint32_t sgVal = ((uint32_t)constrain<int>(sgThreshold, -64, 63)) & 127;
-	registers[StallGuardConfig] = (registers[StallGuardConfig] & ~TMC_SGCSCONF_SGT_MASK) | (sgVal << TMC_SGCSCONF_SGT_SHIFT);
-	registersToUpdate |= 1u << StallGuardConfig;
+	UpdateRegister(StallGuardConfig, (registers[StallGuardConfig] & ~TMC_SGCSCONF_SGT_MASK) | (sgVal << TMC_SGCSCONF_SGT_SHIFT));
 }
 
 void TmcDriverState::SetStallDetectFilter(bool sgFilter) noexcept
 {
-	if (sgFilter)
-	{
-		registers[StallGuardConfig] |= TMC_SGCSCONF_SGT_SFILT;
-	}
-	else
-	{
-		registers[StallGuardConfig] &= ~TMC_SGCSCONF_SGT_SFILT;
-	}
-	registersToUpdate |= 1u << StallGuardConfig;
+	UpdateRegister(StallGuardConfig, (sgFilter) ? registers[StallGuardConfig] | TMC_SGCSCONF_SGT_SFILT : registers[StallGuardConfig] & ~TMC_SGCSCONF_SGT_SFILT);
 }
 
 void TmcDriverState::SetStallMinimumStepsPerSecond(unsigned int stepsPerSecond) noexcept
@@ -722,6 +729,8 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply) noexcept
 		reply.cat(", SG min/max not available");
 	}
 	ResetLoadRegisters();
+	reply.catf(", writes issued %" PRIu32 " suppressed %" PRIu32, shadowRegisters.GetNumIssued(), shadowRegisters.GetNumSuppressed());
+	shadowRegisters.ResetCounts();
 }
 
 // Get microstepping
@@ -755,6 +764,11 @@ inline void TmcDriverState::TransferDone() noexcept
 			{
 				maxSgLoadRegister = sgLoad;
 			}
+			if (StallGuardLog::IsLogging(driverNumber))
+			{
+				StallGuardLog::RecordLoad(driverNumber, sgLoad,
+											((status & TMC_RR_STST) ? StallGuardLog::FlagStandstill : 0) | ((status & TMC_RR_SG) ? StallGuardLog::FlagStalled : 0));
+			}
 		}
 
 		EndstopOrZProbe::UpdateStalledDrivers(driverBit, (status & TMC_RR_SG) != 0);
@@ -809,6 +823,7 @@ inline void TmcDriverState::StartTransfer() noexcept
 				regVal &= ~TMC_DRVCONF_RDSEL_MASK;							// set RDSEL=0 so that we read the microstep counter
 			}
 		}
+		shadowRegisters.Issued(regNum, regVal);
 	}
 
 	// Kick off a transfer for that register
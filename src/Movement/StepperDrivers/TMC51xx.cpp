@@ -11,6 +11,9 @@
 
 #if SUPPORT_TMC51xx
 
+#include "TmcRegisterScheduler.h"
+#include "TmcShadowRegisters.h"
+#include "StallGuardLog.h"
 #include <RTOSIface/RTOSIface.h>
 #include <TaskPriorities.h>
 #include <Movement/Move.h>
@@ -289,6 +292,8 @@ public:
 
 	bool SetRegister(SmartDriverRegister reg, uint32_t regVal) noexcept;
 	uint32_t GetRegister(SmartDriverRegister reg) const noexcept;
+	bool SetRefreshInterval(unsigned int regIndex, uint32_t interval) noexcept { return scheduler.SetRefreshInterval(regIndex, interval); }
+	uint32_t GetRefreshInterval(unsigned int regIndex) const noexcept { return scheduler.GetRefreshInterval(regIndex); }
 
 	float GetStandstillCurrentPercent() const noexcept;
 	void SetStandstillCurrentPercent(float percent) noexcept;
@@ -344,6 +349,9 @@ private:
 	static constexpr unsigned int ReadMsCnt = 2;
 	static constexpr unsigned int ReadPwmScale = 3;
 
+	static const uint16_t DefaultRefreshIntervals[NumReadRegisters];	// how often we read each register by default, in milliseconds
+	static constexpr uint16_t MaxDrvStatusDelay = 5;		// the longest we defer reading DRV_STATUS to send pending writes, in milliseconds
+
 	static constexpr uint8_t NoRegIndex = 0xFF;				// this means no register updated, or no register requested
 
 	volatile uint32_t writeRegisters[NumWriteRegisters];	// the values we want the TMC22xx writable registers to have
@@ -361,10 +369,13 @@ private:
 	uint32_t axisNumber;									// the axis number of this driver as used to index the DriveMovements in the DDA
 	uint32_t microstepShiftFactor;							// how much we need to shift 1 left by to get the current microstepping
 	uint32_t motorCurrent;									// the configured motor current in mA
+	TmcRegisterScheduler scheduler;							// decides which register to read or write in each transaction
+	TmcShadowRegisters<NumWriteRegisters> shadowRegisters;	// the register values we last sent to the driver
 
 	uint16_t numReads, numWrites;							// how many successful reads and writes we had
 	static uint16_t numTimeouts;							// how many times a transfer timed out
 
+	uint8_t driverNumber;									// the number of this driver
 	uint8_t standstillCurrentFraction;						// divide this by 256 to get the motor current standstill fraction
 	uint8_t regIndexBeingUpdated;							// which register we are sending
 	uint8_t regIndexRequested;								// the register we asked to read in the previous transaction, or 0xFF
@@ -397,6 +408,14 @@ const uint8_t TmcDriverState::ReadRegNumbers[NumReadRegisters] =
 	REGNUM_PWM_SCALE
 };
 
+const uint16_t TmcDriverState::DefaultRefreshIntervals[NumReadRegisters] =
+{
+	100,				// GSTAT
+	0,					// DRV_STATUS, as often as possible
+	100,				// MSCNT
+	250					// PWM_SCALE
+};
+
 uint16_t TmcDriverState::numTimeouts = 0;								// how many times a transfer timed out
 
 // Initialise the state of the driver and its CS pin
@@ -404,9 +423,11 @@ void TmcDriverState::Init(uint32_t p_driverNumber) noexcept
 pre(!driversPowered)
 {
 	axisNumber = p_driverNumber;										// axes are mapped straight through to drivers initially
+	driverNumber = p_driverNumber;
 	driverBit = DriversBitmap::MakeFromBits(p_driverNumber);
 	enabled = false;
 	registersToUpdate = newRegistersToUpdate = 0;
+	shadowRegisters.Init();
 	motorCurrent = 0;
 	standstillCurrentFraction = (uint8_t)min<uint32_t>((DefaultStandstillCurrentPercent * 256)/100, 255);
 
@@ -423,7 +444,7 @@ pre(!driversPowered)
 	UpdateRegister(WriteThigh, DefaultThighReg);
 	configuredChopConfReg = DefaultChopConfReg;
 	SetMicrostepping(DefaultMicrosteppingShift, DefaultInterpolation);	// this also updates the chopper control register
-	writeRegisters[WriteCoolConf] = DefaultCoolConfReg;
+	UpdateRegister(WriteCoolConf, DefaultCoolConfReg);
 	SetStallDetectThreshold(DefaultStallDetectThreshold);				// this also updates the CoolConf register
 	SetStallMinimumStepsPerSecond(DefaultMinimumStepsPerSecond);
 	UpdateRegister(WritePwmConf, DefaultPwmConfReg);
@@ -434,14 +455,18 @@ pre(!driversPowered)
 	}
 
 	regIndexBeingUpdated = regIndexRequested = previousRegIndexRequested = NoRegIndex;
+	scheduler.Init(NumReadRegisters, DefaultRefreshIntervals, ReadDrvStat, MaxDrvStatusDelay, millis());
 	numReads = numWrites = 0;
 }
 
-// Set a register value and flag it for updating
+// Set a register value and flag it for updating if the driver doesn't already have that value
 void TmcDriverState::UpdateRegister(size_t regIndex, uint32_t regVal) noexcept
 {
 	writeRegisters[regIndex] = regVal;
-	newRegistersToUpdate |= (1u << regIndex);							// flag it for sending
+	if (shadowRegisters.NeedsWrite(regIndex, regVal, ((registersToUpdate | newRegistersToUpdate) & (1u << regIndex)) != 0))
+	{
+		newRegistersToUpdate |= (1u << regIndex);						// flag it for sending
+	}
 }
 
 // Calculate the chopper control register and flag it for sending
@@ -453,8 +478,7 @@ void TmcDriverState::UpdateChopConfRegister() noexcept
 void TmcDriverState::SetStallDetectThreshold(int sgThreshold) noexcept
 {
 	const uint32_t sgVal = ((uint32_t)constrain<int>(sgThreshold, -64, 63)) & 127u;
-	writeRegisters[WriteCoolConf] = (writeRegisters[WriteCoolConf] & ~COOLCONF_SGT_MASK) | (sgVal << COOLCONF_SGT_SHIFT);
-	newRegistersToUpdate |= 1u << WriteCoolConf;
+	UpdateRegister(WriteCoolConf, (writeRegisters[WriteCoolConf] & ~COOLCONF_SGT_MASK) | (sgVal << COOLCONF_SGT_SHIFT));
 }
 
 inline void TmcDriverState::SetAxisNumber(size_t p_axisNumber) noexcept
@@ -465,6 +489,7 @@ inline void TmcDriverState::SetAxisNumber(size_t p_axisNumber) noexcept
 // Write all registers. This is called when the drivers are known to be powered up.
 inline void TmcDriverState::WriteAll() noexcept
 {
+	shadowRegisters.InvalidateAll();
 	newRegistersToUpdate = (1u << NumWriteRegisters) - 1;
 }
 
@@ -748,8 +773,13 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply, bool clearGlobal
 		reply.cat(" ok");
 	}
 
-	reply.catf(", reads %u, writes %u timeouts %u", numReads, numWrites, numTimeouts);
+	reply.catf(", reads %u, writes %u timeouts %u, writes issued %" PRIu32 " suppressed %" PRIu32,
+				numReads, numWrites, numTimeouts, shadowRegisters.GetNumIssued(), shadowRegisters.GetNumSuppressed());
 	numReads = numWrites = 0;
+	shadowRegisters.ResetCounts();
+	uint32_t maxGap;
+	const uint32_t refreshRate = scheduler.GetPriorityRefreshRate(millis(), maxGap);
+	reply.catf(", DRV_STATUS refresh %" PRIu32 "Hz max gap %" PRIu32 "ms", refreshRate, maxGap);
 	if (clearGlobalStats)
 	{
 		numTimeouts = 0;
@@ -768,15 +798,7 @@ void TmcDriverState::AppendDriverStatus(const StringRef& reply, bool clearGlobal
 
 void TmcDriverState::SetStallDetectFilter(bool sgFilter) noexcept
 {
-	if (sgFilter)
-	{
-		writeRegisters[WriteCoolConf] |= COOLCONF_SGFILT;
-	}
-	else
-	{
-		writeRegisters[WriteCoolConf] &= ~COOLCONF_SGFILT;
-	}
-	newRegistersToUpdate |= 1u << WriteCoolConf;
+	UpdateRegister(WriteCoolConf, (sgFilter) ? writeRegisters[WriteCoolConf] | COOLCONF_SGFILT : writeRegisters[WriteCoolConf] & ~COOLCONF_SGFILT);
 }
 
 void TmcDriverState::SetStallMinimumStepsPerSecond(unsigned int stepsPerSecond) noexcept
@@ -802,18 +824,19 @@ void TmcDriverState::AppendStallConfig(const StringRef& reply) const noexcept
 // In the following, only byte accesses to sendDataBlock are allowed, because accesses to non-cacheable memory must be aligned
 void TmcDriverState::GetSpiCommand(uint8_t *sendDataBlock) noexcept
 {
-	// Find which register to send. The common case is when no registers need to be updated.
+	// Find which register to send. Pending writes go first unless DRV_STATUS is overdue.
 	{
 		TaskCriticalSectionLocker lock;
 		registersToUpdate |= newRegistersToUpdate;
 		newRegistersToUpdate = 0;
 	}
 
-	if (registersToUpdate == 0)
+	const unsigned int regIndexToRead = scheduler.ChooseNext(millis(), registersToUpdate != 0);
+	if (regIndexToRead != TmcRegisterScheduler::WriteNext)
 	{
 		// Read a register
 		regIndexBeingUpdated = NoRegIndex;
-		regIndexRequested = (regIndexRequested >= NumReadRegisters - 1) ? 0 : regIndexRequested + 1;
+		regIndexRequested = regIndexToRead;
 		sendDataBlock[0] = ReadRegNumbers[regIndexRequested];
 		sendDataBlock[1] = 0;
 		sendDataBlock[2] = 0;
@@ -825,8 +848,10 @@ void TmcDriverState::GetSpiCommand(uint8_t *sendDataBlock) noexcept
 		// Write a register
 		const size_t regNum = LowestSetBit(registersToUpdate);
 		regIndexBeingUpdated = regNum;
+		const uint32_t regVal = writeRegisters[regNum];
 		sendDataBlock[0] = WriteRegNumbers[regNum] | 0x80;
-		StoreBE32(sendDataBlock + 1, writeRegisters[regNum]);
+		StoreBE32(sendDataBlock + 1, regVal);
+		shadowRegisters.Issued(regNum, regVal);
 	}
 }
 
@@ -846,10 +871,17 @@ void TmcDriverState::TransferSucceeded(const uint8_t *rcvDataBlock) noexcept
 	if (previousRegIndexRequested < NumReadRegisters)
 	{
 		++numReads;
+		scheduler.ReadCompleted(previousRegIndexRequested, millis());
 		uint32_t regVal = LoadBE32(rcvDataBlock + 1);
 		if (previousRegIndexRequested == ReadDrvStat)
 		{
 			// We treat the DRV_STATUS register separately
+			if (StallGuardLog::IsLogging(driverNumber))
+			{
+				StallGuardLog::RecordLoad(driverNumber, regVal & TMC_RR_SGRESULT,
+											((regVal & TMC_RR_STST) ? StallGuardLog::FlagStandstill : 0) | ((regVal & TMC_RR_SG) ? StallGuardLog::FlagStalled : 0));
+			}
+
 			if ((regVal & TMC_RR_STST) == 0)							// in standstill, SG_RESULT returns the chopper on-time instead
 			{
 				const uint32_t sgResult = regVal & TMC_RR_SGRESULT;
@@ -1509,6 +1541,16 @@ uint32_t SmartDrivers::GetRegister(size_t driver, SmartDriverRegister reg) noexc
 	return (driver < numTmc51xxDrivers) ? driverStates[driver].GetRegister(reg) : 0;
 }
 
+bool SmartDrivers::SetRefreshInterval(size_t driver, unsigned int regIndex, uint32_t interval) noexcept
+{
+	return (driver < numTmc51xxDrivers) && driverStates[driver].SetRefreshInterval(regIndex, interval);
+}
+
+uint32_t SmartDrivers::GetRefreshInterval(size_t driver, unsigned int regIndex) noexcept
+{
+	return (driver < numTmc51xxDrivers) ? driverStates[driver].GetRefreshInterval(regIndex) : 0;
+}
+
 #endif
 
 // End
@@ -0,0 +1,100 @@
+/*
+ * TmcRegisterScheduler.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "TmcRegisterScheduler.h"
+
+// Set up the read registers. The refresh intervals are in milliseconds and zero means read as often as possible.
+void TmcRegisterScheduler::Init(unsigned int p_numReadRegisters, const uint16_t *p_refreshIntervals, unsigned int p_priorityRegister, uint16_t p_maxPriorityDelay, uint32_t now) noexcept
+{
+	numReadRegisters = (p_numReadRegisters < MaxReadRegisters) ? p_numReadRegisters : MaxReadRegisters;
+	priorityRegister = p_priorityRegister;
+	maxPriorityDelay = p_maxPriorityDelay;
+	for (size_t i = 0; i < numReadRegisters; ++i)
+	{
+		refreshIntervals[i] = p_refreshIntervals[i];
+		lastRequestedTimes[i] = now - refreshIntervals[i];			// make them all due straight away
+	}
+	lastPriorityReadTime = statsStartTime = now;
+	numPriorityReads = maxPriorityGap = 0;
+}
+
+// Return the index of the register to read in the next transaction, or WriteNext if the pending write should be sent instead
+unsigned int TmcRegisterScheduler::ChooseNext(uint32_t now, bool writePending) noexcept
+{
+	if (writePending)
+	{
+		if (now - lastRequestedTimes[priorityRegister] < maxPriorityDelay)
+		{
+			return WriteNext;
+		}
+		lastRequestedTimes[priorityRegister] = now;
+		return priorityRegister;
+	}
+
+	// Find the register that is most overdue. The priority register wins ties and is read if nothing else is due.
+	unsigned int best = priorityRegister;
+	int32_t bestOverdue = (int32_t)(now - lastRequestedTimes[priorityRegister]) - (int32_t)refreshIntervals[priorityRegister];
+	if (bestOverdue < 0)
+	{
+		bestOverdue = 0;
+	}
+	for (unsigned int i = 0; i < numReadRegisters; ++i)
+	{
+		if (i != priorityRegister)
+		{
+			const int32_t overdue = (int32_t)(now - lastRequestedTimes[i]) - (int32_t)refreshIntervals[i];
+			if (overdue > bestOverdue)
+			{
+				best = i;
+				bestOverdue = overdue;
+			}
+		}
+	}
+
+	// Record the time of the request, not of the reply, because some drivers only return the value in the following transaction
+	lastRequestedTimes[best] = now;
+	return best;
+}
+
+// Record that a register was read successfully
+void TmcRegisterScheduler::ReadCompleted(unsigned int regIndex, uint32_t now) noexcept
+{
+	if (regIndex == priorityRegister)
+	{
+		const uint32_t gap = now - lastPriorityReadTime;
+		if (gap > maxPriorityGap)
+		{
+			maxPriorityGap = gap;
+		}
+		lastPriorityReadTime = now;
+		++numPriorityReads;
+	}
+}
+
+bool TmcRegisterScheduler::SetRefreshInterval(unsigned int regIndex, uint32_t interval) noexcept
+{
+	if (regIndex < numReadRegisters && interval <= UINT16_MAX)
+	{
+		refreshIntervals[regIndex] = (uint16_t)interval;
+		return true;
+	}
+	return false;
+}
+
+// Get the number of times per second that the priority register was read since the last call, and the longest gap between reads in milliseconds, then reset them
+uint32_t TmcRegisterScheduler::GetPriorityRefreshRate(uint32_t now, uint32_t& maxGap) noexcept
+{
+	const uint32_t elapsed = now - statsStartTime;
+	const uint32_t rate = (elapsed == 0) ? 0 : (uint32_t)(((uint64_t)numPriorityReads * 1000u)/elapsed);
+	const uint32_t gapSinceLastRead = now - lastPriorityReadTime;
+	maxGap = (gapSinceLastRead > maxPriorityGap) ? gapSinceLastRead : maxPriorityGap;
+	statsStartTime = now;
+	numPriorityReads = maxPriorityGap = 0;
+	return rate;
+}
+
+// End
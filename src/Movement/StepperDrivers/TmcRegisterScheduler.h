@@ -0,0 +1,55 @@
+/*
+ * TmcRegisterScheduler.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Decides which register to access in the next transaction with a TMC22xx or TMC51xx driver.
+ *  Each driver can do one register access per transaction. Pending writes normally take priority, but the priority register (DRV_STATUS)
+ *  is read in preference to a write if it hasn't been read for longer than a maximum delay, so that a burst of writes can't hold up
+ *  stall and overtemperature detection. When no write is pending we read whichever register is most overdue relative to its
+ *  refresh interval; if nothing is overdue we read the priority register again. So DRV_STATUS is refreshed at close to the transaction
+ *  rate, and the other registers only use the transactions that their refresh intervals require.
+ */
+
+#ifndef SRC_MOVEMENT_STEPPERDRIVERS_TMCREGISTERSCHEDULER_H_
+#define SRC_MOVEMENT_STEPPERDRIVERS_TMCREGISTERSCHEDULER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class TmcRegisterScheduler
+{
+public:
+	static constexpr unsigned int MaxReadRegisters = 8;
+	static constexpr unsigned int WriteNext = 0xFF;				// returned by ChooseNext when a pending write should be sent
+
+	// Set up the read registers. The refresh intervals are in milliseconds and zero means read as often as possible.
+	void Init(unsigned int p_numReadRegisters, const uint16_t *p_refreshIntervals, unsigned int p_priorityRegister, uint16_t p_maxPriorityDelay, uint32_t now) noexcept;
+
+	// Return the index of the register to read in the next transaction, or WriteNext if the pending write should be sent instead
+	unsigned int ChooseNext(uint32_t now, bool writePending) noexcept;
+
+	// Record that a register was read successfully
+	void ReadCompleted(unsigned int regIndex, uint32_t now) noexcept;
+
+	bool SetRefreshInterval(unsigned int regIndex, uint32_t interval) noexcept;
+	uint32_t GetRefreshInterval(unsigned int regIndex) const noexcept { return (regIndex < numReadRegisters) ? refreshIntervals[regIndex] : 0; }
+	unsigned int GetNumReadRegisters() const noexcept { return numReadRegisters; }
+
+	// Get the number of times per second that the priority register was read since the last call, and the longest gap between reads in milliseconds, then reset them
+	uint32_t GetPriorityRefreshRate(uint32_t now, uint32_t& maxGap) noexcept;
+
+private:
+	uint32_t lastRequestedTimes[MaxReadRegisters];				// when we last asked to read each register
+	uint16_t refreshIntervals[MaxReadRegisters];				// how often we want to read each register, in milliseconds
+	uint32_t lastPriorityReadTime;								// when we last received the priority register
+	uint32_t statsStartTime;									// when we started counting priority register reads
+	uint32_t numPriorityReads;									// how many times we received the priority register since statsStartTime
+	uint32_t maxPriorityGap;									// the longest gap between receiving the priority register since statsStartTime
+	uint16_t maxPriorityDelay;									// how long the priority register may go unread before it takes precedence over writes
+	uint8_t numReadRegisters;
+	uint8_t priorityRegister;
+};
+
+#endif /* SRC_MOVEMENT_STEPPERDRIVERS_TMCREGISTERSCHEDULER_H_ */
@@ -0,0 +1,59 @@
+/*
+ * TmcShadowRegisters.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  Shadow copies of the values last sent to the writable registers of a TMC2660, TMC22xx or TMC51xx driver.
+ *  Commands such as M906, M913, M569 and M915, and the standstill current reduction, recalculate whole registers. Often the result is the value
+ *  the driver already holds, so we compare the new value with the shadow copy and only flag the register for sending if it differs.
+ *  The shadow copies are invalidated when the drivers lose power, so that everything is sent again after power up.
+ */
+
+#ifndef SRC_MOVEMENT_STEPPERDRIVERS_TMCSHADOWREGISTERS_H_
+#define SRC_MOVEMENT_STEPPERDRIVERS_TMCSHADOWREGISTERS_H_
+
+#include <cstdint>
+
+template<unsigned int NumRegisters> class TmcShadowRegisters
+{
+public:
+	static_assert(NumRegisters <= 32, "too many registers");
+
+	void Init() noexcept { valid = 0; numIssued = numSuppressed = 0; }
+
+	// Forget what the driver holds, e.g. because it has been powered down
+	void InvalidateAll() noexcept { valid = 0; }
+
+	// Return true if the register needs to be flagged for sending because its wanted value has changed to newVal.
+	// If a write of the register is already pending then that write will send the new value, so we count the update as suppressed but still return true.
+	bool NeedsWrite(unsigned int regIndex, uint32_t newVal, bool alreadyPending) noexcept
+	{
+		if (alreadyPending || ((valid & (1u << regIndex)) != 0 && lastWritten[regIndex] == newVal))
+		{
+			++numSuppressed;
+			return alreadyPending;
+		}
+		return true;
+	}
+
+	// Record the value that we are sending to the driver. If the transfer fails then the caller leaves the register flagged so that it gets sent again.
+	void Issued(unsigned int regIndex, uint32_t val) noexcept
+	{
+		lastWritten[regIndex] = val;
+		valid |= 1u << regIndex;
+		++numIssued;
+	}
+
+	uint32_t GetNumIssued() const noexcept { return numIssued; }
+	uint32_t GetNumSuppressed() const noexcept { return numSuppressed; }
+	void ResetCounts() noexcept { numIssued = numSuppressed = 0; }
+
+private:
+	uint32_t lastWritten[NumRegisters];						// the values we last sent
+	volatile uint32_t valid;								// bitmap of registers whose values in lastWritten are known to be in the driver
+	volatile uint32_t numIssued;							// how many register writes we sent
+	volatile uint32_t numSuppressed;						// how many register updates didn't need a write of their own
+};
+
+#endif /* SRC_MOVEMENT_STEPPERDRIVERS_TMCSHADOWREGISTERS_H_ */
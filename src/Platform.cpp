@@ -24,6 +24,8 @@
 #include "Heating/Heat.h"
 #include "Movement/DDA.h"
 #include "Movement/Move.h"
+#include "Movement/MoveTrace.h"
+#include "Movement/StepperDrivers/StallGuardLog.h"
 #include "Movement/StepTimer.h"
 #include "Tools/Tool.h"
 #include "Endstops/ZProbe.h"
@@ -215,6 +217,13 @@ constexpr ObjectModelArrayDescriptor Platform::workplaceOffsetsArrayDescriptor =
 			{ return ExpressionValue(reprap.GetGCodes().GetWorkplaceOffset(context.GetIndex(1), context.GetIndex(0)), 3); }
 };
 
+constexpr ObjectModelArrayDescriptor Platform::tasksArrayDescriptor =
+{
+	nullptr,					// no lock needed
+	[] (const ObjectModel *self, const ObjectExplorationContext& context) noexcept -> size_t { return Tasks::GetNumProfiledTasks(); },
+	[] (const ObjectModel *self, ObjectExplorationContext& context) noexcept -> ExpressionValue { return ExpressionValue(self, 9); }
+};
+
 static inline const char* GetFilamentName(size_t extruder) noexcept
 {
 	const Filament *fil = Filament::GetFilamentByExtruder(extruder);
@@ -249,6 +258,7 @@ constexpr ObjectModelTableEntry Platform::objectModelTable[] =
 	{ "shortName",			OBJECT_MODEL_FUNC_NOSELF(BOARD_SHORT_NAME),															ObjectModelEntryFlags::none },
 # endif
 	{ "supports12864",		OBJECT_MODEL_FUNC_NOSELF(SUPPORT_12864_LCD ? true : false),											ObjectModelEntryFlags::verbose },
+	{ "tasks",				OBJECT_MODEL_FUNC_NOSELF(&tasksArrayDescriptor),													ObjectModelEntryFlags::live },
 #if SUPPORTS_UNIQUE_ID
 	{ "uniqueId",			OBJECT_MODEL_FUNC(self->GetUniqueIdString()),														ObjectModelEntryFlags::none },
 #endif
@@ -323,12 +333,17 @@ constexpr ObjectModelTableEntry Platform::objectModelTable[] =
 	// 8. move.extruders[].microstepping members
 	{ "interpolated",		OBJECT_MODEL_FUNC((self->microstepping[ExtruderToLogicalDrive(context.GetLastIndex())] & 0x8000) != 0),		ObjectModelEntryFlags::none },
 	{ "value",				OBJECT_MODEL_FUNC((int32_t)(self->microstepping[ExtruderToLogicalDrive(context.GetLastIndex())] & 0x7FFF)),	ObjectModelEntryFlags::none },
+
+	// 9. boards[0].tasks[] members
+	{ "cpuUsage",			OBJECT_MODEL_FUNC_NOSELF(Tasks::GetProfiledTaskCpuUsage(context.GetLastIndex()), 1),				ObjectModelEntryFlags::live },
+	{ "name",				OBJECT_MODEL_FUNC_NOSELF(Tasks::GetProfiledTaskName(context.GetLastIndex())),						ObjectModelEntryFlags::none },
+	{ "stackUnused",		OBJECT_MODEL_FUNC_NOSELF((int32_t)Tasks::GetProfiledTaskStackUnused(context.GetLastIndex())),		ObjectModelEntryFlags::live },
 };
 
 constexpr uint8_t Platform::objectModelTableDescriptor[] =
 {
-	9,																		// number of sections
-	12 + HAS_LINUX_INTERFACE + HAS_12V_MONITOR + SUPPORT_CAN_EXPANSION + SUPPORTS_UNIQUE_ID,		// section 0: boards[0]
+	10,																		// number of sections
+	13 + HAS_LINUX_INTERFACE + HAS_12V_MONITOR + SUPPORT_CAN_EXPANSION + SUPPORTS_UNIQUE_ID,		// section 0: boards[0]
 	3,																		// section 1: mcuTemp
 #if HAS_VOLTAGE_MONITOR
 	3,																		// section 2: vIn
@@ -345,6 +360,7 @@ constexpr uint8_t Platform::objectModelTableDescriptor[] =
 #endif
 	2,																		// section 7: move.axes[].microstepping
 	2,																		// section 8: move.extruders[].microstepping
+	3,																		// section 9: boards[0].tasks[]
 };
 
 DEFINE_GET_OBJECT_MODEL_TABLE(Platform)
@@ -1123,6 +1139,10 @@ void Platform::Spin() noexcept
 	MassStorage::Spin();
 #endif
 
+#if HAS_STALL_DETECT
+	StallGuardLog::Spin();
+#endif
+
 	// Try to flush messages to serial ports
 	(void)FlushMessages();
 
@@ -1929,7 +1949,7 @@ void Platform::Diagnostics(MessageType mtype) noexcept
 
 #if 0
 	// Debugging temperature readings
-	const uint32_t div = ThermistorAveragingFilter::NumAveraged() >> 2;		// 2 oversample bits
+	const uint32_t div = ThermistorAdcFilter::NumAveraged() >> 2;		// 2 oversample bits
 	MessageF(mtype, "Vssa %" PRIu32 " Vref %" PRIu32 " Temp0 %" PRIu32 " Temp1 %" PRIu32 "\n",
 			adcFilters[VssaFilterIndex].GetSum()/div, adcFilters[VrefFilterIndex].GetSum()/div, adcFilters[0].GetSum()/div, adcFilters[1].GetSum()/div);
 #endif
@@ -2154,6 +2174,7 @@ GCodeResult Platform::DiagnosticTest(GCodeBuffer& gb, const StringRef& reply, Ou
 
 	case (unsigned int)DiagnosticTestType::PrintMoves:
 		DDA::PrintMoves();
+		MoveTrace::Print(gb.GetResponseMessageType());
 		break;
 
 	case (unsigned int)DiagnosticTestType::TimeSquareRoot:		// Show the square root calculation time. Caution: may disable interrupt for several tens of microseconds.
@@ -4246,14 +4267,44 @@ GCodeResult Platform::ConfigureStallDetection(GCodeBuffer& gb, const StringRef&
 			break;
 		}
 	}
+	if (gb.Seen('L'))
+	{
+		// Log the load readings of the selected drivers, or all drivers if none were selected
+		seen = true;
+		const uint32_t numEntries = gb.GetLimitedUIValue('L', StallGuardLog::MaxEntries + 1);
+		uint32_t interval = StallGuardLog::DefaultIntervalMillis;
+		bool dummy;
+		gb.TryGetLimitedUIValue('I', interval, dummy, 1001);
+		StallGuardLog::Configure((drivers.IsEmpty()) ? DriversBitmap::MakeLowestNBits(numSmartDrivers) : drivers, numEntries, interval);
+	}
+	if (gb.Seen('Q'))
+	{
+		seen = true;
+		StallGuardLog::SetSummariesToEventLog(gb.GetIValue() > 0);
+	}
+#if SUPPORT_CAN_EXPANSION
+	if (seen)
+	{
+		const GCodeResult rslt = CanInterface::GetSetRemoteDriverStallParameters(canDrivers, gb, reply, buf);
+		if (rslt != GCodeResult::ok)
+		{
+			return rslt;
+		}
+	}
+#endif
+#if HAS_MASS_STORAGE
+	if (gb.Seen('K'))
+	{
+		// Save the log after the other parameters have been applied, including those sent to expansion boards
+		String<MaxFilenameLength> logFileName;
+		gb.GetQuotedString(logFileName.GetRef());
+		return StallGuardLog::WriteToFile(logFileName.c_str(), reply);
+	}
+#endif
 
 	if (seen)
 	{
-#if SUPPORT_CAN_EXPANSION
-		return CanInterface::GetSetRemoteDriverStallParameters(canDrivers, gb, reply, buf);
-#else
 		return GCodeResult::ok;
-#endif
 	}
 
 	// Print the stall status
@@ -4290,6 +4341,9 @@ GCodeResult Platform::ConfigureStallDetection(GCodeBuffer& gb, const StringRef&
 						  );
 			}
 		);
+	reply.Clear();
+	StallGuardLog::AppendStatus(reply);
+	buf->lcat(reply.c_str());
 
 # if SUPPORT_CAN_EXPANSION
 	return CanInterface::GetSetRemoteDriverStallParameters(canDrivers, gb, reply, buf);
@@ -4479,7 +4533,7 @@ void Platform::Tick() noexcept
 	// Because we are in the tick ISR and no other ISR reads the averaging filter, we can cast away 'volatile' here.
 	if (tickState != 0)
 	{
-		ThermistorAveragingFilter& currentFilter = const_cast<ThermistorAveragingFilter&>(adcFilters[currentFilterNumber]);		// cast away 'volatile'
+		ThermistorAdcFilter& currentFilter = const_cast<ThermistorAdcFilter&>(adcFilters[currentFilterNumber]);		// cast away 'volatile'
 		currentFilter.ProcessReading(AnalogInReadChannel(filteredAdcChannels[currentFilterNumber]));
 
 		++currentFilterNumber;
@@ -4499,7 +4553,7 @@ void Platform::Tick() noexcept
 #if !SAME70
 			// We read a filtered ADC channel on alternate ticks
 			// Because we are in the tick ISR and no other ISR reads the averaging filter, we can cast away 'volatile' here.
-			ThermistorAveragingFilter& currentFilter = const_cast<ThermistorAveragingFilter&>(adcFilters[currentFilterNumber]);		// cast away 'volatile'
+			ThermistorAdcFilter& currentFilter = const_cast<ThermistorAdcFilter&>(adcFilters[currentFilterNumber]);		// cast away 'volatile'
 			currentFilter.ProcessReading(AnalogInReadChannel(filteredAdcChannels[currentFilterNumber]));
 
 			++currentFilterNumber;
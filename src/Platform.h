@@ -27,6 +27,7 @@ Licence: GPL
 #include "RepRapFirmware.h"
 #include "ObjectModel/ObjectModel.h"
 #include "Hardware/IoPorts.h"
+#include "Hardware/AdcFilter.h"
 #include "Fans/FansManager.h"
 #include "Heating/TemperatureError.h"
 #include "OutputMemory.h"
@@ -95,7 +96,8 @@ constexpr unsigned int ZProbeAverageReadings = 8;		// We average this number of
 
 // HEATERS - The bed is assumed to be the at index 0
 
-// Define the number of temperature readings we average for each thermistor. This should be a power of 2 and at least 4 ^ AD_OVERSAMPLE_BITS.
+// Define the number of temperature readings we average for each thermistor when using the boxcar filter. This should be a power of 2 and at least 4 ^ AD_OVERSAMPLE_BITS.
+// The output of the other ADC filter types is scaled to match.
 #ifdef SAME70
 // On the SAME70 we read a thermistor on every tick so that we can average a higher number of readings
 // Keep THERMISTOR_AVERAGE_READINGS * NUM_HEATERS * 1ms no greater than HEAT_SAMPLE_TIME or the PIDs won't work well.
@@ -149,7 +151,7 @@ enum class DiagnosticTestType : unsigned int
 {
 	PrintTestReport = 1,			// run some tests and report the processor ID
 
-	PrintMoves = 100,				// print summary of recent moves (only if recording moves was enabled in firmware)
+	PrintMoves = 100,				// print summary of recent moves (only if recording moves was enabled in firmware) and the M595 move trace
 #ifdef DUET_NG
 	PrintExpanderStatus = 101,		// print DueXn expander status
 #endif
@@ -241,7 +243,7 @@ private:
 	//invariant(index < numAveraged)
 };
 
-typedef AveragingFilter<ThermistorAverageReadings> ThermistorAveragingFilter;
+typedef AdcFilter<ThermistorAverageReadings> ThermistorAdcFilter;
 typedef AveragingFilter<ZProbeAverageReadings> ZProbeAveragingFilter;
 
 // Enumeration of error condition bits
@@ -464,7 +466,7 @@ public:
 #endif
 
 	// Heat and temperature
-	volatile ThermistorAveragingFilter& GetAdcFilter(size_t channel) noexcept
+	volatile ThermistorAdcFilter& GetAdcFilter(size_t channel) noexcept
 	pre(channel < ARRAY_SIZE(adcFilters))
 	{
 		return adcFilters[channel];
@@ -576,6 +578,7 @@ protected:
 	DECLARE_OBJECT_MODEL
 	OBJECT_MODEL_ARRAY(axisDrivers)
 	OBJECT_MODEL_ARRAY(workplaceOffsets)
+	OBJECT_MODEL_ARRAY(tasks)
 
 private:
 	const char* InternalGetSysDir() const noexcept;  					// where the system files are - not thread-safe!
@@ -706,7 +709,7 @@ private:
 	GpInputPort gpinPorts[MaxGpInPorts];
 
 	// Thermistors and temperature monitoring
-	volatile ThermistorAveragingFilter adcFilters[NumAdcFilters];	// ADC reading averaging filters
+	volatile ThermistorAdcFilter adcFilters[NumAdcFilters];		// ADC reading filters
 
 #if HAS_CPU_TEMP_SENSOR
 	uint32_t highestMcuTemperature, lowestMcuTemperature;
@@ -0,0 +1,130 @@
+/*
+ * RingLog.cpp
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ */
+
+#include "RingLog.h"
+#include "Platform.h"
+#include "RepRap.h"
+#include "Movement/StepTimer.h"
+
+#if HAS_MASS_STORAGE
+# include "Storage/MassStorage.h"
+#endif
+
+// Set the number of entries, or zero to disable the log.
+// The buffer is kept when the log is disabled or the number of entries is reduced, so turning the log on and off doesn't fragment the heap.
+// It is only replaced when more entries are requested than it holds. That leaves a hole in the heap, so it is best to configure the largest log first.
+void RingLog::Configure(unsigned int num) noexcept
+{
+	const irqflags_t flags = cpu_irq_save();
+	entries = nullptr;											// stop the ISRs and other tasks using the buffer while we change it
+	cpu_irq_restore(flags);
+
+	if (num > allocatedEntries)
+	{
+		delete[] buffer;
+		buffer = new char[num * entrySize];
+		allocatedEntries = num;
+	}
+
+	numEntries = num;
+	numRecorded = 0;
+	if (num != 0)
+	{
+		entries = buffer;
+	}
+}
+
+// Get the sequence number of the oldest record still held
+uint32_t RingLog::GetOldestSequenceNumber() const noexcept
+{
+	const uint32_t total = numRecorded;
+	return (total > numEntries) ? total - numEntries : 0;
+}
+
+// Add a record if the log is enabled
+void RingLog::Add(const void *entry) noexcept
+{
+	const irqflags_t flags = cpu_irq_save();
+	char * const buf = entries;
+	if (buf != nullptr)
+	{
+		memcpy(buf + (numRecorded % numEntries) * entrySize, entry, entrySize);
+		++numRecorded;
+	}
+	cpu_irq_restore(flags);
+}
+
+// Copy the record with the specified sequence number, returning false if it has been overwritten or the log has been disabled
+bool RingLog::GetEntry(uint32_t sequenceNumber, void *entry) const noexcept
+{
+	const irqflags_t flags = cpu_irq_save();
+	const char * const buf = entries;
+	const uint32_t total = numRecorded;
+	const bool ok = buf != nullptr && sequenceNumber < total && total - sequenceNumber <= numEntries;
+	if (ok)
+	{
+		memcpy(entry, buf + (sequenceNumber % numEntries) * entrySize, entrySize);
+	}
+	cpu_irq_restore(flags);
+	return ok;
+}
+
+#if HAS_MASS_STORAGE
+
+// Save the log to a file in binary form, oldest record first. Records may still be added while we do this.
+GCodeResult RingLog::WriteToFile(const char *filename, const char *magic, uint32_t version, uint32_t param, const char *what, const StringRef& reply) const noexcept
+{
+	String<MaxFilenameLength> fullName;
+	reprap.GetPlatform().MakeSysFileName(fullName.GetRef(), filename);
+	FileStore * const f = MassStorage::OpenFile(fullName.c_str(), OpenMode::write, 0);
+	if (f == nullptr)
+	{
+		reply.printf("Failed to create file %s", fullName.c_str());
+		return GCodeResult::error;
+	}
+
+	// Take a snapshot of the number of records. Records may be overwritten while we write the file, in which case we write padding instead.
+	FileHeader hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	SafeStrncpy(hdr.magic, magic, sizeof(hdr.magic));
+	hdr.version = version;
+	hdr.stepClockRate = StepTimer::StepClockRate;
+	hdr.entrySize = entrySize;
+	hdr.numRecorded = numRecorded;
+	hdr.numEntries = min<uint32_t>(hdr.numRecorded, numEntries);
+	hdr.param = param;
+
+	bool ok = f->Write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+	const uint32_t firstSequenceNumber = hdr.numRecorded - hdr.numEntries;
+	uint32_t record[MaxEntrySize/sizeof(uint32_t)];
+	for (uint32_t i = 0; ok && i < hdr.numEntries; ++i)
+	{
+		if (!GetEntry(firstSequenceNumber + i, record))
+		{
+			memset(record, 0, entrySize);						// the record was overwritten or the log was reconfigured while we were writing
+		}
+		ok = f->Write(reinterpret_cast<const char *>(record), entrySize);
+	}
+
+	if (!f->Close())
+	{
+		ok = false;
+	}
+	if (!ok)
+	{
+		MassStorage::Delete(fullName.c_str(), false);
+		reply.printf("Failed to write file %s", fullName.c_str());
+		return GCodeResult::error;
+	}
+
+	reply.printf("%" PRIu32 " %s saved to file %s", hdr.numEntries, what, fullName.c_str());
+	return GCodeResult::ok;
+}
+
+#endif
+
+// End
@@ -0,0 +1,63 @@
+/*
+ * RingLog.h
+ *
+ *  Created on: 18 Oct 2026
+ *      Author: David
+ *
+ *  A ring buffer of fixed size records, used by the move trace, the StallGuard load log and the CAN capture.
+ *  Records are identified by sequence number, counting from zero when the log was configured, and record N is stored at index N modulo the number of entries.
+ *  Records may be added from ISRs and from several tasks, so we disable interrupts while accessing the buffer.
+ *  The buffer is only allocated when the log is enabled, and the log can be saved to a file in binary form with a standard header.
+ */
+
+#ifndef SRC_RINGLOG_H_
+#define SRC_RINGLOG_H_
+
+#include "RepRapFirmware.h"
+#include "GCodes/GCodeResult.h"
+
+class RingLog
+{
+public:
+	// Header of the binary file. The tools that decode the files in Tools/ depend on this layout.
+	struct FileHeader
+	{
+		char magic[8];									// identifies the type of log, null terminated
+		uint32_t version;								// file format version
+		uint32_t stepClockRate;							// step clock frequency in Hz
+		uint32_t entrySize;								// size of each record
+		uint32_t numEntries;							// number of records that follow
+		uint32_t numRecorded;							// total number of records added, which may be greater than numEntries
+		uint32_t param;									// depends on the type of log
+	};
+	static_assert(sizeof(FileHeader) == 32);
+
+	static constexpr size_t MaxEntrySize = 64;			// the largest record size supported
+
+	constexpr RingLog(size_t p_entrySize) noexcept pre(p_entrySize <= MaxEntrySize)
+		: buffer(nullptr), entries(nullptr), entrySize(p_entrySize), numEntries(0), allocatedEntries(0), numRecorded(0) { }
+
+	void Configure(unsigned int num) noexcept;										// Set the number of entries, or zero to disable the log
+	bool IsEnabled() const noexcept { return entries != nullptr; }
+	unsigned int GetNumEntries() const noexcept { return numEntries; }
+	uint32_t GetNumRecorded() const noexcept { return numRecorded; }
+	uint32_t GetOldestSequenceNumber() const noexcept;								// Get the sequence number of the oldest record still held
+
+	void Add(const void *entry) noexcept;											// Add a record if the log is enabled
+	bool GetEntry(uint32_t sequenceNumber, void *entry) const noexcept;				// Copy a record, returning false if it is no longer held
+
+#if HAS_MASS_STORAGE
+	// Save the log to a file, oldest record first. 'what' describes the records for the reply, e.g. "moves".
+	GCodeResult WriteToFile(const char *filename, const char *magic, uint32_t version, uint32_t param, const char *what, const StringRef& reply) const noexcept;
+#endif
+
+private:
+	char *buffer;										// the allocated buffer
+	char * volatile entries;							// the buffer if the log is enabled, else nullptr
+	size_t entrySize;
+	unsigned int numEntries;
+	unsigned int allocatedEntries;
+	volatile uint32_t numRecorded;						// total number of records added since the log was configured
+};
+
+#endif /* SRC_RINGLOG_H_ */
@@ -69,6 +69,26 @@ static Mutex i2cMutex;
 static Mutex sysDirMutex;
 static Mutex mallocMutex;
 
+// CPU usage profiling data. The tick hook samples which task was running at each 1ms tick, so the figures are statistical
+// and any time spent in interrupt handlers is charged to the task that was interrupted.
+constexpr unsigned int MaxProfiledTasks = 16;					// must be at least the number of RTOS tasks including idle and timer tasks
+constexpr uint32_t CpuUsageSampleTicks = 1000;					// length of each sampling period in ticks
+constexpr unsigned int CpuUsageAverageShift = 3;				// each period contributes 1/8 of the rolling average
+
+struct TaskCpuUsage
+{
+	TaskHandle_t handle;
+	uint32_t ticksThisPeriod;									// number of ticks in the current period that this task was running
+	uint32_t ticksLastPeriod;									// number of ticks in the last complete period that this task was running
+	uint32_t scaledAverage;										// rolling average ticks per period, scaled by (1 << CpuUsageAverageShift)
+};
+
+static TaskCpuUsage taskCpuUsage[MaxProfiledTasks];
+static volatile unsigned int numProfiledTasks = 0;
+static uint32_t cpuUsageTicks = 0;
+static uint32_t numUnprofiledTicks = 0;							// ticks we couldn't attribute because the table was full
+static volatile bool profilingTableFull = false;				// set by the tick hook when it had no free entry for a task
+
 // We need to make malloc/free thread safe. We must use a recursive mutex for it.
 extern "C" void __malloc_lock (struct _reent *_r) noexcept
 {
@@ -162,6 +182,11 @@ extern "C" [[noreturn]] void AppMain() noexcept
 	for (;;) { }					// keep gcc happy
 }
 
+namespace Tasks
+{
+	static void FreeDeadProfiledTasks() noexcept;
+}
+
 extern "C" [[noreturn]] void MainTask(void *pvParameters) noexcept
 {
 	mallocMutex.Create("Malloc");
@@ -173,6 +198,10 @@ extern "C" [[noreturn]] void MainTask(void *pvParameters) noexcept
 	for (;;)
 	{
 		reprap.Spin();
+		if (profilingTableFull)
+		{
+			Tasks::FreeDeadProfiledTasks();
+		}
 	}
 }
 
@@ -203,6 +232,62 @@ namespace Tasks
 		return neverUsedRam;
 	}
 
+	// Return the handle of a profiled task if the task still exists, else nullptr.
+	// A task such as the network task may have been deleted since its entry was made, and its entry is only freed when the table fills up or M122 is run.
+	// We mustn't pass the handle of a deleted task to the RTOS, because its TCB may have been freed. So we only return a handle that we find in the task list.
+	static TaskHandle_t GetLiveProfiledTask(unsigned int index) noexcept
+	{
+		if (index >= numProfiledTasks)
+		{
+			return nullptr;
+		}
+
+		const TaskHandle_t handle = taskCpuUsage[index].handle;
+		if (handle == nullptr)
+		{
+			return nullptr;												// the entry is free
+		}
+		if (   handle == (TaskHandle_t)idleTask.GetTaskMemory()			// the idle and timer tasks are created by the RTOS, so they are not in the task list
+#if configUSE_TIMERS
+			|| handle == (TaskHandle_t)timerTask.GetTaskMemory()
+#endif
+		   )
+		{
+			return handle;
+		}
+
+		for (const TaskBase *t = TaskBase::GetTaskList(); t != nullptr; t = t->GetNext())
+		{
+			if (t->GetHandle() == handle)
+			{
+				return handle;
+			}
+		}
+		return nullptr;
+	}
+
+	// Free the profiling table entries of tasks that have been deleted so that the tick hook can reuse them. Must not be called from an ISR.
+	static void FreeDeadProfiledTasks() noexcept
+	{
+		profilingTableFull = false;
+		const unsigned int numTasks = numProfiledTasks;
+		for (unsigned int i = 0; i < numTasks; ++i)
+		{
+			const TaskHandle_t handle = taskCpuUsage[i].handle;
+			if (handle != nullptr && GetLiveProfiledTask(i) == nullptr)
+			{
+				const irqflags_t flags = cpu_irq_save();				// the tick hook may reuse the entry, so check that it hasn't already
+				TaskCpuUsage& tcu = taskCpuUsage[i];
+				if (tcu.handle == handle)
+				{
+					tcu.handle = nullptr;
+					tcu.ticksLastPeriod = tcu.scaledAverage = 0;
+				}
+				cpu_irq_restore(flags);
+			}
+		}
+	}
+
 	// Write data about the current task
 	void Diagnostics(MessageType mtype) noexcept
 	{
@@ -261,6 +346,28 @@ namespace Tasks
 			}
 		}
 		p.MessageF(mtype, "\n");
+
+		// Print the CPU usage of each task for the last sample period and the rolling average
+		FreeDeadProfiledTasks();
+		p.Message(mtype, "CPU usage % (last, average):");
+		const unsigned int numTasks = numProfiledTasks;
+		for (unsigned int i = 0; i < numTasks; ++i)
+		{
+			const TaskHandle_t handle = GetLiveProfiledTask(i);
+			if (handle == nullptr)
+			{
+				continue;											// the task has been deleted
+			}
+			p.MessageF(mtype, " %s(%.1f,%.1f)",
+						pcTaskGetName(handle),
+						(double)((float)taskCpuUsage[i].ticksLastPeriod * (100.0/(float)CpuUsageSampleTicks)),
+						(double)GetProfiledTaskCpuUsage(i));
+		}
+		if (numUnprofiledTicks != 0)
+		{
+			p.MessageF(mtype, " unprofiled ticks %" PRIu32, numUnprofiledTicks);
+		}
+		p.Message(mtype, "\n");
 	}
 
 	const Mutex *GetSpiMutex() noexcept
@@ -277,6 +384,88 @@ namespace Tasks
 	{
 		return &sysDirMutex;
 	}
+
+	// Record which task was running at this tick. Called from the tick interrupt.
+	static void RecordCpuUsage() noexcept
+	{
+		const TaskHandle_t current = xTaskGetCurrentTaskHandle();
+		const unsigned int numTasks = numProfiledTasks;
+		unsigned int i = 0;
+		while (i < numTasks && taskCpuUsage[i].handle != current)
+		{
+			++i;
+		}
+
+		if (i < numTasks)
+		{
+			++taskCpuUsage[i].ticksThisPeriod;
+		}
+		else
+		{
+			// Reuse an entry freed by FreeDeadProfiledTasks if there is one, else add a new entry
+			i = 0;
+			while (i < numTasks && taskCpuUsage[i].handle != nullptr)
+			{
+				++i;
+			}
+			if (i < MaxProfiledTasks)
+			{
+				taskCpuUsage[i].ticksThisPeriod = 1;
+				taskCpuUsage[i].ticksLastPeriod = 0;
+				taskCpuUsage[i].scaledAverage = 0;
+				taskCpuUsage[i].handle = current;
+				if (i == numTasks)
+				{
+					numProfiledTasks = numTasks + 1;			// publish the new entry only after it has been initialised
+				}
+			}
+			else
+			{
+				++numUnprofiledTicks;
+				profilingTableFull = true;						// ask the main task to free the entries of deleted tasks
+			}
+		}
+
+		++cpuUsageTicks;
+		if (cpuUsageTicks == CpuUsageSampleTicks)
+		{
+			cpuUsageTicks = 0;
+			for (unsigned int j = 0; j < numProfiledTasks; ++j)
+			{
+				TaskCpuUsage& tcu = taskCpuUsage[j];
+				const uint32_t ticks = tcu.ticksThisPeriod;
+				tcu.ticksThisPeriod = 0;
+				tcu.ticksLastPeriod = ticks;
+				tcu.scaledAverage = tcu.scaledAverage + ticks - (tcu.scaledAverage >> CpuUsageAverageShift);
+			}
+		}
+	}
+
+	unsigned int GetNumProfiledTasks() noexcept
+	{
+		return numProfiledTasks;
+	}
+
+	const char *GetProfiledTaskName(unsigned int index) noexcept
+	{
+		const TaskHandle_t handle = GetLiveProfiledTask(index);
+		return (handle != nullptr) ? pcTaskGetName(handle) : "(deleted)";
+	}
+
+	// Return the rolling average CPU usage of a task in percent
+	float GetProfiledTaskCpuUsage(unsigned int index) noexcept
+	{
+		return (index < numProfiledTasks)
+				? (float)taskCpuUsage[index].scaledAverage * (100.0/(float)(CpuUsageSampleTicks << CpuUsageAverageShift))
+					: 0.0;
+	}
+
+	// Return the number of bytes of stack that a task has never used
+	uint32_t GetProfiledTaskStackUnused(unsigned int index) noexcept
+	{
+		const TaskHandle_t handle = GetLiveProfiledTask(index);
+		return (handle != nullptr) ? uxTaskGetStackHighWaterMark(handle) * sizeof(StackType_t) : 0;
+	}
 }
 
 // Exception handlers
@@ -286,6 +475,7 @@ extern "C"
 	void vApplicationTickHook() noexcept
 	{
 		CoreSysTick();
+		Tasks::RecordCpuUsage();
 		reprap.Tick();
 	}
 
@@ -19,6 +19,12 @@ namespace Tasks
 	const Mutex *GetSpiMutex() noexcept;
 	const Mutex *GetI2CMutex() noexcept;
 	const Mutex *GetSysDirMutex() noexcept;
+
+	// Per-task CPU usage profiling
+	unsigned int GetNumProfiledTasks() noexcept;
+	const char *GetProfiledTaskName(unsigned int index) noexcept;
+	float GetProfiledTaskCpuUsage(unsigned int index) noexcept;
+	uint32_t GetProfiledTaskStackUnused(unsigned int index) noexcept;
 }
 
 #endif /* SRC_TASKS_H_ */